@@ -7,30 +7,69 @@
 
 #include <benchmark/benchmark.h>
 
+#include <fcntl.h>
 #include <math.h>
 #include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
 #include "google/ads/googleads/v16/services/google_ads_service.upbdefs.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/arena_block_pool.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/descriptor_snapshot.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/io/async_file_stream.h"
+#include "google/protobuf/io/gzip_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/json/json.h"
+#include "google/protobuf/text_format.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "google/protobuf/util/field_mask_util.h"
+#include "google/protobuf/util/message_differencer.h"
+#include "google/protobuf/util/parallel_parse.h"
+#include "google/protobuf/wire_format_lite.h"
 #include "benchmarks/descriptor.pb.h"
 #include "benchmarks/descriptor.upb.h"
 #include "benchmarks/descriptor.upbdefs.h"
 #include "benchmarks/descriptor_sv.pb.h"
+#include "benchmarks/field_kinds.pb.h"
+#include "benchmarks/field_kinds.upb.h"
+#include "benchmarks/packed_varint.pb.h"
 #include "upb/base/string_view.h"
 #include "upb/base/upcast.h"
+#include "upb/io/chunked_input_stream.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/io/zero_copy_output_stream.h"
 #include "upb/json/decode.h"
 #include "upb/json/encode.h"
 #include "upb/mem/arena.h"
+#include "upb/mem/arena.hpp"
+#include "upb/message/message.h"
+#include "upb/message/promote.h"
+#include "upb/mini_table/field.h"
+#include "upb/mini_table/message.h"
 #include "upb/reflection/def.hpp"
 #include "upb/wire/decode.h"
+#include "upb/wire/encode.h"
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+#endif
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+#endif
 
 upb_StringView descriptor =
     benchmarks_descriptor_proto_upbdefinit.descriptor;
@@ -69,6 +108,60 @@ static void BM_ArenaInitialBlockOneAlloc(benchmark::State& state) {
 }
 BENCHMARK(BM_ArenaInitialBlockOneAlloc);
 
+// Like BM_ArenaOneAlloc and BM_ArenaInitialBlockOneAlloc, but reusing one arena
+// with upb_Arena_Reset() instead of creating a new one every iteration.
+static void BM_ArenaResetOneAlloc(benchmark::State& state) {
+  upb_Arena* arena = upb_Arena_New();
+  for (auto _ : state) {
+    upb_Arena_Malloc(arena, 1);
+    upb_Arena_Reset(arena, SIZE_MAX);
+  }
+  upb_Arena_Free(arena);
+}
+BENCHMARK(BM_ArenaResetOneAlloc);
+
+static void BM_ArenaInitialBlockResetOneAlloc(benchmark::State& state) {
+  upb_Arena* arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
+  for (auto _ : state) {
+    upb_Arena_Malloc(arena, 1);
+    upb_Arena_Reset(arena, SIZE_MAX);
+  }
+  upb_Arena_Free(arena);
+}
+BENCHMARK(BM_ArenaInitialBlockResetOneAlloc);
+
+enum BlockPoolMode { NoBlockPool, UseBlockPool };
+
+// Models a server creating an arena per request: parse a request into the
+// arena, then destroy it.
+template <BlockPoolMode PMode>
+static void BM_Proto2ArenaPerRequest(benchmark::State& state) {
+  protobuf::ArenaOptions options;
+  if (PMode == UseBlockPool) {
+    options.block_pool = protobuf::ArenaBlockPool::Default();
+  }
+  absl::string_view input(descriptor.data, descriptor.size);
+  for (auto _ : state) {
+    protobuf::Arena arena(options);
+    auto* proto =
+        protobuf::Arena::Create<upb_benchmark::FileDescriptorProto>(&arena);
+    if (!proto->ParseFromString(input)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  if (PMode == UseBlockPool) {
+    protobuf::ArenaBlockPool::Stats stats =
+        protobuf::ArenaBlockPool::Default()->GetStats();
+    state.counters["pool_hits"] = stats.hits;
+    state.counters["pool_misses"] = stats.misses;
+  }
+}
+BENCHMARK_TEMPLATE(BM_Proto2ArenaPerRequest, NoBlockPool);
+BENCHMARK_TEMPLATE(BM_Proto2ArenaPerRequest, UseBlockPool);
+BENCHMARK_TEMPLATE(BM_Proto2ArenaPerRequest, NoBlockPool)->Threads(4);
+BENCHMARK_TEMPLATE(BM_Proto2ArenaPerRequest, UseBlockPool)->Threads(4);
+
 static void BM_ArenaFuseUnbalanced(benchmark::State& state) {
   std::vector<upb_Arena*> arenas(state.range(0));
   size_t n = 0;
@@ -240,6 +333,47 @@ static void BM_LoadAdsDescriptor_Proto2(benchmark::State& state) {
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, NoLayout);
 BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Proto2, WithLayout);
 
+// Loads the same descriptors from a snapshot, which builds only the files
+// needed by the looked-up message.
+template <LoadDescriptorMode Mode>
+static void BM_LoadAdsDescriptor_Snapshot(benchmark::State& state) {
+  extern _upb_DefPool_Init
+      google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit;
+  std::vector<upb_StringView> serialized_files;
+  absl::flat_hash_set<const _upb_DefPool_Init*> seen_files;
+  CollectFileDescriptors(
+      &google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit,
+      serialized_files, seen_files);
+  protobuf::DescriptorPool source_pool;
+  std::vector<const protobuf::FileDescriptor*> files;
+  for (auto file : serialized_files) {
+    protobuf::FileDescriptorProto proto;
+    ABSL_CHECK(proto.ParseFromArray(file.data, file.size));
+    files.push_back(source_pool.BuildFile(proto));
+    ABSL_CHECK(files.back() != nullptr);
+  }
+  const std::string data = protobuf::SerializeDescriptorSnapshot(files);
+
+  for (auto _ : state) {
+    auto snapshot = protobuf::DescriptorPoolSnapshot::FromBuffer(data);
+    ABSL_CHECK_OK(snapshot.status());
+    const protobuf::Descriptor* d =
+        (*snapshot)->pool()->FindMessageTypeByName(
+            "google.ads.googleads.v16.services.SearchGoogleAdsResponse");
+    if (!d) {
+      printf("Failed to find descriptor.\n");
+      exit(1);
+    }
+    if (Mode == WithLayout) {
+      protobuf::DynamicMessageFactory factory;
+      factory.GetPrototype(d);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Snapshot, NoLayout);
+BENCHMARK_TEMPLATE(BM_LoadAdsDescriptor_Snapshot, WithLayout);
+
 enum CopyStrings {
   Copy,
   Alias,
@@ -249,14 +383,19 @@ enum ArenaMode {
   NoArena,
   UseArena,
   InitBlock,
+  // One arena for all iterations, reset with upb_Arena_Reset() after each.
+  ResetArena,
 };
 
 template <ArenaMode AMode, CopyStrings Copy>
 static void BM_Parse_Upb_FileDesc(benchmark::State& state) {
+  upb_Arena* reused = AMode == ResetArena ? upb_Arena_New() : nullptr;
   for (auto _ : state) {
     upb_Arena* arena;
     if (AMode == InitBlock) {
       arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
+    } else if (AMode == ResetArena) {
+      arena = reused;
     } else {
       arena = upb_Arena_New();
     }
@@ -268,14 +407,70 @@ static void BM_Parse_Upb_FileDesc(benchmark::State& state) {
       printf("Failed to parse.\n");
       exit(1);
     }
-    upb_Arena_Free(arena);
+    if (AMode == ResetArena) {
+      upb_Arena_Reset(arena, SIZE_MAX);
+    } else {
+      upb_Arena_Free(arena);
+    }
   }
+  if (reused) upb_Arena_Free(reused);
   state.SetBytesProcessed(state.iterations() * descriptor.size);
 }
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, UseArena, Alias);
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, InitBlock, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, InitBlock, Alias);
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, ResetArena, Copy);
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FileDesc, ResetArena, Alias);
+
+enum SubMessageParsing { Eager, Lazy };
+
+// Parses and re-serializes descriptor.proto like a proxy would handle an
+// envelope: only the file's name and package are read, while the messages,
+// enums, services, extensions, and options it carries are passed through.
+// Lazy leaves those fields unparsed with
+// kUpb_DecodeOption_ExperimentalLazyUnlinked, so they are copied through as
+// bytes.
+template <SubMessageParsing kParsing>
+static void BM_ParseSerialize_Upb_Envelope(benchmark::State& state) {
+  const upb_MiniTable* mini_table =
+      &upb_0benchmark__FileDescriptorProto_msg_init;
+  const upb_MiniTable* decode_table = mini_table;
+  int options = kUpb_DecodeOption_AliasString;
+  upb::Arena table_arena;
+  if (kParsing == Lazy) {
+    std::vector<const upb_MiniTableField*> payload;
+    for (int number : {4, 5, 6, 7, 8, 9}) {
+      payload.push_back(upb_MiniTable_FindFieldByNumber(mini_table, number));
+    }
+    decode_table = upb_MiniTable_CopyWithLazyFields(
+        mini_table, payload.data(), payload.size(), table_arena.ptr());
+    options |= kUpb_DecodeOption_ExperimentalLazyUnlinked;
+  }
+  for (auto _ : state) {
+    upb_Arena* arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
+    upb_Message* msg = upb_Message_New(mini_table, arena);
+    if (upb_Decode(descriptor.data, descriptor.size, msg, decode_table,
+                   nullptr, options, arena) != kUpb_DecodeStatus_Ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    benchmark::DoNotOptimize(upb_benchmark_FileDescriptorProto_package(
+        reinterpret_cast<upb_benchmark_FileDescriptorProto*>(msg)));
+    char* serialized;
+    size_t size;
+    if (upb_Encode(msg, mini_table, 0, arena, &serialized, &size) !=
+        kUpb_EncodeStatus_Ok) {
+      printf("Failed to serialize.\n");
+      exit(1);
+    }
+    benchmark::DoNotOptimize(serialized);
+    upb_Arena_Free(arena);
+  }
+  state.SetBytesProcessed(state.iterations() * descriptor.size);
+}
+BENCHMARK_TEMPLATE(BM_ParseSerialize_Upb_Envelope, Eager);
+BENCHMARK_TEMPLATE(BM_ParseSerialize_Upb_Envelope, Lazy);
 
 template <ArenaMode AMode, class P>
 struct Proto2Factory;
@@ -341,6 +536,533 @@ BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, UseArena, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDesc, InitBlock, Copy);
 BENCHMARK_TEMPLATE(BM_Parse_Proto2, FileDescSV, InitBlock, Alias);
 
+enum FieldKind {
+  ClosedEnumField,
+  OneofMessageField,
+  HighFieldNumberField,
+  MapField,
+};
+
+// Parses `state.range(0)` records which hold one kind of field each, to
+// compare how fast upb decodes the different field kinds.
+template <FieldKind kKind>
+static void BM_Parse_Upb_FieldKind(benchmark::State& state) {
+  const int count = state.range(0);
+  upb_benchmark::FieldKindRecords records;
+  for (int i = 0; i < count; ++i) {
+    switch (kKind) {
+      case ClosedEnumField: {
+        upb_benchmark::ClosedEnumRecord* record = records.add_closed_enum();
+        record->set_color(static_cast<upb_benchmark::Color>(i % 3));
+        for (int j = 0; j < 4; ++j) {
+          record->add_colors(static_cast<upb_benchmark::Color>((i + j) % 3));
+        }
+        break;
+      }
+      case OneofMessageField: {
+        upb_benchmark::OneofRecord* record = records.add_oneof();
+        if (i % 2 == 0) {
+          record->mutable_leaf()->set_id(i);
+          record->mutable_leaf()->set_value(int64_t{i} * 1000);
+        } else {
+          record->mutable_other()->set_value(i);
+        }
+        break;
+      }
+      case HighFieldNumberField: {
+        upb_benchmark::HighFieldNumberRecord* record =
+            records.add_high_field_number();
+        record->set_value(i);
+        record->set_name(absl::StrCat("record ", i));
+        record->add_counts(i);
+        record->add_counts(i + 1);
+        break;
+      }
+      case MapField: {
+        auto& counts = *records.add_map()->mutable_counts();
+        for (int j = 0; j < 4; ++j) counts[absl::StrCat("key", j)] = i + j;
+        break;
+      }
+    }
+  }
+  std::string serialized = records.SerializeAsString();
+
+  for (auto _ : state) {
+    upb_Arena* arena = upb_Arena_New();
+    upb_benchmark_FieldKindRecords* parsed =
+        upb_benchmark_FieldKindRecords_parse(serialized.data(),
+                                             serialized.size(), arena);
+    if (!parsed) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    upb_Arena_Free(arena);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FieldKind, ClosedEnumField)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FieldKind, OneofMessageField)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FieldKind, HighFieldNumberField)->Arg(1000);
+BENCHMARK_TEMPLATE(BM_Parse_Upb_FieldKind, MapField)->Arg(1000);
+
+enum PackedVarintKind { UInt32, UInt64, SInt32, SInt64 };
+
+// Parses a single packed field of `state.range(0)` elements whose encoded
+// lengths are spread uniformly over [1, state.range(1)] bytes (capped by the
+// width of the field type).
+template <PackedVarintKind kKind>
+static void BM_ParsePackedVarint_Proto2(benchmark::State& state) {
+  const int count = state.range(0);
+  const int max_len = state.range(1);
+  const bool is_64 = kKind == UInt64 || kKind == SInt64;
+  std::mt19937_64 rng(count * max_len);
+  upb_benchmark::PackedVarints proto;
+  for (int i = 0; i < count; ++i) {
+    int len = 1 + static_cast<int>(rng() % max_len);
+    int bits = std::min(7 * len, is_64 ? 64 : 32);
+    // The wire value: `bits` wide with its top bit set.
+    uint64_t wire = (rng() >> (64 - bits)) | (uint64_t{1} << (bits - 1));
+    switch (kKind) {
+      case UInt32:
+        proto.add_uint32_values(static_cast<uint32_t>(wire));
+        break;
+      case UInt64:
+        proto.add_uint64_values(wire);
+        break;
+      case SInt32:
+        proto.add_sint32_values(
+            protobuf::internal::WireFormatLite::ZigZagDecode32(
+                static_cast<uint32_t>(wire)));
+        break;
+      case SInt64:
+        proto.add_sint64_values(
+            protobuf::internal::WireFormatLite::ZigZagDecode64(wire));
+        break;
+    }
+  }
+  std::string serialized = proto.SerializeAsString();
+
+  upb_benchmark::PackedVarints parsed;
+  for (auto _ : state) {
+    if (!parsed.ParseFromString(serialized)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, UInt32)
+    ->ArgsProduct({{10000, 100000}, {1, 2, 3, 5}});
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, UInt64)
+    ->ArgsProduct({{10000, 100000}, {1, 2, 5, 10}});
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, SInt32)
+    ->ArgsProduct({{10000, 100000}, {1, 2, 3, 5}});
+BENCHMARK_TEMPLATE(BM_ParsePackedVarint_Proto2, SInt64)
+    ->ArgsProduct({{10000, 100000}, {1, 2, 5, 10}});
+
+// Parses a FileDescriptorSet holding many copies of descriptor.proto, with the
+// `file` elements spread over `state.range(0)` threads.
+template <ArenaMode AMode>
+static void BM_ParallelParse_Proto2(benchmark::State& state) {
+  constexpr int kNumFiles = 2000;
+  upb_benchmark::FileDescriptorSet set;
+  absl::string_view input(descriptor.data, descriptor.size);
+  for (int i = 0; i < kNumFiles; ++i) {
+    if (!set.add_file()->ParseFromString(input)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  const std::string serialized = set.SerializeAsString();
+
+  protobuf::util::ParallelParseOptions options;
+  options.field =
+      upb_benchmark::FileDescriptorSet::descriptor()->FindFieldByName("file");
+  options.num_threads = state.range(0);
+  for (auto _ : state) {
+    Proto2Factory<AMode, upb_benchmark::FileDescriptorSet> proto_factory;
+    auto proto = proto_factory.GetProto();
+    if (!protobuf::util::ParseFromStringInParallel(serialized, proto,
+                                                   options)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK_TEMPLATE(BM_ParallelParse_Proto2, NoArena)
+    ->RangeMultiplier(2)
+    ->Range(1, 32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ParallelParse_Proto2, UseArena)
+    ->RangeMultiplier(2)
+    ->Range(1, 32)
+    ->UseRealTime();
+
+enum FileStreamMode { PlainFile, MmapFile, AsyncFile };
+
+// The delimited file benchmarks write to TEST_TMPDIR, so that they can be
+// pointed at tmpfs or at a local disk.
+std::string DelimitedFilePath(FileStreamMode mode) {
+  const char* tmpdir = getenv("TEST_TMPDIR");
+  return absl::StrCat(tmpdir != nullptr ? tmpdir : "/tmp",
+                      "/benchmark_delimited_", mode);
+}
+
+constexpr int kNumDelimitedMessages = 2000;
+
+// Writes length-delimited copies of descriptor.proto to disk, through either
+// FileOutputStream or AsyncFileOutputStream.
+template <FileStreamMode Mode>
+static void BM_SerializeDelimitedFile_Proto2(benchmark::State& state) {
+  const std::string path = DelimitedFilePath(Mode);
+  FileDesc message;
+  if (!message.ParseFromArray(descriptor.data, descriptor.size)) {
+    printf("Failed to parse.\n");
+    exit(1);
+  }
+  int64_t file_size = 0;
+  for (auto _ : state) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ABSL_CHECK_GE(fd, 0);
+    if (Mode == PlainFile) {
+      protobuf::io::FileOutputStream output(fd);
+      for (int i = 0; i < kNumDelimitedMessages; ++i) {
+        ABSL_CHECK(protobuf::util::SerializeDelimitedToZeroCopyStream(
+            message, &output));
+      }
+      ABSL_CHECK(output.Close());
+      file_size = output.ByteCount();
+    } else {
+      protobuf::io::AsyncFileOutputStream output(fd);
+      for (int i = 0; i < kNumDelimitedMessages; ++i) {
+        ABSL_CHECK(protobuf::util::SerializeDelimitedToZeroCopyStream(
+            message, &output));
+      }
+      ABSL_CHECK(output.Close());
+      file_size = output.ByteCount();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * file_size);
+  unlink(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_SerializeDelimitedFile_Proto2, PlainFile);
+BENCHMARK_TEMPLATE(BM_SerializeDelimitedFile_Proto2, AsyncFile);
+
+// Reads a file of length-delimited copies of descriptor.proto back from disk,
+// through FileInputStream, MmapInputStream or AsyncFileInputStream.
+template <FileStreamMode Mode>
+static void BM_ParseDelimitedFile_Proto2(benchmark::State& state) {
+  const std::string path = DelimitedFilePath(Mode);
+  FileDesc message;
+  if (!message.ParseFromArray(descriptor.data, descriptor.size)) {
+    printf("Failed to parse.\n");
+    exit(1);
+  }
+  int64_t file_size;
+  {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ABSL_CHECK_GE(fd, 0);
+    protobuf::io::FileOutputStream output(fd);
+    output.SetCloseOnDelete(true);
+    for (int i = 0; i < kNumDelimitedMessages; ++i) {
+      ABSL_CHECK(
+          protobuf::util::SerializeDelimitedToZeroCopyStream(message, &output));
+    }
+    ABSL_CHECK(output.Flush());
+    file_size = output.ByteCount();
+  }
+
+  for (auto _ : state) {
+    int fd = open(path.c_str(), O_RDONLY);
+    ABSL_CHECK_GE(fd, 0);
+    std::unique_ptr<protobuf::io::ZeroCopyInputStream> input;
+    switch (Mode) {
+      case PlainFile:
+        input = std::make_unique<protobuf::io::FileInputStream>(fd);
+        break;
+      case MmapFile:
+        input = std::make_unique<protobuf::io::MmapInputStream>(fd);
+        break;
+      case AsyncFile:
+        input = std::make_unique<protobuf::io::AsyncFileInputStream>(fd);
+        break;
+    }
+    bool clean_eof = false;
+    int count = 0;
+    while (protobuf::util::ParseDelimitedFromZeroCopyStream(
+        &message, input.get(), &clean_eof)) {
+      ++count;
+    }
+    ABSL_CHECK(clean_eof);
+    ABSL_CHECK_EQ(count, kNumDelimitedMessages);
+    input.reset();
+    close(fd);
+  }
+  state.SetBytesProcessed(state.iterations() * file_size);
+  unlink(path.c_str());
+}
+BENCHMARK_TEMPLATE(BM_ParseDelimitedFile_Proto2, PlainFile);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedFile_Proto2, MmapFile);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedFile_Proto2, AsyncFile);
+
+enum DelimitedApi {
+  // ParseDelimitedFromZeroCopyStream() and
+  // SerializeDelimitedToZeroCopyStream(), one message at a time.
+  PerMessage,
+  // DelimitedMessageReader and DelimitedMessageWriter.
+  Batched,
+};
+
+constexpr int kNumSmallRecords = 1 << 20;
+
+// Returns kNumSmallRecords small messages, which cycle through the fields of
+// descriptor.proto.
+std::vector<const protobuf::MessageLite*> SmallRecords() {
+  static const auto* fields = [] {
+    FileDesc file;
+    if (!file.ParseFromArray(descriptor.data, descriptor.size)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    auto* fields = new std::vector<upb_benchmark::FieldDescriptorProto>;
+    for (const auto& message : file.message_type()) {
+      for (const auto& field : message.field()) fields->push_back(field);
+    }
+    return fields;
+  }();
+  std::vector<const protobuf::MessageLite*> records;
+  records.reserve(kNumSmallRecords);
+  for (int i = 0; i < kNumSmallRecords; ++i) {
+    records.push_back(&(*fields)[i % fields->size()]);
+  }
+  return records;
+}
+
+template <DelimitedApi Api>
+static void BM_SerializeDelimitedSmall_Proto2(benchmark::State& state) {
+  const std::vector<const protobuf::MessageLite*> records = SmallRecords();
+  std::string data;
+  for (auto _ : state) {
+    data.clear();
+    protobuf::io::StringOutputStream output(&data);
+    if (Api == PerMessage) {
+      for (const protobuf::MessageLite* record : records) {
+        ABSL_CHECK(protobuf::util::SerializeDelimitedToZeroCopyStream(
+            *record, &output));
+      }
+    } else {
+      protobuf::util::DelimitedMessageWriter writer(&output);
+      absl::Span<const protobuf::MessageLite* const> remaining(records);
+      while (!remaining.empty()) {
+        auto batch = remaining.subspan(0, 256);
+        ABSL_CHECK(writer.WriteBatch(batch));
+        remaining.remove_prefix(batch.size());
+      }
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.SetItemsProcessed(state.iterations() * records.size());
+}
+BENCHMARK_TEMPLATE(BM_SerializeDelimitedSmall_Proto2, PerMessage);
+BENCHMARK_TEMPLATE(BM_SerializeDelimitedSmall_Proto2, Batched);
+
+template <DelimitedApi Api>
+static void BM_ParseDelimitedSmall_Proto2(benchmark::State& state) {
+  std::string data;
+  {
+    protobuf::io::StringOutputStream output(&data);
+    protobuf::util::DelimitedMessageWriter writer(&output);
+    ABSL_CHECK(writer.WriteBatch(SmallRecords()));
+  }
+  for (auto _ : state) {
+    protobuf::io::ArrayInputStream input(data.data(), data.size());
+    bool clean_eof = false;
+    int count = 0;
+    if (Api == PerMessage) {
+      upb_benchmark::FieldDescriptorProto message;
+      while (protobuf::util::ParseDelimitedFromZeroCopyStream(
+          &message, &input, &clean_eof)) {
+        ++count;
+      }
+    } else {
+      protobuf::util::DelimitedMessageReader reader(
+          &input, &upb_benchmark::FieldDescriptorProto::default_instance());
+      for (auto batch = reader.NextBatch(); !batch.empty();
+           batch = reader.NextBatch()) {
+        count += static_cast<int>(batch.size());
+      }
+      clean_eof = reader.clean_eof();
+    }
+    ABSL_CHECK(clean_eof);
+    ABSL_CHECK_EQ(count, kNumSmallRecords);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.SetItemsProcessed(state.iterations() * kNumSmallRecords);
+}
+BENCHMARK_TEMPLATE(BM_ParseDelimitedSmall_Proto2, PerMessage);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedSmall_Proto2, Batched);
+
+// Zstd and Lz4 are only benchmarked when built with
+// --//src/google/protobuf/io:zstd and --//src/google/protobuf/io:lz4.
+enum CompressionCodec { Gzip, Zstd, Lz4 };
+enum CompressionPayload {
+  // Copies of descriptor.proto, which is mostly short strings.
+  DescriptorPayload,
+  // Random packed varints, which compress poorly.
+  PackedVarintPayload,
+};
+
+// Returns the payload as length-delimited messages.
+std::string CompressionPayloadData(CompressionPayload payload) {
+  std::string data;
+  protobuf::io::StringOutputStream output(&data);
+  if (payload == DescriptorPayload) {
+    FileDesc message;
+    if (!message.ParseFromArray(descriptor.data, descriptor.size)) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+    for (int i = 0; i < kNumDelimitedMessages; ++i) {
+      ABSL_CHECK(
+          protobuf::util::SerializeDelimitedToZeroCopyStream(message, &output));
+    }
+  } else {
+    std::mt19937_64 rng(kNumDelimitedMessages);
+    upb_benchmark::PackedVarints message;
+    for (int i = 0; i < kNumDelimitedMessages; ++i) {
+      message.Clear();
+      for (int j = 0; j < 1000; ++j) {
+        message.add_uint64_values(rng() >> (rng() % 64));
+      }
+      ABSL_CHECK(
+          protobuf::util::SerializeDelimitedToZeroCopyStream(message, &output));
+    }
+  }
+  return data;
+}
+
+std::unique_ptr<protobuf::io::ZeroCopyOutputStream> NewCompressingStream(
+    CompressionCodec codec, protobuf::io::ZeroCopyOutputStream* output) {
+  switch (codec) {
+    case Gzip:
+      return std::make_unique<protobuf::io::GzipOutputStream>(output);
+#if HAVE_ZSTD
+    case Zstd:
+      return std::make_unique<protobuf::io::ZstdOutputStream>(output);
+#endif
+#if HAVE_LZ4
+    case Lz4:
+      return std::make_unique<protobuf::io::Lz4OutputStream>(output);
+#endif
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+std::unique_ptr<protobuf::io::ZeroCopyInputStream> NewDecompressingStream(
+    CompressionCodec codec, protobuf::io::ZeroCopyInputStream* input) {
+  switch (codec) {
+    case Gzip:
+      return std::make_unique<protobuf::io::GzipInputStream>(input);
+#if HAVE_ZSTD
+    case Zstd:
+      return std::make_unique<protobuf::io::ZstdInputStream>(input);
+#endif
+#if HAVE_LZ4
+    case Lz4:
+      return std::make_unique<protobuf::io::Lz4InputStream>(input);
+#endif
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+// Compresses `data` into `compressed` through the codec's output stream.
+void Compress(CompressionCodec codec, absl::string_view data,
+              std::string* compressed) {
+  protobuf::io::StringOutputStream output(compressed);
+  auto stream = NewCompressingStream(codec, &output);
+  void* buffer;
+  int size;
+  while (!data.empty()) {
+    ABSL_CHECK(stream->Next(&buffer, &size));
+    const int n = std::min<size_t>(size, data.size());
+    memcpy(buffer, data.data(), n);
+    stream->BackUp(size - n);
+    data.remove_prefix(n);
+  }
+}
+
+// Compresses the payload with each codec at its default level, reporting the
+// uncompressed throughput and the compression ratio.
+template <CompressionCodec Codec, CompressionPayload Payload>
+static void BM_Compress(benchmark::State& state) {
+  const std::string data = CompressionPayloadData(Payload);
+  std::string compressed;
+  for (auto _ : state) {
+    compressed.clear();
+    Compress(Codec, data, &compressed);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.counters["ratio"] =
+      static_cast<double>(data.size()) / compressed.size();
+}
+BENCHMARK_TEMPLATE(BM_Compress, Gzip, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_Compress, Gzip, PackedVarintPayload);
+#if HAVE_ZSTD
+BENCHMARK_TEMPLATE(BM_Compress, Zstd, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_Compress, Zstd, PackedVarintPayload);
+#endif
+#if HAVE_LZ4
+BENCHMARK_TEMPLATE(BM_Compress, Lz4, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_Compress, Lz4, PackedVarintPayload);
+#endif
+
+// Parses the compressed payload back through each codec's input stream.
+template <CompressionCodec Codec, CompressionPayload Payload>
+static void BM_ParseDelimitedCompressed_Proto2(benchmark::State& state) {
+  const std::string data = CompressionPayloadData(Payload);
+  std::string compressed;
+  Compress(Codec, data, &compressed);
+  FileDesc descriptor_message;
+  upb_benchmark::PackedVarints varint_message;
+  protobuf::Message* message = &varint_message;
+  if (Payload == DescriptorPayload) message = &descriptor_message;
+  for (auto _ : state) {
+    protobuf::io::ArrayInputStream input(compressed.data(), compressed.size());
+    auto stream = NewDecompressingStream(Codec, &input);
+    bool clean_eof = false;
+    int count = 0;
+    while (protobuf::util::ParseDelimitedFromZeroCopyStream(
+        message, stream.get(), &clean_eof)) {
+      ++count;
+    }
+    ABSL_CHECK(clean_eof);
+    ABSL_CHECK_EQ(count, kNumDelimitedMessages);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.counters["ratio"] =
+      static_cast<double>(data.size()) / compressed.size();
+}
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Gzip, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Gzip,
+                   PackedVarintPayload);
+#if HAVE_ZSTD
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Zstd, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Zstd,
+                   PackedVarintPayload);
+#endif
+#if HAVE_LZ4
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Lz4, DescriptorPayload);
+BENCHMARK_TEMPLATE(BM_ParseDelimitedCompressed_Proto2, Lz4,
+                   PackedVarintPayload);
+#endif
+
 static void BM_SerializeDescriptor_Proto2(benchmark::State& state) {
   upb_benchmark::FileDescriptorProto proto;
   proto.ParseFromArray(descriptor.data, descriptor.size);
@@ -362,15 +1084,15 @@ static upb_benchmark_FileDescriptorProto* UpbParseDescriptor(upb_Arena* arena) {
   return set;
 }
 
-static void BM_SerializeDescriptor_Upb(benchmark::State& state) {
+static void SerializeDescriptorUpb(benchmark::State& state, int options) {
   int64_t total = 0;
   upb_Arena* arena = upb_Arena_New();
   upb_benchmark_FileDescriptorProto* set = UpbParseDescriptor(arena);
   for (auto _ : state) {
     upb_Arena* enc_arena = upb_Arena_Init(buf, sizeof(buf), nullptr);
     size_t size;
-    char* data =
-        upb_benchmark_FileDescriptorProto_serialize(set, enc_arena, &size);
+    char* data = upb_benchmark_FileDescriptorProto_serialize_ex(
+        set, options, enc_arena, &size);
     if (!data) {
       printf("Failed to serialize.\n");
       exit(1);
@@ -379,8 +1101,150 @@ static void BM_SerializeDescriptor_Upb(benchmark::State& state) {
   }
   state.SetBytesProcessed(total);
 }
+
+static void BM_SerializeDescriptor_Upb(benchmark::State& state) {
+  SerializeDescriptorUpb(state, 0);
+}
 BENCHMARK(BM_SerializeDescriptor_Upb);
 
+static void BM_SerializeDescriptor_Upb_PrecomputeSizes(
+    benchmark::State& state) {
+  SerializeDescriptorUpb(state, kUpb_EncodeOption_PrecomputeSizes);
+}
+BENCHMARK(BM_SerializeDescriptor_Upb_PrecomputeSizes);
+
+// Returns a FileDescriptorSet holding `count` copies of descriptor.proto.
+static upb_benchmark_FileDescriptorSet* UpbNewDescriptorSet(int count,
+                                                            upb_Arena* arena) {
+  upb_benchmark_FileDescriptorSet* set =
+      upb_benchmark_FileDescriptorSet_new(arena);
+  for (int i = 0; i < count; i++) {
+    upb_benchmark_FileDescriptorProto* file =
+        upb_benchmark_FileDescriptorSet_add_file(set, arena);
+    if (upb_Decode(descriptor.data, descriptor.size, UPB_UPCAST(file),
+                   &upb_0benchmark__FileDescriptorProto_msg_init, nullptr, 0,
+                   arena) != kUpb_DecodeStatus_Ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  return set;
+}
+
+// Serializes a FileDescriptorSet holding `state.range(0)` copies of
+// descriptor.proto into a fresh arena, which is where the one-pass encoder
+// copies the most as it grows its buffer.
+template <int kOptions>
+static void BM_SerializeDescriptorSet_Upb(benchmark::State& state) {
+  upb::Arena arena;
+  upb_benchmark_FileDescriptorSet* set =
+      UpbNewDescriptorSet(state.range(0), arena.ptr());
+  int64_t total = 0;
+  for (auto _ : state) {
+    upb::Arena enc_arena;
+    size_t size;
+    char* data = upb_benchmark_FileDescriptorSet_serialize_ex(
+        set, kOptions, enc_arena.ptr(), &size);
+    if (!data) {
+      printf("Failed to serialize.\n");
+      exit(1);
+    }
+    total += size;
+  }
+  state.SetBytesProcessed(total);
+}
+BENCHMARK_TEMPLATE(BM_SerializeDescriptorSet_Upb, 0)->Arg(1)->Arg(64);
+BENCHMARK_TEMPLATE(BM_SerializeDescriptorSet_Upb,
+                   kUpb_EncodeOption_PrecomputeSizes)
+    ->Arg(1)
+    ->Arg(64);
+
+// An output stream that hands out the same buffer over and over, like one
+// that sends each buffer over the network before returning the next.
+struct UpbDiscardingOutputStream {
+  UpbDiscardingOutputStream() : base{&kVTable} {}
+
+  static void* Next(upb_ZeroCopyOutputStream* z, size_t* count,
+                    upb_Status* status) {
+    auto* s = reinterpret_cast<UpbDiscardingOutputStream*>(z);
+    *count = sizeof(s->buf);
+    s->byte_count += sizeof(s->buf);
+    return s->buf;
+  }
+  static void BackUp(upb_ZeroCopyOutputStream* z, size_t count) {
+    reinterpret_cast<UpbDiscardingOutputStream*>(z)->byte_count -= count;
+  }
+  static size_t ByteCount(const upb_ZeroCopyOutputStream* z) {
+    return reinterpret_cast<const UpbDiscardingOutputStream*>(z)->byte_count;
+  }
+  static constexpr _upb_ZeroCopyOutputStream_VTable kVTable = {
+      &Next, &BackUp, &ByteCount};
+
+  upb_ZeroCopyOutputStream base;
+  size_t byte_count = 0;
+  char buf[64 << 10];
+};
+
+static void BM_SerializeDescriptorSet_Upb_Stream(benchmark::State& state) {
+  upb::Arena arena;
+  upb_benchmark_FileDescriptorSet* set =
+      UpbNewDescriptorSet(state.range(0), arena.ptr());
+  int64_t total = 0;
+  for (auto _ : state) {
+    UpbDiscardingOutputStream output;
+    if (upb_EncodeToStream(UPB_UPCAST(set),
+                           &upb_0benchmark__FileDescriptorSet_msg_init, 0,
+                           &output.base) != kUpb_EncodeStatus_Ok) {
+      printf("Failed to serialize.\n");
+      exit(1);
+    }
+    total += output.byte_count;
+  }
+  state.SetBytesProcessed(total);
+}
+BENCHMARK(BM_SerializeDescriptorSet_Upb_Stream)->Arg(1)->Arg(64);
+
+enum UpbInput { kFlatInput, kStreamInput };
+
+// Parses a FileDescriptorSet holding `state.range(0)` copies of
+// descriptor.proto, either from one flat buffer or from a stream of 64 KiB
+// buffers.
+template <UpbInput kInput>
+static void BM_ParseDescriptorSet_Upb(benchmark::State& state) {
+  std::string data;
+  {
+    upb::Arena arena;
+    size_t size;
+    char* buf = upb_benchmark_FileDescriptorSet_serialize(
+        UpbNewDescriptorSet(state.range(0), arena.ptr()), arena.ptr(), &size);
+    data.assign(buf, size);
+  }
+  for (auto _ : state) {
+    upb::Arena arena;
+    upb_benchmark_FileDescriptorSet* set =
+        upb_benchmark_FileDescriptorSet_new(arena.ptr());
+    upb_DecodeStatus status;
+    if (kInput == kFlatInput) {
+      status = upb_Decode(data.data(), data.size(), UPB_UPCAST(set),
+                          &upb_0benchmark__FileDescriptorSet_msg_init, nullptr,
+                          0, arena.ptr());
+    } else {
+      upb_ZeroCopyInputStream* input = upb_ChunkedInputStream_New(
+          data.data(), data.size(), 64 << 10, arena.ptr());
+      status = upb_DecodeFromStream(input, UPB_UPCAST(set),
+                                    &upb_0benchmark__FileDescriptorSet_msg_init,
+                                    nullptr, 0, arena.ptr());
+    }
+    if (status != kUpb_DecodeStatus_Ok) {
+      printf("Failed to parse.\n");
+      exit(1);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(BM_ParseDescriptorSet_Upb, kFlatInput)->Arg(1)->Arg(64);
+BENCHMARK_TEMPLATE(BM_ParseDescriptorSet_Upb, kStreamInput)->Arg(1)->Arg(64);
+
 static absl::string_view UpbJsonEncode(upb_benchmark_FileDescriptorProto* proto,
                                        const upb_MessageDef* md,
                                        upb_Arena* arena) {
@@ -432,6 +1296,381 @@ static void BM_JsonParse_Proto2(benchmark::State& state) {
 }
 BENCHMARK(BM_JsonParse_Proto2);
 
+// A document dominated by string values, mostly ASCII with some multibyte
+// characters and escapes, like free-form text.
+static void BM_JsonParse_Proto2_Strings(benchmark::State& state) {
+  protobuf::SourceCodeInfo proto;
+  for (int i = 0; i < 2000; ++i) {
+    auto* location = proto.add_location();
+    location->set_leading_comments(absl::StrCat(
+        " Returns the ", i, "th entry of the caf\xc3\xa9 menu, priced in ",
+        "\xe2\x82\xac; see \"menu.proto\" for the full list.\n"));
+    location->set_trailing_comments(" Never empty.\n");
+  }
+  std::string json;
+  ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &json));
+  for (auto _ : state) {
+    protobuf::SourceCodeInfo parsed;
+    ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &parsed));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParse_Proto2_Strings);
+
+// A document dominated by numbers.
+static void BM_JsonParse_Proto2_Numbers(benchmark::State& state) {
+  upb_benchmark::PackedVarints proto;
+  std::mt19937 rng(0);
+  for (int i = 0; i < 10000; ++i) {
+    proto.add_int32_values(static_cast<int32_t>(rng()) >> (rng() % 32));
+    proto.add_uint32_values(rng() >> (rng() % 32));
+    proto.add_sint32_values(-static_cast<int32_t>(rng() % 1000));
+  }
+  std::string json;
+  ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &json));
+  for (auto _ : state) {
+    upb_benchmark::PackedVarints parsed;
+    ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &parsed));
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK(BM_JsonParse_Proto2_Numbers);
+
+enum JsonStreamFormat {
+  // One FileDescriptorSet holding every file, parsed as a single document.
+  Document,
+  // A JSON array of files, read with JsonMessageReader.
+  Array,
+  // Newline-delimited files, read with JsonMessageReader.
+  Delimited,
+};
+
+// Parses many copies of the same file, as found in large JSON exports.
+template <JsonStreamFormat Format>
+static void BM_JsonParse_Proto2_Stream(benchmark::State& state) {
+  constexpr int kNumFiles = 256;
+  protobuf::FileDescriptorProto proto;
+  absl::string_view input(descriptor.data, descriptor.size);
+  proto.ParseFromString(input);
+  std::string file_json;
+  ABSL_CHECK_OK(google::protobuf::json::MessageToJsonString(proto, &file_json));
+
+  std::string json = Format == Document ? "{\"file\": [" : "";
+  if (Format == Array) json = "[";
+  for (int i = 0; i < kNumFiles; ++i) {
+    if (i > 0) json += Format == Delimited ? "\n" : ",";
+    json += file_json;
+  }
+  if (Format == Document) json += "]}";
+  if (Format == Array) json += "]";
+
+  for (auto _ : state) {
+    if (Format == Document) {
+      protobuf::FileDescriptorSet set;
+      ABSL_CHECK_OK(google::protobuf::json::JsonStringToMessage(json, &set));
+      ABSL_CHECK_EQ(set.file_size(), kNumFiles);
+    } else {
+      protobuf::io::ArrayInputStream stream(json.data(), json.size());
+      google::protobuf::json::JsonMessageReader reader(&stream);
+      protobuf::FileDescriptorProto file;
+      int files = 0;
+      while (reader.Next(&file)) ++files;
+      ABSL_CHECK_OK(reader.status());
+      ABSL_CHECK_EQ(files, kNumFiles);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * json.size());
+}
+BENCHMARK_TEMPLATE(BM_JsonParse_Proto2_Stream, Document);
+BENCHMARK_TEMPLATE(BM_JsonParse_Proto2_Stream, Array);
+BENCHMARK_TEMPLATE(BM_JsonParse_Proto2_Stream, Delimited);
+
+// Parses a large textproto holding many copies of the same file, like the
+// config files that are loaded at startup.
+template <ArenaMode AMode>
+static void BM_TextParse_Proto2(benchmark::State& state) {
+  constexpr int kNumFiles = 256;
+  protobuf::FileDescriptorSet set;
+  absl::string_view input(descriptor.data, descriptor.size);
+  ABSL_CHECK(set.add_file()->ParseFromString(input));
+  for (int i = 1; i < kNumFiles; ++i) *set.add_file() = set.file(0);
+  std::string text;
+  ABSL_CHECK(protobuf::TextFormat::PrintToString(set, &text));
+  for (auto _ : state) {
+    Proto2Factory<AMode, protobuf::FileDescriptorSet> proto_factory;
+    auto proto = proto_factory.GetProto();
+    ABSL_CHECK(protobuf::TextFormat::ParseFromString(text, proto));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK_TEMPLATE(BM_TextParse_Proto2, NoArena);
+BENCHMARK_TEMPLATE(BM_TextParse_Proto2, UseArena);
+
+enum TextPrinterPath {
+  // The fast printer, used when no custom printers are registered.
+  FastPrinter,
+  // The general printer, which goes through the field value printers.
+  GeneralPrinter,
+};
+
+enum TextPrintPayload {
+  // A file descriptor, with many levels of nested messages.
+  NestedPayload,
+  // Long repeated numeric fields.
+  RepeatedPayload,
+};
+
+template <TextPrinterPath Path, TextPrintPayload Payload>
+static void BM_TextPrint_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto file;
+  upb_benchmark::PackedVarints varints;
+  protobuf::Message* proto;
+  if (Payload == NestedPayload) {
+    absl::string_view input(descriptor.data, descriptor.size);
+    ABSL_CHECK(file.ParseFromString(input));
+    proto = &file;
+  } else {
+    std::mt19937 rng(0);
+    for (int i = 0; i < 10000; ++i) {
+      varints.add_int32_values(static_cast<int32_t>(rng()) >> (rng() % 32));
+      varints.add_uint32_values(rng() >> (rng() % 32));
+      varints.add_sint32_values(-static_cast<int32_t>(rng() % 1000));
+    }
+    proto = &varints;
+  }
+  protobuf::TextFormat::Printer printer;
+  if (Path == GeneralPrinter) {
+    // Any custom printer turns the fast printer off.
+    ABSL_CHECK(printer.RegisterFieldValuePrinter(
+        protobuf::GeneratedCodeInfo::descriptor()->field(0),
+        new protobuf::TextFormat::FastFieldValuePrinter));
+  }
+  std::string text;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    ABSL_CHECK(printer.PrintToString(*proto, &text));
+    bytes += text.size();
+  }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK_TEMPLATE(BM_TextPrint_Proto2, FastPrinter, NestedPayload);
+BENCHMARK_TEMPLATE(BM_TextPrint_Proto2, GeneralPrinter, NestedPayload);
+BENCHMARK_TEMPLATE(BM_TextPrint_Proto2, FastPrinter, RepeatedPayload);
+BENCHMARK_TEMPLATE(BM_TextPrint_Proto2, GeneralPrinter, RepeatedPayload);
+
+enum FieldMaskMode {
+  // The FieldMask is passed to FieldMaskUtil on every call.
+  UncompiledMask,
+  // The FieldMask is compiled once into a CompiledFieldMask.
+  CompiledMask,
+};
+
+template <FieldMaskMode Mode>
+static void BM_FieldMaskMerge_Proto2(benchmark::State& state) {
+  protobuf::FileDescriptorProto source;
+  ABSL_CHECK(source.ParseFromString(
+      absl::string_view(descriptor.data, descriptor.size)));
+  protobuf::FieldMask mask;
+  protobuf::util::FieldMaskUtil::FromString(
+      "name,package,syntax,options.java_package,options.optimize_for", &mask);
+  const protobuf::util::CompiledFieldMask compiled(
+      protobuf::FileDescriptorProto::descriptor(), mask);
+  const protobuf::util::FieldMaskUtil::MergeOptions options;
+  for (auto _ : state) {
+    protobuf::FileDescriptorProto destination;
+    if (Mode == UncompiledMask) {
+      protobuf::util::FieldMaskUtil::MergeMessageTo(source, mask, options,
+                                                    &destination);
+    } else {
+      compiled.MergeMessageTo(source, options, &destination);
+    }
+    benchmark::DoNotOptimize(destination);
+  }
+}
+BENCHMARK_TEMPLATE(BM_FieldMaskMerge_Proto2, UncompiledMask);
+BENCHMARK_TEMPLATE(BM_FieldMaskMerge_Proto2, CompiledMask);
+
+// Returns a message type of the googleads protos, built from the descriptors
+// compiled into the upb reflection library.
+static const protobuf::Descriptor* FindAdsMessageType(absl::string_view name) {
+  static protobuf::DescriptorPool* pool = [] {
+    extern _upb_DefPool_Init
+        google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit;
+    std::vector<upb_StringView> serialized_files;
+    absl::flat_hash_set<const _upb_DefPool_Init*> seen_files;
+    CollectFileDescriptors(
+        &google_ads_googleads_v16_services_google_ads_service_proto_upbdefinit,
+        serialized_files, seen_files);
+    auto* pool = new protobuf::DescriptorPool;
+    for (auto file : serialized_files) {
+      protobuf::FileDescriptorProto proto;
+      ABSL_CHECK(
+          proto.ParseFromString(absl::string_view(file.data, file.size)));
+      ABSL_CHECK(pool->BuildFile(proto) != nullptr);
+    }
+    return pool;
+  }();
+  return pool->FindMessageTypeByName(name);
+}
+
+// Sets the singular fields of message, and those of its message fields down to
+// depth levels, which makes a wide message of a wide message type.
+static void FillWideMessage(protobuf::Message* message, int depth) {
+  const protobuf::Descriptor* descriptor = message->GetDescriptor();
+  const protobuf::Reflection* reflection = message->GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const protobuf::FieldDescriptor* field = descriptor->field(i);
+    if (field->is_repeated() || field->real_containing_oneof() != nullptr) {
+      continue;
+    }
+    switch (field->cpp_type()) {
+      case protobuf::FieldDescriptor::CPPTYPE_INT32:
+        reflection->SetInt32(message, field, i * 1000);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_INT64:
+        reflection->SetInt64(message, field, int64_t{i} << 40);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_UINT32:
+        reflection->SetUInt32(message, field, i * 1000);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_UINT64:
+        reflection->SetUInt64(message, field, uint64_t{1} << i % 64);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+        reflection->SetDouble(message, field, i / 3.0);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+        reflection->SetFloat(message, field, i / 3.0f);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_BOOL:
+        reflection->SetBool(message, field, true);
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_ENUM:
+        reflection->SetEnumValue(
+            message, field,
+            field->enum_type()
+                ->value(field->enum_type()->value_count() - 1)
+                ->number());
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_STRING:
+        reflection->SetString(message, field,
+                              absl::StrCat(field->name(), " of ",
+                                           descriptor->name()));
+        break;
+      case protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+        if (depth > 0) {
+          FillWideMessage(reflection->MutableMessage(message, field),
+                          depth - 1);
+        }
+        break;
+    }
+  }
+}
+
+enum WideParseMode {
+  // All fields are parsed.
+  FullParse,
+  // Only the fields in a CompiledFieldMask are parsed, and the others are
+  // skipped on the wire.
+  MaskedParse,
+};
+
+// Parses a googleads Campaign, which has about a hundred fields, when only a
+// handful of them are needed.
+template <WideParseMode Mode>
+static void BM_ParseWideMessage_Proto2(benchmark::State& state) {
+  const protobuf::Descriptor* d =
+      FindAdsMessageType("google.ads.googleads.v16.resources.Campaign");
+  ABSL_CHECK(d != nullptr);
+  protobuf::DynamicMessageFactory factory;
+  std::unique_ptr<protobuf::Message> message(factory.GetPrototype(d)->New());
+  FillWideMessage(message.get(), 1);
+  const std::string data = message->SerializeAsString();
+  protobuf::FieldMask mask;
+  protobuf::util::FieldMaskUtil::FromString(
+      "resource_name,id,name,status,network_settings.target_google_search",
+      &mask);
+  const protobuf::util::CompiledFieldMask compiled(d, mask);
+  for (auto _ : state) {
+    if (Mode == FullParse) {
+      ABSL_CHECK(message->ParsePartialFromString(data));
+    } else {
+      ABSL_CHECK(compiled.ParsePartialFromString(data, message.get()));
+    }
+    benchmark::DoNotOptimize(message);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK_TEMPLATE(BM_ParseWideMessage_Proto2, FullParse);
+BENCHMARK_TEMPLATE(BM_ParseWideMessage_Proto2, MaskedParse);
+
+enum DifferencerMatching {
+  // Elements of repeated fields are compared pairwise.
+  PairwiseMatching,
+  // Elements of repeated fields are bucketed by hash.
+  HashMatching,
+  // Like HashMatching, hashing the elements with four threads.
+  ParallelHashMatching,
+};
+
+enum DifferencerField {
+  // The repeated field is treated as a set.
+  SetField,
+  // The repeated field is treated as a map, keyed by a field of its elements.
+  MapField,
+};
+
+template <DifferencerMatching Matching, DifferencerField Field>
+static void BM_Differencer_Proto2(benchmark::State& state) {
+  protobuf::DescriptorProto message1;
+  for (int i = 0; i < state.range(0); ++i) {
+    protobuf::FieldDescriptorProto* field = message1.add_field();
+    field->set_name(absl::StrCat("field_", i));
+    field->set_number(i + 1);
+    field->set_label(protobuf::FieldDescriptorProto::LABEL_OPTIONAL);
+    field->set_type(protobuf::FieldDescriptorProto::TYPE_INT32);
+  }
+  protobuf::DescriptorProto message2 = message1;
+  std::mt19937 rng(0);
+  std::shuffle(message2.mutable_field()->pointer_begin(),
+               message2.mutable_field()->pointer_end(), rng);
+
+  protobuf::util::MessageDifferencer differencer;
+  const protobuf::FieldDescriptor* field =
+      protobuf::DescriptorProto::descriptor()->FindFieldByName("field");
+  if (Field == SetField) {
+    differencer.TreatAsSet(field);
+  } else {
+    differencer.TreatAsMap(
+        field,
+        protobuf::FieldDescriptorProto::descriptor()->FindFieldByName("name"));
+  }
+  differencer.set_match_repeated_fields_by_hash(Matching != PairwiseMatching);
+  if (Matching == ParallelHashMatching) differencer.set_num_hash_threads(4);
+  for (auto _ : state) {
+    ABSL_CHECK(differencer.Compare(message1, message2));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, PairwiseMatching, SetField)
+    ->Arg(1 << 8)
+    ->Arg(1 << 11);
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, HashMatching, SetField)
+    ->Arg(1 << 8)
+    ->Arg(1 << 11)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, ParallelHashMatching, SetField)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, PairwiseMatching, MapField)
+    ->Arg(1 << 8)
+    ->Arg(1 << 11);
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, HashMatching, MapField)
+    ->Arg(1 << 8)
+    ->Arg(1 << 11)
+    ->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Differencer_Proto2, ParallelHashMatching, MapField)
+    ->Arg(1 << 16);
+
 static void BM_JsonSerialize_Upb(benchmark::State& state) {
   upb_Arena* arena = upb_Arena_New();
   upb_benchmark_FileDescriptorProto* set =
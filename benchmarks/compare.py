@@ -32,17 +32,35 @@
 
 """Benchmarks the current working directory against a given baseline.
 
-This script benchmarks both size and speed. Sample output:
+This script benchmarks both size and speed.
+
+It can also diff two JSON reports written by the runtime benchmark suite,
+for example by two builds on CI, and fail if any benchmark regressed:
+
+  ./runtime_benchmark --benchmark_out_format=json --benchmark_out=new.json
+  compare.py --old_report=old.json --new_report=new.json --threshold=5
 """
 
+import argparse
+import collections
 import contextlib
 import json
 import os
 import re
+import statistics
 import subprocess
 import sys
 import tempfile
 
+# Metrics diffed between reports, and whether larger values are better.
+REPORT_METRICS = [
+    ("cpu_time", False),
+    ("bytes_per_second", True),
+    ("allocs_per_op", False),
+]
+
+TIME_UNIT_NS = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}
+
 @contextlib.contextmanager
 def GitWorktree(commit):
   tmpdir = tempfile.mkdtemp()
@@ -58,6 +76,67 @@ def GitWorktree(commit):
 def Run(cmd):
   subprocess.check_call(cmd, shell=True)
 
+def TargetExists(target):
+  return subprocess.run(['bazel', 'query', target],
+                        stdout=subprocess.DEVNULL,
+                        stderr=subprocess.DEVNULL).returncode == 0
+
+def LoadReport(filename):
+  """Returns {benchmark name: {metric: median value}} for a JSON report."""
+  with open(filename) as f:
+    report = json.load(f)
+  samples = collections.defaultdict(lambda: collections.defaultdict(list))
+  for run in report["benchmarks"]:
+    if run.get("run_type", "iteration") != "iteration":
+      continue
+    metrics = samples[run.get("run_name", run["name"])]
+    scale = TIME_UNIT_NS[run.get("time_unit", "ns")]
+    metrics["cpu_time"].append(run["cpu_time"] * scale)
+    for metric in ("bytes_per_second", "allocs_per_op"):
+      if metric in run:
+        metrics[metric].append(run[metric])
+  return {
+      name: {metric: statistics.median(values)
+             for metric, values in metrics.items()}
+      for name, metrics in samples.items()
+  }
+
+
+def DiffReports(old, new, threshold):
+  """Prints the change of every metric and returns the regressions.
+
+  A metric regresses if it got worse by more than `threshold` percent.
+  """
+  regressions = []
+  print("{:<60} {:<18} {:>14} {:>14} {:>9}".format(
+      "benchmark", "metric", "old", "new", "delta"))
+  for name in sorted(set(old) & set(new)):
+    for metric, higher_is_better in REPORT_METRICS:
+      if metric not in old[name] or metric not in new[name]:
+        continue
+      old_value = old[name][metric]
+      new_value = new[name][metric]
+      if old_value == 0:
+        delta = 0 if new_value == 0 else float("inf")
+      else:
+        delta = (new_value - old_value) / old_value * 100
+      worse = -delta if higher_is_better else delta
+      # Sub-allocation differences are noise of the measurement.
+      if metric == "allocs_per_op" and abs(new_value - old_value) < 0.5:
+        worse = 0
+      marker = ""
+      if worse > threshold:
+        regressions.append((name, metric, delta))
+        marker = "  <-- regression"
+      print("{:<60} {:<18} {:>14.4g} {:>14.4g} {:>+8.1f}%{}".format(
+          name, metric, old_value, new_value, delta, marker))
+  for name in sorted(set(old) - set(new)):
+    print("{:<60} only in the old report".format(name))
+  for name in sorted(set(new) - set(old)):
+    print("{:<60} only in the new report".format(name))
+  return regressions
+
+
 def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False):
   tmpfile = "/tmp/bench-output.json"
   Run("rm -rf {}".format(tmpfile))
@@ -86,17 +165,41 @@ def Benchmark(outbase, bench_cpu=True, runs=12, fasttable=False):
         print("{} {} {} ns/op".format(*values), file=f)
     Run("sort {} -o {} ".format(txt_filename, txt_filename))
 
+    # Don't leave a report from an earlier run around to be diffed.
+    if os.path.exists(outbase + ".json"):
+      os.remove(outbase + ".json")
+    # Baselines from before the runtime suite was added have no such target.
+    if TargetExists("benchmarks:runtime_benchmark"):
+      Run("CC=clang bazel build -c opt --copt=-march=native benchmarks:runtime_benchmark" + extra_args)
+      Run("./bazel-bin/benchmarks/runtime_benchmark --benchmark_out_format=json --benchmark_out={}.json --benchmark_repetitions={} --benchmark_min_time=0.05".format(outbase, runs))
+
   Run("CC=clang bazel build -c opt --copt=-g --copt=-march=native :conformance_upb"
       + extra_args)
   Run("cp -f bazel-bin/conformance_upb {}.bin".format(outbase))
 
 
-baseline = "main"
+parser = argparse.ArgumentParser()
+parser.add_argument("baseline", nargs="?", default="main")
+parser.add_argument("--old_report", help="JSON report of the baseline build")
+parser.add_argument("--new_report", help="JSON report of the new build")
+parser.add_argument("--threshold", type=float, default=5.0,
+                    help="Percentage by which a metric may get worse")
+args = parser.parse_args()
+
+if args.old_report or args.new_report:
+  if not (args.old_report and args.new_report):
+    parser.error("--old_report and --new_report must be given together")
+  regressions = DiffReports(LoadReport(args.old_report),
+                            LoadReport(args.new_report), args.threshold)
+  print()
+  print("{} regression(s) above {}%".format(len(regressions), args.threshold))
+  sys.exit(1 if regressions else 0)
+
+baseline = args.baseline
 bench_cpu = True
 fasttable = False
 
-if len(sys.argv) > 1:
-  baseline = sys.argv[1]
+if baseline != "main":
 
   # Quickly verify that the baseline exists.
   with GitWorktree(baseline):
@@ -114,6 +217,10 @@ print()
 
 if bench_cpu:
   Run("~/go/bin/benchstat /tmp/old.txt /tmp/new.txt")
+  if os.path.exists("/tmp/old.json") and os.path.exists("/tmp/new.json"):
+    print()
+    DiffReports(LoadReport("/tmp/old.json"), LoadReport("/tmp/new.json"),
+                args.threshold)
 
 print()
 print()
@@ -121,3 +121,53 @@ with open(base + "/200_fields.proto", "w") as f:
     f.write('  {label} {field_type} field{i} = {i};\n'.format(i=i, label=label,field_type=field_type))
     i += 1
   f.write('}\n')
+
+# Schemas for the runtime benchmark suite, each stressing one kind of content.
+# The field counts are fixed so that results stay comparable between builds.
+with open(base + "/workloads.proto", "w") as f:
+  f.write('syntax = "proto2";\n')
+  f.write('package upb_benchmark;\n')
+
+  f.write('message MapValue {\n')
+  f.write('  optional int64 id = 1;\n')
+  f.write('  optional string name = 2;\n')
+  f.write('  optional double score = 3;\n')
+  f.write('}\n')
+  f.write('message MapHeavy {\n')
+  map_types = [('string', 'string'), ('int32', 'int64'), ('string', 'MapValue'),
+               ('uint64', 'MapValue'), ('string', 'bytes'), ('int64', 'double')]
+  for i, (key_type, value_type) in enumerate(map_types, start=1):
+    f.write('  map<{key_type}, {value_type}> map{i} = {i};\n'.format(
+        i=i, key_type=key_type, value_type=value_type))
+  f.write('}\n')
+
+  # Nesting depth is controlled by the populated data, not by the schema.
+  f.write('message DeeplyNested {\n')
+  f.write('  optional DeeplyNested child = 1;\n')
+  f.write('  optional int32 depth = 2;\n')
+  f.write('  optional string label = 3;\n')
+  f.write('  repeated int64 values = 4 [packed = true];\n')
+  f.write('  optional fixed64 checksum = 5;\n')
+  f.write('}\n')
+
+  f.write('message StringHeavy {\n')
+  i = 1
+  for _ in range(16):
+    f.write('  optional string field{i} = {i};\n'.format(i=i))
+    i += 1
+  for _ in range(4):
+    f.write('  optional bytes field{i} = {i};\n'.format(i=i))
+    i += 1
+  for _ in range(4):
+    f.write('  repeated string field{i} = {i};\n'.format(i=i))
+    i += 1
+  f.write('}\n')
+
+  f.write('message PackedNumerics {\n')
+  packed_types = ['int32', 'int64', 'uint32', 'uint64', 'sint32', 'sint64',
+                  'fixed32', 'fixed64', 'sfixed32', 'sfixed64', 'float',
+                  'double', 'bool']
+  for i, field_type in enumerate(packed_types, start=1):
+    f.write('  repeated {field_type} field{i} = {i} [packed = true];\n'.format(
+        i=i, field_type=field_type))
+  f.write('}\n')
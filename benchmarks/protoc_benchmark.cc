@@ -0,0 +1,126 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Measures protoc code generation over a synthetic tree of .proto files,
+// running the C++ generator with different values of --jobs.
+//
+// Every file defines a handful of messages and imports a few of the files
+// before it, so that the tree resembles a large repository with a deep import
+// graph rather than a set of independent files.
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/compiler/command_line_interface.h"
+#include "google/protobuf/compiler/cpp/generator.h"
+
+namespace {
+
+using ::google::protobuf::compiler::CommandLineInterface;
+using ::google::protobuf::compiler::cpp::CppGenerator;
+
+constexpr int kMessagesPerFile = 8;
+constexpr int kFieldsPerMessage = 12;
+constexpr int kImportsPerFile = 3;
+
+std::string TempDir() {
+  const char* dir = getenv("TEST_TMPDIR");
+  return dir != nullptr ? dir : "/tmp";
+}
+
+std::string FileName(int i) { return absl::StrCat("synthetic_", i, ".proto"); }
+
+// Returns the contents of the i-th file of the tree.
+std::string SyntheticProto(int i) {
+  std::string proto = absl::StrCat("syntax = \"proto3\";\n\npackage synthetic",
+                                   i, ";\n\n");
+  for (int d = 1; d <= kImportsPerFile && d <= i; ++d) {
+    absl::StrAppend(&proto, "import \"", FileName(i - d), "\";\n");
+  }
+  for (int m = 0; m < kMessagesPerFile; ++m) {
+    absl::StrAppend(&proto, "\nmessage Message", m, " {\n");
+    for (int f = 1; f <= kFieldsPerMessage; ++f) {
+      std::string type;
+      switch (f % 6) {
+        case 0:
+          type = "int32";
+          break;
+        case 1:
+          type = "string";
+          break;
+        case 2:
+          type = "repeated int64";
+          break;
+        case 3:
+          type = "map<string, bytes>";
+          break;
+        case 4:
+          // A message of an imported file, or of this file if none.
+          type = i > 0 ? absl::StrCat("synthetic", i - 1, ".Message", m)
+                       : absl::StrCat("Message", (m + 1) % kMessagesPerFile);
+          break;
+        default:
+          type = "optional double";
+          break;
+      }
+      absl::StrAppend(&proto, "  ", type, " field", f, " = ", f, ";\n");
+    }
+    absl::StrAppend(&proto, "}\n");
+  }
+  return proto;
+}
+
+// Writes a tree of `num_files` files and returns the directory containing it.
+std::string WriteTree(int num_files) {
+  const std::string dir =
+      absl::StrCat(TempDir(), "/protoc_benchmark_", num_files);
+  mkdir(dir.c_str(), 0777);
+  mkdir(absl::StrCat(dir, "/out").c_str(), 0777);
+  for (int i = 0; i < num_files; ++i) {
+    std::ofstream out(absl::StrCat(dir, "/", FileName(i)));
+    out << SyntheticProto(i);
+    ABSL_CHECK(out.good());
+  }
+  return dir;
+}
+
+void BM_GenerateCpp(benchmark::State& state) {
+  const int num_files = state.range(0);
+  const int jobs = state.range(1);
+  const std::string dir = WriteTree(num_files);
+
+  std::vector<std::string> args = {
+      "protoc", absl::StrCat("--jobs=", jobs),
+      absl::StrCat("--proto_path=", dir),
+      absl::StrCat("--cpp_out=", dir, "/out")};
+  for (int i = 0; i < num_files; ++i) args.push_back(FileName(i));
+  std::vector<const char*> argv;
+  for (const std::string& arg : args) argv.push_back(arg.c_str());
+
+  CppGenerator generator;
+  for (auto _ : state) {
+    CommandLineInterface cli;
+    cli.RegisterGenerator("--cpp_out", &generator, "");
+    ABSL_CHECK_EQ(cli.Run(static_cast<int>(argv.size()), argv.data()), 0);
+  }
+  state.SetItemsProcessed(state.iterations() * num_files);
+}
+BENCHMARK(BM_GenerateCpp)
+    ->ArgNames({"files", "jobs"})
+    ->ArgsProduct({{50, 500}, {1, 2, 4, 8}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
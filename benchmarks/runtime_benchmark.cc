@@ -0,0 +1,455 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// A suite of C++ runtime benchmarks covering the common message operations
+// over a set of workloads, each in heap and arena mode.
+//
+// Workloads are the real-world descriptor.proto plus the schemas written by
+// gen_synthetic_protos.py, populated with deterministic pseudo-random data.
+// Every benchmark reports bytes per second of encoded message and the number
+// of heap allocations per operation, so that `compare.py --old_report
+// --new_report` can diff the JSON output of two builds.
+
+#include <benchmark/benchmark.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/text_format.h"
+#include "benchmarks/100_fields.pb.h"
+#include "benchmarks/descriptor.pb.h"
+#include "benchmarks/workloads.pb.h"
+
+namespace protobuf = ::google::protobuf;
+
+namespace {
+
+// Heap allocations made by the process, counted by the replacement global
+// operator new below.
+std::atomic<uint64_t> num_allocs{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+  num_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+using protobuf::FieldDescriptor;
+using protobuf::Message;
+using protobuf::Reflection;
+
+// Controls the amount of data Populate() writes into a message.
+struct PopulateOptions {
+  int repeated_size = 4;
+  int string_size = 16;
+  // Message fields are populated down to this depth.
+  int max_depth = 2;
+};
+
+class Populator {
+ public:
+  explicit Populator(const PopulateOptions& options)
+      : options_(options), rng_(options.repeated_size * 31 +
+                                options.string_size * 7 + options.max_depth) {}
+
+  // Populates every field of `message`. If it is a map entry, its key is
+  // derived from `key` so that the entries of a map do not collide.
+  void Populate(Message* message, int depth = 0, int key = 0) {
+    const Reflection* reflection = message->GetReflection();
+    const protobuf::Descriptor* descriptor = message->GetDescriptor();
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+      const FieldDescriptor* field = descriptor->field(i);
+      if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+          depth >= options_.max_depth) {
+        continue;
+      }
+      if (field->real_containing_oneof() != nullptr &&
+          field->index_in_oneof() != 0) {
+        continue;
+      }
+      if (!field->is_repeated()) {
+        SetField(message, reflection, field, depth, key);
+      } else {
+        for (int j = 0; j < options_.repeated_size; ++j) {
+          SetField(message, reflection, field, depth, j);
+        }
+      }
+    }
+  }
+
+ private:
+  std::string RandomString() {
+    std::string s(options_.string_size, 0);
+    for (char& c : s) c = 'a' + rng_() % 26;
+    return s;
+  }
+
+  // Sets the field, or adds its `index`th element if it is repeated.
+  void SetField(Message* message, const Reflection* reflection,
+                const FieldDescriptor* field, int depth, int index) {
+    const bool is_map_key = field->containing_type()->options().map_entry() &&
+                            field->number() == 1;
+    const uint64_t value = is_map_key ? index : rng_();
+#define SET_FIELD(TYPE, VALUE)                    \
+  if (field->is_repeated()) {                     \
+    reflection->Add##TYPE(message, field, VALUE); \
+  } else {                                        \
+    reflection->Set##TYPE(message, field, VALUE); \
+  }
+    switch (field->cpp_type()) {
+      case FieldDescriptor::CPPTYPE_INT32:
+        SET_FIELD(Int32, static_cast<int32_t>(value % 100000));
+        break;
+      case FieldDescriptor::CPPTYPE_INT64:
+        SET_FIELD(Int64, static_cast<int64_t>(value >> (value % 64)));
+        break;
+      case FieldDescriptor::CPPTYPE_UINT32:
+        SET_FIELD(UInt32, static_cast<uint32_t>(value >> 40));
+        break;
+      case FieldDescriptor::CPPTYPE_UINT64:
+        SET_FIELD(UInt64, value >> (value % 64));
+        break;
+      case FieldDescriptor::CPPTYPE_DOUBLE:
+        SET_FIELD(Double, static_cast<double>(value % 1000000) / 1000);
+        break;
+      case FieldDescriptor::CPPTYPE_FLOAT:
+        SET_FIELD(Float, static_cast<float>(value % 1000) / 10);
+        break;
+      case FieldDescriptor::CPPTYPE_BOOL:
+        SET_FIELD(Bool, value % 2 == 0);
+        break;
+      case FieldDescriptor::CPPTYPE_ENUM:
+        SET_FIELD(EnumValue, field->enum_type()->value(0)->number());
+        break;
+      case FieldDescriptor::CPPTYPE_STRING:
+        SET_FIELD(String, is_map_key ? absl::StrCat("key", index)
+                                     : RandomString());
+        break;
+      case FieldDescriptor::CPPTYPE_MESSAGE:
+        Populate(field->is_repeated()
+                     ? reflection->AddMessage(message, field)
+                     : reflection->MutableMessage(message, field),
+                 depth + 1, index);
+        break;
+    }
+#undef SET_FIELD
+  }
+
+  const PopulateOptions options_;
+  std::mt19937_64 rng_;
+};
+
+// Populates `message` as a chain of `depth` nested messages.
+void PopulateDeeplyNested(upb_benchmark::DeeplyNested* message, int depth) {
+  for (int i = 0; i < depth; ++i) {
+    message->set_depth(i);
+    message->set_label(absl::StrCat("level", i));
+    for (int j = 0; j < 4; ++j) message->add_values(int64_t{i} << (j * 8));
+    message->set_checksum(i * 0x9E3779B97F4A7C15);
+    message = message->mutable_child();
+  }
+}
+
+struct Workload {
+  std::string name;
+  const Message* prototype;
+  // The workload's data, in wire format.
+  std::string serialized;
+};
+
+const std::vector<Workload>& Workloads() {
+  static const auto* workloads = [] {
+    auto* workloads = new std::vector<Workload>;
+    auto add = [&](absl::string_view name, const Message& prototype,
+                   std::function<void(Message*)> populate) {
+      std::unique_ptr<Message> message(prototype.New());
+      populate(message.get());
+      workloads->push_back(
+          {std::string(name), &prototype, message->SerializeAsString()});
+    };
+    auto populate_with = [](PopulateOptions options) {
+      return [options](Message* message) {
+        Populator(options).Populate(message);
+      };
+    };
+
+    // descriptor.proto is a real-world schema with real-world data.
+    add("Descriptor", upb_benchmark::FileDescriptorProto::default_instance(),
+        [](Message* message) {
+          protobuf::FileDescriptorProto file;
+          protobuf::FileDescriptorProto::descriptor()->file()->CopyTo(&file);
+          ABSL_CHECK(message->ParseFromString(file.SerializeAsString()));
+        });
+    // The synthetic schema is recursive, so one level of nesting is plenty.
+    add("Synthetic100Fields", upb_benchmark::Message::default_instance(),
+        populate_with({/*repeated_size=*/4, /*string_size=*/16,
+                       /*max_depth=*/1}));
+    add("MapHeavy", upb_benchmark::MapHeavy::default_instance(),
+        populate_with({/*repeated_size=*/64, /*string_size=*/12}));
+    add("DeeplyNested", upb_benchmark::DeeplyNested::default_instance(),
+        [](Message* message) {
+          PopulateDeeplyNested(
+              static_cast<upb_benchmark::DeeplyNested*>(message), 64);
+        });
+    add("StringHeavy", upb_benchmark::StringHeavy::default_instance(),
+        populate_with({/*repeated_size=*/8, /*string_size=*/64}));
+    add("PackedNumerics", upb_benchmark::PackedNumerics::default_instance(),
+        populate_with({/*repeated_size=*/1024, /*string_size=*/0}));
+    return workloads;
+  }();
+  return *workloads;
+}
+
+enum ArenaMode { NoArena, UseArena };
+
+// Owns the messages created by a benchmark, on the heap or on an arena.
+class MessageFactory {
+ public:
+  explicit MessageFactory(ArenaMode mode) {
+    if (mode == UseArena) arena_ = std::make_unique<protobuf::Arena>();
+  }
+
+  Message* New(const Workload& workload) {
+    Message* message = workload.prototype->New(arena_.get());
+    if (arena_ == nullptr) owned_.emplace_back(message);
+    return message;
+  }
+
+  Message* NewPopulated(const Workload& workload) {
+    Message* message = New(workload);
+    ABSL_CHECK(message->ParseFromString(workload.serialized));
+    return message;
+  }
+
+ private:
+  std::unique_ptr<protobuf::Arena> arena_;
+  std::vector<std::unique_ptr<Message>> owned_;
+};
+
+// Reads every set field through reflection, recursively, and returns a value
+// depending on all of them.
+uint64_t ReadAllFields(const Message& message) {
+  const Reflection* reflection = message.GetReflection();
+  std::vector<const FieldDescriptor*> fields;
+  reflection->ListFields(message, &fields);
+  uint64_t sum = 0;
+  for (const FieldDescriptor* field : fields) {
+    const int size =
+        field->is_repeated() ? reflection->FieldSize(message, field) : 1;
+    for (int i = 0; i < size; ++i) {
+#define GET_FIELD(TYPE)                                       \
+  (field->is_repeated()                                       \
+       ? reflection->GetRepeated##TYPE(message, field, i)     \
+       : reflection->Get##TYPE(message, field))
+      switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+          sum += GET_FIELD(Int32);
+          break;
+        case FieldDescriptor::CPPTYPE_INT64:
+          sum += GET_FIELD(Int64);
+          break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+          sum += GET_FIELD(UInt32);
+          break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+          sum += GET_FIELD(UInt64);
+          break;
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+          sum += static_cast<uint64_t>(GET_FIELD(Double));
+          break;
+        case FieldDescriptor::CPPTYPE_FLOAT:
+          sum += static_cast<uint64_t>(GET_FIELD(Float));
+          break;
+        case FieldDescriptor::CPPTYPE_BOOL:
+          sum += GET_FIELD(Bool);
+          break;
+        case FieldDescriptor::CPPTYPE_ENUM:
+          sum += GET_FIELD(EnumValue);
+          break;
+        case FieldDescriptor::CPPTYPE_STRING: {
+          std::string scratch;
+          sum += (field->is_repeated()
+                      ? reflection->GetRepeatedStringReference(message, field,
+                                                               i, &scratch)
+                      : reflection->GetStringReference(message, field,
+                                                       &scratch))
+                     .size();
+          break;
+        }
+        case FieldDescriptor::CPPTYPE_MESSAGE:
+          sum += ReadAllFields(GET_FIELD(Message));
+          break;
+      }
+#undef GET_FIELD
+    }
+  }
+  return sum;
+}
+
+enum Operation {
+  Parse,
+  Serialize,
+  ByteSize,
+  Copy,
+  Merge,
+  Clear,
+  ReflectionRead,
+  TextPrint,
+  TextParse,
+};
+
+void RunOperation(benchmark::State& state, const Workload& workload,
+                  Operation op, ArenaMode mode) {
+  MessageFactory setup_factory(mode);
+  const Message* populated = setup_factory.NewPopulated(workload);
+  std::string text;
+  ABSL_CHECK(protobuf::TextFormat::PrintToString(*populated, &text));
+  // Operations over text format report bytes of text instead.
+  size_t bytes_per_op = workload.serialized.size();
+
+  const uint64_t allocs_before = num_allocs.load(std::memory_order_relaxed);
+  // Allocations made while timing is paused are not counted.
+  uint64_t paused_allocs = 0;
+  switch (op) {
+    case Parse:
+      for (auto _ : state) {
+        MessageFactory factory(mode);
+        Message* message = factory.New(workload);
+        ABSL_CHECK(message->ParseFromString(workload.serialized));
+      }
+      break;
+    case Serialize: {
+      std::string out;
+      for (auto _ : state) {
+        ABSL_CHECK(populated->SerializeToString(&out));
+        benchmark::DoNotOptimize(out.data());
+      }
+      break;
+    }
+    case ByteSize:
+      for (auto _ : state) {
+        benchmark::DoNotOptimize(populated->ByteSizeLong());
+      }
+      break;
+    case Copy:
+      for (auto _ : state) {
+        MessageFactory factory(mode);
+        factory.New(workload)->CopyFrom(*populated);
+      }
+      break;
+    case Merge:
+      // Merging twice covers both merging into empty and into set fields.
+      bytes_per_op *= 2;
+      for (auto _ : state) {
+        MessageFactory factory(mode);
+        Message* message = factory.New(workload);
+        message->MergeFrom(*populated);
+        message->MergeFrom(*populated);
+      }
+      break;
+    case Clear: {
+      MessageFactory factory(mode);
+      Message* message = factory.New(workload);
+      for (auto _ : state) {
+        state.PauseTiming();
+        const uint64_t allocs = num_allocs.load(std::memory_order_relaxed);
+        message->CopyFrom(*populated);
+        paused_allocs += num_allocs.load(std::memory_order_relaxed) - allocs;
+        state.ResumeTiming();
+        message->Clear();
+      }
+      break;
+    }
+    case ReflectionRead:
+      for (auto _ : state) {
+        benchmark::DoNotOptimize(ReadAllFields(*populated));
+      }
+      break;
+    case TextPrint: {
+      bytes_per_op = text.size();
+      std::string out;
+      for (auto _ : state) {
+        out.clear();
+        ABSL_CHECK(protobuf::TextFormat::PrintToString(*populated, &out));
+      }
+      break;
+    }
+    case TextParse:
+      bytes_per_op = text.size();
+      for (auto _ : state) {
+        MessageFactory factory(mode);
+        ABSL_CHECK(
+            protobuf::TextFormat::ParseFromString(text, factory.New(workload)));
+      }
+      break;
+  }
+  const uint64_t allocs = num_allocs.load(std::memory_order_relaxed) -
+                          allocs_before - paused_allocs;
+
+  state.SetBytesProcessed(state.iterations() * bytes_per_op);
+  state.counters["allocs_per_op"] =
+      benchmark::Counter(static_cast<double>(allocs),
+                         benchmark::Counter::kAvgIterations);
+}
+
+// Registers BM_Suite/<workload>/<operation>/<Heap|Arena> for every
+// combination.
+[[maybe_unused]] const bool registered = [] {
+  const std::pair<Operation, const char*> kOperations[] = {
+      {Parse, "Parse"},
+      {Serialize, "Serialize"},
+      {ByteSize, "ByteSizeLong"},
+      {Copy, "Copy"},
+      {Merge, "Merge"},
+      {Clear, "Clear"},
+      {ReflectionRead, "ReflectionRead"},
+      {TextPrint, "TextPrint"},
+      {TextParse, "TextParse"},
+  };
+  for (const Workload& workload : Workloads()) {
+    for (const auto& op : kOperations) {
+      for (ArenaMode mode : {NoArena, UseArena}) {
+        const std::string name =
+            absl::StrCat("BM_Suite/", workload.name, "/", op.second, "/",
+                         mode == NoArena ? "Heap" : "Arena");
+        benchmark::RegisterBenchmark(
+            name.c_str(),
+            [&workload, op = op.first, mode](benchmark::State& state) {
+              RunOperation(state, workload, op, mode);
+            });
+      }
+    }
+  }
+  return true;
+}();
+
+}  // namespace
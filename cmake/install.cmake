@@ -90,6 +90,14 @@ set(protobuf_HEADERS
   ${plugin_proto_proto_srcs}
   ${java_features_proto_proto_srcs}
 )
+if (HAVE_ZSTD)
+  list(APPEND protobuf_HEADERS
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/zstd_stream.h)
+endif ()
+if (HAVE_LZ4)
+  list(APPEND protobuf_HEADERS
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/lz4_stream.h)
+endif ()
 if (protobuf_BUILD_LIBUPB)
   list(APPEND protobuf_HEADERS ${libupb_hdrs})
   # Manually install the bootstrap headers
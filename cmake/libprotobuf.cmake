@@ -20,6 +20,25 @@ target_link_libraries(libprotobuf PRIVATE ${CMAKE_THREAD_LIBS_INIT})
 if(protobuf_WITH_ZLIB)
   target_link_libraries(libprotobuf PRIVATE ${ZLIB_LIBRARIES})
 endif()
+# The optional compression streams are not part of the generated file lists.
+if(HAVE_ZSTD)
+  target_sources(libprotobuf PRIVATE
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/zstd_stream.cc
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/zstd_stream.h)
+  target_include_directories(libprotobuf PRIVATE ${ZSTD_INCLUDE_DIR})
+  target_link_libraries(libprotobuf PRIVATE ${ZSTD_LIBRARY})
+endif()
+if(HAVE_LZ4)
+  target_sources(libprotobuf PRIVATE
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/lz4_stream.cc
+    ${protobuf_SOURCE_DIR}/src/google/protobuf/io/lz4_stream.h)
+  target_include_directories(libprotobuf PRIVATE ${LZ4_INCLUDE_DIR})
+  target_link_libraries(libprotobuf PRIVATE ${LZ4_LIBRARY})
+endif()
+if(HAVE_LIBURING)
+  target_include_directories(libprotobuf PRIVATE ${LIBURING_INCLUDE_DIR})
+  target_link_libraries(libprotobuf PRIVATE ${LIBURING_LIBRARY})
+endif()
 if(protobuf_LINK_LIBATOMIC)
   target_link_libraries(libprotobuf PRIVATE atomic)
 endif()
@@ -52,6 +52,15 @@ function(protobuf_configure_target target)
     if (HAVE_ZLIB)
         target_compile_definitions("${target}" PRIVATE -DHAVE_ZLIB)
     endif ()
+    if (HAVE_ZSTD)
+        target_compile_definitions("${target}" PRIVATE -DHAVE_ZSTD)
+    endif ()
+    if (HAVE_LZ4)
+        target_compile_definitions("${target}" PRIVATE -DHAVE_LZ4)
+    endif ()
+    if (HAVE_LIBURING)
+        target_compile_definitions("${target}" PRIVATE -DHAVE_LIBURING)
+    endif ()
 
 
 endfunction ()
@@ -15,6 +15,7 @@ pub enum EncodeStatus {
     OutOfMemory = 1,
     MaxDepthExceeded = 2,
     MissingRequired = 3,
+    StreamError = 4,
 }
 // LINT.ThenChange()
 
@@ -29,6 +30,7 @@ pub enum DecodeStatus {
     MaxDepthExceeded = 4,
     MissingRequired = 5,
     UnlinkedSubMessage = 6,
+    StreamError = 7,
 }
 // LINT.ThenChange()
 
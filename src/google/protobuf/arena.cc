@@ -23,6 +23,7 @@
 #include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "google/protobuf/arena_allocation_policy.h"
+#include "google/protobuf/arena_block_pool.h"
 #include "google/protobuf/arena_cleanup.h"
 #include "google/protobuf/arenaz_sampler.h"
 #include "google/protobuf/port.h"
@@ -68,6 +69,9 @@ inline size_t AllocationSize(size_t last_size, size_t start_size,
 }
 
 SizedPtr AllocateMemory(const AllocationPolicy& policy, size_t size) {
+  if (policy.block_pool != nullptr) {
+    return policy.block_pool->Allocate(size);
+  }
   if (policy.block_alloc == nullptr) {
     return AllocateAtLeast(size);
   }
@@ -102,10 +106,13 @@ SizedPtr AllocateCleanupChunk(const AllocationPolicy* policy_ptr,
 class GetDeallocator {
  public:
   explicit GetDeallocator(const AllocationPolicy* policy)
-      : dealloc_(policy ? policy->block_dealloc : nullptr) {}
+      : dealloc_(policy ? policy->block_dealloc : nullptr),
+        pool_(policy ? policy->block_pool : nullptr) {}
 
   void operator()(SizedPtr mem) const {
-    if (dealloc_) {
+    if (pool_) {
+      pool_->Deallocate(mem.p, mem.n);
+    } else if (dealloc_) {
       dealloc_(mem.p, mem.n);
     } else {
       internal::SizedDelete(mem.p, mem.n);
@@ -114,6 +121,7 @@ class GetDeallocator {
 
  private:
   void (*dealloc_)(void*, size_t);
+  ArenaBlockPool* pool_;
 };
 
 }  // namespace
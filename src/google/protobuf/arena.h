@@ -51,6 +51,7 @@ namespace protobuf {
 
 struct ArenaOptions;  // defined below
 class Arena;    // defined below
+class ArenaBlockPool;  // defined in arena_block_pool.h
 class Message;  // defined in message.h
 class MessageLite;
 template <typename Key, typename T>
@@ -143,13 +144,21 @@ struct ArenaOptions {
   // calls free.
   void (*block_dealloc)(void*, size_t) = nullptr;
 
+  // A pool that blocks are obtained from and returned to, recycling them
+  // across Arena instances (see arena_block_pool.h). If set, block_alloc and
+  // block_dealloc must not be. The pool must outlive the arena.
+  ArenaBlockPool* block_pool = nullptr;
+
  private:
   internal::AllocationPolicy AllocationPolicy() const {
+    ABSL_DCHECK(block_pool == nullptr ||
+                (block_alloc == nullptr && block_dealloc == nullptr));
     internal::AllocationPolicy res;
     res.start_block_size = start_block_size;
     res.max_block_size = max_block_size;
     res.block_alloc = block_alloc;
     res.block_dealloc = block_dealloc;
+    res.block_pool = block_pool;
     return res;
   }
 
@@ -13,6 +13,9 @@
 
 namespace google {
 namespace protobuf {
+
+class ArenaBlockPool;  // defined in arena_block_pool.h
+
 namespace internal {
 
 // `AllocationPolicy` defines `Arena` allocation policies. Applications can
@@ -29,11 +32,13 @@ struct AllocationPolicy {
 
   void* (*block_alloc)(size_t) = nullptr;
   void (*block_dealloc)(void*, size_t) = nullptr;
+  // If set, takes precedence over `block_alloc` and `block_dealloc`.
+  ArenaBlockPool* block_pool = nullptr;
 
   bool IsDefault() const {
     return start_block_size == kDefaultStartBlockSize &&
            max_block_size == kDefaultMaxBlockSize && block_alloc == nullptr &&
-           block_dealloc == nullptr;
+           block_dealloc == nullptr && block_pool == nullptr;
   }
 };
 
@@ -0,0 +1,256 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/arena_block_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "absl/log/absl_check.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+namespace {
+
+// Returns the largest size class not exceeding `max_block_size`, or 0 if no
+// size class fits.
+size_t MaxPooledBlockSize(size_t max_block_size, size_t min_size,
+                          size_t max_size) {
+  if (max_block_size < min_size) return 0;
+  return std::min(absl::bit_floor(max_block_size), max_size);
+}
+
+void FreeBlockMemory(void* p, size_t size) {
+  PROTOBUF_UNPOISON_MEMORY_REGION(p, size);
+  internal::SizedDelete(p, size);
+}
+
+}  // namespace
+
+ArenaBlockPool::ArenaBlockPool(const Options& options)
+    : max_block_size_(MaxPooledBlockSize(options.max_block_size,
+                                         kMinPooledBlockSize,
+                                         ClassSize(kMaxSizeClasses - 1))),
+      max_shard_bytes_(options.max_cached_bytes / kNumShards),
+      idle_release_interval_(options.idle_release_interval),
+      shards_(new Shard[kNumShards]) {}
+
+ArenaBlockPool::~ArenaBlockPool() { Trim(0); }
+
+ArenaBlockPool* ArenaBlockPool::Default() {
+  static ArenaBlockPool* const pool = new ArenaBlockPool();
+  return pool;
+}
+
+int ArenaBlockPool::SizeClass(size_t size) {
+  size = absl::bit_ceil(std::max(size, kMinPooledBlockSize));
+  return absl::countr_zero(size) - absl::countr_zero(kMinPooledBlockSize);
+}
+
+ArenaBlockPool::Shard& ArenaBlockPool::ThreadShard() {
+  static std::atomic<uint32_t> next_shard{0};
+  // Zero means no shard has been assigned to the thread yet.
+  static PROTOBUF_THREAD_LOCAL uint32_t thread_shard = 0;
+  if (PROTOBUF_PREDICT_FALSE(thread_shard == 0)) {
+    thread_shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards + 1;
+  }
+  return shards_[thread_shard - 1];
+}
+
+ArenaBlockPool::FreeBlock* ArenaBlockPool::PopBlock(Shard& shard,
+                                                    int size_class) {
+  absl::MutexLock lock(&shard.mutex);
+  FreeBlock* block = shard.free_lists[size_class];
+  if (block == nullptr) return nullptr;
+  shard.free_lists[size_class] = block->next;
+  shard.cached_bytes -= ClassSize(size_class);
+  uint32_t& count = shard.counts[size_class];
+  if (--count == 0) {
+    nonempty_shards_[size_class].fetch_and(~ShardBit(shard),
+                                           std::memory_order_relaxed);
+  }
+  shard.low_water[size_class] = std::min(shard.low_water[size_class], count);
+  return block;
+}
+
+ArenaBlockPool::FreeBlock* ArenaBlockPool::UnlinkOldest(Shard& shard,
+                                                        int size_class,
+                                                        uint32_t n) {
+  uint32_t& count = shard.counts[size_class];
+  ABSL_DCHECK_LE(n, count);
+  if (n == 0) return nullptr;
+  FreeBlock** link = &shard.free_lists[size_class];
+  for (uint32_t i = n; i < count; ++i) link = &(*link)->next;
+  FreeBlock* oldest = *link;
+  *link = nullptr;
+  count -= n;
+  if (count == 0) {
+    nonempty_shards_[size_class].fetch_and(~ShardBit(shard),
+                                           std::memory_order_relaxed);
+  }
+  shard.low_water[size_class] = std::min(shard.low_water[size_class], count);
+  shard.cached_bytes -= n * ClassSize(size_class);
+  return oldest;
+}
+
+uint64_t ArenaBlockPool::FreeBlocks(FreeBlock* (&blocks)[kMaxSizeClasses]) {
+  uint64_t freed = 0;
+  for (int c = 0; c < kMaxSizeClasses; ++c) {
+    while (blocks[c] != nullptr) {
+      FreeBlock* block = blocks[c];
+      blocks[c] = block->next;
+      FreeBlockMemory(block, ClassSize(c));
+      ++freed;
+    }
+  }
+  return freed;
+}
+
+internal::SizedPtr ArenaBlockPool::Allocate(size_t size) {
+  if (size > max_block_size_) {
+    unpooled_.fetch_add(1, std::memory_order_relaxed);
+    return internal::AllocateAtLeast(size);
+  }
+  MaybeReleaseIdleBlocks();
+  const int size_class = SizeClass(size);
+  const size_t class_size = ClassSize(size_class);
+
+  // Prefer the calling thread's shard, but take a block from any shard before
+  // falling back to the system allocator: blocks are returned to the shard of
+  // the thread destroying the arena, which need not be the one creating it.
+  // Only shards marked as non-empty are locked. A stale bit costs a lock of an
+  // empty shard, a missing one at worst an allocation.
+  Shard& own = ThreadShard();
+  const uint32_t own_bit = ShardBit(own);
+  uint32_t candidates =
+      nonempty_shards_[size_class].load(std::memory_order_relaxed);
+  FreeBlock* block = nullptr;
+  if (candidates & own_bit) block = PopBlock(own, size_class);
+  candidates &= ~own_bit;
+  while (block == nullptr && candidates != 0) {
+    block = PopBlock(shards_[absl::countr_zero(candidates)], size_class);
+    candidates &= candidates - 1;
+  }
+
+  if (block == nullptr) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return {::operator new(class_size), class_size};
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  PROTOBUF_UNPOISON_MEMORY_REGION(block, class_size);
+  return {block, class_size};
+}
+
+void ArenaBlockPool::Deallocate(void* p, size_t size) {
+  if (size > max_block_size_) {
+    internal::SizedDelete(p, size);
+    return;
+  }
+  // Blocks of pooled sizes always come from Allocate(), which hands out exact
+  // size class sizes.
+  const int size_class = SizeClass(size);
+  ABSL_DCHECK_EQ(size, ClassSize(size_class));
+
+  Shard& shard = ThreadShard();
+  {
+    absl::MutexLock lock(&shard.mutex);
+    if (shard.cached_bytes + size <= max_shard_bytes_) {
+      PROTOBUF_UNPOISON_MEMORY_REGION(p, sizeof(FreeBlock));
+      auto* block = new (p) FreeBlock{shard.free_lists[size_class]};
+      shard.free_lists[size_class] = block;
+      shard.cached_bytes += size;
+      if (shard.counts[size_class]++ == 0) {
+        nonempty_shards_[size_class].fetch_or(ShardBit(shard),
+                                              std::memory_order_relaxed);
+      }
+      PROTOBUF_POISON_MEMORY_REGION(block + 1, size - sizeof(FreeBlock));
+      return;
+    }
+  }
+  overflows_.fetch_add(1, std::memory_order_relaxed);
+  FreeBlockMemory(p, size);
+}
+
+void ArenaBlockPool::MaybeReleaseIdleBlocks() {
+  if (idle_release_interval_ == 0) return;
+  const uint64_t requests =
+      pooled_requests_.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (PROTOBUF_PREDICT_TRUE(requests % idle_release_interval_ != 0)) return;
+  ReleaseIdleBlocks();
+}
+
+void ArenaBlockPool::ReleaseIdleBlocks() {
+  uint64_t released_blocks = 0;
+  for (int i = 0; i < kNumShards; ++i) {
+    Shard& shard = shards_[i];
+    // Unlink the blocks to release under the lock, free them outside of it.
+    FreeBlock* released[kMaxSizeClasses] = {};
+    {
+      absl::MutexLock lock(&shard.mutex);
+      for (int c = 0; c < kMaxSizeClasses; ++c) {
+        // The blocks below the low-water mark were not reused during the
+        // interval; a size class that missed has a low-water mark of zero.
+        released[c] = UnlinkOldest(shard, c, shard.low_water[c]);
+        shard.low_water[c] = shard.counts[c];
+      }
+    }
+    released_blocks += FreeBlocks(released);
+  }
+  idle_releases_.fetch_add(released_blocks, std::memory_order_relaxed);
+}
+
+void ArenaBlockPool::Trim(size_t max_bytes) {
+  const size_t max_shard_bytes = max_bytes / kNumShards;
+  for (int i = 0; i < kNumShards; ++i) {
+    Shard& shard = shards_[i];
+    // Unlink the blocks to release under the lock, free them outside of it.
+    FreeBlock* released[kMaxSizeClasses] = {};
+    {
+      absl::MutexLock lock(&shard.mutex);
+      // Release the largest blocks first.
+      for (int c = kMaxSizeClasses - 1;
+           c >= 0 && shard.cached_bytes > max_shard_bytes; --c) {
+        const size_t excess = shard.cached_bytes - max_shard_bytes;
+        const size_t n = std::min<size_t>(
+            shard.counts[c], (excess + ClassSize(c) - 1) / ClassSize(c));
+        released[c] = UnlinkOldest(shard, c, static_cast<uint32_t>(n));
+      }
+    }
+    FreeBlocks(released);
+  }
+}
+
+ArenaBlockPool::Stats ArenaBlockPool::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.unpooled = unpooled_.load(std::memory_order_relaxed);
+  stats.overflows = overflows_.load(std::memory_order_relaxed);
+  stats.idle_releases = idle_releases_.load(std::memory_order_relaxed);
+  for (int i = 0; i < kNumShards; ++i) {
+    absl::MutexLock lock(&shards_[i].mutex);
+    stats.cached_bytes += shards_[i].cached_bytes;
+  }
+  return stats;
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
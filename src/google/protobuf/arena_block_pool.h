@@ -0,0 +1,174 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file defines ArenaBlockPool, a cache of arena memory blocks that can be
+// shared by many Arena instances.
+//
+// Servers that create an Arena per request and destroy it at the end of the
+// request return every block to the system allocator and then allocate the
+// same block sizes again for the next request. Setting
+// `ArenaOptions::block_pool` makes the arena obtain its blocks from the pool
+// and return them there instead, so blocks are recycled across arena
+// lifetimes:
+//
+//   ArenaOptions options;
+//   options.block_pool = ArenaBlockPool::Default();
+//   Arena arena(options);
+
+#ifndef GOOGLE_PROTOBUF_ARENA_BLOCK_POOL_H__
+#define GOOGLE_PROTOBUF_ARENA_BLOCK_POOL_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// A thread-safe pool of memory blocks of common arena block sizes.
+//
+// Blocks are kept in power-of-two size classes starting at
+// `kMinPooledBlockSize`. The pool is split into shards, each thread using the
+// shard it was assigned on first use, so that threads recycling blocks rarely
+// contend with each other. The amount of memory cached is bounded; blocks
+// returned to a full shard, and blocks larger than `max_block_size`, go back to
+// the system allocator. Blocks that stay unused are released periodically, see
+// `Options::idle_release_interval`, and Trim() releases cached blocks
+// explicitly, for example when the process is under memory pressure.
+//
+// A pool must outlive every arena using it.
+class PROTOBUF_EXPORT ArenaBlockPool {
+ public:
+  // Smallest pooled size class; smaller requests are rounded up.
+  static constexpr size_t kMinPooledBlockSize = 256;
+
+  struct Options {
+    // Blocks larger than this are never pooled.
+    size_t max_block_size = 64 << 10;
+    // Maximum number of bytes cached across all shards.
+    size_t max_cached_bytes = 16 << 20;
+    // Every `idle_release_interval` pooled block requests, the cached blocks
+    // that were not reused since the previous interval are returned to the
+    // system allocator. Size classes that ran out of cached blocks during the
+    // interval, and so missed, keep all of theirs. Zero disables this.
+    uint64_t idle_release_interval = 16 << 10;
+  };
+
+  struct Stats {
+    // Block requests served from the pool.
+    uint64_t hits = 0;
+    // Block requests of a pooled size class that had to allocate.
+    uint64_t misses = 0;
+    // Block requests too large to be pooled.
+    uint64_t unpooled = 0;
+    // Blocks returned to the system allocator because the pool was full.
+    uint64_t overflows = 0;
+    // Cached blocks returned to the system allocator because they were idle.
+    uint64_t idle_releases = 0;
+    // Bytes currently cached in the pool.
+    size_t cached_bytes = 0;
+  };
+
+  ArenaBlockPool() : ArenaBlockPool(Options()) {}
+  explicit ArenaBlockPool(const Options& options);
+  ArenaBlockPool(const ArenaBlockPool&) = delete;
+  ArenaBlockPool& operator=(const ArenaBlockPool&) = delete;
+  ~ArenaBlockPool();
+
+  // Returns a process-wide pool with default options. It is never destroyed.
+  static ArenaBlockPool* Default();
+
+  // Returns a block of at least `size` bytes and its actual size. Called by
+  // Arena; exposed for custom block allocators.
+  internal::SizedPtr Allocate(size_t size);
+
+  // Returns a block obtained from Allocate() to the pool.
+  void Deallocate(void* p, size_t size);
+
+  // Returns cached blocks to the system allocator until at most `max_bytes`
+  // remain cached.
+  void Trim(size_t max_bytes = 0);
+
+  Stats GetStats() const;
+
+ private:
+  static constexpr int kNumShards = 8;
+  // Size classes range from 256 bytes to 128MiB.
+  static constexpr int kMaxSizeClasses = 20;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct Shard {
+    absl::Mutex mutex;
+    FreeBlock* free_lists[kMaxSizeClasses] ABSL_GUARDED_BY(mutex) = {};
+    // Length of each free list, and the shortest it has been since the last
+    // idle release: that many blocks at the end of the list were not reused.
+    uint32_t counts[kMaxSizeClasses] ABSL_GUARDED_BY(mutex) = {};
+    uint32_t low_water[kMaxSizeClasses] ABSL_GUARDED_BY(mutex) = {};
+    size_t cached_bytes ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  // Returns the size class of `size`, which must not exceed max_block_size_.
+  static int SizeClass(size_t size);
+  static size_t ClassSize(int size_class) {
+    return kMinPooledBlockSize << size_class;
+  }
+
+  // Returns the shard used by the calling thread.
+  Shard& ThreadShard();
+  uint32_t ShardBit(const Shard& shard) const {
+    return uint32_t{1} << (&shard - shards_.get());
+  }
+
+  // Takes a block of `size_class` from `shard`, or returns nullptr.
+  FreeBlock* PopBlock(Shard& shard, int size_class);
+  // Unlinks the last, least recently cached, `n` blocks of `size_class` from
+  // `shard` and returns them as a list.
+  FreeBlock* UnlinkOldest(Shard& shard, int size_class, uint32_t n)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex);
+  // Frees the lists of blocks unlinked from each size class and returns the
+  // number of blocks freed.
+  static uint64_t FreeBlocks(FreeBlock* (&blocks)[kMaxSizeClasses]);
+
+  // Counts a pooled block request and releases idle blocks once per
+  // `idle_release_interval_` requests.
+  void MaybeReleaseIdleBlocks();
+  void ReleaseIdleBlocks();
+
+  const size_t max_block_size_;
+  const size_t max_shard_bytes_;
+  const uint64_t idle_release_interval_;
+  std::unique_ptr<Shard[]> shards_;
+  // Bit i of entry c is set while shards_[i] has cached blocks of size class
+  // c, so that Allocate() only locks the shards that can serve a request.
+  std::atomic<uint32_t> nonempty_shards_[kMaxSizeClasses] = {};
+  static_assert(kNumShards <= 32, "one bit per shard");
+
+  std::atomic<uint64_t> pooled_requests_{0};
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> unpooled_{0};
+  std::atomic<uint64_t> overflows_{0};
+  std::atomic<uint64_t> idle_releases_{0};
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_ARENA_BLOCK_POOL_H__
@@ -31,6 +31,7 @@
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/barrier.h"
 #include "absl/utility/utility.h"
+#include "google/protobuf/arena_block_pool.h"
 #include "google/protobuf/arena_cleanup.h"
 #include "google/protobuf/arena_test_util.h"
 #include "google/protobuf/descriptor.h"
@@ -1756,6 +1757,138 @@ TEST(ArenaTest, BlockSizeSmallerThanAllocation) {
   }
 }
 
+// Allocates a few blocks worth of memory on `arena`.
+void FillArena(Arena* arena) {
+  for (int i = 0; i < 100; ++i) {
+    Arena::CreateArray<char>(arena, 100);
+  }
+}
+
+TEST(ArenaTest, BlockPoolRecyclesBlocksAcrossArenas) {
+  ArenaBlockPool pool;
+  ArenaOptions options;
+  options.block_pool = &pool;
+
+  {
+    Arena arena(options);
+    FillArena(&arena);
+  }
+  ArenaBlockPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_GT(stats.misses, 0u);
+  EXPECT_GT(stats.cached_bytes, 0u);
+  const uint64_t first_misses = stats.misses;
+
+  for (int i = 0; i < 10; ++i) {
+    Arena arena(options);
+    FillArena(&arena);
+    TestAllTypes* message = Arena::Create<TestAllTypes>(&arena);
+    TestUtil::SetAllFields(message);
+    TestUtil::ExpectAllFieldsSet(*message);
+  }
+  stats = pool.GetStats();
+  EXPECT_GE(stats.hits, 10 * first_misses);
+  EXPECT_EQ(stats.overflows, 0u);
+
+  pool.Trim();
+  EXPECT_EQ(pool.GetStats().cached_bytes, 0u);
+}
+
+TEST(ArenaTest, BlockPoolDoesNotPoolLargeBlocks) {
+  ArenaBlockPool::Options pool_options;
+  pool_options.max_block_size = 1024;
+  ArenaBlockPool pool(pool_options);
+  ArenaOptions options;
+  options.block_pool = &pool;
+  {
+    Arena arena(options);
+    Arena::CreateArray<char>(&arena, 4096);
+  }
+  ArenaBlockPool::Stats stats = pool.GetStats();
+  EXPECT_GT(stats.unpooled, 0u);
+  EXPECT_LE(stats.cached_bytes, 1024u * 2);
+}
+
+TEST(ArenaTest, BlockPoolBoundsCachedBytes) {
+  ArenaBlockPool::Options pool_options;
+  pool_options.max_cached_bytes = 0;
+  ArenaBlockPool pool(pool_options);
+  ArenaOptions options;
+  options.block_pool = &pool;
+  {
+    Arena arena(options);
+    FillArena(&arena);
+  }
+  ArenaBlockPool::Stats stats = pool.GetStats();
+  EXPECT_GT(stats.overflows, 0u);
+  EXPECT_EQ(stats.cached_bytes, 0u);
+}
+
+TEST(ArenaTest, BlockPoolSharedAcrossThreads) {
+  ArenaBlockPool pool;
+  ArenaOptions options;
+  options.block_pool = &pool;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 100; ++i) {
+        // Create on this thread, destroy on another one half of the time.
+        auto arena = std::make_unique<Arena>(options);
+        FillArena(arena.get());
+        if (i % 2 == 0) {
+          std::thread([arena = std::move(arena)] {}).join();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  ArenaBlockPool::Stats stats = pool.GetStats();
+  EXPECT_GT(stats.hits, stats.misses);
+}
+
+TEST(ArenaTest, BlockPoolTakesBlocksFromOtherShards) {
+  ArenaBlockPool pool;
+  internal::SizedPtr block = pool.Allocate(1024);
+  // Another thread usually returns the block to another shard.
+  std::thread([&] { pool.Deallocate(block.p, block.n); }).join();
+
+  internal::SizedPtr again = pool.Allocate(1024);
+  EXPECT_EQ(again.p, block.p);
+  EXPECT_EQ(pool.GetStats().hits, 1u);
+  // Nothing of this size is cached anymore.
+  internal::SizedPtr other = pool.Allocate(1024);
+  EXPECT_EQ(pool.GetStats().misses, 2u);
+  pool.Deallocate(again.p, again.n);
+  pool.Deallocate(other.p, other.n);
+}
+
+TEST(ArenaTest, BlockPoolReleasesIdleBlocks) {
+  ArenaBlockPool::Options pool_options;
+  pool_options.idle_release_interval = 8;
+  ArenaBlockPool pool(pool_options);
+
+  // Cache blocks of a size that is not requested again.
+  std::vector<internal::SizedPtr> blocks;
+  for (int i = 0; i < 4; ++i) blocks.push_back(pool.Allocate(4096));
+  for (const internal::SizedPtr& block : blocks) {
+    pool.Deallocate(block.p, block.n);
+  }
+  EXPECT_EQ(pool.GetStats().cached_bytes, 4u * 4096);
+
+  // Keep recycling a block of another size. The idle blocks are released
+  // once they have sat unused for a whole interval; the recycled one stays.
+  for (int i = 0; i < 32; ++i) {
+    internal::SizedPtr block = pool.Allocate(256);
+    pool.Deallocate(block.p, block.n);
+  }
+  ArenaBlockPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.idle_releases, 4u);
+  EXPECT_EQ(stats.cached_bytes, 256u);
+  EXPECT_EQ(stats.hits, 31u);
+}
+
 TEST(ArenaTest, GetArenaShouldReturnTheArenaForArenaAllocatedMessages) {
   Arena arena;
   ArenaMessage* message = Arena::Create<ArenaMessage>(&arena);
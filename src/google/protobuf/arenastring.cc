@@ -94,13 +94,15 @@ TaggedStringPtr CreateArenaString(Arena& arena, absl::string_view s) {
 }  // namespace
 
 TaggedStringPtr TaggedStringPtr::ForceCopy(Arena* arena) const {
-  return arena != nullptr ? CreateArenaString(*arena, *Get())
-                          : CreateString(*Get());
+  absl::string_view value =
+      IsAliased() ? *GetAliased() : absl::string_view(*Get());
+  return arena != nullptr ? CreateArenaString(*arena, value)
+                          : CreateString(value);
 }
 
 void ArenaStringPtr::Set(absl::string_view value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (IsDefault() || IsAliased()) {
     // If we're not on an arena, skip straight to a true string to avoid
     // possible copy cost later.
     tagged_ptr_ = arena != nullptr ? CreateArenaString(*arena, value)
@@ -125,7 +127,7 @@ void ArenaStringPtr::Set(absl::string_view value, Arena* arena) {
 template <>
 void ArenaStringPtr::Set(const std::string& value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (IsDefault() || IsAliased()) {
     // If we're not on an arena, skip straight to a true string to avoid
     // possible copy cost later.
     tagged_ptr_ = arena != nullptr ? CreateArenaString(*arena, value)
@@ -149,7 +151,7 @@ void ArenaStringPtr::Set(const std::string& value, Arena* arena) {
 
 void ArenaStringPtr::Set(std::string&& value, Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
-  if (IsDefault()) {
+  if (IsDefault() || IsAliased()) {
     NewString(arena, std::move(value));
   } else if (IsFixedSizeArena()) {
     std::string* current = tagged_ptr_.Get();
@@ -161,6 +163,16 @@ void ArenaStringPtr::Set(std::string&& value, Arena* arena) {
   }
 }
 
+void ArenaStringPtr::SetAliased(absl::string_view value, Arena* arena) {
+  ScopedCheckPtrInvariants check(&tagged_ptr_);
+  if (!TaggedStringPtr::kSupportsAliasing || arena == nullptr) {
+    Set(value, arena);
+    return;
+  }
+  Destroy();
+  tagged_ptr_.SetAliased(Arena::Create<absl::string_view>(arena, value));
+}
+
 std::string* ArenaStringPtr::Mutable(Arena* arena) {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
   if (tagged_ptr_.IsMutable()) {
@@ -185,7 +197,7 @@ std::string* ArenaStringPtr::MutableNoCopy(Arena* arena) {
   if (tagged_ptr_.IsMutable()) {
     return tagged_ptr_.Get();
   } else {
-    ABSL_DCHECK(IsDefault());
+    ABSL_DCHECK(IsDefault() || IsAliased());
     // Allocate empty. The contents are not relevant.
     return NewString(arena);
   }
@@ -194,6 +206,10 @@ std::string* ArenaStringPtr::MutableNoCopy(Arena* arena) {
 template <typename... Lazy>
 std::string* ArenaStringPtr::MutableSlow(::google::protobuf::Arena* arena,
                                          const Lazy&... lazy_default) {
+  if (IsAliased()) {
+    // Copy on first mutation.
+    return NewString(arena, *tagged_ptr_.GetAliased());
+  }
   ABSL_DCHECK(IsDefault());
 
   // For empty defaults, this ends up calling the default constructor which is
@@ -205,6 +221,11 @@ std::string* ArenaStringPtr::MutableSlow(::google::protobuf::Arena* arena,
 std::string* ArenaStringPtr::Release() {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
   if (IsDefault()) return nullptr;
+  if (IsAliased()) {
+    std::string* released = new std::string(*tagged_ptr_.GetAliased());
+    InitDefault();
+    return released;
+  }
 
   std::string* released = tagged_ptr_.Get();
   if (tagged_ptr_.IsArena()) {
@@ -243,6 +264,8 @@ void ArenaStringPtr::ClearToEmpty() {
   ScopedCheckPtrInvariants check(&tagged_ptr_);
   if (IsDefault()) {
     // Already set to default -- do nothing.
+  } else if (IsAliased()) {
+    InitDefault();
   } else {
     // Unconditionally mask away the tag.
     //
@@ -259,6 +282,8 @@ void ArenaStringPtr::ClearToDefault(const LazyString& default_value,
   (void)arena;
   if (IsDefault()) {
     // Already set to default -- do nothing.
+  } else if (IsAliased()) {
+    InitDefault();
   } else {
     UnsafeMutablePointer()->assign(default_value.get());
   }
@@ -279,6 +304,30 @@ const char* EpsCopyInputStream::ReadArenaString(const char* ptr,
   return ptr;
 }
 
+const char* EpsCopyInputStream::ReadAliasedArenaString(const char* ptr,
+                                                       ArenaStringPtr* s,
+                                                       Arena* arena) {
+  ScopedCheckPtrInvariants check(&s->tagged_ptr_);
+  ABSL_DCHECK(arena != nullptr);
+
+  int size = ReadSize(&ptr);
+  if (!ptr) return nullptr;
+
+  const char* aliased;
+  if (TaggedStringPtr::kSupportsAliasing &&
+      (aliased = AliasedData(ptr, size)) != nullptr) {
+    s->tagged_ptr_.SetAliased(
+        Arena::Create<absl::string_view>(arena, aliased, size));
+    return ptr + size;
+  }
+
+  // The bytes are not contiguous in the input, copy them.
+  auto* str = s->NewString(arena);
+  ptr = ReadString(ptr, size, str);
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ptr;
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -75,9 +75,16 @@ class PROTOBUF_EXPORT TaggedStringPtr {
   enum Flags {
     kArenaBit = 0x1,    // ptr is arena allocated
     kMutableBit = 0x2,  // ptr contents are fully mutable
-    kMask = 0x3         // Bit mask
+    kMask = 0x3,        // Bit mask
+    // ptr points to an arena allocated `absl::string_view` referencing memory
+    // owned by the user, see `kAliased`. Only used when kSupportsAliasing.
+    kAliasedBit = 0x4,
   };
 
+  // Aliased strings need a third tag bit, which is only available when
+  // std::string is aligned on at least 8 bytes, as on all 64 bit platforms.
+  static constexpr bool kSupportsAliasing = alignof(std::string) >= 8;
+
   // Composed logical types
   enum Type {
     // Default strings are immutable and never owned.
@@ -100,6 +107,13 @@ class PROTOBUF_EXPORT TaggedStringPtr {
     // updates to the content that fit inside the existing capacity.
     // Fixed size arena strings must never be deleted or destroyed.
     kFixedSizeArena = kArenaBit,
+
+    // Aliased strings are views of bytes owned by the user, typically the
+    // input buffer of a parse with `kMergeWithAliasing`. The view itself is
+    // allocated on the arena; the bytes it references must outlive the arena.
+    // Aliased strings are immutable and never owned. They are neither default
+    // nor std::string values: `Get()` must not be used on them.
+    kAliased = kAliasedBit,
   };
 
   TaggedStringPtr() = default;
@@ -133,11 +147,34 @@ class PROTOBUF_EXPORT TaggedStringPtr {
     return TagAs(kMutableArena, p);
   }
 
+  // Sets the value to `view`, tagging the value as an aliased string.
+  // See documentation for kAliased for more info.
+  // `view` must not be null and must be arena allocated.
+  inline void SetAliased(const absl::string_view* view) {
+    ABSL_DCHECK(kSupportsAliasing);
+    ABSL_DCHECK(view != nullptr);
+    ABSL_DCHECK_EQ(reinterpret_cast<uintptr_t>(view) & (kMask | kAliasedBit),
+                   0UL);
+    ptr_ = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(view) |
+                                   kAliased);
+  }
+
   // Returns true if the contents of the current string are fully mutable.
   inline bool IsMutable() const { return as_int() & kMutableBit; }
 
   // Returns true if the current string is an immutable default value.
-  inline bool IsDefault() const { return (as_int() & kMask) == kDefault; }
+  inline bool IsDefault() const { return (as_int() & kTypeMask) == kDefault; }
+
+  // Returns true if the current string is an aliased value.
+  inline bool IsAliased() const {
+    return kSupportsAliasing && (as_int() & kAliasedBit) != 0;
+  }
+
+  // Returns the aliased view. Requires `IsAliased()`.
+  inline const absl::string_view* GetAliased() const {
+    ABSL_DCHECK(IsAliased());
+    return reinterpret_cast<const absl::string_view*>(as_int() & ~kTypeMask);
+  }
 
   // If the current string is a heap-allocated mutable value, returns a pointer
   // to it.  Returns nullptr otherwise.
@@ -179,6 +216,10 @@ class PROTOBUF_EXPORT TaggedStringPtr {
   TaggedStringPtr Copy(Arena* arena, const LazyString& default_value) const;
 
  private:
+  // Mask of all tag bits in use on this platform.
+  static constexpr uintptr_t kTypeMask =
+      kSupportsAliasing ? kMask | kAliasedBit : kMask;
+
   static inline void assert_aligned(const void* p) {
     static_assert(kMask <= alignof(void*), "Pointer underaligned for bit mask");
     static_assert(kMask <= alignof(std::string),
@@ -327,12 +368,27 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
   // it will be initialized into an empty mutable arena string.
   std::string* MutableNoCopy(Arena* arena);
 
+  // Sets the value to an aliased view of `value`, which must outlive `arena`.
+  // Copies `value` if aliasing is not supported by the platform or `arena` is
+  // null. Used when parsing with `kMergeWithAliasing`.
+  void SetAliased(absl::string_view value, Arena* arena);
+
   // Basic accessors.
+  // Get() must not be used on aliased values, use GetView() instead.
   PROTOBUF_NDEBUG_INLINE const std::string& Get() const {
+    ABSL_DCHECK(!tagged_ptr_.IsAliased());
     // Unconditionally mask away the tag.
     return *tagged_ptr_.Get();
   }
 
+  // Returns the current value, which may be an aliased value.
+  PROTOBUF_NDEBUG_INLINE absl::string_view GetView() const {
+    if (PROTOBUF_PREDICT_FALSE(tagged_ptr_.IsAliased())) {
+      return *tagged_ptr_.GetAliased();
+    }
+    return *tagged_ptr_.Get();
+  }
+
   // Returns a pointer to the stored contents for this instance.
   // This method is for internal debugging and tracking purposes only.
   PROTOBUF_NDEBUG_INLINE const std::string* UnsafeGetPointer() const
@@ -387,6 +443,9 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
   // Returns true if this instances holds an immutable default value.
   inline bool IsDefault() const { return tagged_ptr_.IsDefault(); }
 
+  // Returns true if this instance holds an aliased value.
+  inline bool IsAliased() const { return tagged_ptr_.IsAliased(); }
+
  private:
   template <typename... Args>
   inline std::string* NewString(Arena* arena, Args&&... args) {
@@ -415,7 +474,7 @@ struct PROTOBUF_EXPORT ArenaStringPtr {
 
   // Slow paths.
 
-  // MutableSlow requires that !IsString() || IsDefault
+  // MutableSlow requires that IsDefault() || IsAliased()
   // Variadic to support 0 args for empty default and 1 arg for LazyString.
   template <typename... Lazy>
   std::string* MutableSlow(::google::protobuf::Arena* arena, const Lazy&... lazy_default);
@@ -501,7 +560,7 @@ inline PROTOBUF_NDEBUG_INLINE void ArenaStringPtr::InternalSwap(
   std::swap(lhs->tagged_ptr_, rhs->tagged_ptr_);
   if (internal::DebugHardenForceCopyInSwap()) {
     for (auto* p : {lhs, rhs}) {
-      if (p->IsDefault()) continue;
+      if (p->IsDefault() || p->IsAliased()) continue;
       std::string* old_value = p->tagged_ptr_.Get();
       std::string* new_value =
           p->IsFixedSizeArena()
@@ -518,8 +577,12 @@ inline PROTOBUF_NDEBUG_INLINE void ArenaStringPtr::InternalSwap(
 }
 
 inline void ArenaStringPtr::ClearNonDefaultToEmpty() {
-  // Unconditionally mask away the tag.
   ABSL_DCHECK(!tagged_ptr_.IsDefault());
+  if (PROTOBUF_PREDICT_FALSE(tagged_ptr_.IsAliased())) {
+    InitDefault();
+    return;
+  }
+  // Unconditionally mask away the tag.
   tagged_ptr_.Get()->clear();
 }
 
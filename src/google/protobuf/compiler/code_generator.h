@@ -124,6 +124,15 @@ class PROTOC_EXPORT CodeGenerator {
   // proto files with an edition after this will result in an error.
   virtual Edition GetMaximumEdition() const { return Edition::EDITION_UNKNOWN; }
 
+  // Implement this to return true if Generate() may be called concurrently
+  // for different files, each call with its own GeneratorContext.  This
+  // requires the output for each file to be independent of the output for
+  // all other files: a file's Generate() must not append or insert into
+  // files written by the Generate() of another file.  When this returns
+  // true, protoc may split the files into shards that are generated in
+  // parallel (see --jobs).
+  virtual bool SupportsConcurrentGeneration() const { return false; }
+
   // Builds a default feature set mapping for this generator.
   //
   // This will use the extensions specified by GetFeatureExtensions(), with the
@@ -18,6 +18,8 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -25,7 +27,9 @@
 #include <iostream>
 #include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 #ifdef major
@@ -54,6 +58,7 @@
 #include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/log/globals.h"
@@ -61,6 +66,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_replace.h"
@@ -78,6 +84,7 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/descriptor_database.h"
+#include "google/protobuf/descriptor_snapshot.h"
 #include "google/protobuf/descriptor_visitor.h"
 #include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/feature_resolver.h"
@@ -303,6 +310,29 @@ bool GetBootstrapParam(const std::string& parameter) {
   return false;
 }
 
+// With --jobs, files are split into this many shards per thread so that files
+// of uneven size do not leave threads idle.
+constexpr size_t kShardsPerJob = 4;
+
+// Calls `fn(i)` for every i in [0, n) using up to `num_threads` threads,
+// including the calling one.
+void ParallelFor(int num_threads, size_t n,
+                 absl::FunctionRef<void(size_t)> fn) {
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    size_t i;
+    while ((i = next.fetch_add(1, std::memory_order_relaxed)) < n) {
+      fn(i);
+    }
+  };
+  const size_t num_workers =
+      std::min(static_cast<size_t>(std::max(num_threads, 1)), n);
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_workers; ++i) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+}
+
 
 }  // namespace
 
@@ -451,6 +481,14 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
 
   // Get name of all output files.
   void GetOutputFilenames(std::vector<std::string>* output_filenames);
+
+  // Moves all files written to `other` into this directory, as if they had
+  // been written to this directory with Open().
+  void MergeFrom(GeneratorContextImpl& other);
+
+  // Sets the stream errors are reported to.  Defaults to std::cerr.
+  void set_error_stream(std::ostream* errors) { errors_ = errors; }
+  std::ostream& errors() { return *errors_; }
   // implements GeneratorContext --------------------------------------
   io::ZeroCopyOutputStream* Open(const std::string& filename) override;
   io::ZeroCopyOutputStream* OpenForAppend(const std::string& filename) override;
@@ -472,6 +510,7 @@ class CommandLineInterface::GeneratorContextImpl : public GeneratorContext {
   absl::btree_map<std::string, std::string> files_;
   const std::vector<const FileDescriptor*>& parsed_files_;
   bool had_error_;
+  std::ostream* errors_ = &std::cerr;
 };
 
 class CommandLineInterface::MemoryOutputStream
@@ -654,6 +693,22 @@ bool CommandLineInterface::GeneratorContextImpl::WriteAllToZip(
   return true;
 }
 
+void CommandLineInterface::GeneratorContextImpl::MergeFrom(
+    GeneratorContextImpl& other) {
+  had_error_ |= other.had_error_;
+  for (auto& pair : other.files_) {
+    auto it = files_.find(pair.first);
+    if (it != files_.end()) {
+      errors() << pair.first << ": Tried to write the same file twice."
+               << std::endl;
+      had_error_ = true;
+      continue;
+    }
+    files_.emplace(pair.first, std::move(pair.second));
+  }
+  other.files_.clear();
+}
+
 void CommandLineInterface::GeneratorContextImpl::AddJarManifest() {
   auto pair = files_.insert({"META-INF/MANIFEST.MF", ""});
   if (pair.second) {
@@ -777,7 +832,7 @@ void CommandLineInterface::MemoryOutputStream::UpdateMetadata(
     if (!metadata.ParseFromString(*encoded_data)) {
       if (!TextFormat::ParseFromString(*encoded_data, &metadata)) {
         // The metadata is invalid.
-        std::cerr
+        directory_->errors()
             << filename_
             << ".pb.meta: Could not parse metadata as wire or text format."
             << std::endl;
@@ -842,8 +897,9 @@ CommandLineInterface::MemoryOutputStream::~MemoryOutputStream() {
       if (append_mode_) {
         it->second.append(data_);
       } else {
-        std::cerr << filename_ << ": Tried to write the same file twice."
-                  << std::endl;
+        directory_->errors()
+            << filename_ << ": Tried to write the same file twice."
+            << std::endl;
         directory_->had_error_ = true;
       }
       return;
@@ -861,8 +917,9 @@ CommandLineInterface::MemoryOutputStream::~MemoryOutputStream() {
 
   // Find the file we are going to insert into.
   if (!already_present) {
-    std::cerr << filename_ << ": Tried to insert into file that doesn't exist."
-              << std::endl;
+    directory_->errors() << filename_
+                         << ": Tried to insert into file that doesn't exist."
+                         << std::endl;
     directory_->had_error_ = true;
     return;
   }
@@ -874,8 +931,8 @@ CommandLineInterface::MemoryOutputStream::~MemoryOutputStream() {
   std::string::size_type pos = target->find(magic_string);
 
   if (pos == std::string::npos) {
-    std::cerr << filename_ << ": insertion point \"" << insertion_point_
-              << "\" not found." << std::endl;
+    directory_->errors() << filename_ << ": insertion point \""
+                         << insertion_point_ << "\" not found." << std::endl;
     directory_->had_error_ = true;
     return;
   }
@@ -1318,32 +1375,12 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
     return 1;
   }
 
-  // We construct a separate GeneratorContext for each output location.  Note
-  // that two code generators may output to the same location, in which case
-  // they should share a single GeneratorContext so that OpenForInsert() works.
   GeneratorContextMap output_directories;
 
   // Generate output.
   if (mode_ == MODE_COMPILE) {
-    for (size_t i = 0; i < output_directives_.size(); ++i) {
-      std::string output_location = output_directives_[i].output_location;
-      if (!absl::EndsWith(output_location, ".zip") &&
-          !absl::EndsWith(output_location, ".jar") &&
-          !absl::EndsWith(output_location, ".srcjar")) {
-        AddTrailingSlash(&output_location);
-      }
-
-      auto& generator = output_directories[output_location];
-
-      if (!generator) {
-        // First time we've seen this output location.
-        generator = std::make_unique<GeneratorContextImpl>(parsed_files);
-      }
-
-      if (!GenerateOutput(parsed_files, output_directives_[i],
-                          generator.get())) {
-        return 1;
-      }
+    if (!GenerateOutputs(parsed_files, &output_directories)) {
+      return 1;
     }
   }
 
@@ -1379,6 +1416,12 @@ int CommandLineInterface::Run(int argc, const char* const argv[]) {
     }
   }
 
+  if (!descriptor_snapshot_out_name_.empty()) {
+    if (!WriteDescriptorSnapshot(parsed_files, *descriptor_pool)) {
+      return 1;
+    }
+  }
+
   if (!edition_defaults_out_name_.empty()) {
     if (!WriteEditionDefaults(*descriptor_pool)) {
       return 1;
@@ -1655,6 +1698,7 @@ void CommandLineInterface::Clear() {
   codec_type_.clear();
   descriptor_set_in_names_.clear();
   descriptor_set_out_name_.clear();
+  descriptor_snapshot_out_name_.clear();
   dependency_out_name_.clear();
 
   experimental_editions_ = false;
@@ -1670,6 +1714,7 @@ void CommandLineInterface::Clear() {
   disallow_services_ = false;
   direct_dependencies_explicitly_set_ = false;
   deterministic_output_ = false;
+  jobs_ = 1;
 }
 
 bool CommandLineInterface::MakeProtoProtoPathRelative(
@@ -1916,7 +1961,9 @@ CommandLineInterface::ParseArgumentStatus CommandLineInterface::ParseArguments(
     return PARSE_ARGUMENT_FAIL;
   }
   if (mode_ == MODE_COMPILE && output_directives_.empty() &&
-      descriptor_set_out_name_.empty() && edition_defaults_out_name_.empty()) {
+      descriptor_set_out_name_.empty() &&
+      descriptor_snapshot_out_name_.empty() &&
+      edition_defaults_out_name_.empty()) {
     std::cerr << "Missing output directives." << std::endl;
     return PARSE_ARGUMENT_FAIL;
   }
@@ -2168,6 +2215,24 @@ CommandLineInterface::InterpretArgument(const std::string& name,
     }
     descriptor_set_out_name_ = value;
 
+  } else if (name == "--descriptor_snapshot_out") {
+    if (!descriptor_snapshot_out_name_.empty()) {
+      std::cerr << name << " may only be passed once." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    if (value.empty()) {
+      std::cerr << name << " requires a non-empty value." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    if (mode_ != MODE_COMPILE) {
+      std::cerr
+          << "Cannot use --encode or --decode and generate descriptors at the "
+             "same time."
+          << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    descriptor_snapshot_out_name_ = value;
+
   } else if (name == "--dependency_out") {
     if (!dependency_out_name_.empty()) {
       std::cerr << name << " may only be passed once." << std::endl;
@@ -2232,7 +2297,8 @@ CommandLineInterface::InterpretArgument(const std::string& name,
                 << std::endl;
       return PARSE_ARGUMENT_FAIL;
     }
-    if (!output_directives_.empty() || !descriptor_set_out_name_.empty()) {
+    if (!output_directives_.empty() || !descriptor_set_out_name_.empty() ||
+        !descriptor_snapshot_out_name_.empty()) {
       std::cerr << "Cannot use " << name
                 << " and generate code or descriptors at the same time."
                 << std::endl;
@@ -2274,6 +2340,16 @@ CommandLineInterface::InterpretArgument(const std::string& name,
       return PARSE_ARGUMENT_FAIL;
     }
     fatal_warnings_ = true;
+  } else if (name == "--jobs") {
+    int jobs;
+    if (!absl::SimpleAtoi(value, &jobs) || jobs < 0) {
+      std::cerr << name << " must be a non-negative integer." << std::endl;
+      return PARSE_ARGUMENT_FAIL;
+    }
+    if (jobs == 0) {
+      jobs = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    jobs_ = jobs;
   } else if (name == "--plugin") {
     if (plugin_prefix_.empty()) {
       std::cerr << "This compiler does not support plugins." << std::endl;
@@ -2307,7 +2383,8 @@ CommandLineInterface::InterpretArgument(const std::string& name,
                 << "other info at the same time." << std::endl;
       return PARSE_ARGUMENT_FAIL;
     }
-    if (!output_directives_.empty() || !descriptor_set_out_name_.empty()) {
+    if (!output_directives_.empty() || !descriptor_set_out_name_.empty() ||
+        !descriptor_snapshot_out_name_.empty()) {
       std::cerr << "Cannot use " << name
                 << " and generate code or descriptors at the same time."
                 << std::endl;
@@ -2491,6 +2568,12 @@ Parse PROTO_FILES and generate output based on the options given:
                               This results in potentially larger descriptors
                               that include information about options that were
                               only meant to be useful during compilation.
+  --descriptor_snapshot_out=FILE
+                              Writes a descriptor snapshot of the input files
+                              and all of their dependencies to FILE.  A
+                              snapshot can be mapped into memory and loaded
+                              lazily into a DescriptorPool at runtime; see
+                              google/protobuf/descriptor_snapshot.h.
   --dependency_out=FILE       Write a dependency output file in the format
                               expected by make. This writes the transitive
                               set of input file paths to FILE
@@ -2501,6 +2584,12 @@ Parse PROTO_FILES and generate output based on the options given:
                               gcc). This flag will make protoc return
                               with a non-zero exit code if any warnings
                               are generated.
+  --jobs=N                    Run code generators using up to N threads.
+                              Different output locations are generated
+                              concurrently, and generators that support it
+                              also generate different files concurrently.
+                              The output does not depend on N. 0 means the
+                              number of CPUs; the default is 1.
   --print_free_field_numbers  Print the free field numbers of the messages
                               defined in the given proto files. Extension ranges
                               are counted as occupied fields numbers.
@@ -2547,21 +2636,22 @@ Parse PROTO_FILES and generate output based on the options given:
 
 bool CommandLineInterface::EnforceProto3OptionalSupport(
     const std::string& codegen_name, uint64_t supported_features,
-    const std::vector<const FileDescriptor*>& parsed_files) const {
+    const std::vector<const FileDescriptor*>& parsed_files,
+    std::ostream& errors) const {
   bool supports_proto3_optional =
       supported_features & CodeGenerator::FEATURE_PROTO3_OPTIONAL;
   if (!supports_proto3_optional) {
     for (const auto fd : parsed_files) {
       if (ContainsProto3Optional(
               ::google::protobuf::internal::InternalFeatureHelper::GetEdition(*fd), fd)) {
-        std::cerr << fd->name()
-                  << ": is a proto3 file that contains optional fields, but "
-                     "code generator "
-                  << codegen_name
-                  << " hasn't been updated to support optional fields in "
-                     "proto3. Please ask the owner of this code generator to "
-                     "support proto3 optional."
-                  << std::endl;
+        errors << fd->name()
+               << ": is a proto3 file that contains optional fields, but "
+                  "code generator "
+               << codegen_name
+               << " hasn't been updated to support optional fields in "
+                  "proto3. Please ask the owner of this code generator to "
+                  "support proto3 optional."
+               << std::endl;
         return false;
       }
     }
@@ -2572,7 +2662,8 @@ bool CommandLineInterface::EnforceProto3OptionalSupport(
 bool CommandLineInterface::EnforceEditionsSupport(
     const std::string& codegen_name, uint64_t supported_features,
     Edition minimum_edition, Edition maximum_edition,
-    const std::vector<const FileDescriptor*>& parsed_files) const {
+    const std::vector<const FileDescriptor*>& parsed_files,
+    std::ostream& errors) const {
   if (experimental_editions_) {
     // The user has explicitly specified the experimental flag.
     return true;
@@ -2586,7 +2677,7 @@ bool CommandLineInterface::EnforceEditionsSupport(
     }
 
     if ((supported_features & CodeGenerator::FEATURE_SUPPORTS_EDITIONS) == 0) {
-      std::cerr << absl::Substitute(
+      errors << absl::Substitute(
           "$0: is an editions file, but code generator $1 hasn't been "
           "updated to support editions yet.  Please ask the owner of this code "
           "generator to add support or switch back to proto2/proto3.\n\nSee "
@@ -2595,14 +2686,14 @@ bool CommandLineInterface::EnforceEditionsSupport(
       return false;
     }
     if (edition < minimum_edition) {
-      std::cerr << absl::Substitute(
+      errors << absl::Substitute(
           "$0: is a file using edition $2, which isn't supported by code "
           "generator $1.  Please upgrade your file to at least edition $3.",
           fd->name(), codegen_name, edition, minimum_edition);
       return false;
     }
     if (edition > maximum_edition) {
-      std::cerr << absl::Substitute(
+      errors << absl::Substitute(
           "$0: is a file using edition $2, which isn't supported by code "
           "generator $1.  Please ask the owner of this code generator to add "
           "support or switch back to a maximum of edition $3.",
@@ -2613,10 +2704,172 @@ bool CommandLineInterface::EnforceEditionsSupport(
   return true;
 }
 
+bool CommandLineInterface::GenerateOutputs(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    GeneratorContextMap* output_directories) {
+  // We construct a separate GeneratorContext for each output location.  Note
+  // that two code generators may output to the same location, in which case
+  // they should share a single GeneratorContext so that OpenForInsert() works.
+  const size_t num_directives = output_directives_.size();
+  std::vector<GeneratorContextImpl*> contexts(num_directives);
+  // The position of each directive among the directives of its location.
+  std::vector<size_t> rounds(num_directives);
+  absl::flat_hash_map<GeneratorContextImpl*, size_t> directives_per_context;
+  size_t num_rounds = 0;
+  for (size_t i = 0; i < num_directives; ++i) {
+    std::string output_location = output_directives_[i].output_location;
+    if (!absl::EndsWith(output_location, ".zip") &&
+        !absl::EndsWith(output_location, ".jar") &&
+        !absl::EndsWith(output_location, ".srcjar")) {
+      AddTrailingSlash(&output_location);
+    }
+
+    auto& generator = (*output_directories)[output_location];
+
+    if (!generator) {
+      // First time we've seen this output location.
+      generator = std::make_unique<GeneratorContextImpl>(parsed_files);
+    }
+    contexts[i] = generator.get();
+    rounds[i] = directives_per_context[generator.get()]++;
+    num_rounds = std::max(num_rounds, rounds[i] + 1);
+  }
+
+  if (jobs_ <= 1) {
+    for (size_t i = 0; i < num_directives; ++i) {
+      if (!GenerateOutput(parsed_files, output_directives_[i], contexts[i],
+                          std::cerr)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Directives sharing an output location run in command line order, since a
+  // later one may insert into the output of an earlier one.  Round k runs the
+  // k-th directive of every location concurrently.  A directive whose
+  // generator supports concurrent generation and that runs first at its
+  // location is additionally split into shards of files, each generated into
+  // its own context and merged into the location's context in order.
+  //
+  // Errors are buffered per directive and printed at the end, stopping at the
+  // first failed directive, which is what running the directives one after the
+  // other would have printed.
+  struct Task {
+    size_t directive;
+    std::vector<const FileDescriptor*> files;
+    std::unique_ptr<GeneratorContextImpl> shard_context;
+    std::string errors;
+    bool ok = true;
+  };
+  std::vector<std::string> errors(num_directives);
+  std::vector<bool> failed(num_directives, false);
+  size_t first_failure = num_directives;
+  for (size_t round = 0; round < num_rounds; ++round) {
+    std::vector<Task> tasks;
+    for (size_t i = 0; i < num_directives && i < first_failure; ++i) {
+      if (rounds[i] != round) continue;
+      const OutputDirective& directive = output_directives_[i];
+      if (round > 0 || directive.generator == nullptr ||
+          !directive.generator->SupportsConcurrentGeneration() ||
+          parsed_files.size() < 2) {
+        tasks.push_back({i});
+        continue;
+      }
+      std::ostringstream check_errors;
+      if (!CheckGeneratorSupport(directive, parsed_files, check_errors)) {
+        errors[i] = check_errors.str();
+        failed[i] = true;
+        first_failure = i;
+        break;
+      }
+      const size_t num_shards = std::min(
+          parsed_files.size(), static_cast<size_t>(jobs_) * kShardsPerJob);
+      for (size_t shard = 0; shard < num_shards; ++shard) {
+        Task task{i};
+        task.files.assign(
+            parsed_files.begin() + parsed_files.size() * shard / num_shards,
+            parsed_files.begin() +
+                parsed_files.size() * (shard + 1) / num_shards);
+        task.shard_context =
+            std::make_unique<GeneratorContextImpl>(parsed_files);
+        tasks.push_back(std::move(task));
+      }
+    }
+
+    // A generator that does not support concurrent generation must never be
+    // called from two threads at once, so the tasks of the directives sharing
+    // such a generator run one after the other, in command line order.
+    std::vector<std::vector<size_t>> lanes;
+    absl::flat_hash_map<const CodeGenerator*, size_t> serial_lanes;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+      const CodeGenerator* generator =
+          output_directives_[tasks[t].directive].generator;
+      if (generator != nullptr && !generator->SupportsConcurrentGeneration()) {
+        auto inserted = serial_lanes.try_emplace(generator, lanes.size());
+        if (!inserted.second) {
+          lanes[inserted.first->second].push_back(t);
+          continue;
+        }
+      }
+      lanes.push_back({t});
+    }
+
+    auto run_task = [&](Task& task) {
+      const OutputDirective& directive = output_directives_[task.directive];
+      std::ostringstream task_errors;
+      if (task.shard_context == nullptr) {
+        GeneratorContextImpl* context = contexts[task.directive];
+        context->set_error_stream(&task_errors);
+        task.ok =
+            GenerateOutput(parsed_files, directive, context, task_errors);
+        context->set_error_stream(&std::cerr);
+      } else {
+        task.shard_context->set_error_stream(&task_errors);
+        std::string error;
+        if (!directive.generator->GenerateAll(
+                task.files, GeneratorParameter(directive),
+                task.shard_context.get(), &error)) {
+          task_errors << directive.name << ": " << error << std::endl;
+          task.ok = false;
+        }
+        task.shard_context->set_error_stream(&std::cerr);
+      }
+      task.errors = task_errors.str();
+    };
+    ParallelFor(jobs_, lanes.size(), [&](size_t l) {
+      for (size_t t : lanes[l]) run_task(tasks[t]);
+    });
+
+    for (Task& task : tasks) {
+      const size_t i = task.directive;
+      // Skip the shards following a failed one.
+      if (failed[i]) continue;
+      errors[i] += task.errors;
+      if (task.ok && task.shard_context != nullptr) {
+        std::ostringstream merge_errors;
+        contexts[i]->set_error_stream(&merge_errors);
+        contexts[i]->MergeFrom(*task.shard_context);
+        contexts[i]->set_error_stream(&std::cerr);
+        errors[i] += merge_errors.str();
+      }
+      if (!task.ok) {
+        failed[i] = true;
+        first_failure = std::min(first_failure, i);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < num_directives && i <= first_failure; ++i) {
+    std::cerr << errors[i];
+  }
+  return first_failure == num_directives;
+}
+
 bool CommandLineInterface::GenerateOutput(
     const std::vector<const FileDescriptor*>& parsed_files,
     const OutputDirective& output_directive,
-    GeneratorContext* generator_context) {
+    GeneratorContext* generator_context, std::ostream& errors) {
   // Call the generator.
   std::string error;
   if (output_directive.generator == nullptr) {
@@ -2627,44 +2880,30 @@ bool CommandLineInterface::GenerateOutput(
 
     std::string plugin_name = PluginName(plugin_prefix_, output_directive.name);
     std::string parameters = output_directive.parameter;
-    if (!plugin_parameters_[plugin_name].empty()) {
+    // Output directives may run concurrently, so only look up the maps.
+    auto it = plugin_parameters_.find(plugin_name);
+    if (it != plugin_parameters_.end() && !it->second.empty()) {
       if (!parameters.empty()) {
         parameters.append(",");
       }
-      parameters.append(plugin_parameters_[plugin_name]);
+      parameters.append(it->second);
     }
     if (!GeneratePluginOutput(parsed_files, plugin_name, parameters,
-                              generator_context, &error)) {
-      std::cerr << output_directive.name << ": " << error << std::endl;
+                              generator_context, &error, errors)) {
+      errors << output_directive.name << ": " << error << std::endl;
       return false;
     }
   } else {
     // Regular generator.
-    std::string parameters = output_directive.parameter;
-    if (!generator_parameters_[output_directive.name].empty()) {
-      if (!parameters.empty()) {
-        parameters.append(",");
-      }
-      parameters.append(generator_parameters_[output_directive.name]);
-    }
-    if (!EnforceProto3OptionalSupport(
-            output_directive.name,
-            output_directive.generator->GetSupportedFeatures(), parsed_files)) {
-      return false;
-    }
-
-    if (!EnforceEditionsSupport(
-            output_directive.name,
-            output_directive.generator->GetSupportedFeatures(),
-            output_directive.generator->GetMinimumEdition(),
-            output_directive.generator->GetMaximumEdition(), parsed_files)) {
+    if (!CheckGeneratorSupport(output_directive, parsed_files, errors)) {
       return false;
     }
 
-    if (!output_directive.generator->GenerateAll(parsed_files, parameters,
-                                                 generator_context, &error)) {
+    if (!output_directive.generator->GenerateAll(
+            parsed_files, GeneratorParameter(output_directive),
+            generator_context, &error)) {
       // Generator returned an error.
-      std::cerr << output_directive.name << ": " << error << std::endl;
+      errors << output_directive.name << ": " << error << std::endl;
       return false;
     }
   }
@@ -2672,6 +2911,35 @@ bool CommandLineInterface::GenerateOutput(
   return true;
 }
 
+std::string CommandLineInterface::GeneratorParameter(
+    const OutputDirective& output_directive) const {
+  std::string parameters = output_directive.parameter;
+  auto it = generator_parameters_.find(output_directive.name);
+  if (it != generator_parameters_.end() && !it->second.empty()) {
+    if (!parameters.empty()) {
+      parameters.append(",");
+    }
+    parameters.append(it->second);
+  }
+  return parameters;
+}
+
+bool CommandLineInterface::CheckGeneratorSupport(
+    const OutputDirective& output_directive,
+    const std::vector<const FileDescriptor*>& parsed_files,
+    std::ostream& errors) const {
+  return EnforceProto3OptionalSupport(
+             output_directive.name,
+             output_directive.generator->GetSupportedFeatures(), parsed_files,
+             errors) &&
+         EnforceEditionsSupport(
+             output_directive.name,
+             output_directive.generator->GetSupportedFeatures(),
+             output_directive.generator->GetMinimumEdition(),
+             output_directive.generator->GetMaximumEdition(), parsed_files,
+             errors);
+}
+
 bool CommandLineInterface::GenerateDependencyManifestFile(
     const std::vector<const FileDescriptor*>& parsed_files,
     const GeneratorContextMap& output_directories,
@@ -2703,6 +2971,10 @@ bool CommandLineInterface::GenerateDependencyManifestFile(
     output_filenames.push_back(descriptor_set_out_name_);
   }
 
+  if (!descriptor_snapshot_out_name_.empty()) {
+    output_filenames.push_back(descriptor_snapshot_out_name_);
+  }
+
   if (!edition_defaults_out_name_.empty()) {
     output_filenames.push_back(edition_defaults_out_name_);
   }
@@ -2756,7 +3028,8 @@ bool CommandLineInterface::GenerateDependencyManifestFile(
 bool CommandLineInterface::GeneratePluginOutput(
     const std::vector<const FileDescriptor*>& parsed_files,
     const std::string& plugin_name, const std::string& parameter,
-    GeneratorContext* generator_context, std::string* error) {
+    GeneratorContext* generator_context, std::string* error,
+    std::ostream& errors) {
   CodeGeneratorRequest request;
   CodeGeneratorResponse response;
   std::string processed_parameter = parameter;
@@ -2815,8 +3088,9 @@ bool CommandLineInterface::GeneratePluginOutput(
   // Invoke the plugin.
   Subprocess subprocess;
 
-  if (plugins_.count(plugin_name) > 0) {
-    subprocess.Start(plugins_[plugin_name], Subprocess::EXACT_NAME);
+  auto plugin = plugins_.find(plugin_name);
+  if (plugin != plugins_.end()) {
+    subprocess.Start(plugin->second, Subprocess::EXACT_NAME);
   } else {
     subprocess.Start(plugin_name, Subprocess::SEARCH_PATH);
   }
@@ -2866,13 +3140,13 @@ bool CommandLineInterface::GeneratePluginOutput(
   // Check for errors.
   bool success = true;
   if (!EnforceProto3OptionalSupport(plugin_name, response.supported_features(),
-                                    parsed_files)) {
+                                    parsed_files, errors)) {
     success = false;
   }
   if (!EnforceEditionsSupport(plugin_name, response.supported_features(),
                               static_cast<Edition>(response.minimum_edition()),
                               static_cast<Edition>(response.maximum_edition()),
-                              parsed_files)) {
+                              parsed_files, errors)) {
     success = false;
   }
   if (!response.error().empty()) {
@@ -3016,6 +3290,68 @@ bool CommandLineInterface::WriteDescriptorSet(
   return true;
 }
 
+bool CommandLineInterface::WriteDescriptorSnapshot(
+    const std::vector<const FileDescriptor*>& parsed_files,
+    const DescriptorPool& pool) {
+  // Pools loaded from the snapshot only know the default features, so store
+  // the defaults of any custom features the files may be using.
+  FeatureSetDefaults defaults;
+  bool has_defaults = false;
+  const Descriptor* feature_set =
+      pool.FindMessageTypeByName("google.protobuf.FeatureSet");
+  if (feature_set != nullptr) {
+    std::vector<const FieldDescriptor*> extensions;
+    pool.FindAllExtensions(feature_set, &extensions);
+    if (!extensions.empty()) {
+      absl::StatusOr<FeatureSetDefaults> compiled =
+          FeatureResolver::CompileDefaults(feature_set, extensions,
+                                           MinimumAllowedEdition(),
+                                           MaximumAllowedEdition());
+      if (!compiled.ok()) {
+        std::cerr << descriptor_snapshot_out_name_ << ": "
+                  << compiled.status().message() << std::endl;
+        return false;
+      }
+      defaults = *std::move(compiled);
+      has_defaults = true;
+    }
+  }
+  const std::string snapshot = SerializeDescriptorSnapshot(
+      parsed_files, has_defaults ? &defaults : nullptr);
+
+  int fd;
+  do {
+    fd = open(descriptor_snapshot_out_name_.c_str(),
+              O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+  } while (fd < 0 && errno == EINTR);
+
+  if (fd < 0) {
+    perror(descriptor_snapshot_out_name_.c_str());
+    return false;
+  }
+
+  io::FileOutputStream out(fd);
+
+  {
+    io::CodedOutputStream coded_out(&out);
+    coded_out.WriteString(snapshot);
+    if (coded_out.HadError()) {
+      std::cerr << descriptor_snapshot_out_name_ << ": "
+                << strerror(out.GetErrno()) << std::endl;
+      out.Close();
+      return false;
+    }
+  }
+
+  if (!out.Close()) {
+    std::cerr << descriptor_snapshot_out_name_ << ": "
+              << strerror(out.GetErrno()) << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
 bool CommandLineInterface::WriteEditionDefaults(const DescriptorPool& pool) {
   const Descriptor* feature_set;
   if (opensource_runtime_) {
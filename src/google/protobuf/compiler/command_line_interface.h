@@ -18,6 +18,7 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -223,15 +224,17 @@ class PROTOC_EXPORT CommandLineInterface {
                                      DescriptorDatabase* fallback_database);
 
   // Fails if these files use proto3 optional and the code generator doesn't
-  // support it. This is a permanent check.
+  // support it. This is a permanent check.  Errors are written to `errors`.
   bool EnforceProto3OptionalSupport(
       const std::string& codegen_name, uint64_t supported_features,
-      const std::vector<const FileDescriptor*>& parsed_files) const;
+      const std::vector<const FileDescriptor*>& parsed_files,
+      std::ostream& errors) const;
 
   bool EnforceEditionsSupport(
       const std::string& codegen_name, uint64_t supported_features,
       Edition minimum_edition, Edition maximum_edition,
-      const std::vector<const FileDescriptor*>& parsed_files) const;
+      const std::vector<const FileDescriptor*>& parsed_files,
+      std::ostream& errors) const;
 
 
   // Return status for ParseArguments() and InterpretArgument().
@@ -283,15 +286,34 @@ class PROTOC_EXPORT CommandLineInterface {
 
   bool SetupFeatureResolution(DescriptorPool& pool);
 
-  // Generate the given output file from the given input.
+  // Runs every output directive, creating the GeneratorContext of each output
+  // location in `output_directories`.  Uses up to jobs_ threads; errors are
+  // reported as if the directives had run one after the other.
+  bool GenerateOutputs(const std::vector<const FileDescriptor*>& parsed_files,
+                       GeneratorContextMap* output_directories);
+
+  // Generate the given output file from the given input.  Errors are written
+  // to `errors`.
   struct OutputDirective;  // see below
   bool GenerateOutput(const std::vector<const FileDescriptor*>& parsed_files,
                       const OutputDirective& output_directive,
-                      GeneratorContext* generator_context);
+                      GeneratorContext* generator_context,
+                      std::ostream& errors);
   bool GeneratePluginOutput(
       const std::vector<const FileDescriptor*>& parsed_files,
       const std::string& plugin_name, const std::string& parameter,
-      GeneratorContext* generator_context, std::string* error);
+      GeneratorContext* generator_context, std::string* error,
+      std::ostream& errors);
+
+  // Returns the parameter to pass to the generator of a non-plugin directive.
+  std::string GeneratorParameter(const OutputDirective& output_directive) const;
+
+  // Checks that the generator of a non-plugin directive supports all of the
+  // features used by `parsed_files`.
+  bool CheckGeneratorSupport(
+      const OutputDirective& output_directive,
+      const std::vector<const FileDescriptor*>& parsed_files,
+      std::ostream& errors) const;
 
   // Implements --encode and --decode.
   bool EncodeOrDecode(const DescriptorPool* pool);
@@ -300,6 +322,11 @@ class PROTOC_EXPORT CommandLineInterface {
   bool WriteDescriptorSet(
       const std::vector<const FileDescriptor*>& parsed_files);
 
+  // Implements the --descriptor_snapshot_out option.
+  bool WriteDescriptorSnapshot(
+      const std::vector<const FileDescriptor*>& parsed_files,
+      const DescriptorPool& pool);
+
   // Implements the --edition_defaults_out option.
   bool WriteEditionDefaults(const DescriptorPool& pool);
 
@@ -442,6 +469,10 @@ class PROTOC_EXPORT CommandLineInterface {
   // FileDescriptorSet should be written.  Otherwise, empty.
   std::string descriptor_set_out_name_;
 
+  // If --descriptor_snapshot_out was given, this is the filename to which the
+  // descriptor snapshot should be written.  Otherwise, empty.
+  std::string descriptor_snapshot_out_name_;
+
   std::string edition_defaults_out_name_;
   Edition edition_defaults_minimum_;
   Edition edition_defaults_maximum_;
@@ -472,6 +503,9 @@ class PROTOC_EXPORT CommandLineInterface {
   // When using --encode, this will be passed to SetSerializationDeterministic.
   bool deterministic_output_ = false;
 
+  // Maximum number of threads used to generate output (--jobs).
+  int jobs_ = 1;
+
   bool opensource_runtime_ = google::protobuf::internal::IsOss();
 
 };
@@ -28,8 +28,11 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
 
@@ -37,6 +40,7 @@
 #include "google/protobuf/testing/file.h"
 #include "google/protobuf/any.pb.h"
 #include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/descriptor_snapshot.h"
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
 #include "absl/strings/str_split.h"
@@ -1183,6 +1187,143 @@ TEST_F(CommandLineInterfaceTest, InsertWithAnnotationFixup) {
   CheckGeneratedAnnotations("test_plugin", "foo.proto");
 }
 
+TEST_F(CommandLineInterfaceTest, Jobs) {
+  // Test generating several output locations and files concurrently.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Bar {}\n");
+  CreateTempFile("baz.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Baz {}\n");
+  CreateTempDir("plugin");
+  mock_generator_->set_supports_concurrent_generation(true);
+
+  Run("protocol_compiler --jobs=4 --test_out=$tmpdir "
+      "--plug_out=$tmpdir/plugin --proto_path=$tmpdir "
+      "foo.proto bar.proto baz.proto");
+
+  ExpectNoErrors();
+  const std::string all_files = "foo.proto,bar.proto,baz.proto";
+  ExpectGeneratedWithMultipleInputs("test_generator", all_files, "foo.proto",
+                                    "Foo");
+  ExpectGeneratedWithMultipleInputs("test_generator", all_files, "bar.proto",
+                                    "Bar");
+  ExpectGeneratedWithMultipleInputs("test_generator", all_files, "baz.proto",
+                                    "Baz");
+  for (const auto& file : {std::make_pair("foo.proto", "Foo"),
+                           std::make_pair("bar.proto", "Bar"),
+                           std::make_pair("baz.proto", "Baz")}) {
+    MockCodeGenerator::ExpectGenerated(
+        "test_plugin", "", "", file.first, file.second, all_files,
+        absl::StrCat(temp_directory(), "/plugin"));
+  }
+}
+
+TEST_F(CommandLineInterfaceTest, JobsInsert) {
+  // Insertions into the output of another generator still see that output
+  // when generating concurrently.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  mock_generator_->set_supports_concurrent_generation(true);
+
+  Run("protocol_compiler --jobs=4 "
+      "--test_out=TestParameter:$tmpdir "
+      "--plug_out=TestPluginParameter:$tmpdir "
+      "--test_out=insert=test_generator,test_plugin:$tmpdir "
+      "--plug_out=insert=test_generator,test_plugin:$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectNoErrors();
+  ExpectGeneratedWithInsertions("test_generator", "TestParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+  ExpectGeneratedWithInsertions("test_plugin", "TestPluginParameter",
+                                "test_generator,test_plugin", "foo.proto",
+                                "Foo");
+}
+
+TEST_F(CommandLineInterfaceTest, JobsReportErrorsInOrder) {
+  // The error of the first failed directive is reported, as if the directives
+  // had run one after the other.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "message MockCodeGenerator_Error {}\n");
+  CreateTempDir("alt");
+  mock_generator_->set_supports_concurrent_generation(true);
+
+  Run("protocol_compiler --jobs=4 --alt_out=$tmpdir/alt --test_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto bar.proto");
+
+  ExpectErrorText(
+      "--alt_out: bar.proto: Saw message type MockCodeGenerator_Error.\n");
+}
+
+// A generator that does not support concurrent generation and records
+// whether Generate() was ever called while another call was in progress.
+class OverlapDetectingGenerator : public CodeGenerator {
+ public:
+  bool Generate(const FileDescriptor* file, const std::string& parameter,
+                GeneratorContext* context, std::string* error) const override {
+    if (active_.fetch_add(1) > 0) overlapped_ = true;
+    // Give a concurrent call time to start.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    active_.fetch_sub(1);
+    return true;
+  }
+
+  bool overlapped() const { return overlapped_; }
+
+ private:
+  mutable std::atomic<int> active_{0};
+  mutable std::atomic<bool> overlapped_{false};
+};
+
+TEST_F(CommandLineInterfaceTest, JobsSerializeNonConcurrentGenerator) {
+  // A generator that did not opt into concurrent generation is never called
+  // concurrently, even when it generates into several output locations.
+
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Bar {}\n");
+  CreateTempDir("a");
+  CreateTempDir("b");
+  CreateTempDir("c");
+  auto generator = std::make_unique<OverlapDetectingGenerator>();
+  const OverlapDetectingGenerator* overlap_generator = generator.get();
+  RegisterGenerator("--overlap_out", std::move(generator), "Overlap output.");
+
+  Run("protocol_compiler --jobs=4 --overlap_out=$tmpdir/a "
+      "--overlap_out=$tmpdir/b --overlap_out=$tmpdir/c "
+      "--proto_path=$tmpdir foo.proto bar.proto");
+
+  ExpectNoErrors();
+  EXPECT_FALSE(overlap_generator->overlapped());
+}
+
+TEST_F(CommandLineInterfaceTest, JobsInvalid) {
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "message Foo {}\n");
+
+  Run("protocol_compiler --jobs=-1 --test_out=$tmpdir "
+      "--proto_path=$tmpdir foo.proto");
+
+  ExpectErrorText("--jobs must be a non-negative integer.\n");
+}
+
 #if defined(_WIN32)
 
 TEST_F(CommandLineInterfaceTest, WindowsOutputPath) {
@@ -2396,6 +2537,33 @@ TEST_F(CommandLineInterfaceTest, WriteDescriptorSet) {
   EXPECT_TRUE(descriptor_set.file(0).message_type(0).field(0).has_json_name());
 }
 
+TEST_F(CommandLineInterfaceTest, WriteDescriptorSnapshot) {
+  CreateTempFile("foo.proto",
+                 "syntax = \"proto2\";\n"
+                 "package foo;\n"
+                 "message Foo {}\n");
+  CreateTempFile("bar.proto",
+                 "syntax = \"proto2\";\n"
+                 "import \"foo.proto\";\n"
+                 "message Bar {\n"
+                 "  optional foo.Foo foo = 1;\n"
+                 "}\n");
+
+  Run("protocol_compiler --descriptor_snapshot_out=$tmpdir/snapshot "
+      "--proto_path=$tmpdir bar.proto");
+
+  ExpectNoErrors();
+
+  // The snapshot is self-contained, so it includes foo.proto.
+  std::string contents = ReadFile("snapshot");
+  auto snapshot = DescriptorPoolSnapshot::FromBuffer(contents);
+  ASSERT_TRUE(snapshot.ok()) << snapshot.status();
+  const Descriptor* bar = (*snapshot)->pool()->FindMessageTypeByName("Bar");
+  ASSERT_NE(bar, nullptr);
+  EXPECT_EQ(bar->file()->name(), "bar.proto");
+  EXPECT_EQ(bar->field(0)->message_type()->full_name(), "foo.Foo");
+}
+
 TEST_F(CommandLineInterfaceTest, WriteDescriptorSetWithDuplicates) {
   CreateTempFile("foo.proto",
                  "syntax = \"proto2\";\n"
@@ -234,7 +234,7 @@ void SingularStringView::GenerateAccessorDeclarations(io::Printer* p) const {
         $DEPRECATED$ void $set_name$(Arg_&& arg);
 
         private:
-        const std::string& _internal_$name$() const;
+        absl::string_view _internal_$name$() const;
         inline PROTOBUF_ALWAYS_INLINE void _internal_set_$name$(
             absl::string_view value);
         $donated$;
@@ -315,10 +315,11 @@ void SingularStringView::GenerateInlineAccessorDefinitions(
           $annotate_set$;
           // @@protoc_insertion_point(field_set:$pkg.Msg.field$)
         }
-        inline const std::string& $Msg$::_internal_$name_internal$() const {
+        inline absl::string_view $Msg$::_internal_$name_internal$() const {
           $TsanDetectConcurrentRead$;
           $check_hasbit$;
-          return $field_$.Get();
+          //~ The value may alias the input of a parse with aliasing enabled.
+          return $field_$.GetView();
         }
         inline void $Msg$::_internal_set_$name_internal$(absl::string_view value) {
           $TsanDetectConcurrentMutation$;
@@ -503,7 +504,7 @@ void SingularStringView::GenerateSerializeWithCachedSizesToArray(
                                              "static_cast<int>(_s.length()),");
             }}},
           R"cc(
-            const std::string& _s = this_._internal_$name$();
+            const absl::string_view _s = this_._internal_$name$();
             $utf8_check$;
             target = stream->Write$DeclaredType$MaybeAliased($number$, _s, target);
           )cc");
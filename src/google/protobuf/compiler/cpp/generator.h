@@ -75,6 +75,8 @@ class PROTOC_EXPORT CppGenerator : public CodeGenerator {
     return FEATURE_PROTO3_OPTIONAL | FEATURE_SUPPORTS_EDITIONS;
   }
 
+  bool SupportsConcurrentGeneration() const override { return true; }
+
   Edition GetMinimumEdition() const override { return Edition::EDITION_PROTO2; }
   Edition GetMaximumEdition() const override { return Edition::EDITION_2023; }
 
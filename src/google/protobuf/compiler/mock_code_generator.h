@@ -99,6 +99,13 @@ class MockCodeGenerator : public CodeGenerator {
   uint64_t GetSupportedFeatures() const override;
   void SuppressFeatures(uint64_t features);
 
+  bool SupportsConcurrentGeneration() const override {
+    return supports_concurrent_generation_;
+  }
+  void set_supports_concurrent_generation(bool value) {
+    supports_concurrent_generation_ = value;
+  }
+
   std::vector<const FieldDescriptor*> GetFeatureExtensions() const override {
     return feature_extensions_;
   }
@@ -119,6 +126,7 @@ class MockCodeGenerator : public CodeGenerator {
  private:
   std::string name_;
   uint64_t suppressed_features_ = 0;
+  bool supports_concurrent_generation_ = false;
   mutable Edition minimum_edition_ = MinimumAllowedEdition();
   mutable Edition maximum_edition_ = MaximumAllowedEdition();
   std::vector<const FieldDescriptor*> feature_extensions_ = {
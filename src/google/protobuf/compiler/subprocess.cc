@@ -15,16 +15,20 @@
 
 #ifndef _WIN32
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <sys/select.h>
 #include <sys/wait.h>
 #endif
 
+#include "absl/base/attributes.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/message.h"
 
@@ -32,6 +36,19 @@ namespace google {
 namespace protobuf {
 namespace compiler {
 
+namespace {
+
+// Held while creating a child process.  protoc may run several plugins
+// concurrently (see --jobs), and a child must not inherit the pipes created
+// for another child, or that child's stdin would not be closed until both
+// exit.
+absl::Mutex& StartMutex() {
+  static absl::Mutex mu{absl::kConstInit};
+  return mu;
+}
+
+}  // namespace
+
 #ifdef _WIN32
 
 static void CloseHandleOrDie(HANDLE handle) {
@@ -57,6 +74,10 @@ Subprocess::~Subprocess() {
 }
 
 void Subprocess::Start(const std::string& program, SearchMode search_mode) {
+  // The child side of the pipes is inheritable until closed below, so no other
+  // process may be created in the meantime.
+  absl::MutexLock lock(&StartMutex());
+
   // Create the pipes.
   HANDLE stdin_pipe_read;
   HANDLE stdin_pipe_write;
@@ -296,11 +317,43 @@ char* portable_strdup(const char* s) {
   }
   return ns;
 }
+
+// The "sighandler_t" typedef is GNU-specific, so define our own.
+typedef void SignalHandler(int);
+
+// Ignores SIGPIPE while any subprocess is being communicated with, so that if
+// the child dies it doesn't kill us.  Reference counted since several
+// subprocesses may be communicated with concurrently; the original handler is
+// restored when the last one is done.
+class ScopedIgnoreSigpipe {
+ public:
+  ScopedIgnoreSigpipe() {
+    absl::MutexLock lock(&mutex_);
+    if (users_++ == 0) old_handler_ = signal(SIGPIPE, SIG_IGN);
+  }
+  ~ScopedIgnoreSigpipe() {
+    absl::MutexLock lock(&mutex_);
+    if (--users_ == 0) signal(SIGPIPE, old_handler_);
+  }
+
+ private:
+  static absl::Mutex mutex_;
+  static int users_ ABSL_GUARDED_BY(mutex_);
+  static SignalHandler* old_handler_ ABSL_GUARDED_BY(mutex_);
+};
+
+ABSL_CONST_INIT absl::Mutex ScopedIgnoreSigpipe::mutex_(absl::kConstInit);
+int ScopedIgnoreSigpipe::users_ = 0;
+SignalHandler* ScopedIgnoreSigpipe::old_handler_ = nullptr;
 }  // namespace
 
 void Subprocess::Start(const std::string& program, SearchMode search_mode) {
-  // Note that we assume that there are no other threads, thus we don't have to
-  // do crazy stuff like using socket pairs or avoiding libc locks.
+  // Other threads may start subprocesses concurrently, so all pipes are
+  // created close-on-exec: the child only keeps the ends it dup2()s onto its
+  // stdin and stdout.  Pipes are created under a lock so that no fork() in
+  // another thread happens before FD_CLOEXEC is set.  The child only calls
+  // async-signal-safe functions before exec.
+  absl::MutexLock lock(&StartMutex());
 
   // [0] is read end, [1] is write end.
   int stdin_pipe[2];
@@ -308,6 +361,10 @@ void Subprocess::Start(const std::string& program, SearchMode search_mode) {
 
   ABSL_CHECK(pipe(stdin_pipe) != -1);
   ABSL_CHECK(pipe(stdout_pipe) != -1);
+  for (int fd :
+       {stdin_pipe[0], stdin_pipe[1], stdout_pipe[0], stdout_pipe[1]}) {
+    ABSL_CHECK(fcntl(fd, F_SETFD, FD_CLOEXEC) != -1);
+  }
 
   char* argv[2] = {portable_strdup(program.c_str()), nullptr};
 
@@ -362,11 +419,8 @@ bool Subprocess::Communicate(const Message& input, Message* output,
                              std::string* error) {
   ABSL_CHECK_NE(child_stdin_, -1) << "Must call Start() first.";
 
-  // The "sighandler_t" typedef is GNU-specific, so define our own.
-  typedef void SignalHandler(int);
-
   // Make sure SIGPIPE is disabled so that if the child dies it doesn't kill us.
-  SignalHandler* old_pipe_handler = signal(SIGPIPE, SIG_IGN);
+  ScopedIgnoreSigpipe ignore_sigpipe;
 
   std::string input_data;
   if (!input.SerializeToString(&input_data)) {
@@ -445,9 +499,6 @@ bool Subprocess::Communicate(const Message& input, Message* output,
     }
   }
 
-  // Restore SIGPIPE handling.
-  signal(SIGPIPE, old_pipe_handler);
-
   if (WIFEXITED(status)) {
     if (WEXITSTATUS(status) != 0) {
       int error_code = WEXITSTATUS(status);
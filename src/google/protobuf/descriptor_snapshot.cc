@@ -0,0 +1,569 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/descriptor_snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/absl_check.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Snapshot layout.  All integers are little-endian uint32s, and all offsets
+// are relative to the start of the snapshot.
+//
+//   Header:
+//     char     magic[8]                 "PBSNAP01"
+//     uint32   total_size
+//     uint32   num_files, num_symbols, num_extensions
+//     uint32   files_offset, symbols_offset, extensions_offset
+//     uint32   feature_set_defaults_offset, feature_set_defaults_size
+//   File table, sorted by name:
+//     { name_offset, name_size, proto_offset, proto_size }
+//   Symbol table, holding the top-level symbols of every file, sorted by name:
+//     { name_offset, name_size, file_index }
+//   Extension table, sorted by extendee and number:
+//     { extendee_offset, extendee_size, number, file_index }
+//   Data: names and serialized FileDescriptorProtos referenced by the tables,
+//     and the serialized FeatureSetDefaults, if any.
+//
+// Nothing but the header is validated when a snapshot is opened; entries are
+// bounds-checked when used.
+namespace {
+
+constexpr absl::string_view kMagic("PBSNAP01", 8);
+
+constexpr uint32_t kTotalSizeOffset = 8;
+constexpr uint32_t kNumFilesOffset = 12;
+constexpr uint32_t kNumSymbolsOffset = 16;
+constexpr uint32_t kNumExtensionsOffset = 20;
+constexpr uint32_t kFilesOffsetOffset = 24;
+constexpr uint32_t kSymbolsOffsetOffset = 28;
+constexpr uint32_t kExtensionsOffsetOffset = 32;
+constexpr uint32_t kFeatureSetDefaultsOffsetOffset = 36;
+constexpr uint32_t kFeatureSetDefaultsSizeOffset = 40;
+constexpr uint32_t kHeaderSize = 44;
+
+constexpr uint32_t kFileEntrySize = 16;
+constexpr uint32_t kSymbolEntrySize = 12;
+constexpr uint32_t kExtensionEntrySize = 16;
+
+// True if either the arguments are equal or super_symbol identifies a
+// parent symbol of sub_symbol (e.g. "foo.bar" is a parent of
+// "foo.bar.baz", but not a parent of "foo.barbaz").
+bool IsSubSymbol(absl::string_view sub_symbol, absl::string_view super_symbol) {
+  return sub_symbol == super_symbol ||
+         (absl::StartsWith(super_symbol, sub_symbol) &&
+          super_symbol[sub_symbol.size()] == '.');
+}
+
+void AddFileAndDependencies(const FileDescriptor* file,
+                            absl::flat_hash_set<const FileDescriptor*>* seen,
+                            std::vector<const FileDescriptor*>* output) {
+  if (!seen->insert(file).second) return;
+  for (int i = 0; i < file->dependency_count(); ++i) {
+    AddFileAndDependencies(file->dependency(i), seen, output);
+  }
+  output->push_back(file);
+}
+
+struct SymbolEntry {
+  std::string name;
+  uint32_t file_index;
+};
+
+struct ExtensionEntry {
+  std::string extendee;
+  int number;
+  uint32_t file_index;
+};
+
+void AddExtensions(const Descriptor* message, uint32_t file_index,
+                   std::vector<ExtensionEntry>* output) {
+  for (int i = 0; i < message->extension_count(); ++i) {
+    output->push_back({message->extension(i)->containing_type()->full_name(),
+                       message->extension(i)->number(), file_index});
+  }
+  for (int i = 0; i < message->nested_type_count(); ++i) {
+    AddExtensions(message->nested_type(i), file_index, output);
+  }
+}
+
+// Writes the tables and data of a snapshot into a preallocated buffer.
+class SnapshotWriter {
+ public:
+  SnapshotWriter(std::string* output, uint32_t data_offset)
+      : output_(output), data_offset_(data_offset) {}
+
+  void Write32(uint32_t offset, uint32_t value) {
+    io::CodedOutputStream::WriteLittleEndian32ToArray(
+        value, reinterpret_cast<uint8_t*>(&(*output_)[offset]));
+  }
+
+  // Appends `bytes` to the data section and writes its offset and size to the
+  // table entry at `offset`.
+  void WriteSlice(uint32_t offset, absl::string_view bytes) {
+    Write32(offset, data_offset_ + static_cast<uint32_t>(data_.size()));
+    Write32(offset + 4, static_cast<uint32_t>(bytes.size()));
+    data_.append(bytes.data(), bytes.size());
+  }
+
+  std::string& data() { return data_; }
+
+ private:
+  std::string* output_;
+  const uint32_t data_offset_;
+  std::string data_;
+};
+
+}  // namespace
+
+std::string SerializeDescriptorSnapshot(
+    absl::Span<const FileDescriptor* const> files,
+    const FeatureSetDefaults* feature_set_defaults) {
+  std::vector<const FileDescriptor*> all_files;
+  absl::flat_hash_set<const FileDescriptor*> seen;
+  for (const FileDescriptor* file : files) {
+    AddFileAndDependencies(file, &seen, &all_files);
+  }
+  std::sort(all_files.begin(), all_files.end(),
+            [](const FileDescriptor* a, const FileDescriptor* b) {
+              return a->name() < b->name();
+            });
+
+  std::vector<SymbolEntry> symbols;
+  std::vector<ExtensionEntry> extensions;
+  for (uint32_t i = 0; i < all_files.size(); ++i) {
+    const FileDescriptor* file = all_files[i];
+    for (int j = 0; j < file->message_type_count(); ++j) {
+      symbols.push_back({file->message_type(j)->full_name(), i});
+      AddExtensions(file->message_type(j), i, &extensions);
+    }
+    for (int j = 0; j < file->enum_type_count(); ++j) {
+      symbols.push_back({file->enum_type(j)->full_name(), i});
+    }
+    for (int j = 0; j < file->extension_count(); ++j) {
+      symbols.push_back({file->extension(j)->full_name(), i});
+      extensions.push_back({file->extension(j)->containing_type()->full_name(),
+                            file->extension(j)->number(), i});
+    }
+    for (int j = 0; j < file->service_count(); ++j) {
+      symbols.push_back({file->service(j)->full_name(), i});
+    }
+  }
+  std::sort(symbols.begin(), symbols.end(),
+            [](const SymbolEntry& a, const SymbolEntry& b) {
+              return a.name < b.name;
+            });
+  std::sort(extensions.begin(), extensions.end(),
+            [](const ExtensionEntry& a, const ExtensionEntry& b) {
+              return std::tie(a.extendee, a.number) <
+                     std::tie(b.extendee, b.number);
+            });
+
+  const uint32_t files_offset = kHeaderSize;
+  const uint32_t symbols_offset =
+      files_offset + kFileEntrySize * static_cast<uint32_t>(all_files.size());
+  const uint32_t extensions_offset =
+      symbols_offset + kSymbolEntrySize * static_cast<uint32_t>(symbols.size());
+  const uint32_t data_offset =
+      extensions_offset +
+      kExtensionEntrySize * static_cast<uint32_t>(extensions.size());
+
+  std::string output(data_offset, '\0');
+  SnapshotWriter writer(&output, data_offset);
+  FileDescriptorProto proto;
+  for (uint32_t i = 0; i < all_files.size(); ++i) {
+    const uint32_t entry = files_offset + kFileEntrySize * i;
+    writer.WriteSlice(entry, all_files[i]->name());
+    proto.Clear();
+    all_files[i]->CopyTo(&proto);
+    writer.WriteSlice(entry + 8, proto.SerializeAsString());
+  }
+  for (uint32_t i = 0; i < symbols.size(); ++i) {
+    const uint32_t entry = symbols_offset + kSymbolEntrySize * i;
+    writer.WriteSlice(entry, symbols[i].name);
+    writer.Write32(entry + 8, symbols[i].file_index);
+  }
+  for (uint32_t i = 0; i < extensions.size(); ++i) {
+    const uint32_t entry = extensions_offset + kExtensionEntrySize * i;
+    writer.WriteSlice(entry, extensions[i].extendee);
+    writer.Write32(entry + 8, static_cast<uint32_t>(extensions[i].number));
+    writer.Write32(entry + 12, extensions[i].file_index);
+  }
+  if (feature_set_defaults != nullptr) {
+    writer.WriteSlice(kFeatureSetDefaultsOffsetOffset,
+                      feature_set_defaults->SerializeAsString());
+  }
+
+  ABSL_CHECK_LE(output.size() + writer.data().size(),
+                std::numeric_limits<uint32_t>::max())
+      << "Descriptor snapshots are limited to 4GiB.";
+  output.append(writer.data());
+  std::memcpy(&output[0], kMagic.data(), kMagic.size());
+  writer.Write32(kTotalSizeOffset, static_cast<uint32_t>(output.size()));
+  writer.Write32(kNumFilesOffset, static_cast<uint32_t>(all_files.size()));
+  writer.Write32(kNumSymbolsOffset, static_cast<uint32_t>(symbols.size()));
+  writer.Write32(kNumExtensionsOffset,
+                 static_cast<uint32_t>(extensions.size()));
+  writer.Write32(kFilesOffsetOffset, files_offset);
+  writer.Write32(kSymbolsOffsetOffset, symbols_offset);
+  writer.Write32(kExtensionsOffsetOffset, extensions_offset);
+  return output;
+}
+
+// ===================================================================
+
+SnapshotDescriptorDatabase::SnapshotDescriptorDatabase(absl::string_view data)
+    : data_(data) {}
+
+SnapshotDescriptorDatabase::~SnapshotDescriptorDatabase() = default;
+
+absl::StatusOr<std::unique_ptr<SnapshotDescriptorDatabase>>
+SnapshotDescriptorDatabase::Create(absl::string_view data) {
+  if (data.size() < kHeaderSize || !absl::StartsWith(data, kMagic)) {
+    return absl::InvalidArgumentError("Not a descriptor snapshot.");
+  }
+  auto database = absl::WrapUnique(new SnapshotDescriptorDatabase(data));
+  if (database->Read32(kTotalSizeOffset) != data.size()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Truncated descriptor snapshot: expected ",
+                     database->Read32(kTotalSizeOffset), " bytes, got ",
+                     data.size(), "."));
+  }
+  database->num_files_ = database->Read32(kNumFilesOffset);
+  database->num_symbols_ = database->Read32(kNumSymbolsOffset);
+  database->num_extensions_ = database->Read32(kNumExtensionsOffset);
+  database->files_offset_ = database->Read32(kFilesOffsetOffset);
+  database->symbols_offset_ = database->Read32(kSymbolsOffsetOffset);
+  database->extensions_offset_ = database->Read32(kExtensionsOffsetOffset);
+  database->feature_set_defaults_offset_ =
+      database->Read32(kFeatureSetDefaultsOffsetOffset);
+  database->feature_set_defaults_size_ =
+      database->Read32(kFeatureSetDefaultsSizeOffset);
+
+  auto table_fits = [&](uint32_t offset, uint32_t count, uint32_t entry_size) {
+    return offset >= kHeaderSize &&
+           uint64_t{offset} + uint64_t{count} * entry_size <= data.size();
+  };
+  absl::string_view unused;
+  if (!table_fits(database->files_offset_, database->num_files_,
+                  kFileEntrySize) ||
+      !table_fits(database->symbols_offset_, database->num_symbols_,
+                  kSymbolEntrySize) ||
+      !table_fits(database->extensions_offset_, database->num_extensions_,
+                  kExtensionEntrySize) ||
+      !database->Slice(database->feature_set_defaults_offset_,
+                       database->feature_set_defaults_size_, &unused)) {
+    return absl::InvalidArgumentError("Corrupt descriptor snapshot header.");
+  }
+  return database;
+}
+
+uint32_t SnapshotDescriptorDatabase::Read32(uint32_t offset) const {
+  uint32_t value;
+  io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(data_.data()) + offset, &value);
+  return value;
+}
+
+bool SnapshotDescriptorDatabase::Slice(uint32_t offset, uint32_t size,
+                                       absl::string_view* out) const {
+  if (uint64_t{offset} + size > data_.size()) return false;
+  *out = data_.substr(offset, size);
+  return true;
+}
+
+bool SnapshotDescriptorDatabase::FileName(uint32_t index,
+                                          absl::string_view* name) const {
+  const uint32_t entry = files_offset_ + kFileEntrySize * index;
+  return Slice(Read32(entry), Read32(entry + 4), name);
+}
+
+bool SnapshotDescriptorDatabase::Symbol(uint32_t index,
+                                        absl::string_view* name,
+                                        uint32_t* file_index) const {
+  const uint32_t entry = symbols_offset_ + kSymbolEntrySize * index;
+  *file_index = Read32(entry + 8);
+  return *file_index < num_files_ &&
+         Slice(Read32(entry), Read32(entry + 4), name);
+}
+
+bool SnapshotDescriptorDatabase::Extension(uint32_t index,
+                                           absl::string_view* extendee,
+                                           int* number,
+                                           uint32_t* file_index) const {
+  const uint32_t entry = extensions_offset_ + kExtensionEntrySize * index;
+  *number = static_cast<int>(Read32(entry + 8));
+  *file_index = Read32(entry + 12);
+  return *file_index < num_files_ &&
+         Slice(Read32(entry), Read32(entry + 4), extendee);
+}
+
+bool SnapshotDescriptorDatabase::ParseFile(uint32_t index,
+                                           FileDescriptorProto* output) const {
+  const uint32_t entry = files_offset_ + kFileEntrySize * index;
+  absl::string_view proto;
+  return Slice(Read32(entry + 8), Read32(entry + 12), &proto) &&
+         internal::ParseNoReflection(proto, *output);
+}
+
+uint32_t SnapshotDescriptorDatabase::ExtensionLowerBound(
+    absl::string_view extendee, int number) const {
+  uint32_t lo = 0, hi = num_extensions_;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    absl::string_view mid_extendee;
+    int mid_number;
+    uint32_t file_index;
+    if (!Extension(mid, &mid_extendee, &mid_number, &file_index)) {
+      return num_extensions_;
+    }
+    if (std::tie(mid_extendee, mid_number) < std::tie(extendee, number)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+bool SnapshotDescriptorDatabase::GetFeatureSetDefaults(
+    FeatureSetDefaults* output) const {
+  if (feature_set_defaults_size_ == 0) return false;
+  return internal::ParseNoReflection(
+      data_.substr(feature_set_defaults_offset_, feature_set_defaults_size_),
+      *output);
+}
+
+bool SnapshotDescriptorDatabase::FindFileByName(const std::string& filename,
+                                                FileDescriptorProto* output) {
+  uint32_t lo = 0, hi = num_files_;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    absl::string_view name;
+    if (!FileName(mid, &name)) return false;
+    if (name < filename) {
+      lo = mid + 1;
+    } else if (name > filename) {
+      hi = mid;
+    } else {
+      return ParseFile(mid, output);
+    }
+  }
+  return false;
+}
+
+bool SnapshotDescriptorDatabase::FindFileContainingSymbol(
+    const std::string& symbol_name, FileDescriptorProto* output) {
+  // Find the last symbol that sorts less than or equal to `symbol_name`.  Only
+  // top-level symbols are indexed, so this is either the symbol itself or the
+  // symbol defining it, if any.
+  uint32_t lo = 0, hi = num_symbols_;
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    absl::string_view name;
+    uint32_t file_index;
+    if (!Symbol(mid, &name, &file_index)) return false;
+    if (name <= symbol_name) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == 0) return false;
+  absl::string_view name;
+  uint32_t file_index;
+  return Symbol(lo - 1, &name, &file_index) &&
+         IsSubSymbol(name, symbol_name) && ParseFile(file_index, output);
+}
+
+bool SnapshotDescriptorDatabase::FindFileContainingExtension(
+    const std::string& containing_type, int field_number,
+    FileDescriptorProto* output) {
+  const uint32_t index = ExtensionLowerBound(containing_type, field_number);
+  absl::string_view extendee;
+  int number;
+  uint32_t file_index;
+  return index < num_extensions_ &&
+         Extension(index, &extendee, &number, &file_index) &&
+         extendee == containing_type && number == field_number &&
+         ParseFile(file_index, output);
+}
+
+bool SnapshotDescriptorDatabase::FindAllExtensionNumbers(
+    const std::string& extendee_type, std::vector<int>* output) {
+  bool success = false;
+  for (uint32_t i = ExtensionLowerBound(extendee_type,
+                                        std::numeric_limits<int>::min());
+       i < num_extensions_; ++i) {
+    absl::string_view extendee;
+    int number;
+    uint32_t file_index;
+    if (!Extension(i, &extendee, &number, &file_index) ||
+        extendee != extendee_type) {
+      break;
+    }
+    output->push_back(number);
+    success = true;
+  }
+  return success;
+}
+
+bool SnapshotDescriptorDatabase::FindAllFileNames(
+    std::vector<std::string>* output) {
+  output->reserve(output->size() + num_files_);
+  for (uint32_t i = 0; i < num_files_; ++i) {
+    absl::string_view name;
+    if (!FileName(i, &name)) return false;
+    output->emplace_back(name);
+  }
+  return true;
+}
+
+// ===================================================================
+
+// Memory holding the contents of a snapshot file.
+class DescriptorPoolSnapshot::Mapping {
+ public:
+  Mapping() = default;
+  Mapping(const Mapping&) = delete;
+  Mapping& operator=(const Mapping&) = delete;
+  ~Mapping() {
+#ifndef _WIN32
+    if (mapped_ != nullptr) munmap(mapped_, data_.size());
+#endif
+  }
+
+  absl::Status Open(const std::string& path) {
+#ifndef _WIN32
+    int fd;
+    do {
+      fd = open(path.c_str(), O_RDONLY);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+      return absl::NotFoundError(absl::StrCat(path, ": ", strerror(errno)));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      const int error = errno;
+      close(fd);
+      return absl::InternalError(absl::StrCat(path, ": ", strerror(error)));
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+      close(fd);
+      return absl::InvalidArgumentError(absl::StrCat(path, ": empty file"));
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      return absl::InternalError(absl::StrCat(path, ": ", strerror(error)));
+    }
+    mapped_ = mapped;
+    data_ = absl::string_view(static_cast<const char*>(mapped), size);
+#else   // _WIN32
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) return absl::NotFoundError(absl::StrCat(path, ": not found"));
+    contents_.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+    data_ = contents_;
+#endif  // !_WIN32
+    return absl::OkStatus();
+  }
+
+  absl::string_view data() const { return data_; }
+
+ private:
+#ifndef _WIN32
+  void* mapped_ = nullptr;
+#else
+  std::string contents_;
+#endif
+  absl::string_view data_;
+};
+
+DescriptorPoolSnapshot::DescriptorPoolSnapshot() = default;
+DescriptorPoolSnapshot::~DescriptorPoolSnapshot() {
+  // The pool refers to the database, which refers to the mapping.
+  pool_.reset();
+  database_.reset();
+  mapping_.reset();
+}
+
+absl::StatusOr<std::unique_ptr<DescriptorPoolSnapshot>>
+DescriptorPoolSnapshot::Open(const std::string& path) {
+  auto snapshot = absl::WrapUnique(new DescriptorPoolSnapshot());
+  snapshot->mapping_ = std::make_unique<Mapping>();
+  absl::Status status = snapshot->mapping_->Open(path);
+  if (!status.ok()) return status;
+  status = snapshot->Init(snapshot->mapping_->data());
+  if (!status.ok()) return status;
+  return snapshot;
+}
+
+absl::StatusOr<std::unique_ptr<DescriptorPoolSnapshot>>
+DescriptorPoolSnapshot::FromBuffer(absl::string_view data) {
+  auto snapshot = absl::WrapUnique(new DescriptorPoolSnapshot());
+  absl::Status status = snapshot->Init(data);
+  if (!status.ok()) return status;
+  return snapshot;
+}
+
+absl::Status DescriptorPoolSnapshot::Init(absl::string_view data) {
+  auto database = SnapshotDescriptorDatabase::Create(data);
+  if (!database.ok()) return database.status();
+  database_ = *std::move(database);
+  pool_ = std::make_unique<DescriptorPool>(database_.get());
+  FeatureSetDefaults defaults;
+  if (database_->GetFeatureSetDefaults(&defaults)) {
+    absl::Status status = pool_->SetFeatureSetDefaults(std::move(defaults));
+    if (!status.ok()) return status;
+  }
+  // The files were successfully built when the snapshot was written.
+  pool_->InternalSetLazilyBuildDependencies();
+  return absl::OkStatus();
+}
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,157 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Descriptor snapshots: a file format that lets a process load a large set of
+// already validated descriptors at startup without parsing or indexing them.
+//
+// A snapshot holds the serialized FileDescriptorProtos of a closed set of
+// files together with sorted tables mapping file names, symbols and
+// extensions to them.  It is written at build time from a DescriptorPool that
+// successfully built all of the files (see SerializeDescriptorSnapshot() and
+// `protoc --descriptor_snapshot_out`), and is meant to be mapped into memory:
+//
+//   auto snapshot = DescriptorPoolSnapshot::Open("service.pbsnapshot");
+//   if (!snapshot.ok()) ...
+//   const Descriptor* request =
+//       (*snapshot)->pool()->FindMessageTypeByName("my.service.Request");
+//
+// Opening a snapshot only checks its header.  Files are parsed and built the
+// first time one of their symbols is looked up, and their dependencies only
+// once they are needed, so startup cost does not grow with the size of the
+// dependency graph.
+
+#ifndef GOOGLE_PROTOBUF_DESCRIPTOR_SNAPSHOT_H__
+#define GOOGLE_PROTOBUF_DESCRIPTOR_SNAPSHOT_H__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/descriptor_database.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+
+// Returns a snapshot of `files` and all of their transitive dependencies.  If
+// `feature_set_defaults` is not null, it is stored in the snapshot and
+// installed into pools loaded from it, which is required for files using
+// custom features.
+PROTOBUF_EXPORT std::string SerializeDescriptorSnapshot(
+    absl::Span<const FileDescriptor* const> files,
+    const FeatureSetDefaults* feature_set_defaults = nullptr);
+
+// A DescriptorDatabase reading from a snapshot.  Every lookup is a binary
+// search over the snapshot's tables followed by parsing the matching file.
+class PROTOBUF_EXPORT SnapshotDescriptorDatabase : public DescriptorDatabase {
+ public:
+  SnapshotDescriptorDatabase(const SnapshotDescriptorDatabase&) = delete;
+  SnapshotDescriptorDatabase& operator=(const SnapshotDescriptorDatabase&) =
+      delete;
+  ~SnapshotDescriptorDatabase() override;
+
+  // Returns a database reading from `data`, or an error if `data` is not a
+  // snapshot.  The data is not copied and must outlive the database.
+  static absl::StatusOr<std::unique_ptr<SnapshotDescriptorDatabase>> Create(
+      absl::string_view data);
+
+  // Fills in the FeatureSetDefaults stored in the snapshot.  Returns false if
+  // the snapshot has none.
+  bool GetFeatureSetDefaults(FeatureSetDefaults* output) const;
+
+  // implements DescriptorDatabase -----------------------------------
+  bool FindFileByName(const std::string& filename,
+                      FileDescriptorProto* output) override;
+  bool FindFileContainingSymbol(const std::string& symbol_name,
+                                FileDescriptorProto* output) override;
+  bool FindFileContainingExtension(const std::string& containing_type,
+                                   int field_number,
+                                   FileDescriptorProto* output) override;
+  bool FindAllExtensionNumbers(const std::string& extendee_type,
+                               std::vector<int>* output) override;
+  bool FindAllFileNames(std::vector<std::string>* output) override;
+
+ private:
+  explicit SnapshotDescriptorDatabase(absl::string_view data);
+
+  // Accessors for the entries of the tables.  They return false if the entry
+  // points outside of the snapshot.
+  bool FileName(uint32_t index, absl::string_view* name) const;
+  bool Symbol(uint32_t index, absl::string_view* name,
+              uint32_t* file_index) const;
+  bool Extension(uint32_t index, absl::string_view* extendee, int* number,
+                 uint32_t* file_index) const;
+  // Parses the file at `index` into *output.
+  bool ParseFile(uint32_t index, FileDescriptorProto* output) const;
+
+  // Returns the first extension entry not less than (extendee, number).
+  uint32_t ExtensionLowerBound(absl::string_view extendee, int number) const;
+
+  uint32_t Read32(uint32_t offset) const;
+  bool Slice(uint32_t offset, uint32_t size, absl::string_view* out) const;
+
+  absl::string_view data_;
+  uint32_t num_files_ = 0;
+  uint32_t num_symbols_ = 0;
+  uint32_t num_extensions_ = 0;
+  uint32_t files_offset_ = 0;
+  uint32_t symbols_offset_ = 0;
+  uint32_t extensions_offset_ = 0;
+  uint32_t feature_set_defaults_offset_ = 0;
+  uint32_t feature_set_defaults_size_ = 0;
+};
+
+// A DescriptorPool loaded from a snapshot, together with the memory backing
+// it.  Files are built lazily from the snapshot, with their dependencies only
+// built once needed (see DescriptorPool::InternalSetLazilyBuildDependencies),
+// which is safe because snapshots are written from successfully built files.
+class PROTOBUF_EXPORT DescriptorPoolSnapshot {
+ public:
+  DescriptorPoolSnapshot(const DescriptorPoolSnapshot&) = delete;
+  DescriptorPoolSnapshot& operator=(const DescriptorPoolSnapshot&) = delete;
+  ~DescriptorPoolSnapshot();
+
+  // Maps the snapshot file at `path` into memory.  On platforms without mmap
+  // the file is read instead.
+  static absl::StatusOr<std::unique_ptr<DescriptorPoolSnapshot>> Open(
+      const std::string& path);
+
+  // Loads the snapshot in `data`, which must outlive the returned object.
+  static absl::StatusOr<std::unique_ptr<DescriptorPoolSnapshot>> FromBuffer(
+      absl::string_view data);
+
+  const DescriptorPool* pool() const { return pool_.get(); }
+  SnapshotDescriptorDatabase* database() { return database_.get(); }
+
+ private:
+  class Mapping;
+
+  DescriptorPoolSnapshot();
+
+  // Sets up the database and pool over `data`.
+  absl::Status Init(absl::string_view data);
+
+  std::unique_ptr<Mapping> mapping_;
+  std::unique_ptr<SnapshotDescriptorDatabase> database_;
+  std::unique_ptr<DescriptorPool> pool_;
+};
+
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_DESCRIPTOR_SNAPSHOT_H__
@@ -0,0 +1,184 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/descriptor_snapshot.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/descriptor.pb.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/testing/googletest.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace {
+
+using ::testing::Contains;
+using ::testing::IsEmpty;
+
+std::string UnittestSnapshot() {
+  const FileDescriptor* files[] = {
+      protobuf_unittest::TestAllTypes::descriptor()->file()};
+  return SerializeDescriptorSnapshot(files);
+}
+
+TEST(DescriptorSnapshotTest, FindsTopLevelAndNestedSymbols) {
+  const std::string data = UnittestSnapshot();
+  auto snapshot = DescriptorPoolSnapshot::FromBuffer(data);
+  ASSERT_TRUE(snapshot.ok()) << snapshot.status();
+  const DescriptorPool* pool = (*snapshot)->pool();
+
+  const Descriptor* message =
+      pool->FindMessageTypeByName("protobuf_unittest.TestAllTypes");
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ(message->file()->name(), "google/protobuf/unittest.proto");
+  EXPECT_EQ(message->field_count(),
+            protobuf_unittest::TestAllTypes::descriptor()->field_count());
+
+  const Descriptor* nested = pool->FindMessageTypeByName(
+      "protobuf_unittest.TestAllTypes.NestedMessage");
+  ASSERT_NE(nested, nullptr);
+  EXPECT_EQ(nested->containing_type(), message);
+  EXPECT_NE(pool->FindEnumValueByName(
+                "protobuf_unittest.TestAllTypes.NestedEnum.FOO"),
+            nullptr);
+  EXPECT_NE(pool->FindServiceByName("protobuf_unittest.TestService"), nullptr);
+
+  EXPECT_EQ(pool->FindMessageTypeByName("protobuf_unittest.TestAllType"),
+            nullptr);
+  EXPECT_EQ(pool->FindMessageTypeByName("protobuf_unittest.TestAllTypesX"),
+            nullptr);
+  EXPECT_EQ(pool->FindMessageTypeByName("protobuf_unittest.NoSuchMessage"),
+            nullptr);
+}
+
+TEST(DescriptorSnapshotTest, IncludesDependencies) {
+  const std::string data = UnittestSnapshot();
+  auto snapshot = DescriptorPoolSnapshot::FromBuffer(data);
+  ASSERT_TRUE(snapshot.ok()) << snapshot.status();
+
+  std::vector<std::string> names;
+  ASSERT_TRUE((*snapshot)->database()->FindAllFileNames(&names));
+  EXPECT_TRUE(std::is_sorted(names.begin(), names.end()));
+  EXPECT_THAT(names, Contains("google/protobuf/unittest.proto"));
+  EXPECT_THAT(names, Contains("google/protobuf/unittest_import.proto"));
+  EXPECT_THAT(names, Contains("google/protobuf/unittest_import_public.proto"));
+
+  const Descriptor* message =
+      (*snapshot)->pool()->FindMessageTypeByName(
+          "protobuf_unittest_import.ImportMessage");
+  ASSERT_NE(message, nullptr);
+  EXPECT_EQ(message->file()->name(), "google/protobuf/unittest_import.proto");
+}
+
+TEST(DescriptorSnapshotTest, FindsExtensions) {
+  const std::string data = UnittestSnapshot();
+  auto snapshot = DescriptorPoolSnapshot::FromBuffer(data);
+  ASSERT_TRUE(snapshot.ok()) << snapshot.status();
+  const DescriptorPool* pool = (*snapshot)->pool();
+
+  const Descriptor* extendee =
+      pool->FindMessageTypeByName("protobuf_unittest.TestAllExtensions");
+  ASSERT_NE(extendee, nullptr);
+  const FieldDescriptor* extension = pool->FindExtensionByNumber(
+      extendee, protobuf_unittest::optional_int32_extension.number());
+  ASSERT_NE(extension, nullptr);
+  EXPECT_EQ(extension->name(), "optional_int32_extension");
+
+  // Extensions declared in a message scope are indexed too.
+  extension = pool->FindExtensionByNumber(
+      extendee, protobuf_unittest::TestNestedExtension::test.number());
+  ASSERT_NE(extension, nullptr);
+  EXPECT_EQ(extension->full_name(),
+            "protobuf_unittest.TestNestedExtension.test");
+
+  std::vector<int> numbers;
+  ASSERT_TRUE((*snapshot)->database()->FindAllExtensionNumbers(
+      "protobuf_unittest.TestAllExtensions", &numbers));
+  EXPECT_TRUE(std::is_sorted(numbers.begin(), numbers.end()));
+  EXPECT_THAT(numbers,
+              Contains(protobuf_unittest::optional_int32_extension.number()));
+
+  numbers.clear();
+  EXPECT_FALSE((*snapshot)->database()->FindAllExtensionNumbers(
+      "protobuf_unittest.TestAllTypes", &numbers));
+  EXPECT_THAT(numbers, IsEmpty());
+}
+
+TEST(DescriptorSnapshotTest, StoresFeatureSetDefaults) {
+  FeatureSetDefaults defaults;
+  defaults.set_minimum_edition(EDITION_PROTO2);
+  defaults.set_maximum_edition(EDITION_2023);
+  const FileDescriptor* files[] = {
+      protobuf_unittest::TestAllTypes::descriptor()->file()};
+  const std::string data = SerializeDescriptorSnapshot(files, &defaults);
+
+  auto database = SnapshotDescriptorDatabase::Create(data);
+  ASSERT_TRUE(database.ok()) << database.status();
+  FeatureSetDefaults loaded;
+  ASSERT_TRUE((*database)->GetFeatureSetDefaults(&loaded));
+  EXPECT_EQ(loaded.minimum_edition(), EDITION_PROTO2);
+  EXPECT_EQ(loaded.maximum_edition(), EDITION_2023);
+
+  const std::string data_without_defaults = UnittestSnapshot();
+  auto without_defaults =
+      SnapshotDescriptorDatabase::Create(data_without_defaults);
+  ASSERT_TRUE(without_defaults.ok());
+  EXPECT_FALSE((*without_defaults)->GetFeatureSetDefaults(&loaded));
+}
+
+TEST(DescriptorSnapshotTest, RejectsInvalidData) {
+  const std::string data = UnittestSnapshot();
+
+  EXPECT_EQ(DescriptorPoolSnapshot::FromBuffer("").status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(
+      DescriptorPoolSnapshot::FromBuffer("not a snapshot").status().code(),
+      absl::StatusCode::kInvalidArgument);
+
+  std::string truncated = data.substr(0, data.size() - 1);
+  EXPECT_EQ(DescriptorPoolSnapshot::FromBuffer(truncated).status().code(),
+            absl::StatusCode::kInvalidArgument);
+
+  // Point the symbol table past the end of the snapshot.
+  std::string corrupt = data;
+  corrupt[28] = corrupt[29] = corrupt[30] = corrupt[31] = '\xff';
+  EXPECT_EQ(DescriptorPoolSnapshot::FromBuffer(corrupt).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(DescriptorSnapshotTest, OpensFile) {
+  const std::string data = UnittestSnapshot();
+  const std::string path =
+      absl::StrCat(TestTempDir(), "/descriptor_snapshot_test.pbsnapshot");
+  {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out.write(data.data(), data.size());
+    ASSERT_TRUE(out.good());
+  }
+
+  auto snapshot = DescriptorPoolSnapshot::Open(path);
+  ASSERT_TRUE(snapshot.ok()) << snapshot.status();
+  EXPECT_NE((*snapshot)->pool()->FindMessageTypeByName(
+                "protobuf_unittest.TestAllTypes"),
+            nullptr);
+
+  EXPECT_FALSE(
+      DescriptorPoolSnapshot::Open(absl::StrCat(path, ".missing")).ok());
+}
+
+}  // namespace
+}  // namespace protobuf
+}  // namespace google
@@ -486,7 +486,10 @@ size_t Reflection::SpaceUsedLong(const Message& message) const {
                 // Except oneof fields, those never point to a default instance,
                 // and there is no default instance to point to.
                 const auto& str = GetField<ArenaStringPtr>(message, field);
-                if (!str.IsDefault() || schema_.InRealOneof(field)) {
+                if (str.IsAliased()) {
+                  // Only the view is owned by the message.
+                  total_size += sizeof(absl::string_view);
+                } else if (!str.IsDefault() || schema_.InRealOneof(field)) {
                   // string fields are represented by just a pointer, so also
                   // include sizeof(string) as well.
                   total_size += sizeof(std::string) +
@@ -744,18 +747,18 @@ void SwapFieldHelper::SwapArenaStringPtr(ArenaStringPtr* lhs, Arena* lhs_arena,
   } else if (lhs->IsDefault() && rhs->IsDefault()) {
     // Nothing to do.
   } else if (lhs->IsDefault()) {
-    lhs->Set(rhs->Get(), lhs_arena);
+    lhs->Set(rhs->GetView(), lhs_arena);
     // rhs needs to be destroyed before overwritten.
     rhs->Destroy();
     rhs->InitDefault();
   } else if (rhs->IsDefault()) {
-    rhs->Set(lhs->Get(), rhs_arena);
+    rhs->Set(lhs->GetView(), rhs_arena);
     // lhs needs to be destroyed before overwritten.
     lhs->Destroy();
     lhs->InitDefault();
   } else {
-    std::string temp = lhs->Get();
-    lhs->Set(rhs->Get(), lhs_arena);
+    std::string temp(lhs->GetView());
+    lhs->Set(rhs->GetView(), lhs_arena);
     rhs->Set(std::move(temp), rhs_arena);
   }
 }
@@ -1889,8 +1892,8 @@ std::string Reflection::GetString(const Message& message,
           return GetField<InlinedStringField>(message, field).GetNoArena();
         } else {
           const auto& str = GetField<ArenaStringPtr>(message, field);
-          return str.IsDefault() ? std::string(field->default_value_string())
-                                 : str.Get();
+          return std::string(str.IsDefault() ? field->default_value_string()
+                                             : str.GetView());
         }
     }
     internal::Unreachable();
@@ -1924,6 +1927,10 @@ const std::string& Reflection::GetStringReference(const Message& message,
           return GetField<InlinedStringField>(message, field).GetNoArena();
         } else {
           const auto& str = GetField<ArenaStringPtr>(message, field);
+          if (str.IsAliased()) {
+            scratch->assign(str.GetView().data(), str.GetView().size());
+            return *scratch;
+          }
           return str.IsDefault() ? internal::DefaultValueStringAsString(field)
                                  : str.Get();
         }
@@ -1957,7 +1964,7 @@ absl::Cord Reflection::GetCord(const Message& message,
         } else {
           const auto& str = GetField<ArenaStringPtr>(message, field);
           return absl::Cord(str.IsDefault() ? field->default_value_string()
-                                            : str.Get());
+                                            : str.GetView());
         }
     }
     internal::Unreachable();
@@ -1986,7 +1993,7 @@ absl::string_view Reflection::GetStringView(const Message& message,
     }
     default:
       auto str = GetField<ArenaStringPtr>(message, field);
-      return str.IsDefault() ? field->default_value_string() : str.Get();
+      return str.IsDefault() ? field->default_value_string() : str.GetView();
   }
 }
 
@@ -3034,7 +3041,7 @@ bool Reflection::HasFieldSingular(const Message& message,
                           .empty();
             }
 
-            return GetField<ArenaStringPtr>(message, field).Get().size() > 0;
+            return !GetField<ArenaStringPtr>(message, field).GetView().empty();
           }
         }
         internal::Unreachable();
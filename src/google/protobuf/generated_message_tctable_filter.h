@@ -0,0 +1,68 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the field filter for filtered table-driven parsing.
+// Everything in this file is for internal use only.
+
+#ifndef GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCTABLE_FILTER_H__
+#define GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCTABLE_FILTER_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message_lite.h"
+
+// Must come last:
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace internal {
+
+// Selects the fields that TcParser::ParseFiltered() parses.  The fields of a
+// message that its node does not select are skipped on the wire, without being
+// stored anywhere, not even as unknown fields.  A selected message field whose
+// entry has a child node is parsed with that node selecting its fields in turn,
+// and the other selected fields are parsed as usual.  Fields which can not be
+// parsed field by field, like map fields, are always parsed whole.
+struct PROTOBUF_EXPORT ParseFieldFilter {
+  struct Entry {
+    uint32_t number;
+    // The index of the node for the fields of the message, or -1 to parse the
+    // whole field.
+    int child;
+  };
+
+  // Returns the entry for the field with the given number, or nullptr if
+  // `node` does not select it.
+  const Entry* Find(int node, uint32_t number) const;
+
+  // The entries of each node, ordered by field number.
+  std::vector<std::vector<Entry>> nodes;
+  // The node of the message being parsed.
+  int root = 0;
+};
+
+// Merge the fields that `filter` selects from `input` into `msg`, skipping the
+// others, like TcParser::ParseFiltered().  Like the MergePartialFrom*()
+// methods of MessageLite, these do not check that required fields are set.
+PROTOBUF_EXPORT bool MergeFilteredFrom(absl::string_view input,
+                                       MessageLite* msg,
+                                       const ParseFieldFilter& filter);
+PROTOBUF_EXPORT bool MergeFilteredFrom(io::CodedInputStream* input,
+                                       MessageLite* msg,
+                                       const ParseFieldFilter& filter);
+
+}  // namespace internal
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_GENERATED_MESSAGE_TCTABLE_FILTER_H__
@@ -148,6 +148,19 @@ bool HasLazyRep(const FieldDescriptor* field,
          options.lazy_opt != 0;
 }
 
+// Singular `string_view` fields of generated messages are read through
+// `ArenaStringPtr::GetView()`, so they can alias the input buffer when parsing
+// with aliasing enabled.
+bool HasAliasRep(const FieldDescriptor* field,
+                 const TailCallTableInfo::FieldOptions& options,
+                 const TailCallTableInfo::MessageOptions& message_options) {
+  return (field->type() == FieldDescriptor::TYPE_STRING ||
+          field->type() == FieldDescriptor::TYPE_BYTES) &&
+         field->cpp_string_type() == FieldDescriptor::CppStringType::kView &&
+         !field->is_repeated() && !options.is_string_inlined &&
+         message_options.uses_codegen;
+}
+
 TailCallTableInfo::FastFieldInfo::Field MakeFastFieldEntry(
     const TailCallTableInfo::FieldEntryInfo& entry,
     const TailCallTableInfo::FieldOptions& options,
@@ -171,7 +184,9 @@ TailCallTableInfo::FastFieldInfo::Field MakeFastFieldEntry(
   (field->cpp_string_type() == FieldDescriptor::CppStringType::kCord \
        ? PROTOBUF_PICK_FUNCTION(fn##cS)                              \
    : options.is_string_inlined ? PROTOBUF_PICK_FUNCTION(fn##iS)      \
-                               : PROTOBUF_PICK_REPEATABLE_FUNCTION(fn))
+   : HasAliasRep(field, options, message_options)                    \
+       ? PROTOBUF_PICK_FUNCTION(fn##aS)                              \
+       : PROTOBUF_PICK_REPEATABLE_FUNCTION(fn))
 
   const FieldDescriptor* field = entry.field;
   info.aux_idx = static_cast<uint8_t>(entry.aux_idx);
@@ -609,6 +624,7 @@ TailCallTableInfo::NumToEntryTable MakeNumToEntryTable(
 uint16_t MakeTypeCardForField(
     const FieldDescriptor* field, bool has_hasbit,
     const TailCallTableInfo::FieldOptions& options,
+    const TailCallTableInfo::MessageOptions& message_options,
     cpp::Utf8CheckMode utf8_check_mode) {
   uint16_t type_card;
   namespace fl = internal::field_layout;
@@ -772,6 +788,9 @@ uint16_t MakeTypeCardForField(
           // A repeated string field uses RepeatedPtrField<std::string>
           // (unless it has a ctype option; see above).
           type_card |= fl::kRepSString;
+        } else if (HasAliasRep(field, options, message_options)) {
+          // An ArenaStringPtr that may alias the input.
+          type_card |= fl::kRepAlias;
         } else {
           // Otherwise, non-repeated string fields use ArenaStringPtr.
           type_card |= fl::kRepAString;
@@ -898,8 +917,9 @@ TailCallTableInfo::TailCallTableInfo(
     auto& entry = field_entries.back();
     entry.utf8_check_mode =
         cpp::GetUtf8CheckMode(field, message_options.is_lite);
-    entry.type_card = MakeTypeCardForField(field, entry.hasbit_idx >= 0,
-                                           options, entry.utf8_check_mode);
+    entry.type_card =
+        MakeTypeCardForField(field, entry.hasbit_idx >= 0, options,
+                             message_options, entry.utf8_check_mode);
 
     if (field->type() == FieldDescriptor::TYPE_MESSAGE ||
         field->type() == FieldDescriptor::TYPE_GROUP) {
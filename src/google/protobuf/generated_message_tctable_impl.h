@@ -42,6 +42,9 @@ class UnknownFieldSet;
 
 namespace internal {
 
+// Defined in generated_message_tctable_filter.h.
+struct ParseFieldFilter;
+
 enum {
   kInlinedStringAuxIdx = 0,
   kSplitOffsetAuxIdx = 1,
@@ -134,6 +137,7 @@ enum FieldRep : uint16_t {
   kRepCord     = 2 << kRepShift,  // absl::Cord
   kRepSPiece   = 3 << kRepShift,  // StringPieceField
   kRepSString  = 4 << kRepShift,  // std::string*
+  kRepAlias    = 5 << kRepShift,  // ArenaStringPtr, may alias the input
   // Message types (WT=2 unless otherwise noted):
   kRepMessage  = 0,               // MessageLite*
   kRepGroup    = 1 << kRepShift,  // MessageLite* (WT=3,4)
@@ -306,8 +310,9 @@ inline void AlignFail(std::integral_constant<size_t, 1>,
 //     Mt  - message width table driven parse tables
 //     End - End group tag
 //
-// * string types can have a `c` or `i` suffix, indicating the
-//   underlying storage type to be cord or inlined respectively.
+// * string types can have a `c`, `i` or `a` suffix, indicating the
+//   underlying storage type to be cord, inlined or an ArenaStringPtr that can
+//   alias the input buffer respectively.
 //
 //  validation:
 //    For enums:
@@ -354,6 +359,9 @@ inline void AlignFail(std::integral_constant<size_t, 1>,
   PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastBc)                  \
   PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastSc)                  \
   PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastUc)                  \
+  PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastBa)                  \
+  PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastSa)                  \
+  PROTOBUF_TC_PARSE_FUNCTION_LIST_SINGLE(FastUa)                  \
   PROTOBUF_TC_PARSE_FUNCTION_LIST_REPEATED(FastGd)                \
   PROTOBUF_TC_PARSE_FUNCTION_LIST_REPEATED(FastGt)                \
   PROTOBUF_TC_PARSE_FUNCTION_LIST_REPEATED(FastMd)                \
@@ -439,6 +447,11 @@ class PROTOBUF_EXPORT TcParser final {
       MessageLite* msg, const char* ptr, ParseContext* ctx,
       const TcParseTableBase* table);
 
+  // Like ParseLoop(), but only parses the fields that `filter` selects.
+  static const char* ParseFiltered(MessageLite* msg, const char* ptr,
+                                   ParseContext* ctx,
+                                   const ParseFieldFilter& filter);
+
   // Functions referenced by generated fast tables (numeric types):
   //   F: fixed      V: varint     Z: zigzag
   //   8/32/64: storage type width (bits)
@@ -610,6 +623,7 @@ class PROTOBUF_EXPORT TcParser final {
   // Functions referenced by generated fast tables (string types):
   //   B: bytes      S: string     U: UTF-8 string
   //   (empty): ArenaStringPtr     i: InlinedString
+  //   a: ArenaStringPtr aliasing the input when parsing with aliasing
   //   S: singular   R: repeated
   //   1/2: tag length (bytes)
   PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastBS1(
@@ -663,6 +677,19 @@ class PROTOBUF_EXPORT TcParser final {
   PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastUcS2(
       PROTOBUF_TC_PARAM_DECL);
 
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastBaS1(
+      PROTOBUF_TC_PARAM_DECL);
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastBaS2(
+      PROTOBUF_TC_PARAM_DECL);
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastSaS1(
+      PROTOBUF_TC_PARAM_DECL);
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastSaS2(
+      PROTOBUF_TC_PARAM_DECL);
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastUaS1(
+      PROTOBUF_TC_PARAM_DECL);
+  PROTOBUF_NOINLINE PROTOBUF_CC static const char* FastUaS2(
+      PROTOBUF_TC_PARAM_DECL);
+
   // Functions referenced by generated fast tables (message types):
   //   M: message    G: group
   //   d: default*   t: TcParseTable* (the contents of aux)  l: lazy
@@ -992,7 +1019,8 @@ class PROTOBUF_EXPORT TcParser final {
 
   // Implementations for fast string field parsing functions:
   enum Utf8Type { kNoUtf8 = 0, kUtf8 = 1, kUtf8ValidateOnly = 2 };
-  template <typename TagType, typename FieldType, Utf8Type utf8>
+  template <typename TagType, typename FieldType, Utf8Type utf8,
+            bool alias = false>
   PROTOBUF_CC static inline const char* SingularString(PROTOBUF_TC_PARAM_DECL);
   template <typename TagType, typename FieldType, Utf8Type utf8>
   PROTOBUF_CC static inline const char* RepeatedString(PROTOBUF_TC_PARAM_DECL);
@@ -1096,6 +1124,27 @@ class PROTOBUF_EXPORT TcParser final {
   template <bool is_split>
   PROTOBUF_NOINLINE PROTOBUF_CC static const char* MpMap(
       PROTOBUF_TC_PARAM_DECL);
+
+  // Parses fields like ParseLoop(), but does not call the post loop handler.
+  static const char* ParseFields(MessageLite* msg, const char* ptr,
+                                 ParseContext* ctx,
+                                 const TcParseTableBase* table);
+
+  // Filtered parsing:
+  static const char* ParseLoopFiltered(MessageLite* msg, const char* ptr,
+                                       ParseContext* ctx,
+                                       const TcParseTableBase* table,
+                                       const ParseFieldFilter& filter,
+                                       int node);
+  // Parses the field that starts at `field_start`, whose tag `ptr` points
+  // past, selected by a filter with the given `child` node.
+  static const char* ParseFilteredField(MessageLite* msg,
+                                        const char* field_start,
+                                        const char* ptr, ParseContext* ctx,
+                                        const TcParseTableBase* table,
+                                        uint32_t tag,
+                                        const ParseFieldFilter& filter,
+                                        int child);
 };
 
 // Dispatch to the designated parse function
@@ -1131,7 +1180,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::ToParseLoop(
   return ptr;
 }
 
-inline PROTOBUF_ALWAYS_INLINE const char* TcParser::ParseLoop(
+inline PROTOBUF_ALWAYS_INLINE const char* TcParser::ParseFields(
     MessageLite* msg, const char* ptr, ParseContext* ctx,
     const TcParseTableBase* table) {
   // Note: TagDispatch uses a dispatch table at "&table->fast_entries".
@@ -1153,7 +1202,13 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::ParseLoop(
     if (ptr == nullptr) break;
     if (ctx->LastTag() != 1) break;  // Ended on terminating tag
   }
-  table -= 1;
+  return ptr;
+}
+
+inline PROTOBUF_ALWAYS_INLINE const char* TcParser::ParseLoop(
+    MessageLite* msg, const char* ptr, ParseContext* ctx,
+    const TcParseTableBase* table) {
+  ptr = ParseFields(msg, ptr, ctx, table);
   if (ABSL_PREDICT_FALSE(table->has_post_loop_handler)) {
     return table->post_loop_handler(msg, ptr, ctx);
   }
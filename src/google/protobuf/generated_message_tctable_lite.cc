@@ -14,6 +14,8 @@
 #include <numeric>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "absl/base/optimization.h"
 #include "absl/log/absl_check.h"
@@ -26,6 +28,7 @@
 #include "google/protobuf/arenastring.h"
 #include "google/protobuf/generated_enum_util.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_filter.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/inlined_string_field.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
@@ -133,6 +136,7 @@ void TcParser::VerifyHasBitConsistency(const MessageLite* msg,
       case fl::kFkString:
         switch (entry.type_card & fl::kRepMask) {
           case field_layout::kRepAString:
+          case field_layout::kRepAlias:
             if (has_bit) {
               // Must not point to the default.
               ABSL_CHECK(!RefAt<ArenaStringPtr>(base, entry.offset).IsDefault())
@@ -1124,19 +1128,7 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::PackedVarint(
   // pending hasbits now:
   SyncHasbits(msg, hasbits, table);
   auto* field = &RefAt<RepeatedField<FieldType>>(msg, data.offset());
-  return ctx->ReadPackedVarint(ptr, [field](uint64_t varint) {
-    FieldType val;
-    if (zigzag) {
-      if (sizeof(FieldType) == 8) {
-        val = WireFormatLite::ZigZagDecode64(varint);
-      } else {
-        val = WireFormatLite::ZigZagDecode32(varint);
-      }
-    } else {
-      val = varint;
-    }
-    field->Add(val);
-  });
+  return ctx->ReadPackedVarintToField<FieldType, zigzag>(ptr, field);
 }
 
 PROTOBUF_NOINLINE const char* TcParser::FastV8P1(PROTOBUF_TC_PARAM_DECL) {
@@ -1554,8 +1546,13 @@ const char* ReadStringNoArena(MessageLite* /*msg*/, const char* ptr,
   return ctx->ReadString(ptr, size, field.MutableNoCopy(nullptr));
 }
 
+PROTOBUF_ALWAYS_INLINE inline const char* ReadAliasedStringIntoArena(
+    const char* ptr, ParseContext* ctx, ArenaStringPtr& field, Arena* arena) {
+  return ctx->ReadAliasedArenaString(ptr, &field, arena);
+}
+
 PROTOBUF_ALWAYS_INLINE inline bool IsValidUTF8(ArenaStringPtr& field) {
-  return utf8_range::IsStructurallyValid(field.Get());
+  return utf8_range::IsStructurallyValid(field.GetView());
 }
 
 
@@ -1574,7 +1571,8 @@ PROTOBUF_UNUSED void EnsureArenaStringIsNotDefault(const MessageLite* msg,
 
 }  // namespace
 
-template <typename TagType, typename FieldType, TcParser::Utf8Type utf8>
+template <typename TagType, typename FieldType, TcParser::Utf8Type utf8,
+          bool alias>
 inline PROTOBUF_ALWAYS_INLINE const char* TcParser::SingularString(
     PROTOBUF_TC_PARAM_DECL) {
   if (PROTOBUF_PREDICT_FALSE(data.coded_tag<TagType>() != 0)) {
@@ -1585,7 +1583,9 @@ inline PROTOBUF_ALWAYS_INLINE const char* TcParser::SingularString(
   hasbits |= (uint64_t{1} << data.hasbit_idx());
   auto& field = RefAt<FieldType>(msg, data.offset());
   auto arena = msg->GetArena();
-  if (arena) {
+  if (alias && arena && ctx->AliasingEnabled()) {
+    ptr = ReadAliasedStringIntoArena(ptr, ctx, field, arena);
+  } else if (arena) {
     ptr =
         ReadStringIntoArena(msg, ptr, ctx, data.aux_idx(), table, field, arena);
   } else {
@@ -1663,6 +1663,39 @@ const char* TcParser::FastUiS2(PROTOBUF_TC_PARAM_DECL) {
   PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
 }
 
+// Aliasing string variants:
+
+PROTOBUF_NOINLINE const char* TcParser::FastBaS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, ArenaStringPtr, kNoUtf8,
+                                          /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+PROTOBUF_NOINLINE const char* TcParser::FastBaS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, ArenaStringPtr, kNoUtf8,
+                                          /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+PROTOBUF_NOINLINE const char* TcParser::FastSaS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, ArenaStringPtr,
+                                          kUtf8ValidateOnly, /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+PROTOBUF_NOINLINE const char* TcParser::FastSaS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, ArenaStringPtr,
+                                          kUtf8ValidateOnly, /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+PROTOBUF_NOINLINE const char* TcParser::FastUaS1(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint8_t, ArenaStringPtr, kUtf8,
+                                          /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+PROTOBUF_NOINLINE const char* TcParser::FastUaS2(PROTOBUF_TC_PARAM_DECL) {
+  PROTOBUF_MUSTTAIL return SingularString<uint16_t, ArenaStringPtr, kUtf8,
+                                          /*alias=*/true>(
+      PROTOBUF_TC_PARAM_PASS);
+}
+
 // Corded string variants:
 const char* TcParser::FastBcS1(PROTOBUF_TC_PARAM_DECL) {
   PROTOBUF_MUSTTAIL return MiniParse(PROTOBUF_TC_PARAM_NO_DATA_PASS);
@@ -1812,7 +1845,8 @@ bool TcParser::ChangeOneof(const TcParseTableBase* table,
   uint16_t current_rep = current_entry->type_card & field_layout::kRepMask;
   if (current_kind == field_layout::kFkString) {
     switch (current_rep) {
-      case field_layout::kRepAString: {
+      case field_layout::kRepAString:
+      case field_layout::kRepAlias: {
         auto& field = RefAt<ArenaStringPtr>(msg, current_entry->offset);
         field.Destroy();
         break;
@@ -2208,14 +2242,10 @@ const char* TcParser::MpPackedVarintT(PROTOBUF_TC_PARAM_DECL) {
         field->Add(value);
       }
     });
+  } else if (is_zigzag) {
+    return ctx->ReadPackedVarintToField<FieldType, true>(ptr, field);
   } else {
-    return ctx->ReadPackedVarint(ptr, [=](uint64_t value) {
-      field->Add(is_zigzag ? (sizeof(FieldType) == 8
-                                  ? WireFormatLite::ZigZagDecode64(value)
-                                  : WireFormatLite::ZigZagDecode32(
-                                        static_cast<uint32_t>(value)))
-                           : value);
-    });
+    return ctx->ReadPackedVarintToField<FieldType, false>(ptr, field);
   }
 }
 
@@ -2340,11 +2370,14 @@ PROTOBUF_NOINLINE const char* TcParser::MpString(PROTOBUF_TC_PARAM_DECL) {
   bool is_valid = false;
   void* const base = MaybeGetSplitBase(msg, is_split, table);
   switch (rep) {
-    case field_layout::kRepAString: {
+    case field_layout::kRepAString:
+    case field_layout::kRepAlias: {
       auto& field = RefAt<ArenaStringPtr>(base, entry.offset);
       if (need_init) field.InitDefault();
       Arena* arena = msg->GetArena();
-      if (arena) {
+      if (rep == field_layout::kRepAlias && arena && ctx->AliasingEnabled()) {
+        ptr = ctx->ReadAliasedArenaString(ptr, &field, arena);
+      } else if (arena) {
         ptr = ctx->ReadArenaString(ptr, &field, arena);
       } else {
         std::string* str = field.MutableNoCopy(nullptr);
@@ -2354,7 +2387,7 @@ PROTOBUF_NOINLINE const char* TcParser::MpString(PROTOBUF_TC_PARAM_DECL) {
         EnsureArenaStringIsNotDefault(msg, &field);
         break;
       }
-      is_valid = MpVerifyUtf8(field.Get(), table, entry, xform_val);
+      is_valid = MpVerifyUtf8(field.GetView(), table, entry, xform_val);
       break;
     }
 
@@ -2603,6 +2636,169 @@ error:
   PROTOBUF_MUSTTAIL return Error(PROTOBUF_TC_PARAM_NO_DATA_PASS);
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Filtered parsing
+//////////////////////////////////////////////////////////////////////////////
+
+const ParseFieldFilter::Entry* ParseFieldFilter::Find(int node,
+                                                      uint32_t number) const {
+  const std::vector<Entry>& entries = nodes[node];
+  auto it = std::lower_bound(entries.begin(), entries.end(), number,
+                             [](const Entry& entry, uint32_t number) {
+                               return entry.number < number;
+                             });
+  return it != entries.end() && it->number == number ? &*it : nullptr;
+}
+
+const char* TcParser::ParseFiltered(MessageLite* msg, const char* ptr,
+                                    ParseContext* ctx,
+                                    const ParseFieldFilter& filter) {
+  return ParseLoopFiltered(msg, ptr, ctx, msg->GetTcParseTable(), filter,
+                           filter.root);
+}
+
+const char* TcParser::ParseLoopFiltered(MessageLite* msg, const char* ptr,
+                                        ParseContext* ctx,
+                                        const TcParseTableBase* table,
+                                        const ParseFieldFilter& filter,
+                                        int node) {
+  while (!ctx->Done(&ptr)) {
+    const char* const field_start = ptr;
+    uint32_t tag;
+    ptr = ReadTagInlined(ptr, &tag);
+    if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) return nullptr;
+    if (tag == 0 || (tag & 7) == WireFormatLite::WIRETYPE_END_GROUP) {
+      ctx->SetLastTag(tag);
+      break;
+    }
+    const ParseFieldFilter::Entry* filter_entry = filter.Find(node, tag >> 3);
+    if (filter_entry == nullptr) {
+      // Skip the field without keeping it as an unknown field.
+      ptr = UnknownFieldParse(tag, nullptr, ptr, ctx);
+    } else {
+      ptr = ParseFilteredField(msg, field_start, ptr, ctx, table, tag, filter,
+                               filter_entry->child);
+    }
+    if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) return nullptr;
+  }
+  if (ABSL_PREDICT_FALSE(table->has_post_loop_handler)) {
+    return table->post_loop_handler(msg, ptr, ctx);
+  }
+  return ptr;
+}
+
+const char* TcParser::ParseFilteredField(MessageLite* msg,
+                                         const char* field_start,
+                                         const char* ptr, ParseContext* ctx,
+                                         const TcParseTableBase* table,
+                                         uint32_t tag,
+                                         const ParseFieldFilter& filter,
+                                         int child) {
+  const FieldEntry* entry = FindFieldEntry(table, tag >> 3);
+  if (entry == nullptr) {
+    // Extensions and unknown fields go to the fallback, which parses a single
+    // field.
+    return table->fallback(msg, ptr, ctx, TcFieldData(tag), table, 0);
+  }
+
+  const uint32_t wiretype = tag & 7;
+  const uint16_t type_card = entry->type_card;
+  const uint16_t rep = type_card & field_layout::kRepMask;
+  const bool is_group = rep == field_layout::kRepGroup;
+  if ((type_card & field_layout::kFkMask) == field_layout::kFkMessage &&
+      ((rep == field_layout::kRepMessage &&
+        wiretype == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) ||
+       (is_group && wiretype == WireFormatLite::WIRETYPE_START_GROUP))) {
+    // Find or add the submessage like MpMessage() and
+    // MpRepeatedMessageOrGroup() do, and parse into it directly.
+    const uint16_t card = type_card & field_layout::kFcMask;
+    const bool is_split = (type_card & field_layout::kSplitMask) != 0;
+    const TcParseTableBase* inner_table =
+        GetTableFromAux(type_card, *table->field_aux(entry));
+    MessageLite* submsg;
+    if (card == field_layout::kFcRepeated) {
+      void* const base = MaybeGetSplitBase(msg, is_split, table);
+      RepeatedPtrFieldBase& field =
+          is_split ? MaybeCreateRepeatedRefAt<RepeatedPtrFieldBase, true>(
+                         base, entry->offset, msg)
+                   : MaybeCreateRepeatedRefAt<RepeatedPtrFieldBase, false>(
+                         base, entry->offset, msg);
+      submsg = AddMessage(inner_table, field);
+    } else {
+      bool need_init = false;
+      if (card == field_layout::kFcOptional) {
+        SetHas(*entry, msg);
+      } else if (card == field_layout::kFcOneof) {
+        need_init = ChangeOneof(table, *entry, tag >> 3, ctx, msg);
+      }
+      void* const base = MaybeGetSplitBase(msg, is_split, table);
+      MessageLite*& field = RefAt<MessageLite*>(base, entry->offset);
+      if (need_init || field == nullptr) {
+        field = NewMessage(inner_table, msg->GetArena());
+      }
+      submsg = field;
+    }
+    const auto inner_loop = [&](const char* ptr) {
+      return child < 0 ? ParseLoopPreserveNone(submsg, ptr, ctx, inner_table)
+                       : ParseLoopFiltered(submsg, ptr, ctx, inner_table,
+                                           filter, child);
+    };
+    return is_group ? ctx->ParseGroupInlined(ptr, tag, inner_loop)
+                    : ctx->ParseLengthDelimitedInlined(ptr, inner_loop);
+  }
+
+  // The end of a group is only found by parsing it, so a group with the wire
+  // type of another field goes to the fallback, like the table would send it.
+  if (wiretype == WireFormatLite::WIRETYPE_START_GROUP) {
+    return table->fallback(msg, ptr, ctx, TcFieldData(tag), table, 0);
+  }
+
+  // Any other field is parsed by the table, within a limit at the end of the
+  // field so that parsing stops there.  The tag and the value fit in the slop
+  // bytes after field_start, except for the payload of a length-delimited
+  // field.
+  int size = static_cast<int>(ptr - field_start);
+  switch (wiretype) {
+    case WireFormatLite::WIRETYPE_VARINT: {
+      int i = 0;
+      while (static_cast<uint8_t>(ptr[i]) >= 0x80) {
+        if (++i == 10) return nullptr;
+      }
+      size += i + 1;
+      break;
+    }
+    case WireFormatLite::WIRETYPE_FIXED64:
+      size += 8;
+      break;
+    case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+      const char* payload = ptr;
+      const uint32_t length = ReadSize(&payload);
+      if (payload == nullptr) return nullptr;
+      size = static_cast<int>(payload - field_start);
+      // Like ReadSize(), keep the limit clear of the slop bytes that
+      // PushLimit() adds to it.
+      if (length > static_cast<uint32_t>(std::numeric_limits<int>::max() -
+                                         16 - size)) {
+        return nullptr;
+      }
+      size += static_cast<int>(length);
+      break;
+    }
+    case WireFormatLite::WIRETYPE_FIXED32:
+      size += 4;
+      break;
+    default:
+      return nullptr;
+  }
+  auto old_limit = ctx->PushLimit(field_start, size);
+  ptr = ParseFields(msg, field_start, ctx, table);
+  if (PROTOBUF_PREDICT_FALSE(ptr == nullptr)) return nullptr;
+  if (PROTOBUF_PREDICT_FALSE(!ctx->PopLimit(std::move(old_limit)))) {
+    return nullptr;
+  }
+  return ptr;
+}
+
 static void SerializeMapKey(const NodeBase* node, MapTypeCard type_card,
                             io::CodedOutputStream& coded_output) {
   switch (type_card.wiretype()) {
@@ -2982,13 +3178,14 @@ std::string TypeCardToString(uint16_t type_card) {
           ABSL_LOG(FATAL) << "Unknown type_card: 0x" << type_card;
       }
 
-      static constexpr const char* kRepNames[] = {"AString", "IString", "Cord",
-                                                  "SPiece", "SString"};
+      static constexpr const char* kRepNames[] = {
+          "AString", "IString", "Cord", "SPiece", "SString", "Alias"};
       static_assert((fl::kRepAString >> fl::kRepShift) == 0, "");
       static_assert((fl::kRepIString >> fl::kRepShift) == 1, "");
       static_assert((fl::kRepCord >> fl::kRepShift) == 2, "");
       static_assert((fl::kRepSPiece >> fl::kRepShift) == 3, "");
       static_assert((fl::kRepSString >> fl::kRepShift) == 4, "");
+      static_assert((fl::kRepAlias >> fl::kRepShift) == 5, "");
 
       absl::StrAppend(&out, " | ::_fl::kRep", kRepNames[rep_index]);
       break;
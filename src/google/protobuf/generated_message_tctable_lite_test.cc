@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -21,8 +22,10 @@
 #include "google/protobuf/descriptor_database.h"
 #include "google/protobuf/descriptor_visitor.h"
 #include "google/protobuf/generated_message_tctable_decl.h"
+#include "google/protobuf/generated_message_tctable_filter.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message_lite.h"
 #include "google/protobuf/parse_context.h"
 #include "google/protobuf/unittest.pb.h"
@@ -984,6 +987,77 @@ TEST(GeneratedMessageTctableLiteTest,
   EXPECT_LE(proto.vals().Capacity(), 2048);
 }
 
+TEST(GeneratedMessageTctableLiteTest, ParseFiltered) {
+  protobuf_unittest::TestAllTypes src;
+  src.set_optional_int32(1);
+  src.set_optional_int64(2);
+  src.set_optional_string("skipped");
+  src.set_optional_bytes(std::string(100, 'b'));
+  src.mutable_optionalgroup()->set_a(3);
+  src.mutable_optional_nested_message()->set_bb(4);
+  for (int i = 0; i < 3; ++i) {
+    src.add_repeated_int64(i);
+    src.add_repeated_string("skipped");
+    src.add_repeated_nested_message()->set_bb(i);
+    src.add_repeated_foreign_message()->set_c(i);
+  }
+  src.mutable_oneof_nested_message()->set_bb(5);
+  std::string data = src.SerializeAsString();
+  // Field 1000 is not known to TestAllTypes.
+  data += std::string("\xc0\x3e\x01", 3);
+
+  ParseFieldFilter filter;
+  filter.nodes = {
+      // optional_int32, optional_bytes, optionalgroup, repeated_int64,
+      // repeated_nested_message, repeated_foreign_message and
+      // oneof_nested_message.
+      {{1, -1}, {15, -1}, {16, 1}, {32, -1}, {48, 2}, {49, 3}, {112, 2}},
+      // OptionalGroup.a
+      {{17, -1}},
+      // NestedMessage.bb
+      {{1, -1}},
+      // Nothing from ForeignMessage.
+      {},
+  };
+
+  protobuf_unittest::TestAllTypes expected;
+  expected.set_optional_int32(1);
+  expected.set_optional_bytes(std::string(100, 'b'));
+  expected.mutable_optionalgroup()->set_a(3);
+  for (int i = 0; i < 3; ++i) {
+    expected.add_repeated_int64(i);
+    expected.add_repeated_nested_message()->set_bb(i);
+    expected.add_repeated_foreign_message();
+  }
+  expected.mutable_oneof_nested_message()->set_bb(5);
+
+  protobuf_unittest::TestAllTypes parsed;
+  ASSERT_TRUE(MergeFilteredFrom(data, &parsed, filter));
+  EXPECT_EQ(parsed.SerializeAsString(), expected.SerializeAsString());
+
+  // Fields which span the buffers of a stream are parsed the same way.
+  for (int block_size : {1, 3, 17}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream stream(data.data(), static_cast<int>(data.size()),
+                                block_size);
+    io::CodedInputStream input(&stream);
+    parsed.Clear();
+    ASSERT_TRUE(MergeFilteredFrom(&input, &parsed, filter));
+    EXPECT_TRUE(input.ConsumedEntireMessage());
+    EXPECT_EQ(parsed.SerializeAsString(), expected.SerializeAsString());
+  }
+
+  // Truncated input fails to parse just like it does without a filter,
+  // whether or not the cut is in a selected field.
+  for (size_t size = 0; size < data.size(); ++size) {
+    SCOPED_TRACE(size);
+    const std::string truncated = data.substr(0, size);
+    protobuf_unittest::TestAllTypes unfiltered;
+    parsed.Clear();
+    EXPECT_EQ(MergeFilteredFrom(truncated, &parsed, filter),
+              unfiltered.ParsePartialFromString(truncated));
+  }
+}
 
 }  // namespace internal
 }  // namespace protobuf
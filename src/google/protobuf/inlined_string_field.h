@@ -165,6 +165,11 @@ class PROTOBUF_EXPORT InlinedStringField {
   // Basic accessors.
   PROTOBUF_NDEBUG_INLINE const std::string& Get() const { return GetNoArena(); }
   PROTOBUF_NDEBUG_INLINE const std::string& GetNoArena() const;
+  // Same as Get(). Inlined strings never alias the parse input; this mirrors
+  // ArenaStringPtr::GetView() for generated `string_view` accessors.
+  PROTOBUF_NDEBUG_INLINE absl::string_view GetView() const {
+    return GetNoArena();
+  }
 
   // Mutable returns a std::string* instance that is heap-allocated. If this
   // field is donated, this method undonates this field by mutating the
@@ -0,0 +1,664 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/io/async_file_stream.h"
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/log/absl_check.h"
+#include "absl/log/absl_log.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/io_win32.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+#ifdef _WIN32
+// DO NOT include <io.h>, instead create functions in io_win32.{h,cc} and import
+// them like we do below.
+using google::protobuf::io::win32::close;
+using google::protobuf::io::win32::read;
+using google::protobuf::io::win32::write;
+#endif
+
+namespace {
+
+// EINTR sucks.
+int close_no_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Returns true if reads from or writes to `fd` can block indefinitely, as
+// they can on pipes, sockets and terminals, but not on regular files.
+bool CanBlock(int fd) {
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0) return false;
+  return !S_ISREG(stat_buf.st_mode) && !S_ISBLK(stat_buf.st_mode);
+}
+
+// Waits until `fd` is ready for reading, or for writing if `for_write`.
+// Returns false if `wake_fd` became readable first, i.e. if the stream is
+// being stopped.  Errors are left for the following read() or write() to
+// report.
+bool WaitReady(int fd, bool for_write, int wake_fd) {
+#ifndef _WIN32
+  struct pollfd poll_fds[2];
+  poll_fds[0].fd = fd;
+  poll_fds[0].events = for_write ? POLLOUT : POLLIN;
+  poll_fds[0].revents = 0;
+  poll_fds[1].fd = wake_fd;  // Ignored by poll() if negative.
+  poll_fds[1].events = POLLIN;
+  poll_fds[1].revents = 0;
+  int result;
+  do {
+    result = poll(poll_fds, 2, -1);
+  } while (result < 0 && errno == EINTR);
+  return result <= 0 || poll_fds[1].revents == 0;
+#else
+  return true;
+#endif
+}
+
+// Returns true if a read() or write() that failed with `error` should be
+// retried.  If the descriptor is in non-blocking mode, first waits until it
+// is ready for reading, or for writing if `for_write`, unless woken through
+// `wake_fd`.  The descriptor's flags are left alone, as they are shared with
+// every other holder of the file.
+bool ShouldRetry(int fd, int error, bool for_write, int wake_fd = -1) {
+  if (error == EINTR) return true;
+#ifndef _WIN32
+  if (error == EAGAIN || error == EWOULDBLOCK) {
+    return WaitReady(fd, for_write, wake_fd);
+  }
+#endif
+  return false;
+}
+
+#ifdef HAVE_LIBURING
+// Returns true if `fd` is a regular file that io_uring can read or write at
+// explicit offsets, starting from its current offset.  Files opened with
+// O_APPEND are excluded, as writes to them ignore the offset and could land
+// out of order.
+bool UseUring(int fd, off_t* offset) {
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode)) return false;
+  const int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || (flags & O_APPEND) != 0) return false;
+  *offset = lseek(fd, 0, SEEK_CUR);
+  return *offset >= 0;
+}
+
+// A read or write submitted to the ring, in the order of the file.
+template <typename Block>
+struct UringOp {
+  Block block;
+  off_t offset;
+  int done = 0;  // Bytes read or written so far, for short writes.
+  bool completed = false;
+  int result = 0;
+};
+
+// Waits for completions until `op` has completed.
+template <typename Op>
+void UringWait(struct io_uring* ring, Op* op) {
+  while (!op->completed) {
+    struct io_uring_cqe* cqe;
+    int result;
+    do {
+      result = io_uring_wait_cqe(ring, &cqe);
+    } while (result == -EINTR);
+    ABSL_CHECK_EQ(result, 0) << "io_uring_wait_cqe: " << strerror(-result);
+    Op* completed = static_cast<Op*>(io_uring_cqe_get_data(cqe));
+    completed->result = cqe->res;
+    completed->completed = true;
+    io_uring_cqe_seen(ring, cqe);
+  }
+}
+#endif  // HAVE_LIBURING
+
+}  // namespace
+
+AsyncFileStreamOptions::AsyncFileStreamOptions()
+    : block_size(256 << 10), block_count(4) {}
+
+// ===================================================================
+
+AsyncFileInputStream::AsyncFileInputStream(int file_descriptor)
+    : AsyncFileInputStream(file_descriptor, Options()) {}
+
+AsyncFileInputStream::AsyncFileInputStream(int file_descriptor,
+                                           const Options& options)
+    : file_(file_descriptor), options_(options) {
+  ABSL_CHECK_GT(options_.block_size, 0);
+  ABSL_CHECK_GT(options_.block_count, 0);
+  {
+    absl::MutexLock lock(&mu_);
+    for (int i = 0; i < options_.block_count; ++i) {
+      free_blocks_.push_back(
+          Block{std::make_unique<char[]>(options_.block_size), 0});
+    }
+  }
+#ifndef _WIN32
+  if (CanBlock(file_)) {
+    ABSL_CHECK_EQ(pipe(wake_fds_), 0) << strerror(errno);
+  }
+#endif
+  reader_ = std::thread([this] { ReadLoop(); });
+}
+
+AsyncFileInputStream::~AsyncFileInputStream() {
+  Stop();
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(GetErrno());
+    }
+  }
+  for (int fd : wake_fds_) {
+    if (fd >= 0) close_no_eintr(fd);
+  }
+}
+
+void AsyncFileInputStream::ReadLoop() {
+  if (UringReadLoop()) return;
+
+  while (true) {
+    Block block;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(
+          absl::Condition(this, &AsyncFileInputStream::HasFreeBlockOrStopping));
+      if (stopping_) return;
+      block = std::move(free_blocks_.front());
+      free_blocks_.pop_front();
+    }
+
+    // Reads that can block are only started once there is data, so that
+    // Stop() does not have to wait for it.
+    int result;
+    do {
+      if (wake_fds_[0] >= 0 &&
+          !WaitReady(file_, /*for_write=*/false, wake_fds_[0])) {
+        absl::MutexLock lock(&mu_);
+        free_blocks_.push_back(std::move(block));
+        return;
+      }
+      result = read(file_, block.data.get(), options_.block_size);
+    } while (result < 0 &&
+             ShouldRetry(file_, errno, /*for_write=*/false, wake_fds_[0]));
+    const int error = result < 0 ? errno : 0;
+
+    absl::MutexLock lock(&mu_);
+    if (result < 0 && error == EAGAIN && stopping_) {
+      // Woken from poll() by Stop().
+      free_blocks_.push_back(std::move(block));
+      return;
+    }
+    if (result <= 0) {
+      // End of file, or a read error.
+      errno_ = error;
+      at_end_ = true;
+      free_blocks_.push_back(std::move(block));
+      return;
+    }
+    block.size = result;
+    full_blocks_.push_back(std::move(block));
+  }
+}
+
+bool AsyncFileInputStream::UringReadLoop() {
+#ifdef HAVE_LIBURING
+  off_t offset;
+  if (!UseUring(file_, &offset)) return false;
+  struct io_uring ring;
+  if (io_uring_queue_init(options_.block_count, &ring, 0) != 0) return false;
+
+  using Op = UringOp<Block>;
+  std::deque<Op> in_flight;
+  // Offset of the next read to submit.
+  off_t next_offset = offset;
+  while (true) {
+    const size_t first_new = in_flight.size();
+    {
+      absl::MutexLock lock(&mu_);
+      if (in_flight.empty()) {
+        mu_.Await(absl::Condition(
+            this, &AsyncFileInputStream::HasFreeBlockOrStopping));
+      }
+      if (stopping_) break;
+      while (!free_blocks_.empty()) {
+        in_flight.push_back(Op{std::move(free_blocks_.front()), next_offset});
+        free_blocks_.pop_front();
+        next_offset += options_.block_size;
+      }
+    }
+    for (size_t i = first_new; i < in_flight.size(); ++i) {
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+      ABSL_CHECK(sqe != nullptr);
+      io_uring_prep_read(sqe, file_, in_flight[i].block.data.get(),
+                         options_.block_size, in_flight[i].offset);
+      io_uring_sqe_set_data(sqe, &in_flight[i]);
+    }
+    if (in_flight.size() > first_new) io_uring_submit(&ring);
+
+    // Blocks are handed out in file order, whichever read completes first.
+    Op* op = &in_flight.front();
+    UringWait(&ring, op);
+    if (op->result == -EINTR || op->result == -EAGAIN) {
+      // Resubmit the read, and any later ones behind it.
+      next_offset = op->offset;
+      for (Op& later : in_flight) UringWait(&ring, &later);
+      absl::MutexLock lock(&mu_);
+      for (Op& later : in_flight) free_blocks_.push_back(std::move(later.block));
+      in_flight.clear();
+      continue;
+    }
+    Block block = std::move(op->block);
+    const int result = op->result;
+    offset = op->offset;
+    in_flight.pop_front();
+
+    {
+      absl::MutexLock lock(&mu_);
+      if (result <= 0) {
+        // End of file, or a read error.
+        errno_ = -result;
+        at_end_ = true;
+        free_blocks_.push_back(std::move(block));
+        break;
+      }
+      offset += result;
+      block.size = result;
+      full_blocks_.push_back(std::move(block));
+    }
+    if (result < options_.block_size) {
+      // A short read, normally at the end of the file.  The reads after it
+      // started at the wrong offset: drop them and carry on from here.
+      for (Op& later : in_flight) UringWait(&ring, &later);
+      absl::MutexLock lock(&mu_);
+      for (Op& later : in_flight) free_blocks_.push_back(std::move(later.block));
+      in_flight.clear();
+      next_offset = offset;
+    }
+  }
+
+  // Wait for the reads still in flight, whose buffers the kernel writes to.
+  for (Op& op : in_flight) UringWait(&ring, &op);
+  io_uring_queue_exit(&ring);
+  {
+    absl::MutexLock lock(&mu_);
+    for (Op& op : in_flight) free_blocks_.push_back(std::move(op.block));
+  }
+  // Leave the file offset after the data read, as read() would have.
+  lseek(file_, offset, SEEK_SET);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AsyncFileInputStream::Stop() {
+  {
+    absl::MutexLock lock(&mu_);
+    if (stopping_) return;
+    stopping_ = true;
+  }
+#ifndef _WIN32
+  if (wake_fds_[1] >= 0) {
+    char byte = 0;
+    while (write(wake_fds_[1], &byte, 1) < 0 && errno == EINTR) {
+    }
+  }
+#endif
+  if (reader_.joinable()) reader_.join();
+}
+
+bool AsyncFileInputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  Stop();
+  is_closed_ = true;
+  if (close_no_eintr(file_) != 0) {
+    absl::MutexLock lock(&mu_);
+    errno_ = errno;
+    return false;
+  }
+
+  return true;
+}
+
+int AsyncFileInputStream::GetErrno() const {
+  absl::MutexLock lock(&mu_);
+  return errno_;
+}
+
+bool AsyncFileInputStream::Next(const void** data, int* size) {
+  ABSL_CHECK(!is_closed_);
+
+  if (position_ == current_.size) {
+    absl::MutexLock lock(&mu_);
+    if (current_.data != nullptr) {
+      free_blocks_.push_back(std::move(current_));
+    }
+    current_.size = position_ = 0;
+    mu_.Await(
+        absl::Condition(this, &AsyncFileInputStream::HasFullBlockOrAtEnd));
+    if (full_blocks_.empty()) {
+      last_returned_size_ = 0;
+      return false;
+    }
+    current_ = std::move(full_blocks_.front());
+    full_blocks_.pop_front();
+  }
+
+  *data = current_.data.get() + position_;
+  *size = last_returned_size_ = current_.size - position_;
+  position_ = current_.size;
+  byte_count_ += last_returned_size_;
+  return true;
+}
+
+void AsyncFileInputStream::BackUp(int count) {
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  byte_count_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool AsyncFileInputStream::Skip(int count) {
+  ABSL_CHECK_GE(count, 0);
+
+  // The data was read ahead already, so there is nothing to gain from
+  // seeking.
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!Next(&data, &size)) return false;
+    if (size > count) {
+      BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  last_returned_size_ = 0;  // Don't let caller back up.
+  return true;
+}
+
+int64_t AsyncFileInputStream::ByteCount() const { return byte_count_; }
+
+// ===================================================================
+
+AsyncFileOutputStream::AsyncFileOutputStream(int file_descriptor)
+    : AsyncFileOutputStream(file_descriptor, Options()) {}
+
+AsyncFileOutputStream::AsyncFileOutputStream(int file_descriptor,
+                                             const Options& options)
+    : file_(file_descriptor), options_(options) {
+  ABSL_CHECK_GT(options_.block_size, 0);
+  ABSL_CHECK_GT(options_.block_count, 0);
+  {
+    absl::MutexLock lock(&mu_);
+    for (int i = 0; i < options_.block_count; ++i) {
+      free_blocks_.push_back(
+          Block{std::make_unique<char[]>(options_.block_size), 0});
+    }
+  }
+  writer_ = std::thread([this] { WriteLoop(); });
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+  if (!is_closed_) {
+    Flush();
+    if (close_on_delete_) {
+      if (!Close()) {
+        ABSL_LOG(ERROR) << "close() failed: " << strerror(GetErrno());
+      }
+    }
+  }
+  Stop();
+}
+
+void AsyncFileOutputStream::WriteLoop() {
+  if (UringWriteLoop()) return;
+
+  while (true) {
+    Block block;
+    bool failed;
+    {
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(
+          this, &AsyncFileOutputStream::HasFullBlockOrStopping));
+      // Only exit once every queued block has been written.
+      if (full_blocks_.empty()) return;
+      block = std::move(full_blocks_.front());
+      full_blocks_.pop_front();
+      failed = errno_ != 0;
+    }
+
+    int error = 0;
+    for (int written = 0; !failed && written < block.size;) {
+      int result;
+      do {
+        result =
+            write(file_, block.data.get() + written, block.size - written);
+      } while (result < 0 && ShouldRetry(file_, errno, /*for_write=*/true));
+      if (result <= 0) {
+        // A write of zero bytes should not happen, but treat it like EIO
+        // rather than looping forever.
+        error = result < 0 ? errno : EIO;
+        break;
+      }
+      written += result;
+    }
+
+    absl::MutexLock lock(&mu_);
+    if (error != 0 && errno_ == 0) errno_ = error;
+    block.size = 0;
+    free_blocks_.push_back(std::move(block));
+    --pending_;
+  }
+}
+
+bool AsyncFileOutputStream::UringWriteLoop() {
+#ifdef HAVE_LIBURING
+  off_t offset;
+  if (!UseUring(file_, &offset)) return false;
+  struct io_uring ring;
+  if (io_uring_queue_init(options_.block_count, &ring, 0) != 0) return false;
+
+  using Op = UringOp<Block>;
+  std::deque<Op> in_flight;
+  auto submit = [&](Op* op) {
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    ABSL_CHECK(sqe != nullptr);
+    io_uring_prep_write(sqe, file_, op->block.data.get() + op->done,
+                        op->block.size - op->done, op->offset + op->done);
+    io_uring_sqe_set_data(sqe, op);
+    op->completed = false;
+  };
+  while (true) {
+    const size_t first_new = in_flight.size();
+    {
+      absl::MutexLock lock(&mu_);
+      if (in_flight.empty()) {
+        mu_.Await(absl::Condition(
+            this, &AsyncFileOutputStream::HasFullBlockOrStopping));
+        // Only exit once every queued block has been written.
+        if (full_blocks_.empty()) break;
+      }
+      while (!full_blocks_.empty()) {
+        Block block = std::move(full_blocks_.front());
+        full_blocks_.pop_front();
+        if (errno_ != 0) {
+          // Drop the blocks queued after a failure, as WriteLoop() does.
+          block.size = 0;
+          free_blocks_.push_back(std::move(block));
+          --pending_;
+          continue;
+        }
+        const int size = block.size;
+        in_flight.push_back(Op{std::move(block), offset});
+        offset += size;
+      }
+    }
+    for (size_t i = first_new; i < in_flight.size(); ++i) submit(&in_flight[i]);
+    if (in_flight.size() > first_new) io_uring_submit(&ring);
+    if (in_flight.empty()) continue;
+
+    // Blocks are released in file order, whichever write completes first.
+    Op* op = &in_flight.front();
+    UringWait(&ring, op);
+    int error = 0;
+    if (op->result == -EINTR || op->result == -EAGAIN ||
+        (op->result > 0 && op->done + op->result < op->block.size)) {
+      // Interrupted, or a short write: write the rest.
+      if (op->result > 0) op->done += op->result;
+      submit(op);
+      io_uring_submit(&ring);
+      continue;
+    }
+    if (op->result <= 0) {
+      // A write of zero bytes should not happen, but treat it like EIO
+      // rather than looping forever.
+      error = op->result < 0 ? -op->result : EIO;
+    }
+    Block block = std::move(op->block);
+    in_flight.pop_front();
+
+    absl::MutexLock lock(&mu_);
+    if (error != 0 && errno_ == 0) errno_ = error;
+    block.size = 0;
+    free_blocks_.push_back(std::move(block));
+    --pending_;
+  }
+
+  io_uring_queue_exit(&ring);
+  // Leave the file offset after the data written, as write() would have.
+  lseek(file_, offset, SEEK_SET);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void AsyncFileOutputStream::Stop() {
+  {
+    absl::MutexLock lock(&mu_);
+    stopping_ = true;
+  }
+  if (writer_.joinable()) writer_.join();
+}
+
+void AsyncFileOutputStream::SubmitCurrent() {
+  if (current_.data == nullptr) return;
+  if (position_ == 0) {
+    free_blocks_.push_back(std::move(current_));
+  } else {
+    current_.size = position_;
+    full_blocks_.push_back(std::move(current_));
+    ++pending_;
+  }
+  current_.size = position_ = 0;
+}
+
+bool AsyncFileOutputStream::Flush() {
+  ABSL_CHECK(!is_closed_);
+
+  absl::MutexLock lock(&mu_);
+  SubmitCurrent();
+  mu_.Await(
+      absl::Condition(this, &AsyncFileOutputStream::AllWrittenOrFailed));
+  return errno_ == 0;
+}
+
+bool AsyncFileOutputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  const bool flush_succeeded = Flush();
+  Stop();
+  is_closed_ = true;
+  if (close_no_eintr(file_) != 0) {
+    absl::MutexLock lock(&mu_);
+    errno_ = errno;
+    return false;
+  }
+
+  return flush_succeeded;
+}
+
+int AsyncFileOutputStream::GetErrno() const {
+  absl::MutexLock lock(&mu_);
+  return errno_;
+}
+
+bool AsyncFileOutputStream::Next(void** data, int* size) {
+  ABSL_CHECK(!is_closed_);
+
+  if (current_.data == nullptr || position_ == options_.block_size) {
+    absl::MutexLock lock(&mu_);
+    if (errno_ != 0) return false;
+    SubmitCurrent();
+    mu_.Await(
+        absl::Condition(this, &AsyncFileOutputStream::HasFreeBlockOrFailed));
+    if (errno_ != 0) return false;
+    current_ = std::move(free_blocks_.front());
+    free_blocks_.pop_front();
+  }
+
+  *data = current_.data.get() + position_;
+  *size = last_returned_size_ = options_.block_size - position_;
+  position_ = options_.block_size;
+  byte_count_ += last_returned_size_;
+  return true;
+}
+
+void AsyncFileOutputStream::BackUp(int count) {
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  byte_count_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+int64_t AsyncFileOutputStream::ByteCount() const { return byte_count_; }
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
@@ -0,0 +1,249 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains file streams which overlap I/O with parsing and
+// serialization.  FileInputStream and FileOutputStream issue one blocking
+// read() or write() per block from the caller's thread, so the caller stalls
+// on the disk between every block it parses or serializes.  The streams here
+// keep several blocks in flight instead: AsyncFileInputStream reads ahead and
+// AsyncFileOutputStream writes behind on a background I/O thread, and the
+// caller only waits when that thread falls behind.
+//
+// When built with liburing (HAVE_LIBURING, see the `liburing` build flag), the
+// I/O thread submits all of its blocks to an io_uring at once for regular
+// files, so the kernel works on several of them in parallel.  Other files,
+// and kernels without io_uring, use one read() or write() per block.
+
+#ifndef GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// Options shared by AsyncFileInputStream and AsyncFileOutputStream.
+struct PROTOBUF_EXPORT AsyncFileStreamOptions {
+  // Size of the blocks read or written at once.  Defaults to 256kB.
+  int block_size;
+
+  // Number of blocks in flight, i.e. how many blocks may be read ahead of the
+  // caller, or be waiting to be written behind it.  Defaults to 4.
+  int block_count;
+
+  AsyncFileStreamOptions();  // Initializes with default values.
+};
+
+// A ZeroCopyInputStream which reads from a file descriptor on a background
+// thread, up to `block_count` blocks ahead of the caller.
+//
+// The background thread starts reading as soon as the stream is created and
+// is the only one reading the descriptor until the stream is closed or
+// destroyed.  Closing or destroying the stream waits for reads from regular
+// files to complete, but not for data on pipes, sockets or terminals: the
+// thread waits for those in poll(), which the stream interrupts.  If the
+// descriptor is in non-blocking mode, the thread likewise waits in poll()
+// rather than failing with EAGAIN; the descriptor's flags are not changed.
+class PROTOBUF_EXPORT AsyncFileInputStream final : public ZeroCopyInputStream {
+ public:
+  using Options = AsyncFileStreamOptions;
+
+  // Creates a stream that reads from the given Unix file descriptor.
+  explicit AsyncFileInputStream(int file_descriptor);
+  AsyncFileInputStream(int file_descriptor, const Options& options);
+  AsyncFileInputStream(const AsyncFileInputStream&) = delete;
+  AsyncFileInputStream& operator=(const AsyncFileInputStream&) = delete;
+  ~AsyncFileInputStream() override;
+
+  // Stops reading and closes the underlying file.  Returns false if an error
+  // occurs during the process; use GetErrno() to examine the error.  Even if
+  // an error occurs, the file descriptor is closed when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  WARNING:
+  // This leaves no way for the caller to detect if close() fails.  If
+  // detecting close() errors is important to you, you should arrange
+  // to close the descriptor yourself.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail.
+  int GetErrno() const;
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    int size = 0;
+  };
+
+  // Body of the background thread.
+  void ReadLoop();
+  // Body of the background thread when reading through io_uring.  Returns
+  // false, without reading anything, if io_uring cannot be used.
+  bool UringReadLoop();
+  // Stops the background thread and waits for it to exit.
+  void Stop();
+
+  bool HasFreeBlockOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !free_blocks_.empty() || stopping_;
+  }
+  bool HasFullBlockOrAtEnd() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !full_blocks_.empty() || at_end_;
+  }
+
+  const int file_;
+  const Options options_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+  // A pipe that Stop() writes to, to wake the background thread from poll().
+  int wake_fds_[2] = {-1, -1};
+
+  mutable absl::Mutex mu_;
+  // Blocks waiting to be read into, and blocks read but not yet returned.
+  std::deque<Block> free_blocks_ ABSL_GUARDED_BY(mu_);
+  std::deque<Block> full_blocks_ ABSL_GUARDED_BY(mu_);
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  // True once the background thread reached the end of the file or failed.
+  bool at_end_ ABSL_GUARDED_BY(mu_) = false;
+  // The errno of the I/O error, if one has occurred.  Otherwise, zero.
+  int errno_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // The block returned by the last call to Next(), and how much of it the
+  // caller has consumed.
+  Block current_;
+  int position_ = 0;
+  int last_returned_size_ = 0;
+  int64_t byte_count_ = 0;
+
+  std::thread reader_;
+};
+
+// A ZeroCopyOutputStream which writes to a file descriptor on a background
+// thread, letting up to `block_count` filled blocks wait to be written while
+// the caller keeps serializing.
+//
+// Write errors are reported asynchronously: once one occurs, subsequent
+// calls to Next(), Flush() and Close() fail.  As with AsyncFileInputStream,
+// the descriptor may be in non-blocking mode.
+class PROTOBUF_EXPORT AsyncFileOutputStream final
+    : public ZeroCopyOutputStream {
+ public:
+  using Options = AsyncFileStreamOptions;
+
+  // Creates a stream that writes to the given Unix file descriptor.
+  explicit AsyncFileOutputStream(int file_descriptor);
+  AsyncFileOutputStream(int file_descriptor, const Options& options);
+  AsyncFileOutputStream(const AsyncFileOutputStream&) = delete;
+  AsyncFileOutputStream& operator=(const AsyncFileOutputStream&) = delete;
+  ~AsyncFileOutputStream() override;
+
+  // Waits until all data written so far has been written to the file.
+  // Returns false if an error occurs; use GetErrno() to examine the error.
+  bool Flush();
+
+  // Flushes any buffers and closes the underlying file.  Returns false if
+  // an error occurs during the process; use GetErrno() to examine the error.
+  // Even if an error occurs, the file descriptor is closed when this returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  WARNING:
+  // This leaves no way for the caller to detect if close() fails.  If
+  // detecting close() errors is important to you, you should arrange
+  // to close the descriptor yourself.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail.
+  int GetErrno() const;
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    int size = 0;
+  };
+
+  // Body of the background thread.
+  void WriteLoop();
+  // Body of the background thread when writing through io_uring.  Returns
+  // false, without writing anything, if io_uring cannot be used.
+  bool UringWriteLoop();
+  // Stops the background thread once it wrote all queued blocks.
+  void Stop();
+  // Queues the part of current_ filled by the caller for writing.
+  void SubmitCurrent() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  bool HasFreeBlockOrFailed() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !free_blocks_.empty() || errno_ != 0;
+  }
+  bool HasFullBlockOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !full_blocks_.empty() || stopping_;
+  }
+  bool AllWrittenOrFailed() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return pending_ == 0 || errno_ != 0;
+  }
+
+  const int file_;
+  const Options options_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+
+  mutable absl::Mutex mu_;
+  // Blocks available to the caller, and filled blocks waiting to be written.
+  std::deque<Block> free_blocks_ ABSL_GUARDED_BY(mu_);
+  std::deque<Block> full_blocks_ ABSL_GUARDED_BY(mu_);
+  // Number of blocks queued or being written.
+  int pending_ ABSL_GUARDED_BY(mu_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(mu_) = false;
+  // The errno of the I/O error, if one has occurred.  Otherwise, zero.
+  int errno_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // The block being filled by the caller, and how much of it was returned
+  // by Next().
+  Block current_;
+  int position_ = 0;
+  int last_returned_size_ = 0;
+  int64_t byte_count_ = 0;
+
+  std::thread writer_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ASYNC_FILE_STREAM_H__
@@ -0,0 +1,281 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the implementation of classes Lz4InputStream and
+// Lz4OutputStream.
+
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+
+// Dictionaries are only part of the stable LZ4F API since lz4 1.10.
+#define LZ4F_STATIC_LINKING_ONLY
+#include <lz4frame.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+static const int kDefaultBufferSize = 65536;
+
+Lz4Dictionary::Lz4Dictionary(absl::string_view data)
+    : data_(data), cdict_(LZ4F_createCDict(data_.data(), data_.size())) {}
+
+Lz4Dictionary::~Lz4Dictionary() { LZ4F_freeCDict(cdict_); }
+
+// =========================================================================
+
+Lz4InputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize), dictionary(nullptr) {}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream)
+    : Lz4InputStream(sub_stream, Options()) {}
+
+Lz4InputStream::Lz4InputStream(ZeroCopyInputStream* sub_stream,
+                               const Options& options)
+    : sub_stream_(sub_stream),
+      dctx_(nullptr),
+      dictionary_(options.dictionary),
+      output_buffer_(std::make_unique<char[]>(options.buffer_size)),
+      output_buffer_length_(options.buffer_size) {
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  ABSL_CHECK(dictionary_ == nullptr || dictionary_->ok());
+  LZ4F_errorCode_t error = LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION);
+  if (LZ4F_isError(error)) error_message_ = LZ4F_getErrorName(error);
+}
+
+Lz4InputStream::~Lz4InputStream() { LZ4F_freeDecompressionContext(dctx_); }
+
+bool Lz4InputStream::Decompress() {
+  size_t output_size = 0;
+  while (output_size == 0) {
+    if (input_position_ == input_size_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        input_ = nullptr;
+        input_size_ = input_position_ = 0;
+        if (!at_frame_boundary_) error_message_ = "Truncated LZ4 frame";
+        return false;
+      }
+      input_ = static_cast<const char*>(in);
+      input_size_ = in_size;
+      input_position_ = 0;
+    }
+    size_t consumed = input_size_ - input_position_;
+    output_size = output_buffer_length_;
+    const size_t result =
+        dictionary_ == nullptr
+            ? LZ4F_decompress(dctx_, output_buffer_.get(), &output_size,
+                              input_ + input_position_, &consumed, nullptr)
+            : LZ4F_decompress_usingDict(
+                  dctx_, output_buffer_.get(), &output_size,
+                  input_ + input_position_, &consumed,
+                  dictionary_->data_.data(), dictionary_->data_.size(),
+                  nullptr);
+    if (LZ4F_isError(result)) {
+      error_message_ = LZ4F_getErrorName(result);
+      return false;
+    }
+    // LZ4F_decompress() returns 0 once a frame is fully decoded and checked.
+    if (consumed != 0 || output_size != 0) at_frame_boundary_ = result == 0;
+    input_position_ += consumed;
+  }
+  output_size_ = output_size;
+  output_position_ = 0;
+  byte_count_ += output_size;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool Lz4InputStream::Next(const void** data, int* size) {
+  if (output_position_ == output_size_) {
+    if (error_message_ != nullptr || !Decompress()) return false;
+  }
+  *data = output_buffer_.get() + output_position_;
+  *size = static_cast<int>(output_size_ - output_position_);
+  output_position_ = output_size_;
+  return true;
+}
+
+void Lz4InputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), output_position_);
+  output_position_ -= count;
+}
+
+bool Lz4InputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t Lz4InputStream::ByteCount() const {
+  return byte_count_ - static_cast<int64_t>(output_size_ - output_position_);
+}
+
+// =========================================================================
+
+Lz4OutputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize),
+      compression_level(0),
+      content_checksum(false),
+      dictionary(nullptr) {}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream)
+    : Lz4OutputStream(sub_stream, Options()) {}
+
+Lz4OutputStream::Lz4OutputStream(ZeroCopyOutputStream* sub_stream,
+                                 const Options& options)
+    : sub_stream_(sub_stream),
+      cctx_(nullptr),
+      input_buffer_(std::make_unique<char[]>(options.buffer_size)),
+      input_buffer_length_(options.buffer_size) {
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  ABSL_CHECK(options.dictionary == nullptr || options.dictionary->ok());
+
+  LZ4F_preferences_t preferences;
+  memset(&preferences, 0, sizeof(preferences));
+  preferences.compressionLevel = options.compression_level;
+  preferences.frameInfo.contentChecksumFlag =
+      options.content_checksum ? LZ4F_contentChecksumEnabled
+                               : LZ4F_noContentChecksum;
+  output_buffer_length_ =
+      std::max<size_t>(LZ4F_compressBound(input_buffer_length_, &preferences),
+                       LZ4F_HEADER_SIZE_MAX);
+  output_buffer_ = std::make_unique<char[]>(output_buffer_length_);
+
+  LZ4F_errorCode_t error =
+      LZ4F_createCompressionContext(&cctx_, LZ4F_VERSION);
+  if (LZ4F_isError(error)) {
+    error_message_ = LZ4F_getErrorName(error);
+    return;
+  }
+  const size_t header_size =
+      options.dictionary == nullptr
+          ? LZ4F_compressBegin(cctx_, output_buffer_.get(),
+                               output_buffer_length_, &preferences)
+          : LZ4F_compressBegin_usingCDict(
+                cctx_, output_buffer_.get(), output_buffer_length_,
+                options.dictionary->cdict_, &preferences);
+  if (LZ4F_isError(header_size)) {
+    error_message_ = LZ4F_getErrorName(header_size);
+    return;
+  }
+  WriteOutput(header_size);
+}
+
+Lz4OutputStream::~Lz4OutputStream() {
+  Close();
+  LZ4F_freeCompressionContext(cctx_);
+}
+
+bool Lz4OutputStream::WriteOutput(size_t size) {
+  const char* data = output_buffer_.get();
+  while (size > 0) {
+    void* out;
+    int out_size;
+    if (!sub_stream_->Next(&out, &out_size)) {
+      error_message_ = "Failed to write to the underlying stream";
+      return false;
+    }
+    const size_t n = std::min(size, static_cast<size_t>(out_size));
+    memcpy(out, data, n);
+    data += n;
+    size -= n;
+    if (n < static_cast<size_t>(out_size)) {
+      sub_stream_->BackUp(out_size - static_cast<int>(n));
+    }
+  }
+  return true;
+}
+
+bool Lz4OutputStream::CompressInput() {
+  if (input_size_ == 0) return true;
+  const size_t size =
+      LZ4F_compressUpdate(cctx_, output_buffer_.get(), output_buffer_length_,
+                          input_buffer_.get(), input_size_, nullptr);
+  if (LZ4F_isError(size)) {
+    error_message_ = LZ4F_getErrorName(size);
+    return false;
+  }
+  byte_count_ += input_size_;
+  input_size_ = 0;
+  return WriteOutput(size);
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool Lz4OutputStream::Next(void** data, int* size) {
+  if (error_message_ != nullptr || closed_) return false;
+  if (!CompressInput()) return false;
+  *data = input_buffer_.get();
+  *size = static_cast<int>(input_buffer_length_);
+  input_size_ = input_buffer_length_;
+  return true;
+}
+
+void Lz4OutputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), input_size_);
+  input_size_ -= count;
+}
+
+int64_t Lz4OutputStream::ByteCount() const {
+  return byte_count_ + static_cast<int64_t>(input_size_);
+}
+
+bool Lz4OutputStream::Flush() {
+  if (error_message_ != nullptr || closed_) return false;
+  if (!CompressInput()) return false;
+  const size_t size = LZ4F_flush(cctx_, output_buffer_.get(),
+                                 output_buffer_length_, nullptr);
+  if (LZ4F_isError(size)) {
+    error_message_ = LZ4F_getErrorName(size);
+    return false;
+  }
+  return WriteOutput(size);
+}
+
+bool Lz4OutputStream::Close() {
+  if (closed_) return error_message_ == nullptr;
+  closed_ = true;
+  if (error_message_ != nullptr || !CompressInput()) return false;
+  const size_t size = LZ4F_compressEnd(cctx_, output_buffer_.get(),
+                                       output_buffer_length_, nullptr);
+  if (LZ4F_isError(size)) {
+    error_message_ = LZ4F_getErrorName(size);
+    return false;
+  }
+  return WriteOutput(size);
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // HAVE_LZ4
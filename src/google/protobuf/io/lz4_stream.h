@@ -0,0 +1,215 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the definition for classes Lz4InputStream and
+// Lz4OutputStream, which work like GzipInputStream and GzipOutputStream but
+// read and write the LZ4 frame format.  LZ4 compresses less than zlib or
+// zstd, but is fast enough to be used where compression would otherwise cost
+// more than serialization itself.
+//
+// Lz4InputStream decompresses data from an underlying ZeroCopyInputStream
+// and provides the decompressed data as a ZeroCopyInputStream.
+//
+// Lz4OutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream.
+//
+// Both are only available when protobuf is built with HAVE_LZ4.
+
+#ifndef GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+struct LZ4F_cctx_s;
+struct LZ4F_dctx_s;
+struct LZ4F_CDict_s;
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A dictionary shared by the streams compressing or decompressing many small
+// payloads, such as individual messages, which on their own are too small to
+// compress well.  LZ4 can use any sample of typical payloads as a dictionary,
+// as well as dictionaries trained with `zstd --train`.
+//
+// The dictionary is digested once, so creating streams that use it is cheap.
+// It is immutable and may be shared by streams on different threads.
+class PROTOBUF_EXPORT Lz4Dictionary {
+ public:
+  // `data` is copied.  LZ4 only uses its last 64kB.
+  explicit Lz4Dictionary(absl::string_view data);
+  Lz4Dictionary(const Lz4Dictionary&) = delete;
+  Lz4Dictionary& operator=(const Lz4Dictionary&) = delete;
+  ~Lz4Dictionary();
+
+  // Returns false if lz4 could not load the dictionary.
+  bool ok() const { return cdict_ != nullptr; }
+
+ private:
+  friend class Lz4InputStream;
+  friend class Lz4OutputStream;
+
+  std::string data_;
+  LZ4F_CDict_s* cdict_;
+};
+
+// A ZeroCopyInputStream that reads compressed data through lz4.  Several
+// concatenated LZ4 frames are read as a single stream.
+class PROTOBUF_EXPORT Lz4InputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 64kB.
+    int buffer_size;
+
+    // The dictionary the data was compressed with, if any.  It must outlive
+    // the stream.  Defaults to null.
+    const Lz4Dictionary* dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a Lz4InputStream with default options.
+  explicit Lz4InputStream(ZeroCopyInputStream* sub_stream);
+
+  // Create a Lz4InputStream with the given options.
+  Lz4InputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  Lz4InputStream(const Lz4InputStream&) = delete;
+  Lz4InputStream& operator=(const Lz4InputStream&) = delete;
+  ~Lz4InputStream() override;
+
+  // Return last error message or NULL if no error.
+  const char* Lz4ErrorMessage() const { return error_message_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Decompresses more data into the output buffer.  Returns false at the end
+  // of the stream or on error.
+  bool Decompress();
+
+  ZeroCopyInputStream* sub_stream_;
+  LZ4F_dctx_s* dctx_;
+  const Lz4Dictionary* dictionary_;
+  const char* error_message_ = nullptr;
+
+  // The data last returned by the sub-stream, and how much of it was
+  // consumed.
+  const char* input_ = nullptr;
+  size_t input_size_ = 0;
+  size_t input_position_ = 0;
+  // True if the input ended at a frame boundary.
+  bool at_frame_boundary_ = true;
+
+  std::unique_ptr<char[]> output_buffer_;
+  size_t output_buffer_length_;
+  // The decompressed data in the output buffer, and how much of it was
+  // returned.
+  size_t output_size_ = 0;
+  size_t output_position_ = 0;
+  // Total number of bytes decompressed into the output buffer.
+  int64_t byte_count_ = 0;
+};
+
+class PROTOBUF_EXPORT Lz4OutputStream final : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 64kB.
+    int buffer_size;
+
+    // Zero or negative values select the fast LZ4 compressor, with more
+    // negative values compressing faster.  Values from 3 to 12 select the
+    // slower LZ4-HC compressor, which compresses better.  Defaults to 0.
+    int compression_level;
+
+    // Whether to append a checksum of the uncompressed data to each frame,
+    // which is verified by Lz4InputStream.  Defaults to false.
+    bool content_checksum;
+
+    // Compress with this dictionary, which must outlive the stream.
+    // Defaults to null.
+    const Lz4Dictionary* dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a Lz4OutputStream with default options.
+  explicit Lz4OutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a Lz4OutputStream with the given options.
+  Lz4OutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  Lz4OutputStream(const Lz4OutputStream&) = delete;
+  Lz4OutputStream& operator=(const Lz4OutputStream&) = delete;
+
+  ~Lz4OutputStream() override;
+
+  // Return last error message or NULL if no error.
+  const char* Lz4ErrorMessage() const { return error_message_; }
+
+  // Flushes data written so far to compressed data in the underlying stream.
+  // It is the caller's responsibility to flush the underlying stream if
+  // necessary.  Compression may be less efficient when flushing often.
+  // Returns true if no error.
+  bool Flush();
+
+  // Writes out all data and closes the LZ4 frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Compresses the pending input into the output buffer and writes it to
+  // the sub-stream.
+  bool CompressInput();
+  // Copies the first `size` bytes of the output buffer to the sub-stream.
+  bool WriteOutput(size_t size);
+
+  ZeroCopyOutputStream* sub_stream_;
+  LZ4F_cctx_s* cctx_;
+  const char* error_message_ = nullptr;
+  bool closed_ = false;
+
+  std::unique_ptr<char[]> input_buffer_;
+  size_t input_buffer_length_;
+  // Bytes of the input buffer written by the caller, not compressed yet.
+  size_t input_size_ = 0;
+  // Number of bytes compressed so far.
+  int64_t byte_count_ = 0;
+
+  // LZ4F needs room for a whole compressed input buffer, so it compresses
+  // into this buffer, which is then copied to the sub-stream.
+  std::unique_ptr<char[]> output_buffer_;
+  size_t output_buffer_length_;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_LZ4_STREAM_H__
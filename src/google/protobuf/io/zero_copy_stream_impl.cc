@@ -15,10 +15,17 @@
 #include <sys/types.h>
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include <errno.h>
 
 #include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <istream>
+#include <memory>
 #include <ostream>
 
 #include "google/protobuf/stubs/common.h"
@@ -148,6 +155,192 @@ int FileInputStream::CopyingFileInputStream::Skip(int count) {
 
 // ===================================================================
 
+namespace {
+
+// Windows are aligned to this many bytes when huge pages are requested.
+constexpr int64_t kHugePageSize = int64_t{2} << 20;
+
+}  // namespace
+
+MmapInputStream::Options::Options()
+    : window_size(64 << 20),
+      sequential(true),
+      will_need(true),
+      huge_pages(false) {}
+
+MmapInputStream::MmapInputStream(int file_descriptor)
+    : MmapInputStream(file_descriptor, Options()) {}
+
+MmapInputStream::MmapInputStream(int file_descriptor, const Options& options)
+    : file_(file_descriptor), options_(options) {
+#ifndef _WIN32
+  struct stat st;
+  const off_t offset = lseek(file_, 0, SEEK_CUR);
+  if (offset != (off_t)-1 && fstat(file_, &st) == 0 && S_ISREG(st.st_mode)) {
+    start_ = position_ = window_start_ = window_end_ = offset;
+    end_ = std::max<int64_t>(st.st_size, offset);
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (options_.sequential) {
+      posix_fadvise(file_, start_, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#endif
+    return;
+  }
+#endif
+  // Not a regular file, or no mmap on this platform.
+  fallback_ = std::make_unique<FileInputStream>(file_);
+}
+
+MmapInputStream::~MmapInputStream() {
+  if (close_on_delete_ && !is_closed_) {
+    if (!Close()) {
+      ABSL_LOG(ERROR) << "close() failed: " << strerror(errno_);
+    }
+  }
+  Unmap();
+}
+
+bool MmapInputStream::Close() {
+  ABSL_CHECK(!is_closed_);
+
+  is_closed_ = true;
+  Unmap();
+  if (close_no_eintr(file_) != 0) {
+    errno_ = errno;
+    return false;
+  }
+
+  return true;
+}
+
+int MmapInputStream::GetErrno() const {
+  if (errno_ == 0 && fallback_ != nullptr) return fallback_->GetErrno();
+  return errno_;
+}
+
+bool MmapInputStream::Next(const void** data, int* size) {
+  if (fallback_ != nullptr) return fallback_->Next(data, size);
+  ABSL_CHECK(!is_closed_);
+
+  last_returned_size_ = 0;
+  if (errno_ != 0 || position_ >= end_) return false;
+  if (position_ < window_start_ || position_ >= window_end_) {
+    if (!MapWindow()) return false;
+  }
+  *data = window_ + (position_ - window_start_);
+  *size = last_returned_size_ = static_cast<int>(window_end_ - position_);
+  position_ = window_end_;
+  return true;
+}
+
+void MmapInputStream::BackUp(int count) {
+  if (fallback_ != nullptr) return fallback_->BackUp(count);
+
+  ABSL_CHECK_GT(last_returned_size_, 0)
+      << "BackUp() can only be called after a successful Next().";
+  ABSL_CHECK_LE(count, last_returned_size_);
+  ABSL_CHECK_GE(count, 0);
+  position_ -= count;
+  last_returned_size_ = 0;  // Don't let caller back up further.
+}
+
+bool MmapInputStream::Skip(int count) {
+  if (fallback_ != nullptr) return fallback_->Skip(count);
+
+  ABSL_CHECK_GE(count, 0);
+  last_returned_size_ = 0;  // Don't let caller back up.
+  if (errno_ != 0) return false;
+  if (count > end_ - position_) {
+    position_ = end_;
+    return false;
+  }
+  position_ += count;
+  return true;
+}
+
+int64_t MmapInputStream::ByteCount() const {
+  if (fallback_ != nullptr) return fallback_->ByteCount();
+  return position_ - start_;
+}
+
+bool MmapInputStream::MapWindow() {
+  Unmap();
+#ifndef _WIN32
+  const int64_t page_size = sysconf(_SC_PAGESIZE);
+  const int64_t alignment = options_.huge_pages ? kHugePageSize : page_size;
+  // Round the window size up to the alignment, while keeping it small enough
+  // to be returned by Next().
+  int64_t window_size = std::max(options_.window_size, 1);
+  window_size = (window_size + alignment - 1) / alignment * alignment;
+  window_size = std::min(window_size, int64_t{INT_MAX} / alignment * alignment);
+
+  window_start_ = position_ / alignment * alignment;
+  window_end_ = std::min(end_, window_start_ + window_size);
+  const size_t length = static_cast<size_t>(window_end_ - window_start_);
+
+  void* mapped = MAP_FAILED;
+#ifdef MADV_HUGEPAGE
+  if (options_.huge_pages) {
+    // Reserve enough address space to place the window at a huge page
+    // boundary, map the file over the aligned part and release the rest.
+    const size_t reserved_size = length + kHugePageSize;
+    void* reserved = mmap(nullptr, reserved_size, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved != MAP_FAILED) {
+      const uintptr_t begin = reinterpret_cast<uintptr_t>(reserved);
+      const uintptr_t aligned =
+          (begin + kHugePageSize - 1) & ~uintptr_t{kHugePageSize - 1};
+      mapped = mmap(reinterpret_cast<void*>(aligned), length, PROT_READ,
+                    MAP_PRIVATE | MAP_FIXED, file_, window_start_);
+      if (mapped == MAP_FAILED) {
+        const int error = errno;
+        munmap(reserved, reserved_size);
+        errno = error;
+      } else {
+        const uintptr_t mapped_end =
+            aligned + (length + page_size - 1) / page_size * page_size;
+        if (aligned > begin) munmap(reserved, aligned - begin);
+        if (begin + reserved_size > mapped_end) {
+          munmap(reinterpret_cast<void*>(mapped_end),
+                 begin + reserved_size - mapped_end);
+        }
+        madvise(mapped, length, MADV_HUGEPAGE);
+      }
+    }
+  }
+#endif  // MADV_HUGEPAGE
+  if (mapped == MAP_FAILED) {
+    mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file_, window_start_);
+  }
+  if (mapped == MAP_FAILED) {
+    errno_ = errno;
+    window_end_ = window_start_;
+    return false;
+  }
+  if (options_.sequential) madvise(mapped, length, MADV_SEQUENTIAL);
+  if (options_.will_need) madvise(mapped, length, MADV_WILLNEED);
+
+  mapping_ = mapped;
+  mapping_size_ = length;
+  window_ = static_cast<const char*>(mapped);
+  return true;
+#else   // _WIN32
+  return false;
+#endif  // !_WIN32
+}
+
+void MmapInputStream::Unmap() {
+#ifndef _WIN32
+  if (mapping_ != nullptr) munmap(mapping_, mapping_size_);
+#endif
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  window_ = nullptr;
+  window_end_ = window_start_;
+}
+
+// ===================================================================
+
 FileOutputStream::FileOutputStream(int file_descriptor, int block_size)
     : CopyingOutputStreamAdaptor(&copying_output_, block_size),
       copying_output_(file_descriptor) {}
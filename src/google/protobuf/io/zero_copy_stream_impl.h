@@ -17,7 +17,9 @@
 #ifndef GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 #define GOOGLE_PROTOBUF_IO_ZERO_COPY_STREAM_IMPL_H__
 
+#include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 #include "google/protobuf/stubs/common.h"
@@ -110,6 +112,116 @@ class PROTOBUF_EXPORT FileInputStream final : public ZeroCopyInputStream {
 
 // ===================================================================
 
+// A ZeroCopyInputStream which reads a regular file by mapping it into memory.
+//
+// Unlike FileInputStream, no data is copied: Next() returns pointers straight
+// into the page cache, one mapped window of the file at a time, so large
+// files of messages can be parsed without an intermediate buffer.  The stream
+// reads from the descriptor's current offset up to the end of the file as of
+// construction, and does not move the descriptor's offset.
+//
+// If the descriptor cannot be mapped (for example, it is a pipe or socket, or
+// the platform has no mmap), the stream transparently falls back to reading
+// it like FileInputStream does; see is_mapped().
+//
+// The file must not be truncated while the stream is reading it: accessing a
+// mapped page past the end of a file raises SIGBUS.
+class PROTOBUF_EXPORT MmapInputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // Number of bytes mapped at a time, rounded up to the alignment of the
+    // mapping.  Each call to Next() returns the rest of the current window.
+    // Defaults to 64MB.
+    int window_size;
+
+    // Advise the kernel that windows will be read sequentially, so that it
+    // reads ahead aggressively and drops pages behind.  Defaults to true.
+    bool sequential;
+
+    // Ask the kernel to start reading each window in as soon as it is
+    // mapped.  Defaults to true.
+    bool will_need;
+
+    // Align windows to 2MB and request transparent huge pages for them,
+    // which reduces TLB misses when the file system supports huge pages in
+    // the page cache.  Defaults to false.
+    bool huge_pages;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Creates a stream that reads from the given Unix file descriptor.
+  explicit MmapInputStream(int file_descriptor);
+  MmapInputStream(int file_descriptor, const Options& options);
+  MmapInputStream(const MmapInputStream&) = delete;
+  MmapInputStream& operator=(const MmapInputStream&) = delete;
+  ~MmapInputStream() override;
+
+  // Unmaps the file and closes the underlying file descriptor.  Returns false
+  // if an error occurs during the process; use GetErrno() to examine the
+  // error.  Even if an error occurs, the file descriptor is closed when this
+  // returns.
+  bool Close();
+
+  // By default, the file descriptor is not closed when the stream is
+  // destroyed.  Call SetCloseOnDelete(true) to change that.  WARNING:
+  // This leaves no way for the caller to detect if close() fails.  If
+  // detecting close() errors is important to you, you should arrange
+  // to close the descriptor yourself.
+  void SetCloseOnDelete(bool value) { close_on_delete_ = value; }
+
+  // If an I/O error has occurred on this file descriptor, this is the
+  // errno from that error.  Otherwise, this is zero.  Once an error
+  // occurs, the stream is broken and all subsequent operations will
+  // fail.
+  int GetErrno() const;
+
+  // Returns true if the file is read through mmap, false if the stream fell
+  // back to reading it with read().
+  bool is_mapped() const { return fallback_ == nullptr; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Maps the window containing the file offset `position_`.
+  bool MapWindow();
+  void Unmap();
+
+  const int file_;
+  const Options options_;
+  bool close_on_delete_ = false;
+  bool is_closed_ = false;
+
+  // The errno of the I/O error, if one has occurred.  Otherwise, zero.
+  int errno_ = 0;
+
+  // The range of file offsets read by the stream, and the offset of the next
+  // byte to return.
+  int64_t start_ = 0;
+  int64_t end_ = 0;
+  int64_t position_ = 0;
+
+  // The current mapping, and the range of file offsets [window_start_,
+  // window_end_) it holds at `window_`.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  const char* window_ = nullptr;
+  int64_t window_start_ = 0;
+  int64_t window_end_ = 0;
+
+  int last_returned_size_ = 0;  // How many bytes we returned last time Next()
+                                // was called (used for error checking only).
+
+  // Used instead of the mapping when the file cannot be mapped.
+  std::unique_ptr<FileInputStream> fallback_;
+};
+
+// ===================================================================
+
 // A ZeroCopyOutputStream which writes to a file descriptor.
 //
 // FileOutputStream is preferred over using an ofstream with
@@ -53,6 +53,7 @@
 #include "absl/strings/cord_buffer.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "google/protobuf/io/async_file_stream.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/io_win32.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -61,6 +62,12 @@
 #if HAVE_ZLIB
 #include "google/protobuf/io/gzip_stream.h"
 #endif
+#if HAVE_LZ4
+#include "google/protobuf/io/lz4_stream.h"
+#endif
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+#endif
 
 #include "google/protobuf/test_util.h"
 
@@ -690,6 +697,305 @@ TEST_F(IoTest, GzipInputByteCountAfterClosedConcatenatedStreams) {
 }
 #endif
 
+#if HAVE_ZSTD
+TEST_F(IoTest, ZstdIo) {
+  const int kBufferSize = 2 * 1024;
+  uint8_t* buffer = new uint8_t[kBufferSize];
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int size;
+        {
+          ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+          ZstdOutputStream::Options options;
+          if (kBlockSizes[z] != -1) options.buffer_size = kBlockSizes[z];
+          ZstdOutputStream zout(&output, options);
+          WriteStuff(&zout);
+          EXPECT_TRUE(zout.Close());
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer, size, kBlockSizes[j]);
+          ZstdInputStream::Options options;
+          if (kBlockSizes[z] != -1) options.buffer_size = kBlockSizes[z];
+          ZstdInputStream zin(&input, options);
+          ReadStuff(&zin);
+          EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, ZstdIoLarge) {
+  for (int num_threads : {0, 2}) {
+    std::string compressed;
+    {
+      StringOutputStream output(&compressed);
+      ZstdOutputStream::Options options;
+      options.num_threads = num_threads;
+      ZstdOutputStream zout(&output, options);
+      WriteStuffLarge(&zout);
+      EXPECT_TRUE(zout.Close());
+    }
+    ArrayInputStream input(compressed.data(), compressed.size());
+    ZstdInputStream zin(&input);
+    ReadStuffLarge(&zin);
+    EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, ZstdIoWithFlush) {
+  std::string compressed;
+  StringOutputStream output(&compressed);
+  ZstdOutputStream zout(&output);
+  WriteString(&zout, "Hello ");
+  EXPECT_TRUE(zout.Flush());
+  {
+    // Everything written before the flush can be decompressed.
+    ArrayInputStream input(compressed.data(), compressed.size());
+    ZstdInputStream zin(&input);
+    ReadString(&zin, "Hello ");
+  }
+  WriteString(&zout, "world!");
+  EXPECT_TRUE(zout.Close());
+
+  ArrayInputStream input(compressed.data(), compressed.size());
+  ZstdInputStream zin(&input);
+  ReadString(&zin, "Hello world!");
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&zin, &byte, 1), 0);
+  EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, ZstdIoConcatenatedFrames) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    {
+      ZstdOutputStream zout(&output);
+      WriteString(&zout, "0123456789");
+    }
+    {
+      ZstdOutputStream zout(&output);
+      WriteString(&zout, "QuickBrownFox");
+    }
+  }
+  ArrayInputStream input(compressed.data(), compressed.size(), 3);
+  ZstdInputStream zin(&input);
+  ReadString(&zin, "0123456789QuickBrownFox");
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&zin, &byte, 1), 0);
+  EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, ZstdIoDictionary) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  const std::string golden = message.SerializeAsString();
+  message.set_optional_int32(12345);
+  const std::string payload = message.SerializeAsString();
+
+  ZstdDictionary dictionary(golden);
+  ASSERT_TRUE(dictionary.ok());
+  std::string plain, with_dictionary;
+  {
+    StringOutputStream output(&plain);
+    ZstdOutputStream zout(&output);
+    WriteString(&zout, payload);
+  }
+  {
+    StringOutputStream output(&with_dictionary);
+    ZstdOutputStream::Options options;
+    options.dictionary = &dictionary;
+    ZstdOutputStream zout(&output, options);
+    WriteString(&zout, payload);
+  }
+  // A payload resembling the dictionary compresses much better with it.
+  EXPECT_LT(with_dictionary.size() * 4, plain.size());
+
+  {
+    ArrayInputStream input(with_dictionary.data(), with_dictionary.size());
+    ZstdInputStream::Options options;
+    options.dictionary = &dictionary;
+    ZstdInputStream zin(&input, options);
+    ReadString(&zin, payload);
+    EXPECT_EQ(zin.ZstdErrorMessage(), nullptr);
+  }
+  {
+    ArrayInputStream input(with_dictionary.data(), with_dictionary.size());
+    ZstdInputStream zin(&input);
+    const void* data;
+    int size;
+    EXPECT_FALSE(zin.Next(&data, &size));
+    EXPECT_NE(zin.ZstdErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, ZstdIoTruncated) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    ZstdOutputStream zout(&output);
+    WriteStuffLarge(&zout);
+  }
+  compressed.resize(compressed.size() - 1);
+  ArrayInputStream input(compressed.data(), compressed.size());
+  ZstdInputStream zin(&input);
+  const void* data;
+  int size;
+  while (zin.Next(&data, &size)) {
+  }
+  EXPECT_NE(zin.ZstdErrorMessage(), nullptr);
+}
+#endif  // HAVE_ZSTD
+
+#if HAVE_LZ4
+TEST_F(IoTest, Lz4Io) {
+  const int kBufferSize = 2 * 1024;
+  uint8_t* buffer = new uint8_t[kBufferSize];
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int z = 0; z < kBlockSizeCount; z++) {
+        int size;
+        {
+          ArrayOutputStream output(buffer, kBufferSize, kBlockSizes[i]);
+          Lz4OutputStream::Options options;
+          if (kBlockSizes[z] != -1) options.buffer_size = kBlockSizes[z];
+          options.content_checksum = (z % 2) == 0;
+          Lz4OutputStream lzout(&output, options);
+          WriteStuff(&lzout);
+          EXPECT_TRUE(lzout.Close());
+          size = output.ByteCount();
+        }
+        {
+          ArrayInputStream input(buffer, size, kBlockSizes[j]);
+          Lz4InputStream::Options options;
+          if (kBlockSizes[z] != -1) options.buffer_size = kBlockSizes[z];
+          Lz4InputStream lzin(&input, options);
+          ReadStuff(&lzin);
+          EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+        }
+      }
+    }
+  }
+  delete[] buffer;
+}
+
+TEST_F(IoTest, Lz4IoLarge) {
+  for (int level : {0, -5, 9}) {
+    std::string compressed;
+    {
+      StringOutputStream output(&compressed);
+      Lz4OutputStream::Options options;
+      options.compression_level = level;
+      Lz4OutputStream lzout(&output, options);
+      WriteStuffLarge(&lzout);
+      EXPECT_TRUE(lzout.Close());
+    }
+    ArrayInputStream input(compressed.data(), compressed.size());
+    Lz4InputStream lzin(&input);
+    ReadStuffLarge(&lzin);
+    EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+  }
+}
+
+TEST_F(IoTest, Lz4IoWithFlush) {
+  std::string compressed;
+  StringOutputStream output(&compressed);
+  Lz4OutputStream lzout(&output);
+  WriteString(&lzout, "Hello ");
+  EXPECT_TRUE(lzout.Flush());
+  {
+    // Everything written before the flush can be decompressed.
+    ArrayInputStream input(compressed.data(), compressed.size());
+    Lz4InputStream lzin(&input);
+    ReadString(&lzin, "Hello ");
+  }
+  WriteString(&lzout, "world!");
+  EXPECT_TRUE(lzout.Close());
+
+  ArrayInputStream input(compressed.data(), compressed.size());
+  Lz4InputStream lzin(&input);
+  ReadString(&lzin, "Hello world!");
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&lzin, &byte, 1), 0);
+  EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, Lz4IoConcatenatedFrames) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    {
+      Lz4OutputStream lzout(&output);
+      WriteString(&lzout, "0123456789");
+    }
+    {
+      Lz4OutputStream lzout(&output);
+      WriteString(&lzout, "QuickBrownFox");
+    }
+  }
+  ArrayInputStream input(compressed.data(), compressed.size(), 3);
+  Lz4InputStream lzin(&input);
+  ReadString(&lzin, "0123456789QuickBrownFox");
+  uint8_t byte;
+  EXPECT_EQ(ReadFromInput(&lzin, &byte, 1), 0);
+  EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, Lz4IoDictionary) {
+  protobuf_unittest::TestAllTypes message;
+  TestUtil::SetAllFields(&message);
+  const std::string golden = message.SerializeAsString();
+  message.set_optional_int32(12345);
+  const std::string payload = message.SerializeAsString();
+
+  Lz4Dictionary dictionary(golden);
+  ASSERT_TRUE(dictionary.ok());
+  std::string plain, with_dictionary;
+  {
+    StringOutputStream output(&plain);
+    Lz4OutputStream lzout(&output);
+    WriteString(&lzout, payload);
+  }
+  {
+    StringOutputStream output(&with_dictionary);
+    Lz4OutputStream::Options options;
+    options.dictionary = &dictionary;
+    Lz4OutputStream lzout(&output, options);
+    WriteString(&lzout, payload);
+  }
+  // A payload resembling the dictionary compresses much better with it.
+  EXPECT_LT(with_dictionary.size() * 4, plain.size());
+
+  ArrayInputStream input(with_dictionary.data(), with_dictionary.size());
+  Lz4InputStream::Options options;
+  options.dictionary = &dictionary;
+  Lz4InputStream lzin(&input, options);
+  ReadString(&lzin, payload);
+  EXPECT_EQ(lzin.Lz4ErrorMessage(), nullptr);
+}
+
+TEST_F(IoTest, Lz4IoTruncated) {
+  std::string compressed;
+  {
+    StringOutputStream output(&compressed);
+    Lz4OutputStream lzout(&output);
+    WriteStuffLarge(&lzout);
+  }
+  compressed.resize(compressed.size() - 1);
+  ArrayInputStream input(compressed.data(), compressed.size());
+  Lz4InputStream lzin(&input);
+  const void* data;
+  int size;
+  while (lzin.Next(&data, &size)) {
+  }
+  EXPECT_NE(lzin.Lz4ErrorMessage(), nullptr);
+}
+#endif  // HAVE_LZ4
+
 // There is no string input, only string output.  Also, it doesn't support
 // explicit block sizes.  So, we'll only run one test and we'll use
 // ArrayInput to read back the results.
@@ -1431,6 +1737,92 @@ TEST_F(IoTest, FileIo) {
   }
 }
 
+TEST_F(IoTest, MmapIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  // Windows smaller than the file, so that reads and skips cross them.
+  const int kWindowSizes[] = {1, 4096, 100000, 1 << 20};
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int window_size : kWindowSizes) {
+      for (bool huge_pages : {false, true}) {
+        int file =
+            open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+        ASSERT_GE(file, 0);
+
+        {
+          FileOutputStream output(file, kBlockSizes[i]);
+          WriteStuffLarge(&output);
+          EXPECT_EQ(0, output.GetErrno());
+        }
+
+        // Rewind.
+        ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+        {
+          MmapInputStream::Options options;
+          options.window_size = window_size;
+          options.huge_pages = huge_pages;
+          MmapInputStream input(file, options);
+          ReadStuffLarge(&input);
+          EXPECT_EQ(0, input.GetErrno());
+        }
+
+        close(file);
+      }
+    }
+  }
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, MmapIoStartsAtFileOffset) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+  int file =
+      open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+  ASSERT_GE(file, 0);
+  ASSERT_EQ(write(file, "skipped", 7), 7);
+  {
+    FileOutputStream output(file);
+    WriteStuff(&output);
+  }
+
+  ASSERT_NE(lseek(file, 7, SEEK_SET), (off_t)-1);
+  {
+    MmapInputStream input(file);
+    ReadStuff(&input);
+    EXPECT_EQ(0, input.GetErrno());
+  }
+  // The stream does not move the descriptor's offset.
+  EXPECT_EQ(lseek(file, 0, SEEK_CUR), 7);
+
+  close(file);
+}
+
+TEST_F(IoTest, MmapIoFallsBackForPipes) {
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    int fd[2];
+    ASSERT_EQ(pipe(fd), 0);
+
+    std::thread write_thread([this, fd, i]() {
+      FileOutputStream output(fd[1], kBlockSizes[i]);
+      output.SetCloseOnDelete(true);
+      WriteStuff(&output);
+      EXPECT_EQ(0, output.GetErrno());
+    });
+
+    {
+      MmapInputStream input(fd[0]);
+      input.SetCloseOnDelete(true);
+      EXPECT_FALSE(input.is_mapped());
+      ReadStuff(&input);
+      EXPECT_EQ(0, input.GetErrno());
+    }
+    write_thread.join();
+  }
+}
+#endif
+
 #ifndef _WIN32
 // This tests the FileInputStream with a non blocking file. It opens a pipe in
 // non blocking mode, then starts reading it. The writing thread starts writing
@@ -1597,6 +1989,157 @@ TEST_F(IoTest, FileWriteError) {
   EXPECT_EQ(EBADF, input.GetErrno());
 }
 
+TEST_F(IoTest, AsyncFileIo) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int i = 0; i < kBlockSizeCount; i++) {
+    for (int j = 0; j < kBlockSizeCount; j++) {
+      for (int block_count : {1, 3}) {
+        int file =
+            open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+        ASSERT_GE(file, 0);
+
+        AsyncFileStreamOptions options;
+        options.block_count = block_count;
+        {
+          if (kBlockSizes[i] > 0) options.block_size = kBlockSizes[i];
+          AsyncFileOutputStream output(file, options);
+          WriteStuff(&output);
+          EXPECT_TRUE(output.Flush());
+          EXPECT_EQ(0, output.GetErrno());
+        }
+
+        // Rewind.
+        ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+        {
+          if (kBlockSizes[j] > 0) options.block_size = kBlockSizes[j];
+          AsyncFileInputStream input(file, options);
+          ReadStuff(&input);
+          EXPECT_EQ(0, input.GetErrno());
+        }
+
+        close(file);
+      }
+    }
+  }
+}
+
+TEST_F(IoTest, AsyncFileIoLarge) {
+  std::string filename =
+      absl::StrCat(::testing::TempDir(), "/zero_copy_stream_test_file");
+
+  for (int block_size : {-1, 1000, 65536}) {
+    int file =
+        open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_BINARY, 0777);
+    ASSERT_GE(file, 0);
+
+    AsyncFileStreamOptions options;
+    if (block_size > 0) options.block_size = block_size;
+    {
+      AsyncFileOutputStream output(file, options);
+      WriteStuffLarge(&output);
+      // Destroying the stream writes everything that is still queued.
+    }
+
+    ASSERT_NE(lseek(file, 0, SEEK_SET), (off_t)-1);
+
+    {
+      AsyncFileInputStream input(file, options);
+      input.SetCloseOnDelete(true);
+      ReadStuffLarge(&input);
+      EXPECT_EQ(0, input.GetErrno());
+    }
+  }
+}
+
+TEST_F(IoTest, AsyncFileReadError) {
+  MsvcDebugDisabler debug_disabler;
+
+  // -1 = invalid file descriptor.
+  AsyncFileInputStream input(-1);
+
+  const void* buffer;
+  int size;
+  EXPECT_FALSE(input.Next(&buffer, &size));
+  EXPECT_EQ(EBADF, input.GetErrno());
+}
+
+TEST_F(IoTest, AsyncFileWriteError) {
+  MsvcDebugDisabler debug_disabler;
+
+  // -1 = invalid file descriptor.
+  AsyncFileOutputStream output(-1);
+
+  void* buffer;
+  int size;
+
+  // Writes happen in the background, so errors are only reported once the
+  // data has been handed to the stream.
+  EXPECT_TRUE(output.Next(&buffer, &size));
+  EXPECT_FALSE(output.Flush());
+  EXPECT_EQ(EBADF, output.GetErrno());
+  EXPECT_FALSE(output.Next(&buffer, &size));
+}
+
+#ifndef _WIN32
+TEST_F(IoTest, AsyncFileIoNonBlocking) {
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  ASSERT_EQ(fcntl(fd[0], F_SETFL, O_NONBLOCK), 0);
+  ASSERT_EQ(fcntl(fd[1], F_SETFL, O_NONBLOCK), 0);
+
+  AsyncFileStreamOptions options;
+  options.block_size = 1000;
+  std::thread write_thread([this, fd, &options]() {
+    // Give the reader time to find the pipe empty.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    AsyncFileOutputStream output(fd[1], options);
+    output.SetCloseOnDelete(true);
+    WriteStuffLarge(&output);
+    EXPECT_TRUE(output.Flush());
+    EXPECT_EQ(0, output.GetErrno());
+  });
+
+  {
+    AsyncFileInputStream input(fd[0], options);
+    ReadStuffLarge(&input);
+    EXPECT_EQ(0, input.GetErrno());
+  }
+  write_thread.join();
+
+  // The streams leave the descriptor in non-blocking mode.
+  EXPECT_NE(fcntl(fd[0], F_GETFL) & O_NONBLOCK, 0);
+  close(fd[0]);
+}
+
+TEST_F(IoTest, AsyncFileInputStopsWhileIdle) {
+  // The writer stays open but never writes, so a blocking read() would
+  // never return.
+  int fd[2];
+  ASSERT_EQ(pipe(fd), 0);
+  {
+    AsyncFileInputStream input(fd[0]);
+    // Let the reader start waiting.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  // Data written before the stream is destroyed is still readable.
+  ASSERT_EQ(write(fd[1], "abc", 3), 3);
+  {
+    AsyncFileInputStream input(fd[0]);
+    input.SetCloseOnDelete(true);
+    const void* data;
+    int size;
+    ASSERT_TRUE(input.Next(&data, &size));
+    EXPECT_EQ(absl::string_view(static_cast<const char*>(data), size), "abc");
+    EXPECT_TRUE(input.Close());
+  }
+  close(fd[1]);
+}
+#endif
+
 // Pipes are not seekable, so File{Input,Output}Stream ends up doing some
 // different things to handle them.  We'll test by writing to a pipe and
 // reading back from it.
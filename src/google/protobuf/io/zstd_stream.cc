@@ -0,0 +1,263 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the implementation of classes ZstdInputStream and
+// ZstdOutputStream.
+
+#if HAVE_ZSTD
+#include "google/protobuf/io/zstd_stream.h"
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+static const int kDefaultBufferSize = 128 << 10;
+
+ZstdDictionary::ZstdDictionary(absl::string_view data)
+    : ZstdDictionary(data, ZSTD_CLEVEL_DEFAULT) {}
+
+ZstdDictionary::ZstdDictionary(absl::string_view data, int compression_level)
+    : cdict_(ZSTD_createCDict(data.data(), data.size(), compression_level)),
+      ddict_(ZSTD_createDDict(data.data(), data.size())) {}
+
+ZstdDictionary::~ZstdDictionary() {
+  ZSTD_freeCDict(cdict_);
+  ZSTD_freeDDict(ddict_);
+}
+
+// =========================================================================
+
+ZstdInputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize), dictionary(nullptr) {}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream)
+    : ZstdInputStream(sub_stream, Options()) {}
+
+ZstdInputStream::ZstdInputStream(ZeroCopyInputStream* sub_stream,
+                                 const Options& options)
+    : sub_stream_(sub_stream),
+      dctx_(ZSTD_createDCtx()),
+      output_buffer_(std::make_unique<char[]>(options.buffer_size)),
+      output_buffer_length_(options.buffer_size) {
+  ABSL_CHECK(dctx_ != nullptr);
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  if (options.dictionary != nullptr) {
+    ABSL_CHECK(options.dictionary->ok());
+    size_t result = ZSTD_DCtx_refDDict(dctx_, options.dictionary->ddict_);
+    if (ZSTD_isError(result)) error_message_ = ZSTD_getErrorName(result);
+  }
+}
+
+ZstdInputStream::~ZstdInputStream() { ZSTD_freeDCtx(dctx_); }
+
+bool ZstdInputStream::Decompress() {
+  ZSTD_outBuffer output = {output_buffer_.get(), output_buffer_length_, 0};
+  while (output.pos == 0) {
+    if (input_position_ == input_size_) {
+      const void* in;
+      int in_size;
+      if (!sub_stream_->Next(&in, &in_size)) {
+        input_ = nullptr;
+        input_size_ = input_position_ = 0;
+        if (!at_frame_boundary_) error_message_ = "Truncated zstd frame";
+        return false;
+      }
+      input_ = static_cast<const char*>(in);
+      input_size_ = in_size;
+      input_position_ = 0;
+    }
+    ZSTD_inBuffer input = {input_, input_size_, input_position_};
+    const size_t result = ZSTD_decompressStream(dctx_, &output, &input);
+    if (ZSTD_isError(result)) {
+      error_message_ = ZSTD_getErrorName(result);
+      return false;
+    }
+    // Only mark the boundary once the frame's input was seen at all, so that
+    // an empty input is an empty stream.
+    if (input.pos != input_position_ || output.pos != 0) {
+      at_frame_boundary_ = result == 0;
+    }
+    input_position_ = input.pos;
+  }
+  output_size_ = output.pos;
+  output_position_ = 0;
+  byte_count_ += output.pos;
+  return true;
+}
+
+// implements ZeroCopyInputStream ----------------------------------
+bool ZstdInputStream::Next(const void** data, int* size) {
+  if (output_position_ == output_size_) {
+    if (error_message_ != nullptr || !Decompress()) return false;
+  }
+  *data = output_buffer_.get() + output_position_;
+  *size = static_cast<int>(output_size_ - output_position_);
+  output_position_ = output_size_;
+  return true;
+}
+
+void ZstdInputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), output_position_);
+  output_position_ -= count;
+}
+
+bool ZstdInputStream::Skip(int count) {
+  const void* data;
+  int size = 0;
+  bool ok = Next(&data, &size);
+  while (ok && (size < count)) {
+    count -= size;
+    ok = Next(&data, &size);
+  }
+  if (size > count) {
+    BackUp(size - count);
+  }
+  return ok;
+}
+
+int64_t ZstdInputStream::ByteCount() const {
+  return byte_count_ - static_cast<int64_t>(output_size_ - output_position_);
+}
+
+// =========================================================================
+
+ZstdOutputStream::Options::Options()
+    : buffer_size(kDefaultBufferSize),
+      compression_level(ZSTD_CLEVEL_DEFAULT),
+      num_threads(0),
+      dictionary(nullptr) {}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream)
+    : ZstdOutputStream(sub_stream, Options()) {}
+
+ZstdOutputStream::ZstdOutputStream(ZeroCopyOutputStream* sub_stream,
+                                   const Options& options)
+    : sub_stream_(sub_stream),
+      cctx_(ZSTD_createCCtx()),
+      input_buffer_(std::make_unique<char[]>(options.buffer_size)),
+      input_buffer_length_(options.buffer_size) {
+  ABSL_CHECK(cctx_ != nullptr);
+  ABSL_CHECK_GT(options.buffer_size, 0);
+  size_t result;
+  if (options.dictionary != nullptr) {
+    ABSL_CHECK(options.dictionary->ok());
+    result = ZSTD_CCtx_refCDict(cctx_, options.dictionary->cdict_);
+  } else {
+    result = ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel,
+                                    options.compression_level);
+  }
+  if (ZSTD_isError(result)) error_message_ = ZSTD_getErrorName(result);
+  if (options.num_threads > 0) {
+    // Fails if zstd was built without multithreading support, in which case
+    // we compress on the calling thread.
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_nbWorkers, options.num_threads);
+  }
+}
+
+ZstdOutputStream::~ZstdOutputStream() {
+  Close();
+  ZSTD_freeCCtx(cctx_);
+}
+
+bool ZstdOutputStream::Compress(int directive) {
+  const auto mode = static_cast<ZSTD_EndDirective>(directive);
+  ZSTD_inBuffer input = {input_buffer_.get(), input_size_, 0};
+  while (true) {
+    if (sub_data_position_ == sub_data_size_) {
+      void* out;
+      int out_size;
+      if (!sub_stream_->Next(&out, &out_size)) {
+        sub_data_ = nullptr;
+        sub_data_size_ = sub_data_position_ = 0;
+        error_message_ = "Failed to write to the underlying stream";
+        return false;
+      }
+      ABSL_CHECK_GT(out_size, 0);
+      sub_data_ = static_cast<char*>(out);
+      sub_data_size_ = out_size;
+      sub_data_position_ = 0;
+    }
+    ZSTD_outBuffer output = {sub_data_, sub_data_size_, sub_data_position_};
+    const size_t remaining =
+        ZSTD_compressStream2(cctx_, &output, &input, mode);
+    sub_data_position_ = output.pos;
+    if (ZSTD_isError(remaining)) {
+      error_message_ = ZSTD_getErrorName(remaining);
+      return false;
+    }
+    // With ZSTD_e_continue zstd buffers whatever it cannot output yet, so we
+    // are done once it has taken all of the input.  Flushing and ending are
+    // done once nothing remains in zstd's buffers.
+    const bool done = mode == ZSTD_e_continue ? input.pos == input.size
+                                              : remaining == 0;
+    if (done) break;
+  }
+  byte_count_ += input_size_;
+  input_size_ = 0;
+  if (mode != ZSTD_e_continue) {
+    // Notify lower layer of data.
+    sub_stream_->BackUp(static_cast<int>(sub_data_size_ - sub_data_position_));
+    // We don't own the buffer anymore.
+    sub_data_ = nullptr;
+    sub_data_size_ = sub_data_position_ = 0;
+  }
+  return true;
+}
+
+// implements ZeroCopyOutputStream ---------------------------------
+bool ZstdOutputStream::Next(void** data, int* size) {
+  if (error_message_ != nullptr || closed_) return false;
+  if (input_size_ != 0 && !Compress(ZSTD_e_continue)) return false;
+  *data = input_buffer_.get();
+  *size = static_cast<int>(input_buffer_length_);
+  input_size_ = input_buffer_length_;
+  return true;
+}
+
+void ZstdOutputStream::BackUp(int count) {
+  ABSL_CHECK_GE(count, 0);
+  ABSL_CHECK_LE(static_cast<size_t>(count), input_size_);
+  input_size_ -= count;
+}
+
+int64_t ZstdOutputStream::ByteCount() const {
+  return byte_count_ + static_cast<int64_t>(input_size_);
+}
+
+bool ZstdOutputStream::Flush() {
+  if (error_message_ != nullptr || closed_) return false;
+  return Compress(ZSTD_e_flush);
+}
+
+bool ZstdOutputStream::Close() {
+  if (closed_) return error_message_ == nullptr;
+  closed_ = true;
+  if (error_message_ != nullptr) return false;
+  return Compress(ZSTD_e_end);
+}
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // HAVE_ZSTD
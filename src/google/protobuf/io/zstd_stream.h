@@ -0,0 +1,217 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// This file contains the definition for classes ZstdInputStream and
+// ZstdOutputStream, which work like GzipInputStream and GzipOutputStream but
+// use Zstandard, which compresses several times faster than zlib at a similar
+// ratio.
+//
+// ZstdInputStream decompresses data from an underlying ZeroCopyInputStream
+// and provides the decompressed data as a ZeroCopyInputStream.
+//
+// ZstdOutputStream is a ZeroCopyOutputStream that compresses data to an
+// underlying ZeroCopyOutputStream.
+//
+// Both are only available when protobuf is built with HAVE_ZSTD.
+
+#ifndef GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+#define GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/port.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
+namespace google {
+namespace protobuf {
+namespace io {
+
+// A dictionary shared by the streams compressing or decompressing many small
+// payloads, such as individual messages, which on their own are too small to
+// compress well.  Dictionaries are typically trained on a sample of the
+// payloads with `zstd --train`.
+//
+// The dictionary is digested once, so creating streams that use it is cheap.
+// It is immutable and may be shared by streams on different threads.
+class PROTOBUF_EXPORT ZstdDictionary {
+ public:
+  // `data` is copied.  `compression_level` is the level used by streams
+  // compressing with this dictionary.
+  explicit ZstdDictionary(absl::string_view data);
+  ZstdDictionary(absl::string_view data, int compression_level);
+  ZstdDictionary(const ZstdDictionary&) = delete;
+  ZstdDictionary& operator=(const ZstdDictionary&) = delete;
+  ~ZstdDictionary();
+
+  // Returns false if zstd could not load the dictionary.
+  bool ok() const { return cdict_ != nullptr && ddict_ != nullptr; }
+
+ private:
+  friend class ZstdInputStream;
+  friend class ZstdOutputStream;
+
+  ZSTD_CDict_s* cdict_;
+  ZSTD_DDict_s* ddict_;
+};
+
+// A ZeroCopyInputStream that reads compressed data through zstd.  Several
+// concatenated zstd frames are read as a single stream.
+class PROTOBUF_EXPORT ZstdInputStream final : public ZeroCopyInputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 128kB.
+    int buffer_size;
+
+    // The dictionary the data was compressed with, if any.  It must outlive
+    // the stream.  Defaults to null.
+    const ZstdDictionary* dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ZstdInputStream with default options.
+  explicit ZstdInputStream(ZeroCopyInputStream* sub_stream);
+
+  // Create a ZstdInputStream with the given options.
+  ZstdInputStream(ZeroCopyInputStream* sub_stream, const Options& options);
+  ZstdInputStream(const ZstdInputStream&) = delete;
+  ZstdInputStream& operator=(const ZstdInputStream&) = delete;
+  ~ZstdInputStream() override;
+
+  // Return last error message or NULL if no error.
+  const char* ZstdErrorMessage() const { return error_message_; }
+
+  // implements ZeroCopyInputStream ----------------------------------
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Decompresses more data into the output buffer.  Returns false at the end
+  // of the stream or on error.
+  bool Decompress();
+
+  ZeroCopyInputStream* sub_stream_;
+  ZSTD_DCtx_s* dctx_;
+  const char* error_message_ = nullptr;
+
+  // The data last returned by the sub-stream, and how much of it was
+  // consumed.
+  const char* input_ = nullptr;
+  size_t input_size_ = 0;
+  size_t input_position_ = 0;
+  // True if the input ended at a frame boundary.
+  bool at_frame_boundary_ = true;
+
+  std::unique_ptr<char[]> output_buffer_;
+  size_t output_buffer_length_;
+  // The decompressed data in the output buffer, and how much of it was
+  // returned.
+  size_t output_size_ = 0;
+  size_t output_position_ = 0;
+  // Total number of bytes decompressed into the output buffer.
+  int64_t byte_count_ = 0;
+};
+
+class PROTOBUF_EXPORT ZstdOutputStream final : public ZeroCopyOutputStream {
+ public:
+  struct PROTOBUF_EXPORT Options {
+    // What size buffer to use internally.  Defaults to 128kB.
+    int buffer_size;
+
+    // A compression level between 1 and 22, where higher levels compress
+    // better but more slowly, or a negative level for even faster
+    // compression.  Defaults to 3.  Ignored if `dictionary` is set.
+    int compression_level;
+
+    // Number of threads compressing in the background.  With zero, data is
+    // compressed by the calling thread.  With more, Next() hands data over to
+    // zstd's worker threads, which compress it in parallel and in blocks of
+    // a few megabytes, so that the output is only written once enough data
+    // has accumulated or on Flush() and Close().  Has no effect if zstd was
+    // built without multithreading support.  Defaults to 0.
+    int num_threads;
+
+    // Compress with this dictionary, which must outlive the stream.
+    // Defaults to null.
+    const ZstdDictionary* dictionary;
+
+    Options();  // Initializes with default values.
+  };
+
+  // Create a ZstdOutputStream with default options.
+  explicit ZstdOutputStream(ZeroCopyOutputStream* sub_stream);
+
+  // Create a ZstdOutputStream with the given options.
+  ZstdOutputStream(ZeroCopyOutputStream* sub_stream, const Options& options);
+  ZstdOutputStream(const ZstdOutputStream&) = delete;
+  ZstdOutputStream& operator=(const ZstdOutputStream&) = delete;
+
+  ~ZstdOutputStream() override;
+
+  // Return last error message or NULL if no error.
+  const char* ZstdErrorMessage() const { return error_message_; }
+
+  // Flushes data written so far to compressed data in the underlying stream.
+  // It is the caller's responsibility to flush the underlying stream if
+  // necessary.  Compression may be less efficient when flushing often.
+  // Returns true if no error.
+  bool Flush();
+
+  // Writes out all data and closes the zstd frame.
+  // It is the caller's responsibility to close the underlying stream if
+  // necessary.
+  // Returns true if no error.
+  bool Close();
+
+  // implements ZeroCopyOutputStream ---------------------------------
+  bool Next(void** data, int* size) override;
+  void BackUp(int count) override;
+  int64_t ByteCount() const override;
+
+ private:
+  // Compresses the pending input, with the given ZSTD_EndDirective.
+  bool Compress(int directive);
+
+  ZeroCopyOutputStream* sub_stream_;
+  ZSTD_CCtx_s* cctx_;
+  const char* error_message_ = nullptr;
+  bool closed_ = false;
+
+  // The buffer last returned by the sub-stream, and how much of it was
+  // filled.
+  char* sub_data_ = nullptr;
+  size_t sub_data_size_ = 0;
+  size_t sub_data_position_ = 0;
+
+  std::unique_ptr<char[]> input_buffer_;
+  size_t input_buffer_length_;
+  // Bytes of the input buffer written by the caller, not compressed yet.
+  size_t input_size_ = 0;
+  // Number of bytes compressed so far.
+  int64_t byte_count_ = 0;
+};
+
+}  // namespace io
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_IO_ZSTD_STREAM_H__
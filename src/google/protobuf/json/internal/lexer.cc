@@ -13,12 +13,17 @@
 #include <cfloat>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <ostream>
 #include <string>
 #include <utility>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "absl/algorithm/container.h"
 #include "absl/log/absl_check.h"
 #include "absl/numeric/bits.h"
@@ -30,6 +35,7 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "utf8_validity.h"
+#include "google/protobuf/endian.h"
 #include "google/protobuf/stubs/status_macros.h"
 
 // Must be included last.
@@ -76,6 +82,91 @@ void HardenAgainstHyrumsLaw(absl::string_view to_obfuscate, std::string& out) {
     }
   }
 }
+
+// Returns the offset of the first byte in [p, end) that ParseUtf8() must look
+// at individually: a quote, a backslash or a control character, and also any
+// non-ASCII byte if `stop_at_non_ascii`. Returns `end - p` if there is none.
+size_t FindStringSpecialChar(const char* p, const char* end,
+                             bool stop_at_non_ascii) {
+  const char* const start = p;
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i single_quote = _mm_set1_epi8('\'');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i zero = _mm_setzero_si128();
+  for (; end - p >= 16; p += 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // The comparisons are signed, so non-ASCII bytes are less than ' '.
+    __m128i special = _mm_cmplt_epi8(v, space);
+    if (!stop_at_non_ascii) {
+      special = _mm_andnot_si128(_mm_cmplt_epi8(v, zero), special);
+    }
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(v, quote));
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(v, single_quote));
+    special = _mm_or_si128(special, _mm_cmpeq_epi8(v, backslash));
+    const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+    if (mask != 0) {
+      return static_cast<size_t>(p - start) + absl::countr_zero(mask);
+    }
+  }
+#else
+  constexpr uint64_t kLsbs = 0x0101010101010101;
+  constexpr uint64_t kMsbs = 0x8080808080808080;
+  // Has the high bit of each byte of `x` equal to zero set. Bytes above a zero
+  // byte may be false positives, so only the lowest one is meaningful.
+  auto zero_bytes = [](uint64_t x) { return (x - kLsbs) & ~x & kMsbs; };
+  for (; end - p >= 8; p += 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    v = internal::little_endian::ToHost(v);
+    uint64_t special = (v - kLsbs * ' ') & ~v & kMsbs;
+    if (stop_at_non_ascii) special |= v & kMsbs;
+    special |= zero_bytes(v ^ (kLsbs * '"')) |
+               zero_bytes(v ^ (kLsbs * '\'')) |
+               zero_bytes(v ^ (kLsbs * '\\'));
+    if (special != 0) {
+      return static_cast<size_t>(p - start) + absl::countr_zero(special) / 8;
+    }
+  }
+#endif
+  for (; p < end; ++p) {
+    const uint8_t c = static_cast<uint8_t>(*p);
+    if (c < 0x20 || c == '"' || c == '\'' || c == '\\' ||
+        (stop_at_non_ascii && c >= 0x80)) {
+      break;
+    }
+  }
+  return static_cast<size_t>(p - start);
+}
+
+// Returns the length of the longest prefix of `buf` that ParseUtf8() can
+// consume at once: printable ASCII other than quotes and backslashes, and
+// valid UTF-8 sequences. Sets `*chars` to the number of code points in it.
+size_t SpanPlainStringChars(absl::string_view buf, size_t* chars) {
+  const char* const end = buf.data() + buf.size();
+  const char* p = buf.data();
+  size_t continuation_bytes = 0;
+  while (p < end) {
+    p += FindStringSpecialChar(p, end, /*stop_at_non_ascii=*/true);
+    if (p == end || static_cast<uint8_t>(*p) < 0x80) break;
+
+    // Validate the run of non-ASCII text in one go, stopping short of any
+    // invalid or truncated sequence so that it gets reported as before.
+    const size_t run = FindStringSpecialChar(p, end,
+                                             /*stop_at_non_ascii=*/false);
+    const size_t valid =
+        utf8_range::SpanStructurallyValid(absl::string_view(p, run));
+    for (size_t i = 0; i < valid; ++i) {
+      continuation_bytes += (static_cast<uint8_t>(p[i]) & 0xc0) == 0x80;
+    }
+    p += valid;
+    if (valid < run) break;
+  }
+  const size_t len = static_cast<size_t>(p - buf.data());
+  *chars = len - continuation_bytes;
+  return len;
+}
 }  // namespace
 
 constexpr size_t ParseOptions::kDefaultDepth;
@@ -191,20 +282,28 @@ absl::StatusOr<uint16_t> JsonLexer::ParseU16HexCodepoint() {
 absl::Status JsonLexer::SkipToToken() {
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
-    switch (stream_.PeekChar()) {
-      case '\n':
-        RETURN_IF_ERROR(Advance(1));
-        ++json_loc_.line;
-        json_loc_.col = 0;
-        break;
-      case '\r':
-      case '\t':
-      case ' ':
-        RETURN_IF_ERROR(Advance(1));
-        break;
-      default:
-        return absl::OkStatus();
+    // Skip all of the whitespace in the buffer at once.
+    absl::string_view unread = stream_.Unread();
+    size_t n = 0;
+    for (; n < unread.size(); ++n) {
+      switch (unread[n]) {
+        case '\n':
+          ++json_loc_.line;
+          json_loc_.col = 0;
+          continue;
+        case '\r':
+        case '\t':
+        case ' ':
+          ++json_loc_.col;
+          continue;
+        default:
+          break;
+      }
+      break;
     }
+    json_loc_.offset += n;
+    RETURN_IF_ERROR(stream_.Advance(n));
+    if (n < unread.size()) return absl::OkStatus();
   }
 }
 
@@ -213,7 +312,7 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
 
   enum { kInt, kFraction, kExponent } state = kInt;
   char prev_var = 0;
-  auto number = TakeWhile([state, prev_var](size_t index, char c) mutable {
+  auto is_number_char = [state, prev_var](size_t index, char c) mutable {
     char prev = prev_var;
     prev_var = c;
     if (absl::ascii_isdigit(c)) {
@@ -241,7 +340,16 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseRawNumber() {
     }
 
     return false;
-  });
+  };
+
+  // If the number ends within the buffer, take it without going through the
+  // stream one character at a time.
+  absl::string_view unread = stream_.Unread();
+  auto scan = is_number_char;
+  size_t len = 0;
+  while (len < unread.size() && scan(len, unread[len])) ++len;
+  absl::StatusOr<LocationWith<MaybeOwnedString>> number =
+      len < unread.size() ? Take(len) : TakeWhile(is_number_char);
 
   RETURN_IF_ERROR(number.status());
   absl::string_view number_text = number->value.AsView();
@@ -389,10 +497,28 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
 
   // on_heap is empty if we do not need to heap-allocate the string.
   std::string on_heap;
+  // Whether all of the non-ASCII text in the string was validated as it was
+  // scanned, in which case the string does not need to be validated again.
+  bool utf8_validated = true;
   LocationWith<Mark> mark = BeginMark();
   while (true) {
     RETURN_IF_ERROR(stream_.BufferAtLeast(1).status());
 
+    // Consume any plain characters in the buffer at once.  Like the loop
+    // below, this counts code points rather than bytes in the location.
+    absl::string_view unread = stream_.Unread();
+    size_t chars;
+    size_t plain = SpanPlainStringChars(unread, &chars);
+    if (plain > 0) {
+      if (!on_heap.empty()) {
+        on_heap.append(unread.data(), plain);
+      }
+      RETURN_IF_ERROR(stream_.Advance(plain));
+      json_loc_.offset += chars;
+      json_loc_.col += chars;
+      continue;
+    }
+
     char c = stream_.PeekChar();
     RETURN_IF_ERROR(Advance(1));
     switch (c) {
@@ -406,7 +532,7 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
         MaybeOwnedString result = on_heap.empty()
                                       ? mark.value.UpToUnread(1)
                                       : MaybeOwnedString{std::move(on_heap)};
-        if (utf8_range::IsStructurallyValid(result)) {
+        if (utf8_validated || utf8_range::IsStructurallyValid(result)) {
           return LocationWith<MaybeOwnedString>{std::move(result), loc};
         }
         return Invalid("Invalid UTF-8 string");
@@ -463,6 +589,7 @@ absl::StatusOr<LocationWith<MaybeOwnedString>> JsonLexer::ParseUtf8() {
         // 0b1110xxxx'10xxxxxx'10xxxxxx
         // 0b11110xxx'10xxxxxx'10xxxxxx'10xxxxxx
         size_t lookahead = 0;
+        if (uc >= 0x80) utf8_validated = false;
         switch (absl::countl_one(uc)) {
           case 0:
             break;
@@ -602,6 +602,28 @@ TEST(LexerTest, RejectOverlongUtf8) {
   Bad("\"\340\200\200\"");
 }
 
+TEST(LexerTest, LongStrings) {
+  // Long enough to be scanned in blocks rather than one byte at a time.
+  absl::string_view text =
+      "The quick brown fox, caf\\u00e9, \xe6\x96\xbd\xe6\xb0\x8f and \xf0\x9f"
+      "\x98\x81 jumps over the lazy dog";
+  std::string expected = absl::StrReplaceAll(text, {{"\\u00e9", "\xc3\xa9"}});
+  Do(absl::StrCat("\"", text, "\""), [&](io::ZeroCopyInputStream* stream) {
+    EXPECT_THAT(Value::Parse(stream),
+                IsOkAndHolds(ValueIs<std::string>(expected)));
+  });
+  Bad(absl::StrCat("\"", text, "\xff", text, "\""));
+  Bad(absl::StrCat("\"", text, "\xe6\x96", text, "\""));
+}
+
+TEST(LexerTest, LocationsCountCodePoints) {
+  io::ArrayInputStream stream("\"\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\x01\"", 11);
+  absl::StatusOr<Value> value = Value::Parse(&stream);
+  ASSERT_THAT(value, StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(absl::StrReplaceAll(value.status().message(), {{" ", ""}}),
+              HasSubstr("near1:7(offset6)"));
+}
+
 TEST(LexerTest, MixtureOfEscapesAndRawMultibyteCharacters) {
   Do(R"json("😁\t")json", [](io::ZeroCopyInputStream* stream) {
     EXPECT_THAT(Value::Parse(stream),
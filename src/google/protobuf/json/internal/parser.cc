@@ -1293,6 +1293,57 @@ absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
   return s;
 }
 
+absl::StatusOr<bool> MessageStreamParser::NextElement() {
+  if (!started_) {
+    started_ = true;
+    if (format_ == Format::kDetect) {
+      format_ = lex_.Peek(JsonLexer::kArr) ? Format::kArray
+                                           : Format::kDelimited;
+    }
+    if (format_ != Format::kArray) return !lex_.AtEof();
+    RETURN_IF_ERROR(lex_.Expect("["));
+    if (!lex_.Peek("]")) return true;
+  } else if (format_ != Format::kArray) {
+    return !lex_.AtEof();
+  } else {
+    bool has_comma = lex_.Peek(",");
+    if (!lex_.Peek("]")) {
+      if (!has_comma) return lex_.Invalid("expected ','");
+      return true;
+    }
+    if (has_comma && !lex_.options().allow_legacy_syntax) {
+      return lex_.Invalid("expected ']'");
+    }
+  }
+
+  // The array has been closed.
+  if (!lex_.AtEof()) {
+    return absl::InvalidArgumentError(
+        "extraneous characters after end of JSON array");
+  }
+  return false;
+}
+
+absl::StatusOr<bool> MessageStreamParser::Next(Message* message) {
+  if (done_) return false;
+  absl::StatusOr<bool> has_next = NextElement();
+  if (!has_next.ok() || !*has_next) {
+    done_ = true;
+    return has_next;
+  }
+
+  path_ = MessagePath(message->GetDescriptor()->full_name());
+  ParseProto2Descriptor::Msg msg(message);
+  absl::Status s =
+      ParseMessage<ParseProto2Descriptor>(lex_, *message->GetDescriptor(), msg,
+                                          /*any_reparse=*/false);
+  if (!s.ok()) {
+    done_ = true;
+    return s;
+  }
+  return true;
+}
+
 absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 const std::string& type_url,
                                 io::ZeroCopyInputStream* json_input,
@@ -29,6 +29,39 @@ absl::Status JsonToBinaryStream(google::protobuf::util::TypeResolver* resolver,
                                 io::ZeroCopyInputStream* json_input,
                                 io::ZeroCopyOutputStream* binary_output,
                                 json_internal::ParseOptions options);
+
+// Internal implementation of google::protobuf::json::JsonMessageReader; see json.h
+// for details.
+//
+// A single lexer is kept across messages, so the underlying stream is only
+// buffered while a token is being lexed and memory use is bounded by the size
+// of the largest message rather than by the size of the stream.
+class MessageStreamParser {
+ public:
+  enum class Format { kArray, kDelimited, kDetect };
+
+  MessageStreamParser(io::ZeroCopyInputStream* input,
+                      json_internal::ParseOptions options, Format format)
+      : path_(""), lex_(input, options, &path_), format_(format) {}
+
+  MessageStreamParser(const MessageStreamParser&) = delete;
+  MessageStreamParser& operator=(const MessageStreamParser&) = delete;
+
+  // Parses the next message of the stream into `message`, which must be
+  // empty.  Returns false if the stream has no more messages.
+  absl::StatusOr<bool> Next(Message* message);
+
+ private:
+  // Consumes what separates the previous message from the next one.  Returns
+  // false if there is no next message.
+  absl::StatusOr<bool> NextElement();
+
+  MessagePath path_;
+  JsonLexer lex_;
+  Format format_;
+  bool started_ = false;
+  bool done_ = false;
+};
 }  // namespace json_internal
 }  // namespace protobuf
 }  // namespace google
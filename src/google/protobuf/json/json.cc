@@ -7,9 +7,11 @@
 
 #include "google/protobuf/json/json.h"
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 #include "google/protobuf/json/internal/parser.h"
@@ -116,6 +118,43 @@ absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
 
   return google::protobuf::json_internal::JsonStreamToMessage(input, message, opts);
 }
+
+JsonMessageReader::JsonMessageReader(io::ZeroCopyInputStream* input,
+                                     const ParseOptions& options,
+                                     Format format) {
+  google::protobuf::json_internal::ParseOptions opts;
+  opts.ignore_unknown_fields = options.ignore_unknown_fields;
+  opts.case_insensitive_enum_parsing = options.case_insensitive_enum_parsing;
+
+  // TODO: Drop this setting.
+  opts.allow_legacy_syntax = true;
+
+  using Parser = google::protobuf::json_internal::MessageStreamParser;
+  Parser::Format parser_format = Parser::Format::kDetect;
+  switch (format) {
+    case Format::kArray:
+      parser_format = Parser::Format::kArray;
+      break;
+    case Format::kDelimited:
+      parser_format = Parser::Format::kDelimited;
+      break;
+    case Format::kDetect:
+      break;
+  }
+  parser_ = std::make_unique<Parser>(input, opts, parser_format);
+}
+
+JsonMessageReader::~JsonMessageReader() = default;
+
+bool JsonMessageReader::Next(Message* message) {
+  message->Clear();
+  absl::StatusOr<bool> has_next = parser_->Next(message);
+  if (!has_next.ok()) {
+    status_ = has_next.status();
+    return false;
+  }
+  return *has_next;
+}
 }  // namespace json
 }  // namespace protobuf
 }  // namespace google
@@ -10,6 +10,7 @@
 #ifndef GOOGLE_PROTOBUF_JSON_JSON_H__
 #define GOOGLE_PROTOBUF_JSON_JSON_H__
 
+#include <memory>
 #include <string>
 
 #include "absl/status/status.h"
@@ -22,6 +23,10 @@
 
 namespace google {
 namespace protobuf {
+namespace json_internal {
+class MessageStreamParser;
+}  // namespace json_internal
+
 namespace json {
 struct ParseOptions {
   // Whether to ignore unknown JSON fields during parsing
@@ -98,6 +103,56 @@ inline absl::Status JsonStreamToMessage(io::ZeroCopyInputStream* input,
   return JsonStreamToMessage(input, message, ParseOptions());
 }
 
+// Reads a stream of JSON messages one at a time, such as a large top-level
+// JSON array or newline-delimited JSON (NDJSON), without holding more than one
+// message in memory:
+//
+//   io::FileInputStream input(fd);
+//   JsonMessageReader reader(&input);
+//   MyMessage message;
+//   while (reader.Next(&message)) {
+//     Process(message);
+//   }
+//   if (!reader.status().ok()) ...
+//
+// The same message object may be passed to every call to Next(); to parse on
+// an arena instead, create each message on the arena and Reset() it once the
+// message has been processed.  It will use the DescriptorPool of the
+// passed-in message to resolve Any types.
+//
+// Please note that non-OK statuses are not a stable output of this API and
+// subject to change without notice.
+class PROTOBUF_EXPORT JsonMessageReader {
+ public:
+  enum class Format {
+    // A single JSON array whose elements are the messages.
+    kArray,
+    // JSON objects separated by whitespace, such as NDJSON.
+    kDelimited,
+    // kArray if the stream starts with '[', and kDelimited otherwise.
+    kDetect,
+  };
+
+  explicit JsonMessageReader(io::ZeroCopyInputStream* input,
+                             const ParseOptions& options = ParseOptions(),
+                             Format format = Format::kDetect);
+  JsonMessageReader(const JsonMessageReader&) = delete;
+  JsonMessageReader& operator=(const JsonMessageReader&) = delete;
+  ~JsonMessageReader();
+
+  // Clears `message` and parses the next message of the stream into it.
+  // Returns false once the stream is exhausted or if an error occurs, in which
+  // case status() returns the error.
+  bool Next(Message* message);
+
+  // Returns the error that made Next() return false, if any.
+  const absl::Status& status() const { return status_; }
+
+ private:
+  std::unique_ptr<json_internal::MessageStreamParser> parser_;
+  absl::Status status_;
+};
+
 // Converts protobuf binary data to JSON.
 // The conversion will fail if:
 //   1. TypeResolver fails to resolve a type.
@@ -1316,6 +1316,92 @@ TEST(JsonErrorTest, FieldNameAndSyntaxErrorInSeparateChunks) {
                     "*@ *bool_value"));
 }
 
+// Reads every message of `input` with a JsonMessageReader, returning the
+// int32_value of each.
+absl::StatusOr<std::vector<int32_t>> ReadAll(
+    io::ZeroCopyInputStream* input,
+    JsonMessageReader::Format format = JsonMessageReader::Format::kDetect) {
+  JsonMessageReader reader(input, ParseOptions(), format);
+  std::vector<int32_t> values;
+  TestMessage m;
+  while (reader.Next(&m)) {
+    values.push_back(m.int32_value());
+  }
+  RETURN_IF_ERROR(reader.status());
+  return values;
+}
+
+absl::StatusOr<std::vector<int32_t>> ReadAll(
+    absl::string_view json,
+    JsonMessageReader::Format format = JsonMessageReader::Format::kDetect) {
+  io::ArrayInputStream input(json.data(), json.size());
+  return ReadAll(&input, format);
+}
+
+TEST(JsonMessageReaderTest, Array) {
+  EXPECT_THAT(ReadAll(R"([{"int32Value": 1}, {"int32Value": 2}, {}])"),
+              IsOkAndHolds(ElementsAre(1, 2, 0)));
+  EXPECT_THAT(ReadAll("  [ ]  "), IsOkAndHolds(IsEmpty()));
+  EXPECT_THAT(ReadAll(R"([{"int32Value": 1}])",
+                      JsonMessageReader::Format::kArray),
+              IsOkAndHolds(ElementsAre(1)));
+}
+
+TEST(JsonMessageReaderTest, Delimited) {
+  EXPECT_THAT(ReadAll("{\"int32Value\": 1}\n{\"int32Value\": 2}\n\n{}\n"),
+              IsOkAndHolds(ElementsAre(1, 2, 0)));
+  EXPECT_THAT(ReadAll(""), IsOkAndHolds(IsEmpty()));
+  EXPECT_THAT(ReadAll(" \n "), IsOkAndHolds(IsEmpty()));
+}
+
+TEST(JsonMessageReaderTest, MessagesDoNotLeakIntoEachOther) {
+  std::string json = R"([{"int32Value": 1, "stringValue": "a"}, {}])";
+  io::ArrayInputStream input(json.data(), json.size());
+  JsonMessageReader array_reader(&input);
+  TestMessage m;
+  ASSERT_TRUE(array_reader.Next(&m));
+  EXPECT_EQ(m.string_value(), "a");
+  ASSERT_TRUE(array_reader.Next(&m));
+  EXPECT_EQ(m.int32_value(), 0);
+  EXPECT_EQ(m.string_value(), "");
+  EXPECT_FALSE(array_reader.Next(&m));
+  EXPECT_OK(array_reader.status());
+}
+
+TEST(JsonMessageReaderTest, ChunkedInput) {
+  io::internal::TestZeroCopyInputStream input(
+      {"[{\"int32V", "alue\": 1", "}", ",", " {\"int32Value\"", ": 22}",
+       "]"});
+  EXPECT_THAT(ReadAll(&input), IsOkAndHolds(ElementsAre(1, 22)));
+}
+
+TEST(JsonMessageReaderTest, Errors) {
+  EXPECT_THAT(ReadAll(R"([{"int32Value": 1} {"int32Value": 2}])"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadAll(R"([{"int32Value": 1})"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadAll(R"([{"int32Value": 1}] {})"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadAll(R"({"int32Value": "x"})"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadAll(R"({"int32Value": 1})",
+                      JsonMessageReader::Format::kArray),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ReadAll("[]", JsonMessageReader::Format::kDelimited),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(JsonMessageReaderTest, StopsAfterError) {
+  std::string json = R"({"int32Value": 1} {"int32Value": true} {})";
+  io::ArrayInputStream input(json.data(), json.size());
+  JsonMessageReader reader(&input);
+  TestMessage m;
+  ASSERT_TRUE(reader.Next(&m));
+  EXPECT_FALSE(reader.Next(&m));
+  EXPECT_FALSE(reader.status().ok());
+  EXPECT_FALSE(reader.Next(&m));
+}
+
 }  // namespace
 }  // namespace json
 }  // namespace protobuf
@@ -8,12 +8,16 @@
 #include "google/protobuf/map.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <string>
 #include <type_traits>
 
 #include "absl/hash/hash.h"
+#include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/message_lite.h"
 
@@ -23,10 +27,53 @@
 
 namespace google {
 namespace protobuf {
+
+namespace {
+std::atomic<MapTableLayout> default_map_table_layout{MapTableLayout::kChained};
+}  // namespace
+
+void SetDefaultMapTableLayout(MapTableLayout layout) {
+  default_map_table_layout.store(layout, std::memory_order_relaxed);
+}
+
+MapTableLayout GetDefaultMapTableLayout() {
+  return default_map_table_layout.load(std::memory_order_relaxed);
+}
+
 namespace internal {
 
 const TableEntryPtr kGlobalEmptyTable[kGlobalEmptyTableSize] = {};
 
+namespace {
+// A table entry whose bytes are all kFlatCtrlEmpty.
+constexpr TableEntryPtr kFlatCtrlEmptyEntry =
+    static_cast<TableEntryPtr>(~uintptr_t{0} / 0xFF * kFlatCtrlEmpty);
+}  // namespace
+
+const TableEntryPtr kGlobalEmptyFlatTable[] = {
+    // The slot and the number of deleted slots.
+    TableEntryPtr{}, TableEntryPtr{},
+    // The control bytes.
+    kFlatCtrlEmptyEntry, kFlatCtrlEmptyEntry, kFlatCtrlEmptyEntry,
+    kFlatCtrlEmptyEntry, kFlatCtrlEmptyEntry, kFlatCtrlEmptyEntry};
+
+void UntypedMapBase::SetTableLayout(MapTableLayout layout) {
+  static_assert(sizeof(kGlobalEmptyFlatTable) >=
+                    sizeof(TableEntryPtr) *
+                        FlatTableEntries(kGlobalEmptyTableSize),
+                "kGlobalEmptyFlatTable is too small");
+  ABSL_CHECK(empty()) << "The table layout of a non-empty map can't be changed";
+  const map_index_t bits = static_cast<map_index_t>(layout);
+  if ((seed_ & kLayoutMask) == bits) return;
+  if (num_buckets_ != kGlobalEmptyTableSize) {
+    DeleteTable(table_, TableEntries());
+  }
+  num_buckets_ = index_of_first_non_null_ = kGlobalEmptyTableSize;
+  table_ = const_cast<TableEntryPtr*>(
+      bits == kLayoutFlat ? kGlobalEmptyFlatTable : kGlobalEmptyTable);
+  seed_ = (seed_ & ~kLayoutMask) | bits;
+}
+
 NodeBase* UntypedMapBase::DestroyTree(Tree* tree) {
   NodeBase* head = tree->empty() ? nullptr : tree->begin()->second;
   if (alloc_.arena() == nullptr) {
@@ -175,11 +222,15 @@ void UntypedMapBase::ClearTable(const ClearInput input) {
   }
 
   if (input.reset_table) {
-    std::fill(table_, table_ + num_buckets_, TableEntryPtr{});
+    if (IsFlat()) {
+      InitFlatTable(table_, num_buckets_);
+    } else {
+      std::fill(table_, table_ + num_buckets_, TableEntryPtr{});
+    }
     num_elements_ = 0;
     index_of_first_non_null_ = num_buckets_;
   } else {
-    DeleteTable(table_, num_buckets_);
+    DeleteTable(table_, TableEntries());
   }
 }
 
@@ -197,7 +248,7 @@ auto UntypedMapBase::FindFromTree(map_index_t b, VariantKey key,
 size_t UntypedMapBase::SpaceUsedInTable(size_t sizeof_node) const {
   size_t size = 0;
   // The size of the table.
-  size += sizeof(void*) * num_buckets_;
+  size += sizeof(void*) * TableEntries();
   // All the nodes.
   size += sizeof_node * num_elements_;
   // For each tree, count the overhead of those nodes.
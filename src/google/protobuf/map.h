@@ -29,14 +29,20 @@
 #include <time.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "google/protobuf/stubs/common.h"
 #include "absl/base/attributes.h"
 #include "absl/container/btree_map.h"
 #include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
 #include "absl/meta/type_traits.h"
+#include "absl/numeric/bits.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/arena.h"
+#include "google/protobuf/endian.h"
 #include "google/protobuf/generated_enum_util.h"
 #include "google/protobuf/internal_visibility.h"
 #include "google/protobuf/map_type_handler.h"
@@ -62,6 +68,23 @@ class MapIterator;
 template <typename Enum>
 struct is_proto_enum;
 
+// The hash table layout used by a Map.
+enum class MapTableLayout : uint8_t {
+  // Chained buckets, each converted to a balanced tree if it grows too long.
+  kChained = 1,
+  // Open addressing over a flat array of slots, with one byte of hash per slot
+  // so that groups of slots are probed at once (SwissTable style). Lookups
+  // rarely touch nodes other than the one found, which makes it faster for
+  // large, lookup-heavy maps. The table takes more memory for small maps.
+  kFlat = 2,
+};
+
+// Sets the layout of every map that has not been given one with
+// Map::set_table_layout(), and that has not allocated its table yet. Defaults
+// to kChained.
+PROTOBUF_EXPORT void SetDefaultMapTableLayout(MapTableLayout layout);
+PROTOBUF_EXPORT MapTableLayout GetDefaultMapTableLayout();
+
 namespace rust {
 struct PtrAndLen;
 }  // namespace rust
@@ -439,6 +462,103 @@ inline TableEntryPtr TreeToTableEntry(TreeForMap* node) {
   return static_cast<TableEntryPtr>(reinterpret_cast<uintptr_t>(node) | 1);
 }
 
+// The flat table layout keeps one control byte per slot: the low 7 bits of the
+// hash of the key in the slot, or one of these values.
+enum : uint8_t {
+  kFlatCtrlEmpty = 0x80,
+  kFlatCtrlDeleted = 0xFE,
+};
+
+// Splits a hash into the part selecting the first slot to probe and the part
+// stored in the control byte.
+inline size_t FlatH1(size_t hash) { return hash >> 7; }
+inline uint8_t FlatH2(size_t hash) { return hash & 0x7F; }
+
+// A group of consecutive control bytes, probed at once.
+#if defined(__SSE2__)
+class FlatCtrlGroup {
+ public:
+  static constexpr map_index_t kWidth = 16;
+  // Has bit `i` set for each matching control byte `i`.
+  using Mask = uint32_t;
+
+  explicit FlatCtrlGroup(const uint8_t* ctrl)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+  Mask Match(uint8_t h2) const {
+    return static_cast<Mask>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(h2)), ctrl_)));
+  }
+  Mask MatchEmpty() const { return Match(kFlatCtrlEmpty); }
+  // Both special values have the high bit set, and hash bytes do not.
+  Mask MatchEmptyOrDeleted() const {
+    return static_cast<Mask>(_mm_movemask_epi8(ctrl_));
+  }
+
+  static map_index_t LowestIndex(Mask mask) {
+    return static_cast<map_index_t>(absl::countr_zero(mask));
+  }
+
+ private:
+  __m128i ctrl_;
+};
+#else
+class FlatCtrlGroup {
+ public:
+  static constexpr map_index_t kWidth = 8;
+  // Has the high bit of byte `i` set for each matching control byte `i`.
+  using Mask = uint64_t;
+
+  explicit FlatCtrlGroup(const uint8_t* ctrl) {
+    memcpy(&ctrl_, ctrl, sizeof(ctrl_));
+    ctrl_ = little_endian::ToHost(ctrl_);
+  }
+
+  // May report a byte following a match as a false positive. That byte holds
+  // a hash, so the caller rejects it when comparing keys.
+  Mask Match(uint8_t h2) const {
+    const uint64_t x = ctrl_ ^ (kLsbs * h2);
+    return (x - kLsbs) & ~x & kMsbs;
+  }
+  // kFlatCtrlEmpty is the only value with the high bit set and bit 1 clear.
+  Mask MatchEmpty() const { return ctrl_ & ~(ctrl_ << 6) & kMsbs; }
+  Mask MatchEmptyOrDeleted() const { return ctrl_ & kMsbs; }
+
+  static map_index_t LowestIndex(Mask mask) {
+    return static_cast<map_index_t>(absl::countr_zero(mask)) >> 3;
+  }
+
+ private:
+  static constexpr uint64_t kLsbs = 0x0101010101010101;
+  static constexpr uint64_t kMsbs = 0x8080808080808080;
+  uint64_t ctrl_;
+};
+#endif
+
+// Probes a flat table a group at a time, starting at the slot selected by the
+// hash. The distance between groups grows by one group at each step, which
+// visits every group of a power of two sized table.
+class FlatProbeSeq {
+ public:
+  FlatProbeSeq(size_t hash, map_index_t mask)
+      : mask_(mask), offset_(static_cast<map_index_t>(FlatH1(hash)) & mask) {}
+
+  // The slot at the start of the current group.
+  map_index_t offset() const { return offset_; }
+  // The slot of the `i`th control byte of the current group.
+  map_index_t offset(map_index_t i) const { return (offset_ + i) & mask_; }
+
+  void next() {
+    index_ += FlatCtrlGroup::kWidth;
+    offset_ = (offset_ + index_) & mask_;
+  }
+
+ private:
+  map_index_t mask_;
+  map_index_t offset_;
+  map_index_t index_ = 0;
+};
+
 // This captures all numeric types.
 inline size_t MapValueSpaceUsedExcludingSelfLong(bool) { return 0; }
 inline size_t MapValueSpaceUsedExcludingSelfLong(const std::string& str) {
@@ -453,6 +573,8 @@ size_t MapValueSpaceUsedExcludingSelfLong(const T& message) {
 constexpr size_t kGlobalEmptyTableSize = 1;
 PROTOBUF_EXPORT extern const TableEntryPtr
     kGlobalEmptyTable[kGlobalEmptyTableSize];
+// The flat counterpart of kGlobalEmptyTable: a single empty slot.
+PROTOBUF_EXPORT extern const TableEntryPtr kGlobalEmptyFlatTable[];
 
 template <typename Map,
           typename = typename std::enable_if<
@@ -594,6 +716,11 @@ class PROTOBUF_EXPORT UntypedMapBase {
   bool empty() const { return size() == 0; }
   UntypedMapIterator begin() const;
 
+  MapTableLayout table_layout() const {
+    return HasTableLayout() ? static_cast<MapTableLayout>(seed_ & kLayoutMask)
+                            : GetDefaultMapTableLayout();
+  }
+
   // We make this a static function to reduce the cost in MapField.
   // All the end iterators are singletons anyway.
   static UntypedMapIterator EndIterator() { return {nullptr, nullptr, 0}; }
@@ -610,6 +737,22 @@ class PROTOBUF_EXPORT UntypedMapBase {
     map_index_t bucket;
   };
 
+  // The low bits of seed_ hold the table layout. They are set when the map is
+  // given a layout or allocates its first table, and are otherwise hashed like
+  // the rest of the seed.
+  enum : map_index_t {
+    kLayoutUnset = 0,
+    kLayoutChained = static_cast<map_index_t>(MapTableLayout::kChained),
+    kLayoutFlat = static_cast<map_index_t>(MapTableLayout::kFlat),
+    kLayoutMask = 3,
+  };
+
+  bool HasTableLayout() const { return (seed_ & kLayoutMask) != kLayoutUnset; }
+  bool IsFlat() const { return (seed_ & kLayoutMask) == kLayoutFlat; }
+
+  // Requires an empty map.
+  void SetTableLayout(MapTableLayout layout);
+
   // Returns whether we should insert after the head of the list. For
   // non-optimized builds, we randomly decide whether to insert right at the
   // head of the list or just after the head. This helps add a little bit of
@@ -684,7 +827,8 @@ class PROTOBUF_EXPORT UntypedMapBase {
     AllocFor<NodeBase>(alloc_).deallocate(node, node_size / sizeof(NodeBase));
   }
 
-  void DeleteTable(TableEntryPtr* table, map_index_t n) {
+  // `n` is the number of entries allocated, see TableEntries().
+  void DeleteTable(TableEntryPtr* table, size_t n) {
     if (auto* a = arena()) {
       a->ReturnArrayMemory(table, n * sizeof(TableEntryPtr));
     } else {
@@ -707,15 +851,26 @@ class PROTOBUF_EXPORT UntypedMapBase {
   }
 
   map_index_t VariantBucketNumber(absl::string_view key) const {
-    return static_cast<map_index_t>(absl::HashOf(seed_, key) &
-                                    (num_buckets_ - 1));
+    return static_cast<map_index_t>(VariantHash(key) & (num_buckets_ - 1));
   }
 
   map_index_t VariantBucketNumber(uint64_t key) const {
-    return static_cast<map_index_t>(absl::HashOf(key ^ seed_) &
-                                    (num_buckets_ - 1));
+    return static_cast<map_index_t>(VariantHash(key) & (num_buckets_ - 1));
+  }
+
+  size_t VariantHash(VariantKey key) const {
+    return key.data == nullptr
+               ? VariantHash(key.integral)
+               : VariantHash(absl::string_view(
+                     key.data, static_cast<size_t>(key.integral)));
+  }
+
+  size_t VariantHash(absl::string_view key) const {
+    return absl::HashOf(seed_, key);
   }
 
+  size_t VariantHash(uint64_t key) const { return absl::HashOf(key ^ seed_); }
+
   TableEntryPtr* CreateEmptyTable(map_index_t n) {
     ABSL_DCHECK_GE(n, kMinTableSize);
     ABSL_DCHECK_EQ(n & (n - 1), 0u);
@@ -724,6 +879,100 @@ class PROTOBUF_EXPORT UntypedMapBase {
     return result;
   }
 
+  // The flat layout allocates, in a single array: `num_buckets_` slots holding
+  // a node each, the number of deleted slots, and the control bytes followed
+  // by copies of the first FlatCtrlGroup::kWidth of them so that a group can be
+  // loaded starting at any slot. Empty slots are null, so iterating the slots
+  // works as for the chained layout, each node being a list of one.
+  static constexpr size_t FlatTableEntries(map_index_t n) {
+    return n + 1 +
+           (n + FlatCtrlGroup::kWidth + sizeof(TableEntryPtr) - 1) /
+               sizeof(TableEntryPtr);
+  }
+
+  // Smaller tables than a group work, the control bytes are then copied
+  // several times.
+  enum : map_index_t { kMinFlatTableSize = 4 };
+
+  // Keep at least one slot empty, which ends unsuccessful probes.
+  static map_index_t FlatMaxLoad(map_index_t n) {
+    return n - (std::max)(n / 8, map_index_t{1});
+  }
+
+  // The number of entries allocated for the current table.
+  size_t TableEntries() const {
+    return IsFlat() ? FlatTableEntries(num_buckets_) : num_buckets_;
+  }
+
+  uint8_t* FlatCtrl() const {
+    return reinterpret_cast<uint8_t*>(table_ + num_buckets_ + 1);
+  }
+
+  map_index_t FlatNumDeleted() const {
+    return static_cast<map_index_t>(table_[num_buckets_]);
+  }
+
+  void SetFlatNumDeleted(map_index_t n) {
+    table_[num_buckets_] = static_cast<TableEntryPtr>(uintptr_t{n});
+  }
+
+  void SetFlatCtrl(map_index_t slot, uint8_t ctrl) {
+    uint8_t* ctrls = FlatCtrl();
+    for (map_index_t i = slot; i < num_buckets_ + FlatCtrlGroup::kWidth;
+         i += num_buckets_) {
+      ctrls[i] = ctrl;
+    }
+  }
+
+  static void InitFlatTable(TableEntryPtr* table, map_index_t n) {
+    memset(table, 0, (n + 1) * sizeof(table[0]));
+    memset(table + n + 1, kFlatCtrlEmpty,
+           (FlatTableEntries(n) - n - 1) * sizeof(table[0]));
+  }
+
+  TableEntryPtr* CreateEmptyFlatTable(map_index_t n) {
+    ABSL_DCHECK_GE(n, kMinFlatTableSize);
+    ABSL_DCHECK_EQ(n & (n - 1), 0u);
+    TableEntryPtr* result =
+        AllocFor<TableEntryPtr>(alloc_).allocate(FlatTableEntries(n));
+    InitFlatTable(result, n);
+    return result;
+  }
+
+  // Returns the first empty or deleted slot in the probe sequence of `hash`.
+  map_index_t FlatFindInsertSlot(size_t hash) const {
+    for (FlatProbeSeq seq(hash, num_buckets_ - 1);; seq.next()) {
+      const auto mask =
+          FlatCtrlGroup(FlatCtrl() + seq.offset()).MatchEmptyOrDeleted();
+      if (mask != 0) return seq.offset(FlatCtrlGroup::LowestIndex(mask));
+    }
+  }
+
+  // Inserts `node`, whose key has the given hash and is not in the table yet.
+  // Returns its slot. num_elements_ is not modified.
+  map_index_t FlatInsertUnique(size_t hash, NodeBase* node) {
+    const map_index_t slot = FlatFindInsertSlot(hash);
+    if (FlatCtrl()[slot] == kFlatCtrlDeleted) {
+      SetFlatNumDeleted(FlatNumDeleted() - 1);
+    }
+    SetFlatCtrl(slot, FlatH2(hash));
+    node->next = nullptr;
+    table_[slot] = NodeToTableEntry(node);
+    index_of_first_non_null_ = (std::min)(index_of_first_non_null_, slot);
+    return slot;
+  }
+
+  // The slot stays deleted, rather than empty, until the next rehash so that
+  // probes for keys inserted after it keep going.
+  void FlatEraseSlot(map_index_t slot) {
+    table_[slot] = TableEntryPtr{};
+    SetFlatCtrl(slot, kFlatCtrlDeleted);
+    SetFlatNumDeleted(FlatNumDeleted() + 1);
+  }
+
+  // Picks a new seed for a newly allocated table, keeping the layout bits.
+  void ResetSeed() { seed_ = (Seed() & ~kLayoutMask) | (seed_ & kLayoutMask); }
+
   // Return a randomish value.
   map_index_t Seed() const {
     uint64_t s = 0;
@@ -952,15 +1201,24 @@ class KeyMapBase : public UntypedMapBase {
   friend class RustMapHelper;
 
   PROTOBUF_NOINLINE void erase_no_destroy(map_index_t b, KeyNode* node) {
-    TreeIterator tree_it;
-    const bool is_list = revalidate_if_necessary(b, node, &tree_it);
-    if (is_list) {
-      ABSL_DCHECK(TableEntryIsNonEmptyList(b));
-      auto* head = TableEntryToNode(table_[b]);
-      head = EraseFromLinkedList(node, head);
-      table_[b] = NodeToTableEntry(head);
+    if (IsFlat()) {
+      b &= num_buckets_ - 1;
+      // The slot is stale if the table was rehashed since it was found.
+      if (table_[b] != NodeToTableEntry(node)) {
+        b = FlatFindHelper(TS::ToView(node->key())).bucket;
+      }
+      FlatEraseSlot(b);
     } else {
-      EraseFromTree(b, tree_it);
+      TreeIterator tree_it;
+      const bool is_list = revalidate_if_necessary(b, node, &tree_it);
+      if (is_list) {
+        ABSL_DCHECK(TableEntryIsNonEmptyList(b));
+        auto* head = TableEntryToNode(table_[b]);
+        head = EraseFromLinkedList(node, head);
+        table_[b] = NodeToTableEntry(head);
+      } else {
+        EraseFromTree(b, tree_it);
+      }
     }
     --num_elements_;
     if (PROTOBUF_PREDICT_FALSE(b == index_of_first_non_null_)) {
@@ -973,6 +1231,7 @@ class KeyMapBase : public UntypedMapBase {
 
   NodeAndBucket FindHelper(typename TS::ViewType k,
                            TreeIterator* it = nullptr) const {
+    if (IsFlat()) return FlatFindHelper(k);
     map_index_t b = BucketNumber(k);
     if (TableEntryIsNonEmptyList(b)) {
       auto* node = internal::TableEntryToNode(table_[b]);
@@ -989,6 +1248,26 @@ class KeyMapBase : public UntypedMapBase {
     return {nullptr, b};
   }
 
+  // The bucket of a key that is not found is meaningless for the flat layout,
+  // which picks the slot when inserting.
+  NodeAndBucket FlatFindHelper(typename TS::ViewType k) const {
+    const size_t hash = FlatHash(k);
+    const uint8_t* ctrl = FlatCtrl();
+    for (FlatProbeSeq seq(hash, num_buckets_ - 1);; seq.next()) {
+      const FlatCtrlGroup group(ctrl + seq.offset());
+      for (auto mask = group.Match(FlatH2(hash)); mask != 0; mask &= mask - 1) {
+        const map_index_t slot = seq.offset(FlatCtrlGroup::LowestIndex(mask));
+        auto* node = static_cast<KeyNode*>(TableEntryToNode(table_[slot]));
+        if (TS::Equals(node->key(), k)) return {node, slot};
+      }
+      if (group.MatchEmpty() != 0) return {nullptr, 0};
+    }
+  }
+
+  size_t FlatHash(typename TS::ViewType k) const {
+    return VariantHash(RealKeyToVariantKeyAlternative<Key>{}(k));
+  }
+
   // Insert the given node.
   // If the key is a duplicate, it inserts the new node and returns the old one.
   // Gives ownership to the caller.
@@ -997,7 +1276,12 @@ class KeyMapBase : public UntypedMapBase {
     KeyNode* to_erase = nullptr;
     auto p = this->FindHelper(node->key());
     map_index_t b = p.bucket;
-    if (p.node != nullptr) {
+    if (p.node != nullptr && IsFlat()) {
+      // Take over the slot of the replaced node.
+      node->next = nullptr;
+      table_[b] = NodeToTableEntry(node);
+      return static_cast<KeyNode*>(p.node);
+    } else if (p.node != nullptr) {
       erase_no_destroy(p.bucket, static_cast<KeyNode*>(p.node));
       to_erase = static_cast<KeyNode*>(p.node);
     } else if (ResizeIfLoadIsOutOfRange(num_elements_ + 1)) {
@@ -1012,7 +1296,8 @@ class KeyMapBase : public UntypedMapBase {
   // and bucket b is not a tree, create a tree for buckets b.
   // Requires count(*KeyPtrFromNodePtr(node)) == 0 and that b is the correct
   // bucket.  num_elements_ is not modified.
-  void InsertUnique(map_index_t b, KeyNode* node) {
+  // With the flat layout, `b` is ignored. Returns the bucket of the node.
+  map_index_t InsertUnique(map_index_t b, KeyNode* node) {
     ABSL_DCHECK(index_of_first_non_null_ == num_buckets_ ||
                 !TableEntryIsEmpty(index_of_first_non_null_));
     // In practice, the code that led to this point may have already
@@ -1020,6 +1305,9 @@ class KeyMapBase : public UntypedMapBase {
     // or whatever.  But it's probably cheap enough to recompute that here;
     // it's likely that we're inserting into an empty or short list.
     ABSL_DCHECK(FindHelper(TS::ToView(node->key())).node == nullptr);
+    if (IsFlat()) {
+      return FlatInsertUnique(FlatHash(TS::ToView(node->key())), node);
+    }
     if (TableEntryIsEmpty(b)) {
       InsertUniqueInList(b, node);
       index_of_first_non_null_ = (std::min)(index_of_first_non_null_, b);
@@ -1028,6 +1316,7 @@ class KeyMapBase : public UntypedMapBase {
     } else {
       InsertUniqueInTree(b, NodeToVariantKey, node);
     }
+    return b;
   }
 
   static VariantKey NodeToVariantKey(NodeBase* node) {
@@ -1056,6 +1345,7 @@ class KeyMapBase : public UntypedMapBase {
   // policy that sometimes we resize down as well as up, clients can easily
   // keep O(size()) = O(number of buckets) if they want that.
   bool ResizeIfLoadIsOutOfRange(size_type new_size) {
+    if (IsFlat()) return FlatResizeIfLoadIsOutOfRange(new_size);
     const size_type hi_cutoff = CalculateHiCutoff(num_buckets_);
     const size_type lo_cutoff = hi_cutoff / 4;
     // We don't care how many elements are in trees.  If a lot are,
@@ -1086,14 +1376,57 @@ class KeyMapBase : public UntypedMapBase {
     return false;
   }
 
+  // Like ResizeIfLoadIsOutOfRange(), for the flat layout. Deleted slots count
+  // towards the load until the table is rehashed.
+  bool FlatResizeIfLoadIsOutOfRange(size_type new_size) {
+    const size_type max_load = FlatMaxLoad(num_buckets_);
+    if (PROTOBUF_PREDICT_FALSE(new_size + FlatNumDeleted() > max_load)) {
+      if (new_size <= max_load / 2) {
+        // Mostly deleted slots: rehash without growing.
+        Resize(num_buckets_);
+        return true;
+      }
+      if (num_buckets_ <= max_size() / 2) {
+        Resize(num_buckets_ * 2);
+        return true;
+      }
+    } else if (PROTOBUF_PREDICT_FALSE(new_size <= max_load / 4 &&
+                                      num_buckets_ > kMinFlatTableSize)) {
+      // As for the chained layout, leave room for a few inserts.
+      const size_type hypothetical_size = new_size * 5 / 4 + 1;
+      map_index_t new_num_buckets = num_buckets_;
+      while (new_num_buckets / 2 >= kMinFlatTableSize &&
+             FlatMaxLoad(new_num_buckets / 2) >= hypothetical_size) {
+        new_num_buckets /= 2;
+      }
+      if (new_num_buckets != num_buckets_) {
+        Resize(new_num_buckets);
+        return true;
+      }
+    }
+    return false;
+  }
+
   // Resize to the given number of buckets.
   void Resize(map_index_t new_num_buckets) {
     if (num_buckets_ == kGlobalEmptyTableSize) {
       // This is the global empty array.
       // Just overwrite with a new one. No need to transfer or free anything.
-      num_buckets_ = index_of_first_non_null_ = kMinTableSize;
-      table_ = CreateEmptyTable(num_buckets_);
-      seed_ = Seed();
+      if (!HasTableLayout()) {
+        seed_ |= static_cast<map_index_t>(GetDefaultMapTableLayout());
+      }
+      if (IsFlat()) {
+        num_buckets_ = index_of_first_non_null_ = kMinFlatTableSize;
+        table_ = CreateEmptyFlatTable(num_buckets_);
+      } else {
+        num_buckets_ = index_of_first_non_null_ = kMinTableSize;
+        table_ = CreateEmptyTable(num_buckets_);
+      }
+      ResetSeed();
+      return;
+    }
+    if (IsFlat()) {
+      FlatResize(new_num_buckets);
       return;
     }
 
@@ -1114,6 +1447,23 @@ class KeyMapBase : public UntypedMapBase {
     DeleteTable(old_table, old_table_size);
   }
 
+  void FlatResize(map_index_t new_num_buckets) {
+    ABSL_DCHECK_GE(new_num_buckets, kMinFlatTableSize);
+    const auto old_table = table_;
+    const map_index_t old_table_size = num_buckets_;
+    num_buckets_ = new_num_buckets;
+    table_ = CreateEmptyFlatTable(num_buckets_);
+    const map_index_t start = index_of_first_non_null_;
+    index_of_first_non_null_ = num_buckets_;
+    for (map_index_t i = start; i < old_table_size; ++i) {
+      if (!internal::TableEntryIsEmpty(old_table[i])) {
+        auto* node = static_cast<KeyNode*>(TableEntryToNode(old_table[i]));
+        FlatInsertUnique(FlatHash(TS::ToView(node->key())), node);
+      }
+    }
+    DeleteTable(old_table, FlatTableEntries(old_table_size));
+  }
+
   // Transfer all nodes in the list `node` into `this`.
   void TransferList(KeyNode* node) {
     do {
@@ -1321,6 +1671,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
  private:
   Map(Arena* arena, const Map& other) : Base(arena) {
     StaticValidityCheck();
+    if (other.HasTableLayout()) this->SetTableLayout(other.table_layout());
     insert(other.begin(), other.end());
   }
   static_assert(!std::is_const<mapped_type>::value &&
@@ -1663,6 +2014,14 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
 
   hasher hash_function() const { return {}; }
 
+  // Sets the hash table layout of this map, which must be empty. Maps that are
+  // not given a layout use the default one, see SetDefaultMapTableLayout().
+  // Copies of the map use the same layout.
+  void set_table_layout(MapTableLayout layout) {
+    this->SetTableLayout(layout);
+  }
+  MapTableLayout table_layout() const { return Base::table_layout(); }
+
   size_t SpaceUsedExcludingSelfLong() const {
     if (empty()) return 0;
     return SpaceUsedInternal() + internal::SpaceUsedInValues(this);
@@ -1757,7 +2116,7 @@ class Map : private internal::KeyMapBase<internal::KeyForBase<Key>> {
     Arena::CreateInArenaStorage(&node->kv.second, this->alloc_.arena(),
                                 std::forward<Args>(args)...);
 
-    this->InsertUnique(b, node);
+    b = this->InsertUnique(b, node);
     ++this->num_elements_;
     return std::make_pair(iterator(internal::UntypedMapIterator{node, this, b}),
                           true);
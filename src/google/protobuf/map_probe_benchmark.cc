@@ -5,6 +5,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
@@ -16,7 +17,10 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "google/protobuf/map.h"
+#include "google/protobuf/map_unittest.pb.h"
 
 namespace google::protobuf::internal {
 struct MapBenchmarkPeer {
@@ -28,6 +32,7 @@ struct MapBenchmarkPeer {
 
   template <typename T>
   static double GetMeanProbeLength(const T& map) {
+    if (map.IsFlat()) return GetMeanFlatProbeLength(map);
     double total_probe_cost = 0;
     for (map_index_t b = 0; b < map.num_buckets_; ++b) {
       if (map.TableEntryIsList(b)) {
@@ -49,6 +54,28 @@ struct MapBenchmarkPeer {
     return total_probe_cost / map.size();
   }
 
+  // The number of groups probed before the one holding the element.
+  template <typename T>
+  static double GetMeanFlatProbeLength(const T& map) {
+    double total_probe_cost = 0;
+    for (map_index_t b = 0; b < map.num_buckets_; ++b) {
+      if (map.TableEntryIsEmpty(b)) continue;
+      const auto& key = static_cast<typename T::Node*>(
+                            internal::TableEntryToNode(map.table_[b]))
+                            ->kv.first;
+      size_t cost = 0;
+      for (FlatProbeSeq seq(map.FlatHash(T::TS::ToView(key)),
+                            map.num_buckets_ - 1);
+           ((b - seq.offset()) & (map.num_buckets_ - 1)) >=
+           FlatCtrlGroup::kWidth;
+           seq.next()) {
+        ++cost;
+      }
+      total_probe_cost += static_cast<double>(cost);
+    }
+    return total_probe_cost / map.size();
+  }
+
   template <typename T>
   static double GetPercentTree(const T& map) {
     size_t total_tree_size = 0;
@@ -61,12 +88,12 @@ struct MapBenchmarkPeer {
            static_cast<double>(map.size());
   }
 };
-}  // namespace protobuf
-}  // namespace google::internal
+}  // namespace google::protobuf::internal
 
 namespace {
 
 using Peer = google::protobuf::internal::MapBenchmarkPeer;
+using google::protobuf::MapTableLayout;
 
 absl::BitGen& GlobalBitGen() {
   static auto* value = new absl::BitGen;
@@ -115,12 +142,13 @@ struct Ratios {
 };
 
 template <class ElemFn>
-Ratios CollectMeanProbeLengths() {
+Ratios CollectMeanProbeLengths(MapTableLayout layout) {
   const auto min_max_sizes = GetMinMaxLoadSizes();
 
   ElemFn elem;
   using Key = decltype(elem());
   Table<Key> t;
+  t.set_table_layout(layout);
 
   Ratios result;
   while (t.size() < min_max_sizes.min_load) t[elem()];
@@ -247,15 +275,117 @@ std::string Name() {
   return Name(static_cast<T*>(nullptr));
 }
 
+std::string Name(MapTableLayout layout) {
+  return layout == MapTableLayout::kFlat ? "flat" : "chained";
+}
+
+// Returns the mean time of one call to `op`, which performs `ops_per_call`
+// operations, in nanoseconds per operation.
+template <typename Op>
+double NanosPerOp(size_t ops_per_call, Op op) {
+  constexpr absl::Duration kMinTime = absl::Milliseconds(100);
+  size_t calls = 0;
+  const absl::Time start = absl::Now();
+  absl::Duration elapsed;
+  do {
+    op();
+    ++calls;
+    elapsed = absl::Now() - start;
+  } while (elapsed < kMinTime);
+  return absl::ToDoubleNanoseconds(elapsed) /
+         static_cast<double>(calls * std::max<size_t>(ops_per_call, 1));
+}
+
+struct Throughput {
+  double insert;
+  double lookup_hit;
+  double lookup_miss;
+  double iterate;
+};
+
+template <class ElemFn>
+Throughput CollectThroughput(MapTableLayout layout) {
+  constexpr size_t kNumKeys = 100000;
+  ElemFn elem;
+  using Key = decltype(elem());
+  // Skewed distributions repeat keys often, so the number of draws is bounded.
+  std::vector<Key> keys;
+  {
+    Table<Key> unique;
+    for (size_t i = 0; i < 20 * kNumKeys && keys.size() < 2 * kNumKeys; ++i) {
+      Key key = elem();
+      if (unique.insert({key, 0}).second) keys.push_back(key);
+    }
+  }
+  // Every other distinct key is left out of the table to measure misses.
+  std::vector<Key> missing_keys;
+  for (size_t i = 1; i < keys.size(); i += 2) {
+    missing_keys.push_back(keys[i]);
+  }
+  for (size_t i = 0; 2 * i < keys.size(); ++i) keys[i] = keys[2 * i];
+  keys.resize((keys.size() + 1) / 2);
+
+  Throughput result;
+  result.insert = NanosPerOp(keys.size(), [&] {
+    Table<Key> t;
+    t.set_table_layout(layout);
+    for (const Key& key : keys) t[key];
+  });
+
+  Table<Key> t;
+  t.set_table_layout(layout);
+  for (const Key& key : keys) t[key];
+  size_t found = 0;
+  result.lookup_hit = NanosPerOp(keys.size(), [&] {
+    for (const Key& key : keys) found += t.contains(key);
+  });
+  result.lookup_miss = NanosPerOp(missing_keys.size(), [&] {
+    for (const Key& key : missing_keys) found += t.contains(key);
+  });
+  int sum = 0;
+  result.iterate = NanosPerOp(t.size(), [&] {
+    for (const auto& entry : t) sum += entry.second;
+  });
+  // Keep the loops from being optimized away.
+  if (found + sum == 0) absl::PrintF("");
+  return result;
+}
+
+// Parsing a map field inserts every entry through the generated parser.
+double CollectParseThroughput(MapTableLayout layout) {
+  constexpr int kNumEntries = 10000;
+  protobuf_unittest::TestMap message;
+  for (int i = 0; i < kNumEntries; ++i) {
+    (*message.mutable_map_string_foreign_message())[String<false>::Make(i)]
+        .set_c(i);
+  }
+  const std::string data = message.SerializeAsString();
+  bool ok = true;
+  const double result = NanosPerOp(kNumEntries, [&] {
+    protobuf_unittest::TestMap parsed;
+    parsed.mutable_map_string_foreign_message()->set_table_layout(layout);
+    ok &= parsed.MergeFromString(data);
+  });
+  if (!ok) absl::FPrintF(stderr, "Failed to parse the map benchmark input\n");
+  return result;
+}
+
 struct Result {
   std::string name;
   std::string dist_name;
+  MapTableLayout layout;
   Ratios ratios;
+  Throughput throughput;
 };
 
 template <typename T, typename Dist>
 void RunForTypeAndDistribution(std::vector<Result>& results) {
-  results.push_back({Name<T>(), Name<Dist>(), CollectMeanProbeLengths<Dist>()});
+  for (MapTableLayout layout :
+       {MapTableLayout::kChained, MapTableLayout::kFlat}) {
+    results.push_back({Name<T>(), Name<Dist>(), layout,
+                       CollectMeanProbeLengths<Dist>(layout),
+                       CollectThroughput<Dist>(layout)});
+  }
 }
 
 template <class T>
@@ -279,25 +409,44 @@ int main(int argc, char** argv) {
   absl::PrintF("{\n");
   absl::PrintF("  \"benchmarks\": [\n");
   absl::string_view comma;
+  auto print_entry = [&](absl::string_view name, double time, double ratio) {
+    absl::PrintF("    %s{\n", comma);
+    absl::PrintF("      \"cpu_time\": %f,\n", time);
+    absl::PrintF("      \"real_time\": %f,\n", time);
+    absl::PrintF("      \"allocs_per_iter\": %f,\n", ratio);
+
+    absl::PrintF("      \"iterations\": 1,\n");
+    absl::PrintF("      \"name\": \"%s\",\n", name);
+    absl::PrintF("      \"time_unit\": \"ns\"\n");
+    absl::PrintF("    }\n");
+    comma = ",";
+  };
   for (const auto& result : results) {
+    // The chained layout keeps the historical names.
+    const std::string prefix =
+        result.layout == MapTableLayout::kChained
+            ? absl::StrCat(result.name, "/", result.dist_name, "/")
+            : absl::StrCat(result.name, "/", result.dist_name, "/",
+                           Name(result.layout), "/");
     auto print = [&](absl::string_view stat, double Ratios::*val) {
-      std::string name =
-          absl::StrCat(result.name, "/", result.dist_name, "/", stat);
-      absl::PrintF("    %s{\n", comma);
-      absl::PrintF("      \"cpu_time\": 0,\n");
-      absl::PrintF("      \"real_time\": 0,\n");
-      absl::PrintF("      \"allocs_per_iter\": %f,\n", result.ratios.*val);
-
-      absl::PrintF("      \"iterations\": 1,\n");
-      absl::PrintF("      \"name\": \"%s\",\n", name);
-      absl::PrintF("      \"time_unit\": \"ns\"\n");
-      absl::PrintF("    }\n");
-      comma = ",";
+      print_entry(absl::StrCat(prefix, stat), 0, result.ratios.*val);
     };
     print("min", &Ratios::min_load);
     print("avg", &Ratios::avg_load);
     print("max", &Ratios::max_load);
     print("tree_percent", &Ratios::percent_tree);
+    auto print_time = [&](absl::string_view op, double Throughput::*val) {
+      print_entry(absl::StrCat(prefix, op), result.throughput.*val, 0);
+    };
+    print_time("insert", &Throughput::insert);
+    print_time("lookup_hit", &Throughput::lookup_hit);
+    print_time("lookup_miss", &Throughput::lookup_miss);
+    print_time("iterate", &Throughput::iterate);
+  }
+  for (MapTableLayout layout :
+       {MapTableLayout::kChained, MapTableLayout::kFlat}) {
+    print_entry(absl::StrCat("Parse/StrL/", Name(layout)),
+                CollectParseThroughput(layout), 0);
   }
   absl::PrintF("  ],\n");
   absl::PrintF("  \"context\": {\n");
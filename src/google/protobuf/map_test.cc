@@ -10,6 +10,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -19,6 +20,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/container/flat_hash_set.h"
+#include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "google/protobuf/arena_test_util.h"
 #include "google/protobuf/internal_visibility_for_testing.h"
@@ -282,6 +284,167 @@ TEST(MapTest, IteratorNodeFieldIsNullPtrAtEnd) {
   EXPECT_EQ(internal::UntypedMapIterator::FromTyped(map.cend()).node_, nullptr);
 }
 
+// Applies the same random operations to a flat Map and to a std::map.
+template <typename Key, typename MakeKey>
+void FlatLayoutMatchesStdMap(Arena* arena, MakeKey make_key) {
+  Map<Key, int> map(arena);
+  map.set_table_layout(MapTableLayout::kFlat);
+  std::map<Key, int> expected;
+  absl::BitGen gen;
+  for (int i = 0; i < 20000; ++i) {
+    const Key key = make_key(absl::Uniform(gen, 0, 1000));
+    switch (absl::Uniform(gen, 0, 4)) {
+      case 0:
+      case 1:
+        map[key] = i;
+        expected[key] = i;
+        break;
+      case 2:
+        EXPECT_EQ(map.erase(key), expected.erase(key));
+        break;
+      case 3: {
+        auto it = map.find(key);
+        if (it != map.end()) map.erase(it);
+        expected.erase(key);
+        break;
+      }
+    }
+  }
+  EXPECT_EQ(map.table_layout(), MapTableLayout::kFlat);
+  const std::map<Key, int> contents(map.begin(), map.end());
+  EXPECT_EQ(contents, expected);
+  for (const auto& entry : expected) {
+    auto it = map.find(entry.first);
+    ASSERT_NE(it, map.end());
+    EXPECT_EQ(it->second, entry.second);
+  }
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(MapTest, FlatLayoutMatchesStdMap) {
+  FlatLayoutMatchesStdMap<int32_t>(nullptr, [](int i) { return i; });
+  FlatLayoutMatchesStdMap<std::string>(
+      nullptr, [](int i) { return absl::StrCat("key", i); });
+}
+
+TEST(MapTest, FlatLayoutMatchesStdMapOnArena) {
+  Arena arena;
+  FlatLayoutMatchesStdMap<int32_t>(&arena, [](int i) { return i; });
+  FlatLayoutMatchesStdMap<std::string>(
+      &arena, [](int i) { return absl::StrCat("key", i); });
+}
+
+TEST(MapTest, FlatLayoutEraseRevalidatesIterator) {
+  Map<int, int> map;
+  map.set_table_layout(MapTableLayout::kFlat);
+  map[0] = 0;
+  auto it = map.find(0);
+  // Grow the table a few times, moving the element to another slot.
+  for (int i = 1; i < 1000; ++i) map[i] = i;
+  EXPECT_EQ(&it->second, &map[0]);
+  map.erase(it);
+  EXPECT_FALSE(map.contains(0));
+  EXPECT_EQ(map.size(), 999);
+}
+
+TEST(MapTest, FlatLayoutReusesDeletedSlots) {
+  Map<int, int> map;
+  map.set_table_layout(MapTableLayout::kFlat);
+  for (int i = 0; i < 100000; ++i) {
+    map[i] = i;
+    if (i >= 10) map.erase(i - 10);
+  }
+  EXPECT_EQ(map.size(), 10);
+  EXPECT_LE(MapTestPeer::NumBuckets(map), 32);
+}
+
+TEST(MapTest, FlatLayoutShrinks) {
+  Map<int, int> map;
+  map.set_table_layout(MapTableLayout::kFlat);
+  for (int i = 0; i < 10000; ++i) map[i] = i;
+  const size_t large = MapTestPeer::NumBuckets(map);
+  for (int i = 0; i < 9990; ++i) map.erase(i);
+  map[-1] = -1;
+  EXPECT_LT(MapTestPeer::NumBuckets(map), large / 100);
+  EXPECT_EQ(map.size(), 11);
+}
+
+TEST(MapTest, TableLayoutIsKeptByCopyAndSwap) {
+  Map<int, int> flat;
+  flat.set_table_layout(MapTableLayout::kFlat);
+  flat[1] = 1;
+  Map<int, int> chained;
+  chained.set_table_layout(MapTableLayout::kChained);
+  chained[2] = 2;
+
+  Map<int, int> copy(flat);
+  EXPECT_EQ(copy.table_layout(), MapTableLayout::kFlat);
+  EXPECT_THAT(copy, UnorderedElementsAre(Pair(1, 1)));
+
+  flat.swap(chained);
+  EXPECT_EQ(flat.table_layout(), MapTableLayout::kChained);
+  EXPECT_EQ(chained.table_layout(), MapTableLayout::kFlat);
+  EXPECT_THAT(flat, UnorderedElementsAre(Pair(2, 2)));
+  EXPECT_THAT(chained, UnorderedElementsAre(Pair(1, 1)));
+}
+
+TEST(MapTest, SetTableLayoutAfterClear) {
+  Map<int, int> map;
+  for (int i = 0; i < 100; ++i) map[i] = i;
+  map.clear();
+  map.set_table_layout(MapTableLayout::kFlat);
+  for (int i = 0; i < 100; ++i) map[i] = i;
+  EXPECT_EQ(map.table_layout(), MapTableLayout::kFlat);
+  EXPECT_EQ(map.size(), 100);
+}
+
+#if GTEST_HAS_DEATH_TEST
+TEST(MapTest, SetTableLayoutOfNonEmptyMapDeathTest) {
+  Map<int, int> map;
+  map[1] = 1;
+  EXPECT_DEATH(map.set_table_layout(MapTableLayout::kFlat), "non-empty");
+}
+#endif  // GTEST_HAS_DEATH_TEST
+
+TEST(MapTest, DefaultTableLayout) {
+  EXPECT_EQ(GetDefaultMapTableLayout(), MapTableLayout::kChained);
+  SetDefaultMapTableLayout(MapTableLayout::kFlat);
+  Map<int, int> map;
+  map[1] = 1;
+  Map<int, int> chained;
+  chained.set_table_layout(MapTableLayout::kChained);
+  chained[1] = 1;
+  SetDefaultMapTableLayout(MapTableLayout::kChained);
+  EXPECT_EQ(map.table_layout(), MapTableLayout::kFlat);
+  EXPECT_EQ(chained.table_layout(), MapTableLayout::kChained);
+}
+
+TEST(MapTest, ParseIntoFlatLayout) {
+  UNITTEST::TestMap source;
+  MapTestUtil::SetMapFields(&source);
+  for (int i = 0; i < 1000; ++i) {
+    (*source.mutable_map_string_foreign_message())[absl::StrCat(i)].set_c(i);
+  }
+  const std::string data = source.SerializeAsString();
+
+  UNITTEST::TestMap message;
+  message.mutable_map_int32_int32()->set_table_layout(MapTableLayout::kFlat);
+  message.mutable_map_string_foreign_message()->set_table_layout(
+      MapTableLayout::kFlat);
+  ASSERT_TRUE(message.ParseFromString(data));
+  EXPECT_EQ(message.map_int32_int32().table_layout(), MapTableLayout::kFlat);
+  EXPECT_EQ(message.map_string_foreign_message().table_layout(),
+            MapTableLayout::kFlat);
+  EXPECT_EQ(message.map_string_foreign_message().at("999").c(), 999);
+  MapTestUtil::ExpectMapFieldsSet(message);
+  // Parsing again replaces the values of existing keys in place.
+  ASSERT_TRUE(message.MergeFromString(data));
+  EXPECT_EQ(message.map_string_foreign_message_size(),
+            source.map_string_foreign_message_size());
+}
+
 template <typename Aligned, bool on_arena = false>
 void MapTest_Aligned() {
   Arena arena;
@@ -176,7 +176,9 @@ class SudoMapReflectionFriend;
 }
 
 namespace internal {
-class MapFieldPrinterHelper;  // text_format.cc
+class MapFieldPrinterHelper;   // text_format.cc
+class FastPrinterFieldReader;  // text_format.cc
+class TextParserFieldWriter;   // text_format.cc
 PROTOBUF_EXPORT std::string StringifyMessage(
     const Message& message);  // text_format.cc
 }  // namespace internal
@@ -1117,6 +1119,10 @@ class PROTOBUF_EXPORT Reflection final {
   friend struct internal::FuzzPeer;
   // Needed for implementing text format for map.
   friend class internal::MapFieldPrinterHelper;
+  // Needed for the fast path of TextFormat::Printer.
+  friend class internal::FastPrinterFieldReader;
+  // Needed for TextFormat::Parser to write fields directly.
+  friend class internal::TextParserFieldWriter;
 
   Reflection(const Descriptor* descriptor,
              const internal::ReflectionSchema& schema,
@@ -33,6 +33,7 @@
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "google/protobuf/arena.h"
+#include "google/protobuf/generated_message_tctable_filter.h"
 #include "google/protobuf/generated_message_tctable_impl.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
@@ -332,6 +333,43 @@ bool MessageLite::MergeFromImpl(io::CodedInputStream* input,
   return CheckFieldPresence(ctx, *this, parse_flags);
 }
 
+namespace internal {
+
+bool MergeFilteredFrom(absl::string_view input, MessageLite* msg,
+                       const ParseFieldFilter& filter) {
+  const char* ptr;
+  ParseContext ctx(io::CodedInputStream::GetDefaultRecursionLimit(), false,
+                   &ptr, input);
+  ptr = TcParser::ParseFiltered(msg, ptr, &ctx, filter);
+  // ctx has an explicit limit set (length of string_view).
+  return ptr != nullptr && ctx.EndedAtLimit();
+}
+
+bool MergeFilteredFrom(io::CodedInputStream* input, MessageLite* msg,
+                       const ParseFieldFilter& filter) {
+  // Like MessageLite::MergeFromImpl() above.
+  ZeroCopyCodedInputStream zcis(input);
+  const char* ptr;
+  ParseContext ctx(input->RecursionBudget(), zcis.aliasing_enabled(), &ptr,
+                   &zcis);
+  ctx.TrackCorrectEnding();
+  ctx.data().pool = input->GetExtensionPool();
+  ctx.data().factory = input->GetExtensionFactory();
+  ptr = TcParser::ParseFiltered(msg, ptr, &ctx, filter);
+  if (PROTOBUF_PREDICT_FALSE(!ptr)) return false;
+  ctx.BackUp(ptr);
+  if (!ctx.EndedAtEndOfStream()) {
+    ABSL_DCHECK_NE(ctx.LastTag(), 1u);  // We can't end on a pushed limit.
+    if (ctx.IsExceedingLimit(ptr)) return false;
+    input->SetLastTag(ctx.LastTag());
+  } else {
+    input->SetConsumed();
+  }
+  return true;
+}
+
+}  // namespace internal
+
 bool MessageLite::MergePartialFromCodedStream(io::CodedInputStream* input) {
   return MergeFromImpl(input, kMergePartial);
 }
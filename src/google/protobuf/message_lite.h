@@ -956,7 +956,10 @@ class PROTOBUF_EXPORT MessageLite {
     // Default:  when merging, pointer is followed and expanded (deep-copy).
     // Aliasing: when merging, the destination message is allowed to retain
     //           pointers to the original structure (shallow-copy). This mostly
-    //           is intended for use with STRING_PIECE.
+    //           is intended for use with STRING_PIECE, and singular
+    //           `string_view` fields of messages on an arena, which then
+    //           reference the input until they are mutated. The input must
+    //           outlive the destination message.
     // NOTE: STRING_PIECE is not recommended for new usage. Prefer Cords.
     kMergeWithAliasing = 4,
     kParseWithAliasing = 5,
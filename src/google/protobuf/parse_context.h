@@ -37,6 +37,7 @@
 #include "google/protobuf/port.h"
 #include "google/protobuf/repeated_field.h"
 #include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/varint_shuffle.h"
 #include "google/protobuf/wire_format_lite.h"
 
 
@@ -208,6 +209,12 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   PROTOBUF_NODISCARD const char* ReadArenaString(const char* ptr,
                                                  ArenaStringPtr* s,
                                                  Arena* arena);
+  // Like ReadArenaString, but makes `s` an aliased view of the input instead
+  // of copying it when aliasing is enabled and the string is contiguous in the
+  // input buffer.
+  PROTOBUF_NODISCARD const char* ReadAliasedArenaString(const char* ptr,
+                                                        ArenaStringPtr* s,
+                                                        Arena* arena);
 
   PROTOBUF_NODISCARD const char* ReadCord(const char* ptr, int size,
                                           ::absl::Cord* cord) {
@@ -234,6 +241,12 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   template <typename Add, typename SizeCb>
   PROTOBUF_NODISCARD const char* ReadPackedVarint(const char* ptr, Add add,
                                                   SizeCb size_callback);
+  // Reads a packed varint array directly into `out`, decoding whole blocks of
+  // varints at a time. Equivalent to `ReadPackedVarint` with a callback that
+  // appends each (optionally zigzag decoded) value to `out`.
+  template <typename T, bool zigzag = false>
+  PROTOBUF_NODISCARD const char* ReadPackedVarintToField(const char* ptr,
+                                                         RepeatedField<T>* out);
 
   uint32_t LastTag() const { return last_tag_minus_1_ + 1; }
   bool ConsumeEndGroup(uint32_t start_tag) {
@@ -317,6 +330,14 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   }
 
  private:
+  // Drives `read_array(ptr, end)` over a packed varint array of `size` bytes,
+  // flipping buffers as needed. `read_array` must consume every varint that
+  // starts before `end` and return a pointer past the last one, or nullptr.
+  template <typename ReadArray>
+  PROTOBUF_NODISCARD const char* ReadPackedVarintChunks(const char* ptr,
+                                                        int size,
+                                                        ReadArray read_array);
+
   enum { kSlopBytes = 16, kPatchBufferSize = 32 };
   static_assert(kPatchBufferSize >= kSlopBytes * 2,
                 "Patch buffer needs to be at least large enough to hold all "
@@ -351,6 +372,23 @@ class PROTOBUF_EXPORT EpsCopyInputStream {
   // systems. TODO do we need to set this as build flag?
   enum { kSafeStringSize = 50000000 };
 
+  // Returns the address in the caller's input of the `size` bytes at `ptr`, or
+  // nullptr if aliasing is disabled or the bytes were copied into the patch
+  // buffer from more than one chunk.
+  const char* AliasedData(const char* ptr, int size) const {
+    if (size > BytesAvailable(ptr)) return nullptr;
+    if (aliasing_ == kNoDelta) {
+      // The current buffer is the input chunk itself, slop bytes included.
+      return ptr;
+    }
+    if (aliasing_ > kNoDelta && ptr + size <= buffer_end_) {
+      // The patch buffer holds a copy of the tail of the input.
+      return reinterpret_cast<const char*>(
+          reinterpret_cast<std::uintptr_t>(ptr) + aliasing_);
+    }
+    return nullptr;
+  }
+
   int BytesAvailable(const char* ptr) const {
     ABSL_DCHECK_NE(ptr, nullptr);
     ptrdiff_t available = buffer_end_ + kSlopBytes - ptr;
@@ -1225,16 +1263,28 @@ const char* ReadPackedVarintArray(const char* ptr, const char* end, Add add) {
   return ptr;
 }
 
-template <typename Add, typename SizeCb>
-const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
-                                                 SizeCb size_callback) {
-  int size = ReadSize(&ptr);
-  size_callback(size);
+template <typename T, bool zigzag>
+const char* ReadPackedVarintArrayToField(const char* ptr, const char* end,
+                                         RepeatedField<T>* out) {
+  // The last varint may straddle `end`, hence the extra element.
+  int capacity = CountVarintTerminators(ptr, end) + 1;
+  int old_entries = out->size();
+  out->Reserve(old_entries + capacity);
+  T* dst = out->AddNAlreadyReserved(capacity);
+  int count;
+  ptr = DecodePackedVarints<T, zigzag>(ptr, end, dst, count);
+  ABSL_DCHECK_LE(count, capacity);
+  out->Truncate(old_entries + count);
+  return ptr;
+}
 
-  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+template <typename ReadArray>
+const char* EpsCopyInputStream::ReadPackedVarintChunks(const char* ptr,
+                                                       int size,
+                                                       ReadArray read_array) {
   int chunk_size = static_cast<int>(buffer_end_ - ptr);
   while (size > chunk_size) {
-    ptr = ReadPackedVarintArray(ptr, buffer_end_, add);
+    ptr = read_array(ptr, buffer_end_);
     if (ptr == nullptr) return nullptr;
     int overrun = static_cast<int>(ptr - buffer_end_);
     ABSL_DCHECK(overrun >= 0 && overrun <= kSlopBytes);
@@ -1246,7 +1296,7 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
       std::memcpy(buf, buffer_end_, kSlopBytes);
       ABSL_CHECK_LE(size - chunk_size, kSlopBytes);
       auto end = buf + (size - chunk_size);
-      auto res = ReadPackedVarintArray(buf + overrun, end, add);
+      auto res = read_array(buf + overrun, end);
       if (res == nullptr || res != end) return nullptr;
       return buffer_end_ + (res - buf);
     }
@@ -1260,10 +1310,34 @@ const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
     chunk_size = static_cast<int>(buffer_end_ - ptr);
   }
   auto end = ptr + size;
-  ptr = ReadPackedVarintArray(ptr, end, add);
+  ptr = read_array(ptr, end);
   return end == ptr ? ptr : nullptr;
 }
 
+template <typename Add, typename SizeCb>
+const char* EpsCopyInputStream::ReadPackedVarint(const char* ptr, Add add,
+                                                 SizeCb size_callback) {
+  int size = ReadSize(&ptr);
+  size_callback(size);
+
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ReadPackedVarintChunks(
+      ptr, size, [&add](const char* p, const char* end) {
+        return ReadPackedVarintArray(p, end, add);
+      });
+}
+
+template <typename T, bool zigzag>
+const char* EpsCopyInputStream::ReadPackedVarintToField(const char* ptr,
+                                                        RepeatedField<T>* out) {
+  int size = ReadSize(&ptr);
+  GOOGLE_PROTOBUF_PARSER_ASSERT(ptr);
+  return ReadPackedVarintChunks(
+      ptr, size, [out](const char* p, const char* end) {
+        return ReadPackedVarintArrayToField<T, zigzag>(p, end, out);
+      });
+}
+
 // Helper for verification of utf8
 PROTOBUF_EXPORT
 bool VerifyUTF8(absl::string_view s, const char* field_name);
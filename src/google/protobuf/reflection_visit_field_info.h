@@ -122,7 +122,7 @@ struct DynamicFieldInfoHelper {
     ABSL_DCHECK(!is_oneof || reflection->HasOneofField(message, field));
     auto str = Get<ArenaStringPtr>(reflection, message, field);
     ABSL_DCHECK(!str.IsDefault());
-    return str.Get();
+    return str.GetView();
   }
 };
 
@@ -1,14 +1,20 @@
+#include <algorithm>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 // clang-format off
 #include "absl/strings/string_view.h"
 // clang-format on
+#include "google/protobuf/arena.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/message_lite.h"
+#include "google/protobuf/reflection_visit_fields.h"
 #include "google/protobuf/text_format.h"
 #include "google/protobuf/unittest_string_view.pb.h"
 
@@ -311,6 +317,164 @@ TEST(StringViewFieldTest, RepeatedSetAndGetByReflection) {
               StrEq("222222222222"));
 }
 
+bool IsWithin(absl::string_view inner, absl::string_view outer) {
+  return inner.data() >= outer.data() &&
+         inner.data() + inner.size() <= outer.data() + outer.size();
+}
+
+std::string SerializedTestStringView() {
+  TestStringView message;
+  message.set_singular_string(STRING_PAYLOAD);
+  message.set_singular_bytes("\x01\x02\x03");
+  message.add_repeated_string("foo");
+  return message.SerializeAsString();
+}
+
+TEST(StringViewFieldTest, ParseWithAliasingOnArenaAliasesInput) {
+  const std::string data = SerializedTestStringView();
+  Arena arena;
+  auto* message = Arena::Create<TestStringView>(&arena);
+
+  ASSERT_TRUE(message->ParseFrom<MessageLite::kParseWithAliasing>(data));
+
+  EXPECT_THAT(message->singular_string(), StrEq(STRING_PAYLOAD));
+  EXPECT_THAT(message->singular_bytes(), StrEq("\x01\x02\x03"));
+  EXPECT_TRUE(IsWithin(message->singular_string(), data));
+  EXPECT_TRUE(IsWithin(message->singular_bytes(), data));
+  // Repeated fields are always copied.
+  EXPECT_FALSE(IsWithin(message->repeated_string(0), data));
+  EXPECT_EQ(message->SerializeAsString(), data);
+}
+
+TEST(StringViewFieldTest, ParseWithoutAliasingCopies) {
+  const std::string data = SerializedTestStringView();
+  Arena arena;
+  auto* message = Arena::Create<TestStringView>(&arena);
+  TestStringView heap_message;
+
+  ASSERT_TRUE(message->ParseFromString(data));
+  ASSERT_TRUE(heap_message.ParseFrom<MessageLite::kParseWithAliasing>(data));
+
+  EXPECT_FALSE(IsWithin(message->singular_string(), data));
+  // Messages not on an arena never alias their input.
+  EXPECT_FALSE(IsWithin(heap_message.singular_string(), data));
+  EXPECT_THAT(heap_message.singular_string(), StrEq(STRING_PAYLOAD));
+}
+
+TEST(StringViewFieldTest, AliasedFieldIsCopiedOnMutation) {
+  std::string data = SerializedTestStringView();
+  Arena arena;
+  auto* message = Arena::Create<TestStringView>(&arena);
+  ASSERT_TRUE(message->ParseFrom<MessageLite::kParseWithAliasing>(data));
+
+  TestStringView copy(*message);
+  auto* arena_copy = Arena::Create<TestStringView>(&arena, *message);
+  TestStringView merged;
+  merged.MergeFrom(*message);
+
+  message->set_singular_bytes("bytes");
+  EXPECT_THAT(message->singular_bytes(), StrEq("bytes"));
+  EXPECT_FALSE(IsWithin(message->singular_bytes(), data));
+
+  // Copies own their values: changing the input only affects the aliased
+  // field that is left.
+  std::fill(data.begin(), data.end(), 'x');
+  EXPECT_THAT(message->singular_string(), StrEq(std::string(30, 'x')));
+  EXPECT_THAT(copy.singular_string(), StrEq(STRING_PAYLOAD));
+  EXPECT_THAT(arena_copy->singular_string(), StrEq(STRING_PAYLOAD));
+  EXPECT_THAT(merged.singular_string(), StrEq(STRING_PAYLOAD));
+  EXPECT_THAT(merged.singular_bytes(), StrEq("\x01\x02\x03"));
+
+  message->clear_singular_string();
+  EXPECT_FALSE(message->has_singular_string());
+  EXPECT_THAT(message->singular_string(), StrEq(""));
+}
+
+TEST(StringViewFieldTest, AliasedFieldByReflection) {
+  const std::string data = SerializedTestStringView();
+  Arena arena;
+  auto* message = Arena::Create<TestStringView>(&arena);
+  ASSERT_TRUE(message->ParseFrom<MessageLite::kParseWithAliasing>(data));
+
+  const Reflection* reflection = message->GetReflection();
+  const FieldDescriptor* field =
+      message->GetDescriptor()->FindFieldByName("singular_string");
+
+  EXPECT_THAT(reflection->GetString(*message, field), StrEq(STRING_PAYLOAD));
+  std::string scratch;
+  EXPECT_THAT(reflection->GetStringReference(*message, field, &scratch),
+              StrEq(STRING_PAYLOAD));
+  Reflection::ScratchSpace scratch_space;
+  absl::string_view view =
+      reflection->GetStringView(*message, field, scratch_space);
+  EXPECT_THAT(view, StrEq(STRING_PAYLOAD));
+  EXPECT_TRUE(IsWithin(view, data));
+  EXPECT_GT(message->SpaceUsedLong(), sizeof(TestStringView));
+
+  TestStringView heap_message;
+  heap_message.set_singular_bytes("heap");
+  reflection->Swap(message, &heap_message);
+  EXPECT_THAT(heap_message.singular_string(), StrEq(STRING_PAYLOAD));
+  EXPECT_FALSE(IsWithin(heap_message.singular_string(), data));
+  EXPECT_THAT(message->singular_bytes(), StrEq("heap"));
+
+  reflection->SetString(&heap_message, field, std::string("set"));
+  EXPECT_THAT(heap_message.singular_string(), StrEq("set"));
+}
+
+#ifdef __cpp_if_constexpr
+TEST(StringViewFieldTest, VisitAliasedFields) {
+  const std::string data = SerializedTestStringView();
+  Arena arena;
+  auto* message = Arena::Create<TestStringView>(&arena);
+  ASSERT_TRUE(message->ParseFrom<MessageLite::kParseWithAliasing>(data));
+
+  std::vector<absl::string_view> views;
+  internal::VisitFields(*message, [&](auto info) {
+    if constexpr (info.cpp_type == FieldDescriptor::CPPTYPE_STRING &&
+                  !info.is_repeated && !info.is_map) {
+      views.push_back(info.Get());
+    }
+  });
+
+  EXPECT_THAT(views, testing::UnorderedElementsAre(STRING_PAYLOAD,
+                                                  "\x01\x02\x03"));
+  for (absl::string_view view : views) {
+    EXPECT_TRUE(IsWithin(view, data));
+  }
+}
+#endif  // __cpp_if_constexpr
+
+TEST(StringViewFieldTest, ParseWithAliasingFromChunkedStream) {
+  TestStringView expected;
+  for (int i = 0; i < 20; ++i) {
+    expected.set_singular_string(std::string(i * 11, 'a' + i));
+    expected.set_singular_bytes(std::string(i * 7, 'A' + i));
+  }
+  std::string data;
+  for (int i = 0; i < 20; ++i) {
+    TestStringView part;
+    part.set_singular_string(std::string(i * 11, 'a' + i));
+    part.set_singular_bytes(std::string(i * 7, 'A' + i));
+    data += part.SerializeAsString();
+  }
+
+  for (int block_size : {1, 5, 32, 100, 4096}) {
+    Arena arena;
+    auto* message = Arena::Create<TestStringView>(&arena);
+    io::ArrayInputStream array_input(
+        data.data(), static_cast<int>(data.size()), block_size);
+    io::ZeroCopyInputStream* input = &array_input;
+    ASSERT_TRUE(message->ParseFrom<MessageLite::kParseWithAliasing>(input))
+        << block_size;
+    EXPECT_THAT(message->singular_string(), StrEq(expected.singular_string()));
+    EXPECT_THAT(message->singular_bytes(), StrEq(expected.singular_bytes()));
+    if (block_size >= static_cast<int>(data.size())) {
+      EXPECT_TRUE(IsWithin(message->singular_string(), data));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace protobuf
 }  // namespace google
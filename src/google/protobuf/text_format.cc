@@ -22,10 +22,12 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "absl/container/btree_set.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/absl_check.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/cord.h"
@@ -36,10 +38,16 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/types/optional.h"
 #include "google/protobuf/any.h"
+#include "google/protobuf/arenastring.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/descriptor.pb.h"
 #include "google/protobuf/dynamic_message.h"
+#include "google/protobuf/extension_set.h"
+#include "google/protobuf/generated_message_reflection.h"
+#include "google/protobuf/inlined_string_field.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/strtod.h"
 #include "google/protobuf/io/tokenizer.h"
@@ -49,6 +57,7 @@
 #include "google/protobuf/message.h"
 #include "google/protobuf/reflection_mode.h"
 #include "google/protobuf/repeated_field.h"
+#include "google/protobuf/repeated_ptr_field.h"
 #include "google/protobuf/unknown_field_set.h"
 #include "google/protobuf/wire_format_lite.h"
 #include "utf8_validity.h"
@@ -315,6 +324,177 @@ auto TextFormat::Parser::UnsetFieldsMetadata::GetUnsetFieldId(
   return {&message, &fd};
 }
 
+namespace internal {
+// Writes the values the parser reads straight into the message layout, as
+// WireFormat does, instead of through the Reflection setters and their
+// per-call type checks.  Strings and submessages are created on the
+// message's arena.  Extensions, cords, inlined strings and lazy and map
+// fields still go through Reflection.
+class TextParserFieldWriter {
+ public:
+  // Each of these sets a singular field, or appends to a repeated one.
+#define PROTOBUF_DEFINE_SETTER(NAME, TYPE)                              \
+  static void Set##NAME(Message* message, const Reflection* reflection, \
+                        const FieldDescriptor* field, TYPE value) {     \
+    Set<TYPE>(message, reflection, field, value);                       \
+  }
+  PROTOBUF_DEFINE_SETTER(Int32, int32_t)
+  PROTOBUF_DEFINE_SETTER(Int64, int64_t)
+  PROTOBUF_DEFINE_SETTER(UInt32, uint32_t)
+  PROTOBUF_DEFINE_SETTER(UInt64, uint64_t)
+  PROTOBUF_DEFINE_SETTER(Float, float)
+  PROTOBUF_DEFINE_SETTER(Double, double)
+  PROTOBUF_DEFINE_SETTER(Bool, bool)
+#undef PROTOBUF_DEFINE_SETTER
+  static void SetEnumValue(Message* message, const Reflection* reflection,
+                           const FieldDescriptor* field, int value);
+  static void SetEnum(Message* message, const Reflection* reflection,
+                      const FieldDescriptor* field,
+                      const EnumValueDescriptor* value) {
+    SetEnumValue(message, reflection, field, value->number());
+  }
+  static void SetString(Message* message, const Reflection* reflection,
+                        const FieldDescriptor* field, std::string value);
+
+  // Returns the submessage of a singular field, creating it if needed, or a
+  // new element of a repeated one.  A non-null `factory` is used to create
+  // the submessage, as for Reflection::MutableMessage().
+  static Message* MutableMessage(Message* message,
+                                 const Reflection* reflection,
+                                 const FieldDescriptor* field,
+                                 MessageFactory* factory);
+
+ private:
+  // `T` is the field's C++ type.  Enums use SetEnumValue() instead, as their
+  // C++ type is also int.
+  template <typename T>
+  static void Set(Message* message, const Reflection* reflection,
+                  const FieldDescriptor* field, T value);
+
+  // Marks a singular field as set, clearing the other field of its oneof.
+  // Returns true if the oneof case changed.
+  static bool SetPresent(Message* message, const Reflection* reflection,
+                         const FieldDescriptor* field) {
+    if (!reflection->schema_.InRealOneof(field)) {
+      reflection->SetHasBit(message, field);
+      return false;
+    }
+    if (reflection->HasOneofField(*message, field)) return false;
+    const OneofDescriptor* oneof = field->containing_oneof();
+    reflection->ClearOneof(message, oneof);
+    *GetPointerAtOffset<uint32_t>(
+        message, reflection->schema_.GetOneofCaseOffset(oneof)) =
+        field->number();
+    return true;
+  }
+};
+
+template <typename T>
+void TextParserFieldWriter::Set(Message* message, const Reflection* reflection,
+                                const FieldDescriptor* field, T value) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension())) {
+#define PROTOBUF_SET_EXTENSION(TYPE, METHOD)          \
+  if constexpr (std::is_same_v<T, TYPE>) {            \
+    if (field->is_repeated()) {                       \
+      reflection->Add##METHOD(message, field, value); \
+    } else {                                          \
+      reflection->Set##METHOD(message, field, value); \
+    }                                                 \
+    return;                                           \
+  }
+    PROTOBUF_SET_EXTENSION(int32_t, Int32)
+    PROTOBUF_SET_EXTENSION(int64_t, Int64)
+    PROTOBUF_SET_EXTENSION(uint32_t, UInt32)
+    PROTOBUF_SET_EXTENSION(uint64_t, UInt64)
+    PROTOBUF_SET_EXTENSION(float, Float)
+    PROTOBUF_SET_EXTENSION(double, Double)
+    PROTOBUF_SET_EXTENSION(bool, Bool)
+#undef PROTOBUF_SET_EXTENSION
+  }
+  if (field->is_repeated()) {
+    reflection->MutableRaw<RepeatedField<T>>(message, field)->Add(value);
+    return;
+  }
+  SetPresent(message, reflection, field);
+  *reflection->MutableRaw<T>(message, field) = value;
+}
+
+void TextParserFieldWriter::SetEnumValue(Message* message,
+                                         const Reflection* reflection,
+                                         const FieldDescriptor* field,
+                                         int value) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension())) {
+    if (field->is_repeated()) {
+      reflection->AddEnumValue(message, field, value);
+    } else {
+      reflection->SetEnumValue(message, field, value);
+    }
+    return;
+  }
+  // The parser only passes known values of closed enums, so unlike
+  // Reflection::SetEnumValue() there is no unknown value to divert.
+  if (field->is_repeated()) {
+    reflection->MutableRaw<RepeatedField<int>>(message, field)->Add(value);
+    return;
+  }
+  SetPresent(message, reflection, field);
+  *reflection->MutableRaw<int>(message, field) = value;
+}
+
+void TextParserFieldWriter::SetString(Message* message,
+                                      const Reflection* reflection,
+                                      const FieldDescriptor* field,
+                                      std::string value) {
+  if (PROTOBUF_PREDICT_FALSE(
+          field->is_extension() ||
+          field->cpp_string_type() == FieldDescriptor::CppStringType::kCord ||
+          (!field->is_repeated() && reflection->IsInlined(field)))) {
+    if (field->is_repeated()) {
+      reflection->AddString(message, field, std::move(value));
+    } else {
+      reflection->SetString(message, field, std::move(value));
+    }
+    return;
+  }
+  if (field->is_repeated()) {
+    reflection->MutableRaw<RepeatedPtrField<std::string>>(message, field)
+        ->Add(std::move(value));
+    return;
+  }
+  ArenaStringPtr* str = reflection->MutableRaw<ArenaStringPtr>(message, field);
+  // A oneof string that was not set holds another field's value.
+  if (SetPresent(message, reflection, field)) str->InitDefault();
+  str->Set(std::move(value), message->GetArena());
+}
+
+Message* TextParserFieldWriter::MutableMessage(Message* message,
+                                               const Reflection* reflection,
+                                               const FieldDescriptor* field,
+                                               MessageFactory* factory) {
+  if (PROTOBUF_PREDICT_FALSE(factory != nullptr || field->is_extension() ||
+                             field->is_map() ||
+                             reflection->IsLazyField(field))) {
+    return field->is_repeated()
+               ? reflection->AddMessage(message, field, factory)
+               : reflection->MutableMessage(message, field, factory);
+  }
+  // Unlike Reflection::AddMessage(), this finds the prototype without a
+  // MessageFactory lookup.
+  const Message* prototype = reflection->GetDefaultMessageInstance(field);
+  if (field->is_repeated()) {
+    return DownCastMessage<Message>(
+        reflection->MutableRaw<RepeatedPtrFieldBase>(message, field)
+            ->AddMessage(prototype));
+  }
+  Message** holder = reflection->MutableRaw<Message*>(message, field);
+  // A oneof message that was not set holds another field's value.
+  if (SetPresent(message, reflection, field) || *holder == nullptr) {
+    *holder = prototype->New(message->GetArena());
+  }
+  return *holder;
+}
+}  // namespace internal
+
 // ===========================================================================
 // Internal class for parsing an ASCII representation of a Protocol Message.
 // This class makes use of the Protocol Message compiler's tokenizer found
@@ -480,7 +660,7 @@ class TextFormat::Parser::ParserImpl {
   // Consumes the specified message with the given starting delimiter.
   // This method checks to see that the end delimiter at the conclusion of
   // the consumption matches the starting delimiter passed in here.
-  bool ConsumeMessage(Message* message, const std::string delimiter) {
+  bool ConsumeMessage(Message* message, absl::string_view delimiter) {
     while (!LookingAt(">") && !LookingAt("}")) {
       DO(ConsumeField(message));
     }
@@ -595,21 +775,7 @@ class TextFormat::Parser::ParserImpl {
           field = descriptor->FindFieldByNumber(field_number);
         }
       } else {
-        field = descriptor->FindFieldByName(field_name);
-        // Group-like delimited fields will accept both the capitalized type
-        // names as well.
-        if (field == nullptr) {
-          std::string lower_field_name = field_name;
-          absl::AsciiStrToLower(&lower_field_name);
-          field = descriptor->FindFieldByName(lower_field_name);
-          // If the case-insensitive match worked but the field is NOT a group,
-          if (field != nullptr && !internal::cpp::IsGroupLike(*field)) {
-            field = nullptr;
-          }
-          if (field != nullptr && field->message_type()->name() != field_name) {
-            field = nullptr;
-          }
-        }
+        field = FindFieldByName(descriptor, field_name);
 
         if (field == nullptr && allow_case_insensitive_field_) {
           std::string lower_field_name = field_name;
@@ -749,6 +915,53 @@ class TextFormat::Parser::ParserImpl {
     return true;
   }
 
+  // Looks up a field by its name, or by its type name if it is group-like.
+  // Messages are looked up through a table of these names once they have had
+  // as many lookups as they have fields, which pays for building the table.
+  const FieldDescriptor* FindFieldByName(const Descriptor* descriptor,
+                                         absl::string_view name) {
+    FieldNameTable& table = field_name_tables_[descriptor];
+    if (table.lookups <= descriptor->field_count()) {
+      if (++table.lookups <= descriptor->field_count()) {
+        return FindFieldByNameUncached(descriptor, name);
+      }
+      table.fields.reserve(descriptor->field_count());
+      for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor* field = descriptor->field(i);
+        table.fields.emplace(field->name(), field);
+      }
+      // Field names take precedence over type names.
+      for (int i = 0; i < descriptor->field_count(); ++i) {
+        const FieldDescriptor* field = descriptor->field(i);
+        if (internal::cpp::IsGroupLike(*field)) {
+          table.fields.emplace(field->message_type()->name(), field);
+        }
+      }
+    }
+    auto it = table.fields.find(name);
+    return it == table.fields.end() ? nullptr : it->second;
+  }
+
+  static const FieldDescriptor* FindFieldByNameUncached(
+      const Descriptor* descriptor, absl::string_view name) {
+    const FieldDescriptor* field = descriptor->FindFieldByName(name);
+    // Group-like delimited fields will accept both the capitalized type
+    // names as well.
+    if (field == nullptr) {
+      std::string lower_field_name(name);
+      absl::AsciiStrToLower(&lower_field_name);
+      field = descriptor->FindFieldByName(lower_field_name);
+      // If the case-insensitive match worked but the field is NOT a group,
+      if (field != nullptr && !internal::cpp::IsGroupLike(*field)) {
+        field = nullptr;
+      }
+      if (field != nullptr && field->message_type()->name() != name) {
+        field = nullptr;
+      }
+    }
+    return field;
+  }
+
   // Skips the next field including the field's name and value.
   bool SkipField() {
     std::string field_name;
@@ -803,13 +1016,9 @@ class TextFormat::Parser::ParserImpl {
     DO(ConsumeMessageDelimiter(&delimiter));
     MessageFactory* factory =
         finder_ ? finder_->FindExtensionFactory(field) : nullptr;
-    if (field->is_repeated()) {
-      DO(ConsumeMessage(reflection->AddMessage(message, field, factory),
-                        delimiter));
-    } else {
-      DO(ConsumeMessage(reflection->MutableMessage(message, field, factory),
-                        delimiter));
-    }
+    DO(ConsumeMessage(internal::TextParserFieldWriter::MutableMessage(
+                          message, reflection, field, factory),
+                      delimiter));
 
     ++recursion_limit_;
 
@@ -842,26 +1051,28 @@ class TextFormat::Parser::ParserImpl {
 
   bool ConsumeFieldValue(Message* message, const Reflection* reflection,
                          const FieldDescriptor* field) {
-// Define an easy to use macro for setting fields. This macro checks
-// to see if the field is repeated (in which case we need to use the Add
-// methods or not (in which case we need to use the Set methods).
+// Define an easy to use macro for setting fields. Values are written through
+// TextParserFieldWriter, which appends to repeated fields and sets singular
+// ones.
 // When checking for no-op operations, We verify that both the existing value in
 // the message and the new value are the default. If the existing field value is
 // not the default, setting it to the default should not be treated as a no-op.
 // The pointer of this is kept in no_op_fields_ for bookkeeping.
-#define SET_FIELD(CPPTYPE, CPPTYPELCASE, VALUE)                    \
-  if (field->is_repeated()) {                                      \
-    reflection->Add##CPPTYPE(message, field, VALUE);               \
-  } else {                                                         \
-    if (no_op_fields_ && !field->has_presence() &&                 \
-        field->default_value_##CPPTYPELCASE() ==                   \
-            reflection->Get##CPPTYPE(*message, field) &&           \
-        field->default_value_##CPPTYPELCASE() == VALUE) {          \
-      no_op_fields_->ids_.insert(                                  \
-          UnsetFieldsMetadata::GetUnsetFieldId(*message, *field)); \
-    } else {                                                       \
-      reflection->Set##CPPTYPE(message, field, std::move(VALUE));  \
-    }                                                              \
+#define SET_FIELD(CPPTYPE, CPPTYPELCASE, VALUE)                               \
+  if (field->is_repeated()) {                                                 \
+    internal::TextParserFieldWriter::Set##CPPTYPE(message, reflection, field, \
+                                                  std::move(VALUE));          \
+  } else {                                                                    \
+    if (no_op_fields_ && !field->has_presence() &&                            \
+        field->default_value_##CPPTYPELCASE() ==                              \
+            reflection->Get##CPPTYPE(*message, field) &&                      \
+        field->default_value_##CPPTYPELCASE() == VALUE) {                     \
+      no_op_fields_->ids_.insert(                                             \
+          UnsetFieldsMetadata::GetUnsetFieldId(*message, *field));            \
+    } else {                                                                  \
+      internal::TextParserFieldWriter::Set##CPPTYPE(message, reflection,      \
+                                                    field, std::move(VALUE)); \
+    }                                                                         \
   }
 
     switch (field->cpp_type()) {
@@ -1076,7 +1287,7 @@ class TextFormat::Parser::ParserImpl {
   }
 
   // Returns true if the current token's text is equal to that specified.
-  bool LookingAt(const std::string& text) {
+  bool LookingAt(absl::string_view text) {
     return tokenizer_.current().text == text;
   }
 
@@ -1318,15 +1529,19 @@ class TextFormat::Parser::ParserImpl {
   // full_type_name, then serializes it into serialized_value.
   bool ConsumeAnyValue(const Descriptor* value_descriptor,
                        std::string* serialized_value) {
-    DynamicMessageFactory factory;
-    const Message* value_prototype = factory.GetPrototype(value_descriptor);
+    if (any_factory_ == nullptr) {
+      any_factory_ = std::make_unique<DynamicMessageFactory>();
+    }
+    const Message* value_prototype =
+        any_factory_->GetPrototype(value_descriptor);
     if (value_prototype == nullptr) {
       return false;
     }
-    std::unique_ptr<Message> value(value_prototype->New());
+    Arena arena;
+    Message* value = value_prototype->New(&arena);
     std::string sub_delimiter;
     DO(ConsumeMessageDelimiter(&sub_delimiter));
-    DO(ConsumeMessage(value.get(), sub_delimiter));
+    DO(ConsumeMessage(value, sub_delimiter));
 
     if (allow_partial_) {
       value->AppendPartialToString(serialized_value);
@@ -1345,7 +1560,7 @@ class TextFormat::Parser::ParserImpl {
   // Consumes a token and confirms that it matches that specified in the
   // value parameter. Returns false if the token found does not match that
   // which was specified.
-  bool Consume(const std::string& value) {
+  bool Consume(absl::string_view value) {
     const std::string& current_value = tokenizer_.current().text;
 
     if (current_value != value) {
@@ -1361,7 +1576,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Similar to `Consume`, but the following token may be tokenized as
   // TYPE_WHITESPACE.
-  bool ConsumeBeforeWhitespace(const std::string& value) {
+  bool ConsumeBeforeWhitespace(absl::string_view value) {
     // Report whitespace after this token, but only once.
     tokenizer_.set_report_whitespace(true);
     bool result = Consume(value);
@@ -1371,7 +1586,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Attempts to consume the supplied value. Returns false if the token found
   // does not match the value specified.
-  bool TryConsume(const std::string& value) {
+  bool TryConsume(absl::string_view value) {
     if (tokenizer_.current().text == value) {
       tokenizer_.Next();
       return true;
@@ -1382,7 +1597,7 @@ class TextFormat::Parser::ParserImpl {
 
   // Similar to `TryConsume`, but the following token may be tokenized as
   // TYPE_WHITESPACE.
-  bool TryConsumeBeforeWhitespace(const std::string& value) {
+  bool TryConsumeBeforeWhitespace(absl::string_view value) {
     // Report whitespace after this token, but only once.
     tokenizer_.set_report_whitespace(true);
     bool result = TryConsume(value);
@@ -1393,8 +1608,9 @@ class TextFormat::Parser::ParserImpl {
   bool TryConsumeWhitespace() {
     had_silent_marker_ = false;
     if (LookingAtType(io::Tokenizer::TYPE_WHITESPACE)) {
-      if (tokenizer_.current().text ==
-          absl::StrCat(" ", internal::kDebugStringSilentMarkerForDetection)) {
+      absl::string_view text = tokenizer_.current().text;
+      if (absl::ConsumePrefix(&text, " ") &&
+          text == internal::kDebugStringSilentMarkerForDetection) {
         had_silent_marker_ = true;
       }
       tokenizer_.Next();
@@ -1446,12 +1662,19 @@ class TextFormat::Parser::ParserImpl {
   bool had_errors_;
   UnsetFieldsMetadata* no_op_fields_{};
 
+  struct FieldNameTable {
+    int lookups = 0;
+    absl::flat_hash_map<absl::string_view, const FieldDescriptor*> fields;
+  };
+  absl::flat_hash_map<const Descriptor*, FieldNameTable> field_name_tables_;
+  // Creates the messages that Any values are parsed into.
+  std::unique_ptr<DynamicMessageFactory> any_factory_;
 };
 
 // ===========================================================================
 // Internal class for writing text to the io::ZeroCopyOutputStream. Adapted
 // from the Printer found in //third_party/protobuf/io/printer.h
-class TextFormat::Printer::TextGenerator
+class TextFormat::Printer::TextGenerator final
     : public TextFormat::BaseTextGenerator {
  public:
   explicit TextGenerator(io::ZeroCopyOutputStream* output,
@@ -1532,6 +1755,17 @@ class TextFormat::Printer::TextGenerator
     }
   }
 
+  // Like Print(), for text that is known to hold no newlines.  This skips
+  // looking for them.
+  void PrintWithoutNewlines(absl::string_view text) {
+    Write(text.data(), text.size());
+  }
+
+  void PrintNewline() {
+    Write("\n", 1);
+    at_start_of_line_ = true;
+  }
+
   // True if any write to the underlying stream failed.  (We don't just
   // crash in this case because this is an I/O failure, not a programming
   // error.)
@@ -2200,6 +2434,8 @@ TextFormat::Printer::Printer()
       print_message_fields_in_index_order_(false),
       expand_any_(false),
       truncate_string_field_longer_than_(0LL),
+      has_builtin_field_value_printer_(false),
+      utf8_string_escaping_(false),
       finder_(nullptr) {
   SetUseUtf8StringEscaping(false);
 }
@@ -2207,16 +2443,20 @@ TextFormat::Printer::Printer()
 void TextFormat::Printer::SetUseUtf8StringEscaping(bool as_utf8) {
   SetDefaultFieldValuePrinter(as_utf8 ? new FastFieldValuePrinterUtf8Escaping()
                                       : new DebugStringFieldValuePrinter());
+  has_builtin_field_value_printer_ = true;
+  utf8_string_escaping_ = as_utf8;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FieldValuePrinter* printer) {
   default_field_value_printer_.reset(new FieldValuePrinterWrapper(printer));
+  has_builtin_field_value_printer_ = false;
 }
 
 void TextFormat::Printer::SetDefaultFieldValuePrinter(
     const FastFieldValuePrinter* printer) {
   default_field_value_printer_.reset(printer);
+  has_builtin_field_value_printer_ = false;
 }
 
 bool TextFormat::Printer::RegisterFieldValuePrinter(
@@ -2294,8 +2534,11 @@ bool TextFormat::Printer::Print(const Message& message,
                                 internal::FieldReporterLevel reporter) const {
   TextGenerator generator(output, insert_silent_marker_, initial_indent_level_);
 
-
-  Print(message, &generator);
+  if (CanUseFastPrinter()) {
+    FastPrint(message, &generator);
+  } else {
+    Print(message, &generator);
+  }
 
   // Output false if the generator failed internally.
   return !generator.failed();
@@ -2828,6 +3071,415 @@ void TextFormat::Printer::PrintFieldValue(const Message& message,
   }
 }
 
+namespace internal {
+// Reads the fields of a message for TextFormat::Printer's fast path straight
+// from the message layout, as WireFormat does, instead of through the
+// Reflection getters and their per-call type checks.  Extensions live in the
+// ExtensionSet and lazy fields are parsed on access, so those are still read
+// through Reflection.
+class FastPrinterFieldReader {
+ public:
+  // Lists the fields set in `message`, like Reflection::ListFields(), in
+  // field number order, or in the order of FieldIndexSorter if
+  // `in_index_order`.
+  static void ListFields(const Message& message, const Reflection* reflection,
+                         bool in_index_order,
+                         std::vector<const FieldDescriptor*>* fields);
+
+  // Reads a singular field if `index` is negative, otherwise element `index`
+  // of a repeated field.  `T` is the field's C++ type; enums use
+  // GetEnumValue() instead, as their C++ type is also int.
+  template <typename T>
+  static T Get(const Message& message, const Reflection* reflection,
+               const FieldDescriptor* field, int index);
+  static int GetEnumValue(const Message& message, const Reflection* reflection,
+                          const FieldDescriptor* field, int index);
+  // Cords that are not flat are copied to `scratch`.
+  static absl::string_view GetString(const Message& message,
+                                     const Reflection* reflection,
+                                     const FieldDescriptor* field, int index,
+                                     std::string* scratch);
+  static const Message& GetMessage(const Message& message,
+                                   const Reflection* reflection,
+                                   const FieldDescriptor* field, int index);
+
+ private:
+  static absl::string_view CordView(const absl::Cord& cord,
+                                    std::string* scratch) {
+    if (absl::optional<absl::string_view> flat = cord.TryFlat()) return *flat;
+    absl::CopyCordToString(cord, scratch);
+    return *scratch;
+  }
+};
+
+void FastPrinterFieldReader::ListFields(
+    const Message& message, const Reflection* reflection, bool in_index_order,
+    std::vector<const FieldDescriptor*>* fields) {
+  fields->clear();
+  const ReflectionSchema& schema = reflection->schema_;
+  if (schema.IsDefaultInstance(message)) return;
+
+  const Descriptor* descriptor = reflection->descriptor_;
+  const uint32_t* const has_bits =
+      schema.HasHasbits() ? reflection->GetHasBits(message) : nullptr;
+  const uint32_t* const has_bit_indices = schema.has_bit_indices_;
+  const uint32_t* const oneof_cases =
+      GetConstPointerAtOffset<uint32_t>(&message, schema.oneof_case_offset_);
+  // Weak fields are left out, as they are by Reflection::ListFields().
+  for (int i = 0; i <= reflection->last_non_weak_field_index_; ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    bool has;
+    if (field->is_repeated()) {
+      has = reflection->FieldSize(message, field) > 0;
+    } else if (schema.InRealOneof(field)) {
+      has = oneof_cases[field->containing_oneof()->index()] ==
+            static_cast<uint32_t>(field->number());
+    } else if (has_bits != nullptr &&
+               has_bit_indices[i] != static_cast<uint32_t>(-1)) {
+      const uint32_t index = has_bit_indices[i];
+      has = (has_bits[index / 32] >> (index % 32)) & 1;
+    } else {
+      has = reflection->HasFieldSingular(message, field);
+    }
+    if (has) fields->push_back(field);
+  }
+  // Extensions come after the fields in index order, and are appended by
+  // number.
+  if (schema.HasExtensionSet()) {
+    reflection->GetExtensionSet(message).AppendToList(
+        descriptor, reflection->descriptor_pool_, fields);
+  }
+  const auto by_number = [](const FieldDescriptor* a,
+                            const FieldDescriptor* b) {
+    return a->number() < b->number();
+  };
+  if (!in_index_order &&
+      !std::is_sorted(fields->begin(), fields->end(), by_number)) {
+    std::sort(fields->begin(), fields->end(), by_number);
+  }
+}
+
+template <typename T>
+T FastPrinterFieldReader::Get(const Message& message,
+                              const Reflection* reflection,
+                              const FieldDescriptor* field, int index) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension())) {
+#define PROTOBUF_GET_EXTENSION(TYPE, METHOD)                           \
+  if constexpr (std::is_same_v<T, TYPE>) {                             \
+    return index < 0 ? reflection->Get##METHOD(message, field)         \
+                     : reflection->GetRepeated##METHOD(message, field, \
+                                                       index);         \
+  }
+    PROTOBUF_GET_EXTENSION(int32_t, Int32)
+    PROTOBUF_GET_EXTENSION(int64_t, Int64)
+    PROTOBUF_GET_EXTENSION(uint32_t, UInt32)
+    PROTOBUF_GET_EXTENSION(uint64_t, UInt64)
+    PROTOBUF_GET_EXTENSION(float, Float)
+    PROTOBUF_GET_EXTENSION(double, Double)
+    PROTOBUF_GET_EXTENSION(bool, Bool)
+#undef PROTOBUF_GET_EXTENSION
+  }
+  return index < 0 ? reflection->GetRaw<T>(message, field)
+                   : reflection->GetRaw<RepeatedField<T>>(message, field)
+                         .Get(index);
+}
+
+int FastPrinterFieldReader::GetEnumValue(const Message& message,
+                                         const Reflection* reflection,
+                                         const FieldDescriptor* field,
+                                         int index) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension())) {
+    return index < 0 ? reflection->GetEnumValue(message, field)
+                     : reflection->GetRepeatedEnumValue(message, field, index);
+  }
+  return index < 0
+             ? reflection->GetRaw<int>(message, field)
+             : reflection->GetRaw<RepeatedField<int>>(message, field).Get(
+                   index);
+}
+
+absl::string_view FastPrinterFieldReader::GetString(
+    const Message& message, const Reflection* reflection,
+    const FieldDescriptor* field, int index, std::string* scratch) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension())) {
+    return index < 0 ? reflection->GetStringReference(message, field, scratch)
+                     : reflection->GetRepeatedStringReference(message, field,
+                                                              index, scratch);
+  }
+  const bool is_cord =
+      field->cpp_string_type() == FieldDescriptor::CppStringType::kCord;
+  if (index >= 0) {
+    if (is_cord) {
+      return CordView(
+          reflection->GetRaw<RepeatedField<absl::Cord>>(message, field).Get(
+              index),
+          scratch);
+    }
+    return reflection->GetRaw<RepeatedPtrField<std::string>>(message, field)
+        .Get(index);
+  }
+  if (is_cord) {
+    return CordView(reflection->schema_.InRealOneof(field)
+                        ? *reflection->GetRaw<absl::Cord*>(message, field)
+                        : reflection->GetRaw<absl::Cord>(message, field),
+                    scratch);
+  }
+  if (reflection->IsInlined(field)) {
+    return reflection->GetRaw<InlinedStringField>(message, field).GetNoArena();
+  }
+  const ArenaStringPtr& str =
+      reflection->GetRaw<ArenaStringPtr>(message, field);
+  return str.IsDefault() ? DefaultValueStringAsString(field) : str.GetView();
+}
+
+const Message& FastPrinterFieldReader::GetMessage(const Message& message,
+                                                  const Reflection* reflection,
+                                                  const FieldDescriptor* field,
+                                                  int index) {
+  if (PROTOBUF_PREDICT_FALSE(field->is_extension() || field->is_map() ||
+                             reflection->IsLazyField(field))) {
+    return index < 0 ? reflection->GetMessage(message, field)
+                     : reflection->GetRepeatedMessage(message, field, index);
+  }
+  if (index >= 0) {
+    return reflection->GetRaw<RepeatedPtrField<Message>>(message, field).Get(
+        index);
+  }
+  const Message* sub_message =
+      reflection->GetRaw<const Message*>(message, field);
+  return sub_message != nullptr ? *sub_message
+                                : *reflection->GetDefaultMessageInstance(field);
+}
+}  // namespace internal
+
+// The fast printer produces the same output as PrintMessage() does with the
+// built-in field value printers, but calls the TextGenerator directly instead
+// of going through the virtual FastFieldValuePrinter and BaseTextGenerator
+// interfaces, reads fields through FastPrinterFieldReader, and formats numbers
+// without building strings.
+bool TextFormat::Printer::CanUseFastPrinter() const {
+  return has_builtin_field_value_printer_ && custom_printers_.empty() &&
+         custom_message_printers_.empty();
+}
+
+void TextFormat::Printer::FastPrint(const Message& message,
+                                    TextGenerator* generator) const {
+  const Reflection* reflection = message.GetReflection();
+  if (reflection == nullptr ||
+      (expand_any_ &&
+       message.GetDescriptor()->full_name() == internal::kAnyFullTypeName)) {
+    // Leave the rare cases to the general printer.
+    Print(message, static_cast<BaseTextGenerator*>(generator));
+    return;
+  }
+  const Descriptor* descriptor = message.GetDescriptor();
+  std::vector<const FieldDescriptor*> fields;
+  if (descriptor->options().map_entry()) {
+    fields.push_back(descriptor->field(0));
+    fields.push_back(descriptor->field(1));
+  } else {
+    internal::FastPrinterFieldReader::ListFields(
+        message, reflection, print_message_fields_in_index_order_, &fields);
+  }
+
+  for (const FieldDescriptor* field : fields) {
+    FastPrintField(message, reflection, field, generator);
+  }
+  if (!hide_unknown_fields_) {
+    PrintUnknownFields(reflection->GetUnknownFields(message), generator,
+                       kUnknownFieldRecursionLimit);
+  }
+}
+
+void TextFormat::Printer::FastPrintField(const Message& message,
+                                         const Reflection* reflection,
+                                         const FieldDescriptor* field,
+                                         TextGenerator* generator) const {
+  if (use_short_repeated_primitives_ && field->is_repeated() &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_STRING &&
+      field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE) {
+    const int size = reflection->FieldSize(message, field);
+    FastPrintFieldName(field, generator);
+    generator->PrintMaybeWithMarker(MarkerToken(), ": ", "[");
+    for (int i = 0; i < size; ++i) {
+      if (i > 0) generator->PrintWithoutNewlines(", ");
+      FastPrintFieldValue(message, reflection, field, i, generator);
+    }
+    generator->PrintWithoutNewlines("]");
+    FastPrintFieldEnd(generator);
+    return;
+  }
+
+  // FastPrint() only lists singular fields that are set, and both fields of
+  // map entries, which are printed even when unset.
+  const int count = field->is_repeated() ? reflection->FieldSize(message, field)
+                                         : 1;
+
+  std::vector<const Message*> sorted_map_field;
+  bool need_release = false;
+  const bool is_map = field->is_map();
+  if (is_map) {
+    need_release = internal::MapFieldPrinterHelper::SortMap(
+        message, reflection, field, &sorted_map_field);
+  }
+
+  for (int j = 0; j < count; ++j) {
+    FastPrintFieldName(field, generator);
+
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      if (TryRedactFieldValue(message, field, generator,
+                              /*insert_value_separator=*/true)) {
+        break;
+      }
+      const Message& sub_message =
+          is_map ? *sorted_map_field[j]
+                 : internal::FastPrinterFieldReader::GetMessage(
+                       message, reflection, field,
+                       field->is_repeated() ? j : -1);
+      generator->PrintMaybeWithMarker(MarkerToken(), " ",
+                                      single_line_mode_ ? "{ " : "{\n");
+      generator->Indent();
+      FastPrint(sub_message, generator);
+      generator->Outdent();
+      generator->PrintWithoutNewlines("}");
+    } else {
+      generator->PrintMaybeWithMarker(MarkerToken(), ": ");
+      FastPrintFieldValue(message, reflection, field,
+                          field->is_repeated() ? j : -1, generator);
+    }
+    FastPrintFieldEnd(generator);
+  }
+
+  if (need_release) {
+    for (const Message* message_to_delete : sorted_map_field) {
+      delete message_to_delete;
+    }
+  }
+}
+
+void TextFormat::Printer::FastPrintFieldName(const FieldDescriptor* field,
+                                             TextGenerator* generator) const {
+  if (use_field_number_) {
+    generator->PrintWithoutNewlines(absl::AlphaNum(field->number()).Piece());
+  } else if (field->is_extension()) {
+    generator->PrintWithoutNewlines("[");
+    generator->PrintWithoutNewlines(field->PrintableNameForExtension());
+    generator->PrintWithoutNewlines("]");
+  } else if (internal::cpp::IsGroupLike(*field)) {
+    // Groups must be serialized with their original capitalization.
+    generator->PrintWithoutNewlines(field->message_type()->name());
+  } else {
+    generator->PrintWithoutNewlines(field->name());
+  }
+}
+
+void TextFormat::Printer::FastPrintFieldValue(const Message& message,
+                                              const Reflection* reflection,
+                                              const FieldDescriptor* field,
+                                              int index,
+                                              TextGenerator* generator) const {
+  if (TryRedactFieldValue(message, field, generator,
+                          /*insert_value_separator=*/false)) {
+    return;
+  }
+
+  using internal::FastPrinterFieldReader;
+  switch (field->cpp_type()) {
+#define OUTPUT_FIELD(CPPTYPE, TYPE)                            \
+  case FieldDescriptor::CPPTYPE_##CPPTYPE:                     \
+    generator->PrintWithoutNewlines(                           \
+        absl::AlphaNum(FastPrinterFieldReader::Get<TYPE>(      \
+                           message, reflection, field, index)) \
+            .Piece());                                         \
+    break
+
+    OUTPUT_FIELD(INT32, int32_t);
+    OUTPUT_FIELD(INT64, int64_t);
+    OUTPUT_FIELD(UINT32, uint32_t);
+    OUTPUT_FIELD(UINT64, uint64_t);
+#undef OUTPUT_FIELD
+
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      const float value = FastPrinterFieldReader::Get<float>(
+          message, reflection, field, index);
+      generator->PrintWithoutNewlines(
+          !std::isnan(value) ? io::SimpleFtoa(value) : "nan");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      const double value = FastPrinterFieldReader::Get<double>(
+          message, reflection, field, index);
+      generator->PrintWithoutNewlines(
+          !std::isnan(value) ? io::SimpleDtoa(value) : "nan");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_BOOL: {
+      const bool value = FastPrinterFieldReader::Get<bool>(
+          message, reflection, field, index);
+      generator->PrintWithoutNewlines(value ? "true" : "false");
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      absl::string_view value = FastPrinterFieldReader::GetString(
+          message, reflection, field, index, &scratch);
+      std::string truncated_value;
+      if (truncate_string_field_longer_than_ > 0 &&
+          static_cast<size_t>(truncate_string_field_longer_than_) <
+              value.size()) {
+        truncated_value =
+            absl::StrCat(value.substr(0, truncate_string_field_longer_than_),
+                         "...<truncated>...");
+        value = truncated_value;
+      }
+      if (utf8_string_escaping_ &&
+          field->type() == FieldDescriptor::TYPE_STRING) {
+        HardenedPrintString(value, generator);
+      } else {
+        // Escaping leaves no newlines.
+        generator->PrintWithoutNewlines("\"");
+        if (!value.empty()) {
+          generator->PrintWithoutNewlines(absl::CEscape(value));
+        }
+        generator->PrintWithoutNewlines("\"");
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      const int enum_value = FastPrinterFieldReader::GetEnumValue(
+          message, reflection, field, index);
+      const EnumValueDescriptor* enum_desc =
+          field->enum_type()->FindValueByNumber(enum_value);
+      if (enum_desc != nullptr) {
+        generator->PrintWithoutNewlines(
+            internal::NameOfEnumAsString(enum_desc));
+      } else {
+        // See PrintFieldValue().
+        generator->PrintWithoutNewlines(absl::AlphaNum(enum_value).Piece());
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      FastPrint(FastPrinterFieldReader::GetMessage(message, reflection, field,
+                                                   index),
+                generator);
+      break;
+  }
+}
+
+void TextFormat::Printer::FastPrintFieldEnd(TextGenerator* generator) const {
+  if (single_line_mode_) {
+    generator->PrintWithoutNewlines(" ");
+  } else {
+    generator->PrintNewline();
+  }
+}
+
 /* static */ bool TextFormat::Print(const Message& message,
                                     io::ZeroCopyOutputStream* output) {
   return Printer().Print(message, output);
@@ -529,6 +529,22 @@ class PROTOBUF_EXPORT TextFormat {
                              BaseTextGenerator* generator,
                              bool insert_value_separator) const;
 
+    // The fast printer, used by Print() when no custom printers are
+    // registered.  It walks messages like PrintMessage() does, but writes to
+    // the TextGenerator directly.
+    bool CanUseFastPrinter() const;
+    void FastPrint(const Message& message, TextGenerator* generator) const;
+    void FastPrintField(const Message& message, const Reflection* reflection,
+                        const FieldDescriptor* field,
+                        TextGenerator* generator) const;
+    void FastPrintFieldName(const FieldDescriptor* field,
+                            TextGenerator* generator) const;
+    void FastPrintFieldValue(const Message& message,
+                             const Reflection* reflection,
+                             const FieldDescriptor* field, int index,
+                             TextGenerator* generator) const;
+    void FastPrintFieldEnd(TextGenerator* generator) const;
+
     const FastFieldValuePrinter* GetFieldPrinter(
         const FieldDescriptor* field) const {
       auto it = custom_printers_.find(field);
@@ -554,6 +570,10 @@ class PROTOBUF_EXPORT TextFormat {
     int64_t truncate_string_field_longer_than_;
 
     std::unique_ptr<const FastFieldValuePrinter> default_field_value_printer_;
+    // Whether default_field_value_printer_ was set by
+    // SetUseUtf8StringEscaping(), and with which value.
+    bool has_builtin_field_value_printer_;
+    bool utf8_string_escaping_;
     absl::flat_hash_map<const FieldDescriptor*,
                         std::unique_ptr<const FastFieldValuePrinter>>
         custom_printers_;
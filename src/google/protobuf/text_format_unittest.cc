@@ -37,6 +37,7 @@
 #include "absl/strings/str_replace.h"
 #include "absl/strings/substitute.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/dynamic_message.h"
 #include "google/protobuf/io/tokenizer.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
@@ -617,6 +618,64 @@ TEST_F(TextFormatTest, PrintBufferTooSmall) {
   EXPECT_EQ(output_stream.ByteCount(), 1);
 }
 
+TEST_F(TextFormatTest, FastPrinterMatchesGeneralPrinter) {
+  unittest::TestAllTypes all_types;
+  TestUtil::SetAllFields(&all_types);
+  all_types.add_repeated_string("caf\xc3\xa9 \xff\n\"");
+  all_types.mutable_unknown_fields()->AddVarint(123456, 7);
+  protobuf_unittest::TestMap map;
+  (*map.mutable_map_int32_int32())[2] = 3;
+  (*map.mutable_map_int32_int32())[1] = 4;
+  (*map.mutable_map_string_string())["b"] = "x";
+  (*map.mutable_map_int32_foreign_message())[5].set_c(6);
+  unittest::TestAllExtensions extensions;
+  TestUtil::SetAllExtensions(&extensions);
+  unittest::TestOneof2 oneof;
+  oneof.set_foo_bytes_cord(absl::Cord("foo"));
+  oneof.set_bar_string("bar");
+  oneof.set_baz_int(8);
+  proto3_unittest::TestAllTypes proto3;
+  proto3.set_optional_int32(0);
+  proto3.set_optional_string("bar");
+  proto3.add_repeated_int64(-1);
+  // Dynamic messages lay out their fields differently from generated ones.
+  DynamicMessageFactory factory;
+  std::unique_ptr<Message> dynamic(
+      factory.GetPrototype(unittest::TestAllTypes::descriptor())->New());
+  dynamic->CopyFrom(all_types);
+  const Message* messages[] = {&all_types, &map,    &extensions,
+                               &oneof,     &proto3, dynamic.get()};
+
+  for (int options = 0; options < 64; ++options) {
+    SCOPED_TRACE(options);
+    auto configure = [&](TextFormat::Printer& printer) {
+      printer.SetSingleLineMode(options & 1);
+      printer.SetUseUtf8StringEscaping(options & 2);
+      printer.SetUseShortRepeatedPrimitives(options & 4);
+      printer.SetUseFieldNumber(options & 8);
+      printer.SetPrintMessageFieldsInIndexOrder(options & 16);
+      printer.SetTruncateStringFieldLongerThan(options & 32 ? 4 : 0);
+      printer.SetInitialIndentLevel(1);
+    };
+    TextFormat::Printer fast_printer;
+    configure(fast_printer);
+    TextFormat::Printer general_printer;
+    configure(general_printer);
+    // Registering any custom printer turns off the fast printer.
+    ASSERT_TRUE(general_printer.RegisterFieldValuePrinter(
+        unittest::TestRequired::descriptor()->field(0),
+        new TextFormat::FastFieldValuePrinter));
+
+    for (const Message* message : messages) {
+      std::string fast_text;
+      std::string general_text;
+      EXPECT_TRUE(fast_printer.PrintToString(*message, &fast_text));
+      EXPECT_TRUE(general_printer.PrintToString(*message, &general_text));
+      EXPECT_EQ(fast_text, general_text);
+    }
+  }
+}
+
 // A printer that appends 'u' to all unsigned int32.
 class CustomUInt32FieldValuePrinter : public TextFormat::FieldValuePrinter {
  public:
@@ -995,6 +1054,45 @@ TEST_F(TextFormatExtensionsTest, ParseExtensions) {
   TestUtil::ExpectAllExtensionsSet(proto_);
 }
 
+TEST_F(TextFormatTest, ParseOnArena) {
+  Arena arena;
+  auto* message = Arena::Create<unittest::TestAllTypes>(&arena);
+  ASSERT_TRUE(TextFormat::ParseFromString(proto_text_format_, message));
+  TestUtil::ExpectAllFieldsSet(*message);
+  EXPECT_EQ(message->optional_nested_message().GetArena(), &arena);
+  EXPECT_EQ(message->repeated_nested_message(1).GetArena(), &arena);
+
+  // Dynamic messages lay out their fields differently from generated ones.
+  DynamicMessageFactory factory;
+  Message* dynamic =
+      factory.GetPrototype(unittest::TestAllTypes::descriptor())->New(&arena);
+  ASSERT_TRUE(TextFormat::ParseFromString(proto_text_format_, dynamic));
+  unittest::TestAllTypes copy;
+  ASSERT_TRUE(copy.ParseFromString(dynamic->SerializeAsString()));
+  TestUtil::ExpectAllFieldsSet(copy);
+}
+
+TEST_F(TextFormatTest, MergeSwitchesOneofMember) {
+  unittest::TestOneof2 message;
+  ASSERT_TRUE(TextFormat::MergeFromString("foo_int: 5", &message));
+  EXPECT_EQ(message.foo_int(), 5);
+  ASSERT_TRUE(TextFormat::MergeFromString("foo_string: \"abc\"", &message));
+  EXPECT_EQ(message.foo_string(), "abc");
+  ASSERT_TRUE(
+      TextFormat::MergeFromString("foo_message { moo_int: 1 }", &message));
+  ASSERT_TRUE(
+      TextFormat::MergeFromString("foo_message { corge_int: 2 }", &message));
+  EXPECT_EQ(message.foo_message().moo_int(), 1);
+  EXPECT_EQ(message.foo_message().corge_int(0), 2);
+  ASSERT_TRUE(TextFormat::MergeFromString("foo_bytes_cord: \"x\"", &message));
+  EXPECT_EQ(message.foo_bytes_cord(), "x");
+  ASSERT_TRUE(TextFormat::MergeFromString("foo_string: \"def\"", &message));
+  EXPECT_EQ(message.foo_string(), "def");
+  ASSERT_TRUE(TextFormat::MergeFromString("foo_int: 3", &message));
+  EXPECT_TRUE(message.has_foo_int());
+  EXPECT_EQ(message.foo_int(), 3);
+}
+
 
 TEST_F(TextFormatTest, ParseEnumFieldFromNumber) {
   // Create a parse string with a numerical value for an enum field.
@@ -2066,6 +2164,31 @@ TEST_F(TextFormatParserTest, GroupCapitalization) {
       1, 16);
 }
 
+TEST_F(TextFormatParserTest, GroupCapitalizationAfterManyFields) {
+  // Once a message type has had many field lookups, its fields are looked up
+  // through a table, which must accept the same names.
+  const int num_lines = unittest::TestAllTypes::descriptor()->field_count() + 1;
+  std::string prefix;
+  for (int i = 0; i < num_lines; ++i) {
+    absl::StrAppend(&prefix, "repeated_int32: ", i, "\n");
+  }
+  unittest::TestAllTypes proto;
+  EXPECT_TRUE(parser_.ParseFromString(
+      absl::StrCat(prefix, "OptionalGroup { a: 15 }\noptionalgroup { a: 16 }\n",
+                   "RepeatedGroup { a: 17 }\n"),
+      &proto));
+  EXPECT_EQ(proto.repeated_int32_size(), num_lines);
+  EXPECT_EQ(proto.optionalgroup().a(), 16);
+  ASSERT_EQ(proto.repeatedgroup_size(), 1);
+  EXPECT_EQ(proto.repeatedgroup(0).a(), 17);
+
+  ExpectFailure(
+      absl::StrCat(prefix, "OPTIONALgroup {\na: 15\n}\n"),
+      "Message type \"protobuf_unittest.TestAllTypes\" has no field named "
+      "\"OPTIONALgroup\".",
+      num_lines + 1, 15);
+}
+
 TEST_F(TextFormatParserTest, DelimitedCapitalization) {
   editions_unittest::TestDelimited proto;
   EXPECT_TRUE(parser_.ParseFromString("grouplike {\na: 1\n}\n", &proto));
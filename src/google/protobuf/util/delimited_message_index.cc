@@ -0,0 +1,214 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/delimited_message_index.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+// Identifies a serialized index, and its version.
+constexpr absl::string_view kMagic = "PBDIDX1\n";
+
+// The longest varint, which ReadVarint32() accepts for sizes.
+constexpr int kMaxSizeBytes = 10;
+
+enum class ReadResult { kOk, kEof, kError };
+
+// Reads the size prefix of the next record from `input`.
+ReadResult ReadRecordSize(io::ZeroCopyInputStream* input, uint32_t* size) {
+  uint64_t value = 0;
+  int length = 0;
+  const void* data;
+  int data_size;
+  while (input->Next(&data, &data_size)) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (int i = 0; i < data_size; ++i) {
+      value |= static_cast<uint64_t>(bytes[i] & 0x7F) << (7 * length);
+      ++length;
+      if (bytes[i] < 0x80 || length == kMaxSizeBytes) {
+        input->BackUp(data_size - i - 1);
+        // Like ReadVarint32(), drop the upper bits.
+        *size = static_cast<uint32_t>(value);
+        return bytes[i] < 0x80 && *size <= INT_MAX ? ReadResult::kOk
+                                                   : ReadResult::kError;
+      }
+    }
+  }
+  return length == 0 ? ReadResult::kEof : ReadResult::kError;
+}
+
+bool SkipBytes(io::ZeroCopyInputStream* input, int64_t count) {
+  while (count > 0) {
+    const int n = static_cast<int>(std::min<int64_t>(count, INT_MAX));
+    if (!input->Skip(n)) return false;
+    count -= n;
+  }
+  return true;
+}
+
+}  // namespace
+
+DelimitedMessageIndex::DelimitedMessageIndex()
+    : DelimitedMessageIndex(kDefaultStride) {}
+
+DelimitedMessageIndex::DelimitedMessageIndex(int stride) : stride_(stride) {
+  ABSL_CHECK_GT(stride, 0);
+}
+
+void DelimitedMessageIndex::AddRecord(size_t message_size) {
+  if (record_count_ % stride_ == 0) checkpoints_.push_back(byte_size_);
+  ++record_count_;
+  byte_size_ += io::CodedOutputStream::VarintSize64(message_size) +
+                static_cast<int64_t>(message_size);
+}
+
+bool DelimitedMessageIndex::Scan(io::ZeroCopyInputStream* input) {
+  while (true) {
+    uint32_t size;
+    switch (ReadRecordSize(input, &size)) {
+      case ReadResult::kOk:
+        break;
+      case ReadResult::kEof:
+        return true;
+      case ReadResult::kError:
+        return false;
+    }
+    if (!input->Skip(static_cast<int>(size))) return false;
+    AddRecord(size);
+  }
+}
+
+int64_t DelimitedMessageIndex::CheckpointOffset(int64_t checkpoint) const {
+  return checkpoint < static_cast<int64_t>(checkpoints_.size())
+             ? checkpoints_[checkpoint]
+             : byte_size_;
+}
+
+bool DelimitedMessageIndex::SeekToRecord(io::ZeroCopyInputStream* input,
+                                         int64_t record) const {
+  if (record < 0 || record > record_count_) return false;
+  const int64_t checkpoint = record / stride_;
+  if (!SkipBytes(input, CheckpointOffset(checkpoint))) return false;
+  for (int64_t i = checkpoint * stride_; i < record; ++i) {
+    uint32_t size;
+    if (ReadRecordSize(input, &size) != ReadResult::kOk ||
+        !input->Skip(static_cast<int>(size))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<DelimitedMessageIndex::Range> DelimitedMessageIndex::Split(
+    int max_ranges) const {
+  ABSL_CHECK_GT(max_ranges, 0);
+  const int64_t num_checkpoints = static_cast<int64_t>(checkpoints_.size());
+  const int64_t num_ranges = std::min<int64_t>(max_ranges, num_checkpoints);
+  std::vector<Range> ranges;
+  ranges.reserve(num_ranges);
+  for (int64_t i = 0; i < num_ranges; ++i) {
+    const int64_t begin = num_checkpoints * i / num_ranges;
+    const int64_t end = num_checkpoints * (i + 1) / num_ranges;
+    Range range;
+    range.first_record = begin * stride_;
+    range.num_records =
+        std::min(end * stride_, record_count_) - range.first_record;
+    range.offset = CheckpointOffset(begin);
+    range.size = CheckpointOffset(end) - range.offset;
+    ranges.push_back(range);
+  }
+  return ranges;
+}
+
+std::string DelimitedMessageIndex::Serialize() const {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    io::CodedOutputStream coded_output(&output);
+    coded_output.WriteRaw(kMagic.data(), static_cast<int>(kMagic.size()));
+    coded_output.WriteVarint32(static_cast<uint32_t>(stride_));
+    coded_output.WriteVarint64(static_cast<uint64_t>(record_count_));
+    coded_output.WriteVarint64(static_cast<uint64_t>(byte_size_));
+    // Offsets are stored as deltas, which are about the same for all of them.
+    int64_t previous = 0;
+    for (int64_t offset : checkpoints_) {
+      coded_output.WriteVarint64(static_cast<uint64_t>(offset - previous));
+      previous = offset;
+    }
+  }
+  return data;
+}
+
+bool DelimitedMessageIndex::Parse(absl::string_view data) {
+  if (data.size() > INT_MAX) return false;
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  std::string magic;
+  uint32_t stride;
+  uint64_t record_count;
+  uint64_t byte_size;
+  if (!input.ReadString(&magic, static_cast<int>(kMagic.size())) ||
+      magic != kMagic || !input.ReadVarint32(&stride) || stride == 0 ||
+      stride > INT_MAX || !input.ReadVarint64(&record_count) ||
+      record_count > INT64_MAX || !input.ReadVarint64(&byte_size) ||
+      byte_size > INT64_MAX) {
+    return false;
+  }
+  // Each record takes at least one byte.
+  if (record_count > byte_size) return false;
+
+  const uint64_t num_checkpoints = (record_count + stride - 1) / stride;
+  // Each offset takes at least one byte.
+  if (num_checkpoints > static_cast<uint64_t>(input.BytesUntilLimit())) {
+    return false;
+  }
+  std::vector<int64_t> checkpoints;
+  checkpoints.reserve(num_checkpoints);
+  uint64_t offset = 0;
+  for (uint64_t i = 0; i < num_checkpoints; ++i) {
+    uint64_t delta;
+    if (!input.ReadVarint64(&delta) || delta > byte_size - offset) {
+      return false;
+    }
+    offset += delta;
+    checkpoints.push_back(static_cast<int64_t>(offset));
+  }
+  if (!checkpoints.empty() && checkpoints[0] != 0) return false;
+  if (input.BytesUntilLimit() != 0) return false;
+
+  stride_ = static_cast<int>(stride);
+  record_count_ = static_cast<int64_t>(record_count);
+  byte_size_ = static_cast<int64_t>(byte_size);
+  checkpoints_ = std::move(checkpoints);
+  return true;
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
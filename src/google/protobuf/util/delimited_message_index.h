@@ -0,0 +1,119 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// An index over a stream of size-delimited messages, as written by
+// SerializeDelimitedToOstream() and friends in delimited_message_util.h.
+//
+// Finding record N of a delimited stream normally requires reading the size
+// prefixes of all the records before it.  DelimitedMessageIndex records the
+// byte offset of one out of every `stride` records, so that record N is
+// reached by skipping straight to the offset of record N - N % stride and
+// then over fewer than `stride` records.  It also knows the number of records
+// and where they end, which lets the records be split into byte ranges that
+// are read independently, for example by several threads (see
+// ParseDelimitedInParallel() in delimited_message_util.h).
+//
+// The index is kept apart from the data, typically in a sidecar file next to
+// it, so that the data stays readable by anything that reads delimited
+// messages.  It can be maintained while writing, by DelimitedMessageWriter or
+// by calling AddRecord() for each message written, or built afterwards by
+// scanning the data with Scan(), which reads the size prefixes only.
+//
+// Offsets are relative to the start of the indexed data.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_DELIMITED_MESSAGE_INDEX_H__
+#define GOOGLE_PROTOBUF_UTIL_DELIMITED_MESSAGE_INDEX_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+class PROTOBUF_EXPORT DelimitedMessageIndex {
+ public:
+  static constexpr int kDefaultStride = 1024;
+
+  // A run of consecutive records, which occupy `size` bytes starting at byte
+  // `offset` of the data.
+  struct Range {
+    int64_t first_record;
+    int64_t num_records;
+    int64_t offset;
+    int64_t size;
+  };
+
+  // Creates an empty index which records the offset of one out of every
+  // `stride` records.  Smaller strides make seeking faster and the index
+  // larger.
+  DelimitedMessageIndex();
+  explicit DelimitedMessageIndex(int stride);
+
+  // Adds the next record, whose message is `message_size` bytes long, not
+  // counting its size prefix.
+  void AddRecord(size_t message_size);
+
+  // Adds the records read from `input` up to its end, reading their size
+  // prefixes and skipping over the messages without parsing them.  Returns
+  // false if the input is malformed or ends in the middle of a record, in
+  // which case the records before the bad one were added.
+  bool Scan(io::ZeroCopyInputStream* input);
+
+  int stride() const { return stride_; }
+  // The number of records in the data.
+  int64_t record_count() const { return record_count_; }
+  // The size of the data, in bytes.
+  int64_t byte_size() const { return byte_size_; }
+
+  // Advances `input`, which must be positioned at the start of the indexed
+  // data, to the start of record `record`.  This skips to the offset of the
+  // nearest preceding indexed record, which is fast if `input` implements
+  // Skip() efficiently, like FileInputStream and ArrayInputStream do, and
+  // then reads fewer than stride() size prefixes.  `record` may be
+  // record_count(), to position `input` at the end of the data.  Returns
+  // false on error or if the record does not exist.
+  bool SeekToRecord(io::ZeroCopyInputStream* input, int64_t record) const;
+
+  // Splits the records into at most `max_ranges` ranges holding about the
+  // same number of records each.  The ranges start at records whose offset
+  // is indexed and cover all of the records in order.  There are no empty
+  // ranges, so an empty index has none.
+  std::vector<Range> Split(int max_ranges) const;
+
+  // Serializes the index, to be stored next to the data.
+  std::string Serialize() const;
+  // Replaces the index with one serialized by Serialize().  Returns false if
+  // `data` is not a valid index, in which case the index is left unchanged.
+  bool Parse(absl::string_view data);
+
+ private:
+  // The offset of record `checkpoint * stride_`.
+  int64_t CheckpointOffset(int64_t checkpoint) const;
+
+  int stride_;
+  int64_t record_count_ = 0;
+  int64_t byte_size_ = 0;
+  // The offsets of records 0, stride_, 2 * stride_, ...
+  std::vector<int64_t> checkpoints_;
+};
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_DELIMITED_MESSAGE_INDEX_H__
@@ -0,0 +1,205 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/delimited_message_index.h"
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/mutex.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/util/delimited_message_util.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+
+constexpr int kNumRecords = 1000;
+
+// Writes kNumRecords records of varying sizes, whose optional_int32 is their
+// record number.
+std::string WriteRecords(DelimitedMessageIndex* index) {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    DelimitedMessageWriter writer(&output, index);
+    TestAllTypes message;
+    for (int i = 0; i < kNumRecords; ++i) {
+      message.set_optional_int32(i);
+      message.set_optional_string(std::string(i % 300, 'x'));
+      EXPECT_TRUE(writer.Write(message));
+    }
+  }
+  return data;
+}
+
+TEST(DelimitedMessageIndexTest, WriterMaintainsIndex) {
+  DelimitedMessageIndex index(16);
+  const std::string data = WriteRecords(&index);
+  EXPECT_EQ(index.record_count(), kNumRecords);
+  EXPECT_EQ(index.byte_size(), static_cast<int64_t>(data.size()));
+
+  // Scanning the data builds the same index.
+  DelimitedMessageIndex scanned(16);
+  io::ArrayInputStream input(data.data(), data.size(), 100);
+  EXPECT_TRUE(scanned.Scan(&input));
+  EXPECT_EQ(scanned.Serialize(), index.Serialize());
+}
+
+TEST(DelimitedMessageIndexTest, WriterDoesNotIndexFailedWrites) {
+  DelimitedMessageIndex index;
+  char buffer[64];
+  io::ArrayOutputStream output(buffer, sizeof(buffer));
+  DelimitedMessageWriter writer(&output, &index);
+  TestAllTypes message;
+  message.set_optional_int32(1);
+  ASSERT_TRUE(writer.Write(message));
+  EXPECT_EQ(index.record_count(), 1);
+
+  message.set_optional_string(std::string(100, 'x'));
+  EXPECT_FALSE(writer.Write(message));
+  EXPECT_EQ(index.record_count(), 1);
+}
+
+TEST(DelimitedMessageIndexTest, AddRecordMatchesSerializeDelimited) {
+  std::ostringstream stream;
+  DelimitedMessageIndex index(3);
+  TestAllTypes message;
+  for (int i = 0; i < 10; ++i) {
+    message.add_repeated_int32(i);
+    ASSERT_TRUE(SerializeDelimitedToOstream(message, &stream));
+    index.AddRecord(message.GetCachedSize());
+  }
+  const std::string data = stream.str();
+  EXPECT_EQ(index.record_count(), 10);
+  EXPECT_EQ(index.byte_size(), static_cast<int64_t>(data.size()));
+}
+
+TEST(DelimitedMessageIndexTest, SeekToRecord) {
+  DelimitedMessageIndex index(16);
+  const std::string data = WriteRecords(&index);
+  for (int record : {0, 1, 15, 16, 17, 500, kNumRecords - 1}) {
+    SCOPED_TRACE(record);
+    io::ArrayInputStream input(data.data(), data.size(), 64);
+    ASSERT_TRUE(index.SeekToRecord(&input, record));
+    TestAllTypes message;
+    bool clean_eof;
+    ASSERT_TRUE(ParseDelimitedFromZeroCopyStream(&message, &input, &clean_eof));
+    EXPECT_EQ(message.optional_int32(), record);
+  }
+
+  io::ArrayInputStream input(data.data(), data.size());
+  ASSERT_TRUE(index.SeekToRecord(&input, kNumRecords));
+  TestAllTypes message;
+  bool clean_eof = false;
+  EXPECT_FALSE(ParseDelimitedFromZeroCopyStream(&message, &input, &clean_eof));
+  EXPECT_TRUE(clean_eof);
+
+  io::ArrayInputStream past_end(data.data(), data.size());
+  EXPECT_FALSE(index.SeekToRecord(&past_end, kNumRecords + 1));
+}
+
+TEST(DelimitedMessageIndexTest, ScanFailsOnTruncatedData) {
+  DelimitedMessageIndex index;
+  std::string data = WriteRecords(&index);
+  data.pop_back();
+  DelimitedMessageIndex scanned;
+  io::ArrayInputStream input(data.data(), data.size());
+  EXPECT_FALSE(scanned.Scan(&input));
+  EXPECT_EQ(scanned.record_count(), kNumRecords - 1);
+}
+
+TEST(DelimitedMessageIndexTest, Split) {
+  DelimitedMessageIndex index(16);
+  const std::string data = WriteRecords(&index);
+  for (int max_ranges : {1, 3, 8, 1000}) {
+    SCOPED_TRACE(max_ranges);
+    std::vector<DelimitedMessageIndex::Range> ranges = index.Split(max_ranges);
+    ASSERT_LE(ranges.size(), static_cast<size_t>(max_ranges));
+    int64_t record = 0;
+    int64_t offset = 0;
+    for (const DelimitedMessageIndex::Range& range : ranges) {
+      EXPECT_EQ(range.first_record, record);
+      EXPECT_EQ(range.offset, offset);
+      EXPECT_GT(range.num_records, 0);
+      record += range.num_records;
+      offset += range.size;
+    }
+    EXPECT_EQ(record, kNumRecords);
+    EXPECT_EQ(offset, static_cast<int64_t>(data.size()));
+  }
+  EXPECT_TRUE(DelimitedMessageIndex().Split(4).empty());
+}
+
+TEST(DelimitedMessageIndexTest, SerializeAndParse) {
+  DelimitedMessageIndex index(16);
+  WriteRecords(&index);
+  const std::string serialized = index.Serialize();
+
+  DelimitedMessageIndex parsed;
+  ASSERT_TRUE(parsed.Parse(serialized));
+  EXPECT_EQ(parsed.stride(), 16);
+  EXPECT_EQ(parsed.record_count(), index.record_count());
+  EXPECT_EQ(parsed.byte_size(), index.byte_size());
+  EXPECT_EQ(parsed.Serialize(), serialized);
+
+  for (size_t size = 0; size < serialized.size(); ++size) {
+    EXPECT_FALSE(parsed.Parse(serialized.substr(0, size)));
+  }
+  EXPECT_FALSE(parsed.Parse(serialized + "x"));
+  EXPECT_EQ(parsed.Serialize(), serialized);
+}
+
+TEST(DelimitedMessageIndexTest, ParseDelimitedInParallel) {
+  DelimitedMessageIndex index(16);
+  const std::string data = WriteRecords(&index);
+  for (int num_threads : {1, 2, 8}) {
+    SCOPED_TRACE(num_threads);
+    absl::Mutex mutex;
+    std::vector<int> seen(kNumRecords);
+    EXPECT_TRUE(ParseDelimitedInParallel(
+        index,
+        [&] {
+          return std::make_unique<io::ArrayInputStream>(data.data(),
+                                                        data.size(), 256);
+        },
+        &TestAllTypes::default_instance(), num_threads,
+        [&](int64_t record, const MessageLite& message) {
+          EXPECT_EQ(static_cast<const TestAllTypes&>(message).optional_int32(),
+                    record);
+          absl::MutexLock lock(&mutex);
+          ++seen[record];
+        }));
+    EXPECT_EQ(seen, std::vector<int>(kNumRecords, 1));
+  }
+}
+
+TEST(DelimitedMessageIndexTest, ParseDelimitedInParallelFailsOnBadData) {
+  DelimitedMessageIndex index(16);
+  std::string data = WriteRecords(&index);
+  data.resize(data.size() / 2);
+  EXPECT_FALSE(ParseDelimitedInParallel(
+      index,
+      [&] {
+        return std::make_unique<io::ArrayInputStream>(data.data(), data.size());
+      },
+      &TestAllTypes::default_instance(), 4,
+      [](int64_t, const MessageLite&) {}));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
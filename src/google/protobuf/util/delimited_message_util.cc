@@ -10,7 +10,25 @@
 
 #include "google/protobuf/util/delimited_message_util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/prefetch.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "google/protobuf/util/delimited_message_index.h"
 
 namespace google {
 namespace protobuf {
@@ -101,6 +119,240 @@ bool SerializeDelimitedToCodedStream(const MessageLite& message,
   return true;
 }
 
+namespace {
+
+// The longest varint, which ReadVarint32() accepts for sizes.
+constexpr int kMaxSizeBytes = 10;
+
+// Reads the size prefix of a record from [ptr, end).  Returns the length of
+// the prefix, 0 if it is incomplete, or -1 if it is not a valid size.
+int ReadRecordSize(const char* ptr, const char* end, uint32_t* size) {
+  uint64_t value = 0;
+  for (int i = 0; i < kMaxSizeBytes; ++i) {
+    if (ptr + i == end) return 0;
+    const uint8_t byte = static_cast<uint8_t>(ptr[i]);
+    value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+    if (byte < 0x80) {
+      // Like ReadVarint32(), drop the upper bits.
+      *size = static_cast<uint32_t>(value);
+      return *size <= INT_MAX ? i + 1 : -1;
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+DelimitedMessageReader::DelimitedMessageReader(io::ZeroCopyInputStream* input,
+                                               const MessageLite* prototype)
+    : DelimitedMessageReader(input, prototype, Options()) {}
+
+DelimitedMessageReader::DelimitedMessageReader(io::ZeroCopyInputStream* input,
+                                               const MessageLite* prototype,
+                                               const Options& options)
+    : input_(input), prototype_(prototype), options_(options) {
+  ABSL_CHECK_GT(options_.batch_size, 0);
+}
+
+DelimitedMessageReader::~DelimitedMessageReader() {
+  if (ptr_ != end_) input_->BackUp(static_cast<int>(end_ - ptr_));
+}
+
+absl::Span<MessageLite* const> DelimitedMessageReader::NextBatch() {
+  batch_count_ = 0;
+  if (done_) return {};
+  if (arena_.SpaceAllocated() > options_.max_arena_size) {
+    messages_.clear();
+    arena_.Reset();
+  }
+
+  const size_t batch_size = static_cast<size_t>(options_.batch_size);
+  while (batch_count_ < batch_size) {
+    // Find the records that lie entirely within the current buffer.
+    records_.clear();
+    while (batch_count_ + records_.size() < batch_size) {
+      uint32_t size;
+      const int prefix = ReadRecordSize(ptr_, end_, &size);
+      if (prefix <= 0 || static_cast<size_t>(end_ - ptr_) - prefix < size) {
+        break;
+      }
+      records_.emplace_back(ptr_ + prefix, size);
+      ptr_ += prefix + size;
+    }
+    for (size_t i = 0; i < records_.size(); ++i) {
+      if (i + 1 < records_.size()) {
+        absl::PrefetchToLocalCache(records_[i + 1].data());
+      }
+      if (!ParseRecord(records_[i])) {
+        done_ = true;
+        return absl::MakeConstSpan(messages_.data(), batch_count_);
+      }
+    }
+    if (batch_count_ == batch_size) break;
+
+    // The next record, if any, starts in the current buffer but does not end
+    // there.
+    absl::string_view record;
+    if (!ReadSplitRecord(&record) || !ParseRecord(record)) {
+      done_ = true;
+      break;
+    }
+  }
+  return absl::MakeConstSpan(messages_.data(), batch_count_);
+}
+
+bool DelimitedMessageReader::NextBuffer() {
+  const void* data;
+  int size;
+  do {
+    if (!input_->Next(&data, &size)) {
+      ptr_ = end_ = nullptr;
+      return false;
+    }
+  } while (size == 0);
+  ptr_ = static_cast<const char*>(data);
+  end_ = ptr_ + size;
+  return true;
+}
+
+bool DelimitedMessageReader::ReadSplitRecord(absl::string_view* record) {
+  record_buffer_.assign(ptr_, end_);
+  ptr_ = end_;
+
+  // Gather the size prefix.
+  uint32_t size;
+  int prefix;
+  while ((prefix = ReadRecordSize(
+              record_buffer_.data(),
+              record_buffer_.data() + record_buffer_.size(), &size)) == 0) {
+    if (!NextBuffer()) {
+      clean_eof_ = record_buffer_.empty();
+      return false;
+    }
+    const size_t n = std::min<size_t>(end_ - ptr_,
+                                      kMaxSizeBytes - record_buffer_.size());
+    record_buffer_.append(ptr_, n);
+    ptr_ += n;
+  }
+  if (prefix < 0) return false;
+
+  // Gather the message.  Only the last bytes appended above can lie past the
+  // end of the record, since the current buffer held no complete record.
+  const size_t record_size = prefix + size;
+  if (record_buffer_.size() > record_size) {
+    ptr_ -= record_buffer_.size() - record_size;
+    record_buffer_.resize(record_size);
+  }
+  while (record_buffer_.size() < record_size) {
+    if (ptr_ == end_ && !NextBuffer()) return false;
+    const size_t n =
+        std::min<size_t>(end_ - ptr_, record_size - record_buffer_.size());
+    record_buffer_.append(ptr_, n);
+    ptr_ += n;
+  }
+  *record = absl::string_view(record_buffer_).substr(prefix);
+  return true;
+}
+
+bool DelimitedMessageReader::ParseRecord(absl::string_view record) {
+  if (batch_count_ == messages_.size()) {
+    messages_.push_back(prototype_->New(&arena_));
+  }
+  MessageLite* message = messages_[batch_count_];
+  if (!message->ParseFromArray(record.data(),
+                               static_cast<int>(record.size()))) {
+    return false;
+  }
+  ++batch_count_;
+  return true;
+}
+
+DelimitedMessageWriter::DelimitedMessageWriter(io::ZeroCopyOutputStream* output)
+    : DelimitedMessageWriter(output, nullptr) {}
+
+DelimitedMessageWriter::DelimitedMessageWriter(io::ZeroCopyOutputStream* output,
+                                               DelimitedMessageIndex* index)
+    : output_(output), index_(index) {}
+
+bool DelimitedMessageWriter::Write(const MessageLite& message) {
+  const MessageLite* batch[] = {&message};
+  return WriteBatch(batch);
+}
+
+bool DelimitedMessageWriter::WriteBatch(
+    absl::Span<const MessageLite* const> messages) {
+  // Compute all sizes first; the loop below only uses the cached sizes.
+  for (const MessageLite* message : messages) {
+    if (message->ByteSizeLong() > INT_MAX) return false;
+  }
+  io::EpsCopyOutputStream* stream = output_.EpsCopy();
+  uint8_t* ptr = output_.Cur();
+  for (const MessageLite* message : messages) {
+    ptr = stream->EnsureSpace(ptr);
+    ptr = io::CodedOutputStream::WriteVarint32ToArray(
+        static_cast<uint32_t>(message->GetCachedSize()), ptr);
+    ptr = message->_InternalSerialize(ptr, stream);
+  }
+  output_.SetCur(ptr);
+  if (stream->HadError()) return false;
+  // Only index the records once they are known to have been written.
+  if (index_ != nullptr) {
+    for (const MessageLite* message : messages) {
+      index_->AddRecord(message->GetCachedSize());
+    }
+  }
+  return true;
+}
+
+bool ParseDelimitedInParallel(
+    const DelimitedMessageIndex& index,
+    absl::FunctionRef<std::unique_ptr<io::ZeroCopyInputStream>()> open_input,
+    const MessageLite* prototype, int num_threads,
+    absl::FunctionRef<void(int64_t record, const MessageLite& message)>
+        callback) {
+  ABSL_CHECK_GT(num_threads, 0);
+  // Several ranges per thread, so that threads finishing early take over
+  // some of the work.
+  constexpr int kRangesPerThread = 4;
+  const std::vector<DelimitedMessageIndex::Range> ranges =
+      index.Split(num_threads * kRangesPerThread);
+
+  std::atomic<size_t> next_range{0};
+  std::atomic<bool> ok{true};
+  auto worker = [&] {
+    for (size_t i = next_range++; i < ranges.size() && ok.load();
+         i = next_range++) {
+      const DelimitedMessageIndex::Range& range = ranges[i];
+      std::unique_ptr<io::ZeroCopyInputStream> input = open_input();
+      if (input == nullptr ||
+          !index.SeekToRecord(input.get(), range.first_record)) {
+        ok = false;
+        return;
+      }
+      io::LimitingInputStream limited_input(input.get(), range.size);
+      DelimitedMessageReader reader(&limited_input, prototype);
+      int64_t record = range.first_record;
+      for (auto batch = reader.NextBatch(); !batch.empty();
+           batch = reader.NextBatch()) {
+        for (const MessageLite* message : batch) callback(record++, *message);
+      }
+      if (!reader.clean_eof() ||
+          record != range.first_record + range.num_records) {
+        ok = false;
+        return;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t num_workers =
+      std::min(static_cast<size_t>(num_threads), ranges.size());
+  for (size_t i = 1; i < num_workers; ++i) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+  return ok.load();
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
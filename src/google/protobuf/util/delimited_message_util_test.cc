@@ -11,9 +11,12 @@
 #include "google/protobuf/util/delimited_message_util.h"
 
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
 
@@ -88,6 +91,112 @@ TEST(DelimitedMessageUtilTest, FailsAtEndOfStream) {
   }
 }
 
+TEST(DelimitedMessageUtilTest, ReaderReadsWriterOutput) {
+  std::vector<protobuf_unittest::TestAllTypes> messages(100);
+  std::vector<const MessageLite*> batch;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (i % 10 == 0) TestUtil::SetAllFields(&messages[i]);
+    messages[i].set_optional_int32(static_cast<int32_t>(i));
+    batch.push_back(&messages[i]);
+  }
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    DelimitedMessageWriter writer(&output);
+    EXPECT_TRUE(writer.Write(messages[0]));
+    EXPECT_TRUE(writer.WriteBatch(absl::MakeConstSpan(batch).subspan(1)));
+    EXPECT_FALSE(writer.HadError());
+  }
+
+  // Read through buffers of various sizes, so that records are split across
+  // them.
+  for (int block_size : {1, 7, 64, -1}) {
+    SCOPED_TRACE(block_size);
+    io::ArrayInputStream input(data.data(), data.size(), block_size);
+    DelimitedMessageReader::Options options;
+    options.batch_size = 16;
+    options.max_arena_size = 0;
+    DelimitedMessageReader reader(
+        &input, &protobuf_unittest::TestAllTypes::default_instance(), options);
+    size_t count = 0;
+    for (auto batch = reader.NextBatch(); !batch.empty();
+         batch = reader.NextBatch()) {
+      EXPECT_LE(batch.size(), 16u);
+      for (const MessageLite* message : batch) {
+        EXPECT_EQ(static_cast<const protobuf_unittest::TestAllTypes*>(message)
+                      ->SerializeAsString(),
+                  messages[count].SerializeAsString());
+        ++count;
+      }
+    }
+    EXPECT_TRUE(reader.clean_eof());
+    EXPECT_EQ(count, messages.size());
+  }
+}
+
+TEST(DelimitedMessageUtilTest, ReaderMatchesParseDelimited) {
+  std::stringstream stream;
+  protobuf_unittest::ForeignMessage message;
+  for (int i = 0; i < 3; ++i) {
+    message.set_c(i);
+    EXPECT_TRUE(SerializeDelimitedToOstream(message, &stream));
+  }
+  const std::string data = stream.str();
+
+  io::ArrayInputStream input(data.data(), data.size());
+  {
+    DelimitedMessageReader::Options options;
+    options.batch_size = 2;
+    DelimitedMessageReader reader(
+        &input, &protobuf_unittest::ForeignMessage::default_instance(),
+        options);
+    EXPECT_EQ(reader.NextBatch().size(), 2u);
+  }
+  // The reader gave back the data it read ahead.
+  bool clean_eof = true;
+  EXPECT_TRUE(ParseDelimitedFromZeroCopyStream(&message, &input, &clean_eof));
+  EXPECT_EQ(message.c(), 2);
+  EXPECT_FALSE(ParseDelimitedFromZeroCopyStream(&message, &input, &clean_eof));
+  EXPECT_TRUE(clean_eof);
+}
+
+TEST(DelimitedMessageUtilTest, ReaderFailsAtEndOfStream) {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    DelimitedMessageWriter writer(&output);
+    protobuf_unittest::ForeignMessage message;
+    message.set_c(42);
+    EXPECT_TRUE(writer.Write(message));
+    EXPECT_TRUE(writer.Write(message));
+  }
+  data.pop_back();
+
+  io::ArrayInputStream input(data.data(), data.size());
+  DelimitedMessageReader reader(
+      &input, &protobuf_unittest::ForeignMessage::default_instance());
+  EXPECT_EQ(reader.NextBatch().size(), 1u);
+  EXPECT_TRUE(reader.NextBatch().empty());
+  EXPECT_FALSE(reader.clean_eof());
+}
+
+TEST(DelimitedMessageUtilTest, ReaderChecksRequiredFields) {
+  std::string data;
+  {
+    io::StringOutputStream output(&data);
+    DelimitedMessageWriter writer(&output);
+    protobuf_unittest::TestRequired message;
+    message.set_a(1);
+    EXPECT_TRUE(writer.Write(message));
+  }
+
+  io::ArrayInputStream input(data.data(), data.size());
+  DelimitedMessageReader reader(
+      &input, &protobuf_unittest::TestRequired::default_instance());
+  EXPECT_TRUE(reader.NextBatch().empty());
+  EXPECT_FALSE(reader.clean_eof());
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -7,9 +7,11 @@
 
 #include "google/protobuf/util/field_mask_util.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/container/btree_map.h"
@@ -21,7 +23,11 @@
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/strip.h"
+#include "google/protobuf/descriptor.pb.h"
+#include "google/protobuf/generated_message_tctable_filter.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/unknown_field_set.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
@@ -159,6 +165,84 @@ void FieldMaskUtil::GetFieldMaskForAllFields(const Descriptor* descriptor,
 }
 
 namespace {
+// Merges the whole of field from source into destination, as
+// FieldMaskUtil::MergeMessageTo() does for the fields at the end of a path.
+void MergeField(const Message& source, const FieldDescriptor* field,
+                const FieldMaskUtil::MergeOptions& options,
+                Message* destination) {
+  const Reflection* source_reflection = source.GetReflection();
+  const Reflection* destination_reflection = destination->GetReflection();
+  if (!field->is_repeated()) {
+    switch (field->cpp_type()) {
+#define COPY_VALUE(TYPE, Name)                                              \
+  case FieldDescriptor::CPPTYPE_##TYPE: {                                   \
+    if (source_reflection->HasField(source, field)) {                       \
+      destination_reflection->Set##Name(                                    \
+          destination, field, source_reflection->Get##Name(source, field)); \
+    } else {                                                                \
+      destination_reflection->ClearField(destination, field);               \
+    }                                                                       \
+    break;                                                                  \
+  }
+      COPY_VALUE(BOOL, Bool)
+      COPY_VALUE(INT32, Int32)
+      COPY_VALUE(INT64, Int64)
+      COPY_VALUE(UINT32, UInt32)
+      COPY_VALUE(UINT64, UInt64)
+      COPY_VALUE(FLOAT, Float)
+      COPY_VALUE(DOUBLE, Double)
+      COPY_VALUE(ENUM, Enum)
+      COPY_VALUE(STRING, String)
+#undef COPY_VALUE
+      case FieldDescriptor::CPPTYPE_MESSAGE: {
+        if (options.replace_message_fields()) {
+          destination_reflection->ClearField(destination, field);
+        }
+        if (source_reflection->HasField(source, field)) {
+          destination_reflection->MutableMessage(destination, field)
+              ->MergeFrom(source_reflection->GetMessage(source, field));
+        }
+        break;
+      }
+    }
+  } else {
+    if (options.replace_repeated_fields()) {
+      destination_reflection->ClearField(destination, field);
+    }
+    switch (field->cpp_type()) {
+#define COPY_REPEATED_VALUE(TYPE, Name)                            \
+  case FieldDescriptor::CPPTYPE_##TYPE: {                          \
+    int size = source_reflection->FieldSize(source, field);        \
+    for (int i = 0; i < size; ++i) {                               \
+      destination_reflection->Add##Name(                           \
+          destination, field,                                      \
+          source_reflection->GetRepeated##Name(source, field, i)); \
+    }                                                              \
+    break;                                                         \
+  }
+      COPY_REPEATED_VALUE(BOOL, Bool)
+      COPY_REPEATED_VALUE(INT32, Int32)
+      COPY_REPEATED_VALUE(INT64, Int64)
+      COPY_REPEATED_VALUE(UINT32, UInt32)
+      COPY_REPEATED_VALUE(UINT64, UInt64)
+      COPY_REPEATED_VALUE(FLOAT, Float)
+      COPY_REPEATED_VALUE(DOUBLE, Double)
+      COPY_REPEATED_VALUE(ENUM, Enum)
+      COPY_REPEATED_VALUE(STRING, String)
+#undef COPY_REPEATED_VALUE
+      case FieldDescriptor::CPPTYPE_MESSAGE: {
+        int size = source_reflection->FieldSize(source, field);
+        for (int i = 0; i < size; ++i) {
+          destination_reflection->AddMessage(destination, field)
+              ->MergeFrom(
+                  source_reflection->GetRepeatedMessage(source, field, i));
+        }
+        break;
+      }
+    }
+  }
+}
+
 // A FieldMaskTree represents a FieldMask in a tree structure. For example,
 // given a FieldMask "foo.bar,foo.baz,bar.baz", the FieldMaskTree will be:
 //
@@ -454,75 +538,7 @@ void FieldMaskTree::MergeMessage(const Node* node, const Message& source,
                    destination_reflection->MutableMessage(destination, field));
       continue;
     }
-    if (!field->is_repeated()) {
-      switch (field->cpp_type()) {
-#define COPY_VALUE(TYPE, Name)                                              \
-  case FieldDescriptor::CPPTYPE_##TYPE: {                                   \
-    if (source_reflection->HasField(source, field)) {                       \
-      destination_reflection->Set##Name(                                    \
-          destination, field, source_reflection->Get##Name(source, field)); \
-    } else {                                                                \
-      destination_reflection->ClearField(destination, field);               \
-    }                                                                       \
-    break;                                                                  \
-  }
-        COPY_VALUE(BOOL, Bool)
-        COPY_VALUE(INT32, Int32)
-        COPY_VALUE(INT64, Int64)
-        COPY_VALUE(UINT32, UInt32)
-        COPY_VALUE(UINT64, UInt64)
-        COPY_VALUE(FLOAT, Float)
-        COPY_VALUE(DOUBLE, Double)
-        COPY_VALUE(ENUM, Enum)
-        COPY_VALUE(STRING, String)
-#undef COPY_VALUE
-        case FieldDescriptor::CPPTYPE_MESSAGE: {
-          if (options.replace_message_fields()) {
-            destination_reflection->ClearField(destination, field);
-          }
-          if (source_reflection->HasField(source, field)) {
-            destination_reflection->MutableMessage(destination, field)
-                ->MergeFrom(source_reflection->GetMessage(source, field));
-          }
-          break;
-        }
-      }
-    } else {
-      if (options.replace_repeated_fields()) {
-        destination_reflection->ClearField(destination, field);
-      }
-      switch (field->cpp_type()) {
-#define COPY_REPEATED_VALUE(TYPE, Name)                            \
-  case FieldDescriptor::CPPTYPE_##TYPE: {                          \
-    int size = source_reflection->FieldSize(source, field);        \
-    for (int i = 0; i < size; ++i) {                               \
-      destination_reflection->Add##Name(                           \
-          destination, field,                                      \
-          source_reflection->GetRepeated##Name(source, field, i)); \
-    }                                                              \
-    break;                                                         \
-  }
-        COPY_REPEATED_VALUE(BOOL, Bool)
-        COPY_REPEATED_VALUE(INT32, Int32)
-        COPY_REPEATED_VALUE(INT64, Int64)
-        COPY_REPEATED_VALUE(UINT32, UInt32)
-        COPY_REPEATED_VALUE(UINT64, UInt64)
-        COPY_REPEATED_VALUE(FLOAT, Float)
-        COPY_REPEATED_VALUE(DOUBLE, Double)
-        COPY_REPEATED_VALUE(ENUM, Enum)
-        COPY_REPEATED_VALUE(STRING, String)
-#undef COPY_REPEATED_VALUE
-        case FieldDescriptor::CPPTYPE_MESSAGE: {
-          int size = source_reflection->FieldSize(source, field);
-          for (int i = 0; i < size; ++i) {
-            destination_reflection->AddMessage(destination, field)
-                ->MergeFrom(
-                    source_reflection->GetRepeatedMessage(source, field, i));
-          }
-          break;
-        }
-      }
-    }
+    MergeField(source, field, options, destination);
   }
 }
 
@@ -690,6 +706,246 @@ bool FieldMaskUtil::TrimMessage(const FieldMask& mask, Message* message,
   return tree.TrimMessage(ABSL_DIE_IF_NULL(message));
 }
 
+// The tree a CompiledFieldMask is compiled from.  Unlike FieldMaskTree, it
+// holds resolved fields, keyed by number.  A node without children stands for
+// its whole field.
+struct CompiledFieldMask::CompileNode {
+  const FieldDescriptor* field = nullptr;
+  absl::btree_map<int, std::unique_ptr<CompileNode>> children;
+};
+
+void CompiledFieldMask::AddPath(
+    CompileNode* root, const std::vector<const FieldDescriptor*>& fields) {
+  CompileNode* node = root;
+  for (size_t i = 0; i < fields.size(); ++i) {
+    std::unique_ptr<CompileNode>& child =
+        node->children[fields[i]->number()];
+    if (child == nullptr) {
+      child = absl::make_unique<CompileNode>();
+      child->field = fields[i];
+    } else if (child->children.empty()) {
+      // The path is covered by one already in the tree.
+      return;
+    }
+    node = child.get();
+  }
+  // The path covers all the paths below it.
+  node->children.clear();
+}
+
+void CompiledFieldMask::AddRequiredFields(CompileNode* node,
+                                          const Descriptor* descriptor) {
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const FieldDescriptor* field = descriptor->field(i);
+    auto it = node->children.find(field->number());
+    if (field->is_required()) {
+      if (it == node->children.end()) {
+        auto child = absl::make_unique<CompileNode>();
+        child->field = field;
+        it = node->children.emplace(field->number(), std::move(child)).first;
+      } else if (it->second->children.empty()) {
+        continue;
+      }
+      if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+        AddRequiredFields(it->second.get(), field->message_type());
+      }
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+               it != node->children.end() && !it->second->children.empty()) {
+      AddRequiredFields(it->second.get(), field->message_type());
+    }
+  }
+}
+
+CompiledFieldMask::CompiledFieldMask(const Descriptor* descriptor,
+                                     const FieldMask& mask)
+    : descriptor_(ABSL_DIE_IF_NULL(descriptor)),
+      empty_(mask.paths().empty()) {
+  CompileNode root;
+  std::vector<const FieldDescriptor*> fields;
+  for (const std::string& path : mask.paths()) {
+    if (!FieldMaskUtil::GetFieldDescriptors(descriptor, path, &fields)) {
+      ABSL_LOG(ERROR) << "Invalid path \"" << path << "\" for message "
+                      << descriptor->full_name();
+      continue;
+    }
+    AddPath(&root, fields);
+  }
+  root_ = AddNode(descriptor, root);
+
+  // The parser only handles message_set_wire_format types as a whole.
+  auto parse_filter = std::make_shared<internal::ParseFieldFilter>();
+  parse_filter->nodes.resize(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    for (const Entry& entry : nodes_[i].entries) {
+      const bool parse_whole =
+          entry.child < 0 ||
+          entry.field->message_type()->options().message_set_wire_format();
+      parse_filter->nodes[i].push_back(
+          {static_cast<uint32_t>(entry.field->number()),
+           parse_whole ? -1 : entry.child});
+    }
+  }
+  parse_filter->root = root_;
+  parse_filter_ = std::move(parse_filter);
+
+  if (!empty_) {
+    AddRequiredFields(&root, descriptor);
+    required_root_ = AddNode(descriptor, root);
+  }
+}
+
+int CompiledFieldMask::AddNode(const Descriptor* descriptor,
+                               const CompileNode& compile_node) {
+  Node node;
+  node.field_bits.resize((descriptor->field_count() + 63) / 64);
+  for (const auto& kv : compile_node.children) {
+    const CompileNode& child = *kv.second;
+    const int index = child.field->index();
+    node.field_bits[index / 64] |= uint64_t{1} << (index % 64);
+    node.entries.push_back(
+        {child.field, child.children.empty()
+                          ? -1
+                          : AddNode(child.field->message_type(), child)});
+  }
+  nodes_.push_back(std::move(node));
+  return static_cast<int>(nodes_.size()) - 1;
+}
+
+const CompiledFieldMask::Entry* CompiledFieldMask::Node::Find(
+    int number) const {
+  auto it = std::lower_bound(entries.begin(), entries.end(), number,
+                             [](const Entry& entry, int number) {
+                               return entry.field->number() < number;
+                             });
+  if (it == entries.end() || it->field->number() != number) return nullptr;
+  return &*it;
+}
+
+void CompiledFieldMask::MergeMessageTo(
+    const Message& source, const FieldMaskUtil::MergeOptions& options,
+    Message* destination) const {
+  ABSL_CHECK(source.GetDescriptor() == descriptor_);
+  ABSL_CHECK(destination->GetDescriptor() == descriptor_);
+  MergeMessage(nodes_[root_], source, options, destination);
+}
+
+void CompiledFieldMask::MergeMessage(const Node& node, const Message& source,
+                                     const FieldMaskUtil::MergeOptions& options,
+                                     Message* destination) const {
+  for (const Entry& entry : node.entries) {
+    if (entry.child >= 0) {
+      MergeMessage(nodes_[entry.child],
+                   source.GetReflection()->GetMessage(source, entry.field),
+                   options,
+                   destination->GetReflection()->MutableMessage(destination,
+                                                                entry.field));
+    } else {
+      MergeField(source, entry.field, options, destination);
+    }
+  }
+}
+
+bool CompiledFieldMask::TrimMessage(Message* message) const {
+  ABSL_CHECK(ABSL_DIE_IF_NULL(message)->GetDescriptor() == descriptor_);
+  if (empty_) return false;
+  return TrimMessage(nodes_[root_], message);
+}
+
+bool CompiledFieldMask::TrimMessage(
+    Message* message, const FieldMaskUtil::TrimOptions& options) const {
+  if (!options.keep_required_fields()) return TrimMessage(message);
+  ABSL_CHECK(ABSL_DIE_IF_NULL(message)->GetDescriptor() == descriptor_);
+  if (empty_) return false;
+  return TrimMessage(nodes_[required_root_], message);
+}
+
+bool CompiledFieldMask::TrimMessage(const Node& node, Message* message) const {
+  const Reflection* reflection = message->GetReflection();
+  const Descriptor* descriptor = message->GetDescriptor();
+  bool modified = false;
+  for (int index = 0; index < descriptor->field_count(); ++index) {
+    const FieldDescriptor* field = descriptor->field(index);
+    if (!node.Contains(index)) {
+      if (field->is_repeated() ? reflection->FieldSize(*message, field) != 0
+                               : reflection->HasField(*message, field)) {
+        modified = true;
+        reflection->ClearField(message, field);
+      }
+      continue;
+    }
+    if (field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE ||
+        field->is_repeated()) {
+      continue;
+    }
+    const Entry* entry = node.Find(field->number());
+    if (entry->child >= 0 && reflection->HasField(*message, field)) {
+      modified = TrimMessage(nodes_[entry->child],
+                             reflection->MutableMessage(message, field)) ||
+                 modified;
+    }
+  }
+  return modified;
+}
+
+void CompiledFieldMask::CopyMessageTo(const Message& source,
+                                      Message* destination) const {
+  ABSL_CHECK(source.GetDescriptor() == descriptor_);
+  ABSL_CHECK(destination->GetDescriptor() == descriptor_);
+  if (empty_) {
+    destination->CopyFrom(source);
+    return;
+  }
+  destination->Clear();
+  CopyMessage(nodes_[root_], source, destination);
+}
+
+void CompiledFieldMask::CopyMessage(const Node& node, const Message& source,
+                                    Message* destination) const {
+  const Reflection* reflection = source.GetReflection();
+  for (const Entry& entry : node.entries) {
+    if (entry.child < 0) {
+      MergeField(source, entry.field, FieldMaskUtil::MergeOptions(),
+                 destination);
+    } else if (reflection->HasField(source, entry.field)) {
+      CopyMessage(nodes_[entry.child],
+                  reflection->GetMessage(source, entry.field),
+                  destination->GetReflection()->MutableMessage(destination,
+                                                               entry.field));
+    }
+  }
+  // Trimming only clears regular fields, so extensions and unknown fields are
+  // kept.
+  if (source.GetDescriptor()->extension_range_count() > 0) {
+    std::vector<const FieldDescriptor*> fields;
+    reflection->ListFields(source, &fields);
+    for (const FieldDescriptor* field : fields) {
+      if (field->is_extension()) {
+        MergeField(source, field, FieldMaskUtil::MergeOptions(), destination);
+      }
+    }
+  }
+  const UnknownFieldSet& unknown_fields = reflection->GetUnknownFields(source);
+  if (!unknown_fields.empty()) {
+    destination->GetReflection()->MutableUnknownFields(destination)->MergeFrom(
+        unknown_fields);
+  }
+}
+
+bool CompiledFieldMask::ParsePartialFromString(absl::string_view data,
+                                               Message* message) const {
+  ABSL_CHECK(ABSL_DIE_IF_NULL(message)->GetDescriptor() == descriptor_);
+  if (empty_) return message->ParsePartialFromString(data);
+  message->Clear();
+  return internal::MergeFilteredFrom(data, message, *parse_filter_);
+}
+
+bool CompiledFieldMask::MergePartialFromCodedStream(
+    io::CodedInputStream* input, Message* message) const {
+  ABSL_CHECK(ABSL_DIE_IF_NULL(message)->GetDescriptor() == descriptor_);
+  if (empty_) return message->MergePartialFromCodedStream(input);
+  return internal::MergeFilteredFrom(input, message, *parse_filter_);
+}
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -11,6 +11,7 @@
 #define GOOGLE_PROTOBUF_UTIL_FIELD_MASK_UTIL_H__
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,12 +19,17 @@
 #include "absl/log/absl_check.h"
 #include "absl/strings/string_view.h"
 #include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
 
 // Must be included last.
 #include "google/protobuf/port_def.inc"
 
 namespace google {
 namespace protobuf {
+namespace internal {
+struct ParseFieldFilter;
+}  // namespace internal
+
 namespace util {
 
 class PROTOBUF_EXPORT FieldMaskUtil {
@@ -233,6 +239,117 @@ class PROTOBUF_EXPORT FieldMaskUtil::TrimOptions {
   bool keep_required_fields_;
 };
 
+// A FieldMask compiled for one message type, to apply the same mask to many
+// messages.  FieldMaskUtil::MergeMessageTo() and TrimMessage() split the paths
+// of the mask and look up their fields by name on every call.  A
+// CompiledFieldMask resolves the fields once, and keeps, for the message and
+// for every submessage that is only partly in the mask, the fields in the mask
+// both as a bitset over the fields of the message type and as a list ordered by
+// field number.
+//
+// Merging and trimming with a CompiledFieldMask has the same result as with the
+// FieldMask it was compiled from, except that paths which are not valid for
+// the message type (see FieldMaskUtil::GetFieldDescriptors()) are logged and
+// otherwise ignored.  As with FieldMaskUtil, an empty mask means all fields
+// when trimming and no fields when merging.
+//
+// A CompiledFieldMask is not modified after it has been created, so it can be
+// used from several threads at once.
+class PROTOBUF_EXPORT CompiledFieldMask {
+ public:
+  CompiledFieldMask(const Descriptor* descriptor,
+                    const google::protobuf::FieldMask& mask);
+
+  const Descriptor* descriptor() const { return descriptor_; }
+
+  // Same as FieldMaskUtil::MergeMessageTo().
+  void MergeMessageTo(const Message& source,
+                      const FieldMaskUtil::MergeOptions& options,
+                      Message* destination) const;
+
+  // Same as FieldMaskUtil::TrimMessage().
+  bool TrimMessage(Message* message) const;
+  bool TrimMessage(Message* message,
+                   const FieldMaskUtil::TrimOptions& options) const;
+
+  // Replaces the contents of destination with the fields of source that are in
+  // the mask, and the extensions and unknown fields of source and of the
+  // submessages that are partly in the mask.  This gives the same message as
+  // copying source and trimming the copy, without copying the fields that
+  // would be trimmed.
+  void CopyMessageTo(const Message& source, Message* destination) const;
+
+  // Parses a message from input and merges the fields that are in the mask
+  // into message.  The other fields, and unknown fields, are skipped on the
+  // wire without being parsed or stored, and submessages that are partly in
+  // the mask are parsed field by field, all by the table-driven parser.  Map
+  // fields are parsed whole.  An empty mask parses all fields.
+  // Like Message::MergePartialFromCodedStream(), this does not check that
+  // required fields are set.  Returns false if the input is malformed.
+  bool MergePartialFromCodedStream(io::CodedInputStream* input,
+                                   Message* message) const;
+  // Clears message and then parses data into it, like above.
+  bool ParsePartialFromString(absl::string_view data, Message* message) const;
+
+ private:
+  // A field in the mask, with the index of the node for the fields of its
+  // message type that are in the mask, or -1 if it is in the mask as a whole.
+  struct Entry {
+    const FieldDescriptor* field;
+    int child;
+  };
+
+  // The fields of a message type that are in the mask.
+  struct Node {
+    // Returns true if the field with the given index in its message type is in
+    // the mask.
+    bool Contains(int index) const {
+      return (field_bits[index / 64] >> (index % 64)) & 1;
+    }
+    // Returns the entry of the field with the given number, or nullptr if it
+    // is not in the mask.
+    const Entry* Find(int number) const;
+
+    // Ordered by field number.
+    std::vector<Entry> entries;
+    // Bit i is set if field(i) of the message type is in the mask.
+    std::vector<uint64_t> field_bits;
+  };
+
+  struct CompileNode;
+
+  // Adds the path made of fields to the tree, like FieldMaskTree::AddPath().
+  static void AddPath(CompileNode* root,
+                      const std::vector<const FieldDescriptor*>& fields);
+  // Adds the required fields of the messages in the tree to it, like
+  // FieldMaskTree::AddRequiredFieldPath().
+  static void AddRequiredFields(CompileNode* node,
+                                const Descriptor* descriptor);
+
+  // Adds the nodes for compile_node and its descendants to nodes_, and returns
+  // the index of the one for compile_node.
+  int AddNode(const Descriptor* descriptor, const CompileNode& compile_node);
+
+  void MergeMessage(const Node& node, const Message& source,
+                    const FieldMaskUtil::MergeOptions& options,
+                    Message* destination) const;
+  bool TrimMessage(const Node& node, Message* message) const;
+  void CopyMessage(const Node& node, const Message& source,
+                   Message* destination) const;
+
+  const Descriptor* descriptor_;
+  // True if the mask has no paths.
+  bool empty_;
+  std::vector<Node> nodes_;
+  // The node of the message type, and the one that additionally keeps the
+  // required fields for TrimOptions::keep_required_fields().
+  int root_ = -1;
+  int required_root_ = -1;
+  // The fields in the mask, as nodes_ from root_, for parsing.  Held by
+  // pointer to keep the internal parser types out of this header.
+  std::shared_ptr<const internal::ParseFieldFilter> parse_filter_;
+};
+
 }  // namespace util
 }  // namespace protobuf
 }  // namespace google
@@ -9,12 +9,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/field_mask.pb.h"
 #include <gtest/gtest.h>
 #include "google/protobuf/test_util.h"
 #include "google/protobuf/unittest.pb.h"
+#include "google/protobuf/unknown_field_set.h"
 
 namespace google {
 namespace protobuf {
@@ -93,6 +95,7 @@ TEST_F(SnakeCaseCamelCaseTest, RoundTripTest) {
 using google::protobuf::FieldMask;
 using protobuf_unittest::NestedTestAllTypes;
 using protobuf_unittest::TestAllTypes;
+using protobuf_unittest::TestFieldOrderings;
 using protobuf_unittest::TestRequired;
 using protobuf_unittest::TestRequiredMessage;
 
@@ -804,6 +807,188 @@ TEST(FieldMaskUtilTest, TrimMessageReturnValue) {
   // supported.
 }
 
+// Masks for NestedTestAllTypes, some with paths that cover each other.
+const char* const kCompiledMasks[] = {
+    "",
+    "payload.optional_int32",
+    "payload.optional_nested_message.bb,payload.repeated_string",
+    "payload.optional_foreign_message,payload.optionalgroup.a,"
+    "payload.oneof_nested_message.bb,payload.oneof_uint32",
+    "child.payload,child.payload.optional_int64,payload.repeated_nested_enum",
+    "child.child.payload.optional_string,repeated_child",
+    "payload.default_string",
+    "no_such_field",
+};
+
+NestedTestAllTypes MakeNestedTestAllTypes() {
+  NestedTestAllTypes message;
+  TestUtil::SetAllFields(message.mutable_payload());
+  TestUtil::SetAllFields(message.mutable_child()->mutable_payload());
+  message.mutable_child()->mutable_child()->mutable_payload()
+      ->set_optional_string("grandchild");
+  message.add_repeated_child()->mutable_payload()->set_optional_int32(1);
+  return message;
+}
+
+TEST(FieldMaskUtilTest, CompiledMergeMessage) {
+  const NestedTestAllTypes src = MakeNestedTestAllTypes();
+  for (const char* paths : kCompiledMasks) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(NestedTestAllTypes::descriptor(), mask);
+    for (int i = 0; i < 4; ++i) {
+      FieldMaskUtil::MergeOptions options;
+      options.set_replace_message_fields(i & 1);
+      options.set_replace_repeated_fields(i & 2);
+      NestedTestAllTypes expected = MakeNestedTestAllTypes();
+      expected.mutable_payload()->clear_optional_int32();
+      NestedTestAllTypes dst = expected;
+      FieldMaskUtil::MergeMessageTo(src, mask, options, &expected);
+      compiled.MergeMessageTo(src, options, &dst);
+      EXPECT_EQ(dst.DebugString(), expected.DebugString());
+    }
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledTrimMessage) {
+  for (const char* paths : kCompiledMasks) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(NestedTestAllTypes::descriptor(), mask);
+    NestedTestAllTypes expected = MakeNestedTestAllTypes();
+    NestedTestAllTypes trimmed = expected;
+    EXPECT_EQ(compiled.TrimMessage(&trimmed),
+              FieldMaskUtil::TrimMessage(mask, &expected));
+    EXPECT_EQ(trimmed.DebugString(), expected.DebugString());
+    EXPECT_FALSE(compiled.TrimMessage(&trimmed));
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledTrimMessageKeepsRequiredFields) {
+  TestRequiredMessage message;
+  message.mutable_required_message()->set_a(1);
+  message.mutable_required_message()->set_dummy2(2);
+  message.mutable_optional_message()->set_b(3);
+  message.mutable_optional_message()->set_dummy4(4);
+  message.add_repeated_message()->set_c(5);
+  for (const char* paths :
+       {"optional_message.dummy4", "required_message.dummy2",
+        "optional_message", "repeated_message"}) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(TestRequiredMessage::descriptor(), mask);
+    for (bool keep_required_fields : {false, true}) {
+      FieldMaskUtil::TrimOptions options;
+      options.set_keep_required_fields(keep_required_fields);
+      TestRequiredMessage expected = message;
+      TestRequiredMessage trimmed = message;
+      EXPECT_EQ(compiled.TrimMessage(&trimmed, options),
+                FieldMaskUtil::TrimMessage(mask, &expected, options));
+      EXPECT_EQ(trimmed.DebugString(), expected.DebugString());
+    }
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledCopyMessage) {
+  const NestedTestAllTypes src = MakeNestedTestAllTypes();
+  for (const char* paths : kCompiledMasks) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(NestedTestAllTypes::descriptor(), mask);
+    NestedTestAllTypes expected = src;
+    compiled.TrimMessage(&expected);
+    NestedTestAllTypes dst;
+    dst.mutable_payload()->set_optional_int32(-1);
+    compiled.CopyMessageTo(src, &dst);
+    EXPECT_EQ(dst.DebugString(), expected.DebugString());
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledCopyMessageKeepsExtensionsAndUnknownFields) {
+  TestFieldOrderings src;
+  src.set_my_int(1);
+  src.set_my_string("foo");
+  src.set_my_float(2.0);
+  src.mutable_optional_nested_message()->set_bb(3);
+  src.mutable_optional_nested_message()->set_oo(4);
+  src.SetExtension(protobuf_unittest::my_extension_int, 5);
+  src.SetExtension(protobuf_unittest::my_extension_string, "bar");
+  src.GetReflection()->MutableUnknownFields(&src)->AddVarint(1000, 6);
+  src.GetReflection()
+      ->MutableUnknownFields(src.mutable_optional_nested_message())
+      ->AddVarint(1000, 7);
+  for (const char* paths :
+       {"my_int,optional_nested_message.bb", "my_string", "my_float"}) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(TestFieldOrderings::descriptor(), mask);
+    TestFieldOrderings expected = src;
+    compiled.TrimMessage(&expected);
+    TestFieldOrderings dst;
+    dst.SetExtension(protobuf_unittest::my_extension_int, -1);
+    compiled.CopyMessageTo(src, &dst);
+    EXPECT_EQ(dst.DebugString(), expected.DebugString());
+    EXPECT_EQ(dst.GetExtension(protobuf_unittest::my_extension_int), 5);
+    EXPECT_EQ(dst.GetReflection()->GetUnknownFields(dst).field_count(), 1);
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledParse) {
+  const NestedTestAllTypes src = MakeNestedTestAllTypes();
+  const std::string data = src.SerializeAsString();
+  for (const char* paths : kCompiledMasks) {
+    SCOPED_TRACE(paths);
+    FieldMask mask;
+    FieldMaskUtil::FromString(paths, &mask);
+    CompiledFieldMask compiled(NestedTestAllTypes::descriptor(), mask);
+    NestedTestAllTypes expected = src;
+    compiled.TrimMessage(&expected);
+    NestedTestAllTypes parsed;
+    ASSERT_TRUE(compiled.ParsePartialFromString(data, &parsed));
+    EXPECT_EQ(parsed.DebugString(), expected.DebugString());
+
+    // Truncated input fails, whether or not the cut is in a masked field.
+    for (size_t size : {data.size() - 1, data.size() / 2}) {
+      EXPECT_FALSE(
+          compiled.ParsePartialFromString(data.substr(0, size), &parsed));
+    }
+  }
+}
+
+TEST(FieldMaskUtilTest, CompiledFieldMaskIgnoresInvalidPaths) {
+  FieldMask mask;
+  FieldMaskUtil::FromString(
+      "payload.optional_int32,payload.no_such_field,payload.repeated_int32.x",
+      &mask);
+  CompiledFieldMask compiled(NestedTestAllTypes::descriptor(), mask);
+  NestedTestAllTypes message = MakeNestedTestAllTypes();
+  EXPECT_TRUE(compiled.TrimMessage(&message));
+  NestedTestAllTypes expected;
+  expected.mutable_payload()->set_optional_int32(
+      MakeNestedTestAllTypes().payload().optional_int32());
+  EXPECT_EQ(message.DebugString(), expected.DebugString());
+}
+
+TEST(FieldMaskUtilTest, CompiledParseSkipsUnknownFields) {
+  TestAllTypes src;
+  TestUtil::SetAllFields(&src);
+  std::string data = src.SerializeAsString();
+  // Field 1000 is not known to TestAllTypes.
+  data += std::string("\xc0\x3e\x01", 3);
+  FieldMask mask;
+  FieldMaskUtil::FromString("optional_int32", &mask);
+  CompiledFieldMask compiled(TestAllTypes::descriptor(), mask);
+  TestAllTypes parsed;
+  ASSERT_TRUE(compiled.ParsePartialFromString(data, &parsed));
+  TestAllTypes expected;
+  expected.set_optional_int32(src.optional_int32());
+  EXPECT_EQ(parsed.SerializeAsString(), expected.SerializeAsString());
+}
 
 }  // namespace
 }  // namespace util
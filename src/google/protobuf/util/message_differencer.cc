@@ -12,16 +12,21 @@
 #include "google/protobuf/util/message_differencer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <thread>  // NOLINT(build/c++11)
 #include <utility>
+#include <vector>
 
 #include "google/protobuf/descriptor.pb.h"
 #include "absl/container/fixed_array.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "absl/log/absl_check.h"
 #include "absl/log/absl_log.h"
 #include "absl/strings/escaping.h"
@@ -149,7 +154,33 @@ class MessageDifferencer::MultipleFieldsMapKeyComparator
     return true;
   }
 
+  // Returns a hash of the key fields of message, which is the same for all
+  // messages that IsMatch() considers to have the same key.
+  size_t HashKey(const Message& message) const {
+    size_t hash = 0;
+    for (const auto& path : key_field_paths_) {
+      hash = absl::HashOf(hash, HashKeyInternal(message, path, 0));
+    }
+    return hash;
+  }
+
  private:
+  size_t HashKeyInternal(
+      const Message& message,
+      const std::vector<const FieldDescriptor*>& key_field_path,
+      int path_index) const {
+    const FieldDescriptor* field = key_field_path[path_index];
+    if (path_index == static_cast<int64_t>(key_field_path.size() - 1)) {
+      // Like IsMatchInternal(), hash the value whether it is set or not.
+      return message_differencer_->HashField(message, field);
+    }
+    const Reflection* reflection = message.GetReflection();
+    if (!reflection->HasField(message, field)) return 0;
+    return absl::HashOf(
+        1, HashKeyInternal(reflection->GetMessage(message, field),
+                           key_field_path, path_index + 1));
+  }
+
   bool IsMatchInternal(
       const Message& message1, const Message& message2, int unpacked_any,
       const std::vector<SpecificField>& parent_fields,
@@ -1897,6 +1928,64 @@ bool MaximumMatcher::FindArgumentPathDFS(int v, std::vector<bool>* visited) {
   return false;
 }
 
+// Below this many unmatched elements, comparing them pairwise is about as fast
+// as hashing them first.
+constexpr int kMinElementsToMatchByHash = 8;
+
+// The number of elements hashed at a time by each hashing thread, and the
+// minimum number of elements worth starting another thread for.
+constexpr int kElementsPerHashTask = 1024;
+
+// Hashes a float or double compared exactly.  NaNs are equal to each other or
+// to nothing, depending on the comparator, so they all get the same hash, and
+// -0.0 == 0.0.
+template <typename T>
+size_t HashFloatingPoint(T value) {
+  if (std::isnan(value)) return 0;
+  return absl::HashOf(value == 0 ? T{0} : value);
+}
+
+// Returns true if the singular, non-message field is set to its default value,
+// so that MessageDifferencer::Equivalent() treats it as unset.
+bool HasDefaultValue(const Message& message, const FieldDescriptor* field) {
+  const Reflection* reflection = message.GetReflection();
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_INT32:
+      return reflection->GetInt32(message, field) ==
+             field->default_value_int32();
+    case FieldDescriptor::CPPTYPE_INT64:
+      return reflection->GetInt64(message, field) ==
+             field->default_value_int64();
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return reflection->GetUInt32(message, field) ==
+             field->default_value_uint32();
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return reflection->GetUInt64(message, field) ==
+             field->default_value_uint64();
+    case FieldDescriptor::CPPTYPE_DOUBLE: {
+      const double value = reflection->GetDouble(message, field);
+      return value == field->default_value_double() || std::isnan(value);
+    }
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      const float value = reflection->GetFloat(message, field);
+      return value == field->default_value_float() || std::isnan(value);
+    }
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return reflection->GetBool(message, field) == field->default_value_bool();
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return reflection->GetEnumValue(message, field) ==
+             field->default_value_enum()->number();
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      return reflection->GetStringReference(message, field, &scratch) ==
+             field->default_value_string();
+    }
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      break;
+  }
+  return false;
+}
+
 }  // namespace
 
 bool MessageDifferencer::MatchRepeatedFieldIndices(
@@ -1985,68 +2074,78 @@ bool MessageDifferencer::MatchRepeatedFieldIndices(
         }
       }
     }
-    for (int i = start_offset; i < count1; ++i) {
-      // Indicates any matched elements for this repeated field.
-      bool match = false;
-      int matched_j = -1;
+    if (!is_treated_as_smart_set && CanMatchByHash(key_comparator) &&
+        count2 - start_offset >= kMinElementsToMatchByHash) {
+      success = MatchRepeatedFieldIndicesByHash(
+          message1, message2, unpacked_any, repeated_field, key_comparator,
+          parent_fields, start_offset, reporter == nullptr, match_list1,
+          match_list2);
+      if (!success && reporter == nullptr) return false;
+    } else {
+      for (int i = start_offset; i < count1; ++i) {
+        // Indicates any matched elements for this repeated field.
+        bool match = false;
+        int matched_j = -1;
+
+        for (int j = start_offset; j < count2; j++) {
+          if (match_list2->at(j) != -1) {
+            if (!is_treated_as_smart_set || num_diffs_list1[i] == 0 ||
+                num_diffs_list1[match_list2->at(j)] == 0) {
+              continue;
+            }
+          }
 
-      for (int j = start_offset; j < count2; j++) {
-        if (match_list2->at(j) != -1) {
-          if (!is_treated_as_smart_set || num_diffs_list1[i] == 0 ||
-              num_diffs_list1[match_list2->at(j)] == 0) {
-            continue;
+          if (is_treated_as_smart_set) {
+            num_diffs_reporter.Reset();
+            match =
+                IsMatch(repeated_field, key_comparator, &message1, &message2,
+                        unpacked_any, parent_fields, &num_diffs_reporter, i, j);
+          } else {
+            match =
+                IsMatch(repeated_field, key_comparator, &message1, &message2,
+                        unpacked_any, parent_fields, nullptr, i, j);
           }
-        }
 
-        if (is_treated_as_smart_set) {
-          num_diffs_reporter.Reset();
-          match =
-              IsMatch(repeated_field, key_comparator, &message1, &message2,
-                      unpacked_any, parent_fields, &num_diffs_reporter, i, j);
-        } else {
-          match = IsMatch(repeated_field, key_comparator, &message1, &message2,
-                          unpacked_any, parent_fields, nullptr, i, j);
-        }
+          if (is_treated_as_smart_set) {
+            if (match) {
+              num_diffs_list1[i] = 0;
+            } else if (repeated_field->cpp_type() ==
+                       FieldDescriptor::CPPTYPE_MESSAGE) {
+              // Replace with the one with fewer diffs.
+              const int32_t num_diffs = num_diffs_reporter.GetNumDiffs();
+              if (num_diffs < num_diffs_list1[i]) {
+                // If j has been already matched to some element, ensure the
+                // current num_diffs is smaller.
+                if (match_list2->at(j) == -1 ||
+                    num_diffs < num_diffs_list1[match_list2->at(j)]) {
+                  num_diffs_list1[i] = num_diffs;
+                  match = true;
+                }
+              }
+            }
+          }
 
-        if (is_treated_as_smart_set) {
           if (match) {
-            num_diffs_list1[i] = 0;
-          } else if (repeated_field->cpp_type() ==
-                     FieldDescriptor::CPPTYPE_MESSAGE) {
-            // Replace with the one with fewer diffs.
-            const int32_t num_diffs = num_diffs_reporter.GetNumDiffs();
-            if (num_diffs < num_diffs_list1[i]) {
-              // If j has been already matched to some element, ensure the
-              // current num_diffs is smaller.
-              if (match_list2->at(j) == -1 ||
-                  num_diffs < num_diffs_list1[match_list2->at(j)]) {
-                num_diffs_list1[i] = num_diffs;
-                match = true;
-              }
+            matched_j = j;
+            if (!is_treated_as_smart_set || num_diffs_list1[i] == 0) {
+              break;
             }
           }
         }
 
+        match = (matched_j != -1);
         if (match) {
-          matched_j = j;
-          if (!is_treated_as_smart_set || num_diffs_list1[i] == 0) {
-            break;
+          if (is_treated_as_smart_set && match_list2->at(matched_j) != -1) {
+            // This is to revert the previously matched index in list2.
+            match_list1->at(match_list2->at(matched_j)) = -1;
+            match = false;
           }
+          match_list1->at(i) = matched_j;
+          match_list2->at(matched_j) = i;
         }
+        if (!match && reporter == nullptr) return false;
+        success = success && match;
       }
-
-      match = (matched_j != -1);
-      if (match) {
-        if (is_treated_as_smart_set && match_list2->at(matched_j) != -1) {
-          // This is to revert the previously matched index in list2.
-          match_list1->at(match_list2->at(matched_j)) = -1;
-          match = false;
-        }
-        match_list1->at(i) = matched_j;
-        match_list2->at(matched_j) = i;
-      }
-      if (!match && reporter == nullptr) return false;
-      success = success && match;
     }
   }
 
@@ -2059,6 +2158,214 @@ bool MessageDifferencer::MatchRepeatedFieldIndices(
   return success;
 }
 
+bool MessageDifferencer::CanMatchByHash(
+    const MapKeyComparator* key_comparator) const {
+  // Hashes cannot tell which values a custom comparator or ignore criteria
+  // consider equal, and partial comparison is not symmetric.
+  if (!match_repeated_fields_by_hash_ || scope_ == PARTIAL ||
+      field_comparator_kind_ != kFCDefault || !ignore_criteria_.empty()) {
+    return false;
+  }
+  // Only the MapKeyComparators created by TreatAsMap*() are known to compare
+  // key fields.
+  return key_comparator == nullptr ||
+         std::find(owned_key_comparators_.begin(), owned_key_comparators_.end(),
+                   key_comparator) != owned_key_comparators_.end();
+}
+
+bool MessageDifferencer::MatchRepeatedFieldIndicesByHash(
+    const Message& message1, const Message& message2, int unpacked_any,
+    const FieldDescriptor* repeated_field,
+    const MapKeyComparator* key_comparator,
+    const std::vector<SpecificField>& parent_fields, int start_offset,
+    bool stop_at_mismatch, std::vector<int>* match_list1,
+    std::vector<int>* match_list2) {
+  const int count1 = static_cast<int>(match_list1->size());
+  const int count2 = static_cast<int>(match_list2->size());
+  const std::vector<size_t> hashes1 = HashRepeatedFieldElements(
+      message1, repeated_field, key_comparator, start_offset, count1);
+  const std::vector<size_t> hashes2 = HashRepeatedFieldElements(
+      message2, repeated_field, key_comparator, start_offset, count2);
+
+  // The elements of message2 with the same hash, in increasing order.  Since
+  // matches are never undone, the ones before `first` are all matched.
+  struct Candidates {
+    std::vector<int> indices;
+    size_t first = 0;
+  };
+  absl::flat_hash_map<size_t, Candidates> candidates;
+  for (int j = start_offset; j < count2; ++j) {
+    candidates[hashes2[j - start_offset]].indices.push_back(j);
+  }
+
+  bool success = true;
+  for (int i = start_offset; i < count1; ++i) {
+    // Elements that match have the same hash, so this finds the same element
+    // as trying all unmatched elements of message2 in order would.
+    int matched_j = -1;
+    auto it = candidates.find(hashes1[i - start_offset]);
+    if (it != candidates.end()) {
+      Candidates& same_hash = it->second;
+      while (same_hash.first < same_hash.indices.size() &&
+             match_list2->at(same_hash.indices[same_hash.first]) != -1) {
+        ++same_hash.first;
+      }
+      for (size_t k = same_hash.first; k < same_hash.indices.size(); ++k) {
+        const int j = same_hash.indices[k];
+        if (match_list2->at(j) == -1 &&
+            IsMatch(repeated_field, key_comparator, &message1, &message2,
+                    unpacked_any, parent_fields, nullptr, i, j)) {
+          matched_j = j;
+          break;
+        }
+      }
+    }
+    if (matched_j != -1) {
+      match_list1->at(i) = matched_j;
+      match_list2->at(matched_j) = i;
+    } else {
+      if (stop_at_mismatch) return false;
+      success = false;
+    }
+  }
+  return success;
+}
+
+std::vector<size_t> MessageDifferencer::HashRepeatedFieldElements(
+    const Message& message, const FieldDescriptor* repeated_field,
+    const MapKeyComparator* key_comparator, int begin, int end) const {
+  std::vector<size_t> hashes(end - begin);
+  const Reflection* reflection = message.GetReflection();
+  auto hash_elements = [&](int first, int last) {
+    for (int i = first; i < last; ++i) {
+      hashes[i - begin] =
+          key_comparator == nullptr
+              ? HashFieldValue(message, repeated_field, i)
+              : static_cast<const MultipleFieldsMapKeyComparator*>(
+                    key_comparator)
+                    ->HashKey(
+                        reflection->GetRepeatedMessage(message, repeated_field,
+                                                       i));
+    }
+  };
+
+  const int num_tasks =
+      (end - begin + kElementsPerHashTask - 1) / kElementsPerHashTask;
+  const int num_threads = std::min(num_hash_threads_, num_tasks);
+  if (num_threads <= 1) {
+    hash_elements(begin, end);
+    return hashes;
+  }
+
+  std::atomic<int> next_task{0};
+  auto worker = [&] {
+    int task;
+    while ((task = next_task.fetch_add(1, std::memory_order_relaxed)) <
+           num_tasks) {
+      const int first = begin + task * kElementsPerHashTask;
+      hash_elements(first, std::min(end, first + kElementsPerHashTask));
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (int i = 1; i < num_threads; ++i) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+  return hashes;
+}
+
+size_t MessageDifferencer::HashMessage(const Message& message) const {
+  // Any messages are compared by their unpacked contents, not their bytes.
+  if (message.GetDescriptor()->full_name() == internal::kAnyFullTypeName) {
+    return 0;
+  }
+  std::vector<const FieldDescriptor*> fields;
+  message.GetReflection()->ListFields(message, &fields);
+  size_t hash = 0;
+  for (const FieldDescriptor* field : fields) {
+    if (ignored_fields_.contains(field)) continue;
+    size_t field_hash;
+    if (field->is_repeated()) {
+      field_hash = HashField(message, field);
+    } else if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE) {
+      // Empty messages are equivalent to unset ones.
+      field_hash = HashFieldValue(message, field, -1);
+      if (field_hash == 0) continue;
+    } else {
+      if (HasDefaultValue(message, field)) continue;
+      field_hash = HashFieldValue(message, field, -1);
+    }
+    hash = absl::HashOf(hash, field->number(), field_hash);
+  }
+  return hash;
+}
+
+size_t MessageDifferencer::HashField(const Message& message,
+                                     const FieldDescriptor* field) const {
+  if (!field->is_repeated()) return HashFieldValue(message, field, -1);
+  // Only plain lists compare their elements in order.
+  if (!IsComparedAsListForHashing(field)) return 0;
+  const int size = message.GetReflection()->FieldSize(message, field);
+  size_t hash = absl::HashOf(size);
+  for (int i = 0; i < size; ++i) {
+    hash = absl::HashOf(hash, HashFieldValue(message, field, i));
+  }
+  return hash;
+}
+
+size_t MessageDifferencer::HashFieldValue(const Message& message,
+                                          const FieldDescriptor* field,
+                                          int index) const {
+  const Reflection* reflection = message.GetReflection();
+  const bool exact_floats =
+      field_comparator_.default_impl->float_comparison() ==
+      DefaultFieldComparator::EXACT;
+  switch (field->cpp_type()) {
+#define GET_FIELD(METHOD)                          \
+  (index < 0 ? reflection->Get##METHOD(message, field) \
+             : reflection->GetRepeated##METHOD(message, field, index))
+
+    case FieldDescriptor::CPPTYPE_INT32:
+      return absl::HashOf(GET_FIELD(Int32));
+    case FieldDescriptor::CPPTYPE_INT64:
+      return absl::HashOf(GET_FIELD(Int64));
+    case FieldDescriptor::CPPTYPE_UINT32:
+      return absl::HashOf(GET_FIELD(UInt32));
+    case FieldDescriptor::CPPTYPE_UINT64:
+      return absl::HashOf(GET_FIELD(UInt64));
+    case FieldDescriptor::CPPTYPE_BOOL:
+      return absl::HashOf(GET_FIELD(Bool));
+    case FieldDescriptor::CPPTYPE_ENUM:
+      return absl::HashOf(GET_FIELD(EnumValue));
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+      return exact_floats ? HashFloatingPoint(GET_FIELD(Double)) : 0;
+    case FieldDescriptor::CPPTYPE_FLOAT:
+      return exact_floats ? HashFloatingPoint(GET_FIELD(Float)) : 0;
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      return HashMessage(GET_FIELD(Message));
+#undef GET_FIELD
+
+    case FieldDescriptor::CPPTYPE_STRING: {
+      std::string scratch;
+      return absl::HashOf(
+          index < 0
+              ? reflection->GetStringReference(message, field, &scratch)
+              : reflection->GetRepeatedStringReference(message, field, index,
+                                                       &scratch));
+    }
+  }
+  return 0;
+}
+
+bool MessageDifferencer::IsComparedAsListForHashing(
+    const FieldDescriptor* field) const {
+  if (field->is_map() || GetMapKeyComparator(field) != nullptr) return false;
+  auto it = repeated_field_comparisons_.find(field);
+  return (it != repeated_field_comparisons_.end()
+              ? it->second
+              : repeated_field_comparison_) == AS_LIST;
+}
+
 FieldComparator::ComparisonResult MessageDifferencer::GetFieldComparisonResult(
     const Message& message1, const Message& message2,
     const FieldDescriptor* field, int index1, int index2,
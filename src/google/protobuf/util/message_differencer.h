@@ -20,6 +20,7 @@
 #ifndef GOOGLE_PROTOBUF_UTIL_MESSAGE_DIFFERENCER_H__
 #define GOOGLE_PROTOBUF_UTIL_MESSAGE_DIFFERENCER_H__
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <string>
@@ -605,6 +606,35 @@ class PROTOBUF_EXPORT MessageDifferencer {
   // Returns the current repeated field comparison used by this differencer.
   RepeatedFieldComparison repeated_field_comparison() const;
 
+  // Tells the differencer whether to use hashes to match the elements of
+  // repeated fields treated as sets (TreatAsSet) or as maps by key fields
+  // (TreatAsMap, TreatAsMapWithMultipleFieldsAsKey and
+  // TreatAsMapWithMultipleFieldPathsAsKey).  Every element is hashed over the
+  // values that the comparison requires to be equal, and is then only compared
+  // with the elements of the other field that have the same hash, which makes
+  // matching large fields take about linear rather than quadratic time.  The
+  // elements are matched, and the differences reported, exactly as without
+  // hashing.
+  //
+  // Hashing is not used, and the elements are compared pairwise as before,
+  // with PARTIAL scope, with a field comparator other than a
+  // DefaultFieldComparator, with ignore criteria, and for fields treated as
+  // smart sets or as maps with a custom MapKeyComparator.  This method must
+  // be called before Compare.  The default for a new
+  // differencer is false.
+  void set_match_repeated_fields_by_hash(bool value) {
+    match_repeated_fields_by_hash_ = value;
+  }
+
+  // Sets the number of threads, including the calling one, used to hash the
+  // elements of large repeated fields when matching them by hash (see
+  // set_match_repeated_fields_by_hash).  The messages being compared must not
+  // be modified concurrently.  The default for a new differencer is 1.
+  void set_num_hash_threads(int num_threads) {
+    ABSL_CHECK_GE(num_threads, 1);
+    num_hash_threads_ = num_threads;
+  }
+
   // Compares the two specified messages, returning true if they are the same,
   // false otherwise. If this method returns false, any changes between the
   // two messages will be reported if a Reporter was specified via
@@ -918,6 +948,43 @@ class PROTOBUF_EXPORT MessageDifferencer {
       const std::vector<SpecificField>& parent_fields,
       std::vector<int>* match_list1, std::vector<int>* match_list2);
 
+  // Returns true if the elements of a repeated field compared using
+  // key_comparator, which may be NULL, can be matched by hash.
+  bool CanMatchByHash(const MapKeyComparator* key_comparator) const;
+
+  // Matches the elements of the repeated field from index start_offset on
+  // like the greedy loop in MatchRepeatedFieldIndices does, but only compares
+  // elements with the same hash.  Returns false as soon as an element of
+  // message1 has no match if stop_at_mismatch is true.
+  bool MatchRepeatedFieldIndicesByHash(
+      const Message& message1, const Message& message2, int unpacked_any,
+      const FieldDescriptor* repeated_field,
+      const MapKeyComparator* key_comparator,
+      const std::vector<SpecificField>& parent_fields, int start_offset,
+      bool stop_at_mismatch, std::vector<int>* match_list1,
+      std::vector<int>* match_list2);
+
+  // Returns the hashes of the elements of the repeated field from index begin
+  // to end, hashing them with num_hash_threads_ threads if there are many.
+  std::vector<size_t> HashRepeatedFieldElements(
+      const Message& message, const FieldDescriptor* repeated_field,
+      const MapKeyComparator* key_comparator, int begin, int end) const;
+
+  // Hashes messages, fields and field values so that the ones this
+  // differencer considers equal always have the same hash.  Anything whose
+  // equality cannot be decided in advance, like Any messages and approximately
+  // compared floats, does not contribute to the hash.  These methods only
+  // read the differencer's settings, so they can run on several threads.
+  size_t HashMessage(const Message& message) const;
+  size_t HashField(const Message& message, const FieldDescriptor* field) const;
+  // index is -1 for singular fields.
+  size_t HashFieldValue(const Message& message, const FieldDescriptor* field,
+                        int index) const;
+
+  // Returns true if the repeated field is compared as a plain list, so that
+  // its elements are compared in order.
+  bool IsComparedAsListForHashing(const FieldDescriptor* field) const;
+
   // Checks if index is equal to new_index in all the specific fields.
   static bool CheckPathChanged(const std::vector<SpecificField>& parent_fields);
 
@@ -969,6 +1036,8 @@ class PROTOBUF_EXPORT MessageDifferencer {
   bool report_moves_;
   bool report_ignores_;
   bool force_compare_no_presence_ = false;
+  bool match_repeated_fields_by_hash_ = false;
+  int num_hash_threads_ = 1;
 
   std::string* output_string_;
 
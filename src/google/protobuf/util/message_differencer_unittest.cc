@@ -23,6 +23,7 @@
 #include "google/protobuf/testing/googletest.h"
 #include <gtest/gtest.h>
 #include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/absl_check.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -1997,6 +1998,125 @@ TEST(MessageDifferencerTest, RepeatedFieldSmartList_RecursivePerformance) {
   EXPECT_LE(comparator.compare_count(), kDepth * kDepth);
 }
 
+// Fills msg1 and msg2 with many items, which are mostly the same but in a
+// different order.  Some of them are modified, added or removed, and some
+// fields are set to their default value on one side only.
+void FillItemsForMatchingByHash(protobuf_unittest::TestDiffMessage* msg1,
+                                protobuf_unittest::TestDiffMessage* msg2) {
+  constexpr int kNumItems = 1200;
+  std::vector<protobuf_unittest::TestDiffMessage::Item> items;
+  for (int i = 0; i < kNumItems; ++i) {
+    protobuf_unittest::TestDiffMessage::Item* item = msg1->add_item();
+    item->set_a(i % 100);
+    item->set_b(absl::StrCat("b", i % 7));
+    item->add_ra(i % 3);
+    item->add_ra(i % 5);
+    if (i % 4 == 0) item->mutable_m()->set_a(i % 11);
+    if (i % 9 == 0) item->mutable_m()->add_rc(i);
+    items.push_back(*item);
+  }
+
+  std::default_random_engine rng;
+  std::shuffle(items.begin() + 10, items.end(), rng);
+  for (int i = 0; i < kNumItems; ++i) {
+    protobuf_unittest::TestDiffMessage::Item& item = items[i];
+    if (i % 97 == 0) continue;
+    if (i % 89 == 0) item.set_b("modified");
+    if (i % 83 == 0) std::swap(*item.mutable_ra(0), *item.mutable_ra(1));
+    if (i % 13 == 0 && !item.has_m()) item.mutable_m();
+    if (i % 17 == 0 && item.a() == 0) item.clear_a();
+    *msg2->add_item() = item;
+  }
+  msg2->add_item()->set_a(1000);
+}
+
+// Expects matching repeated fields by hash to report the same differences as
+// comparing their elements pairwise.
+void ExpectSameReportWhenMatchingByHash(
+    const protobuf_unittest::TestDiffMessage& msg1,
+    const protobuf_unittest::TestDiffMessage& msg2,
+    absl::FunctionRef<void(util::MessageDifferencer*)> configure) {
+  util::MessageDifferencer pairwise;
+  configure(&pairwise);
+  std::string expected;
+  pairwise.ReportDifferencesToString(&expected);
+  const bool expected_result = pairwise.Compare(msg1, msg2);
+  pairwise.ReportDifferencesToString(nullptr);
+  EXPECT_EQ(pairwise.Compare(msg1, msg2), expected_result);
+
+  for (int num_threads : {1, 4}) {
+    SCOPED_TRACE(num_threads);
+    util::MessageDifferencer by_hash;
+    configure(&by_hash);
+    by_hash.set_match_repeated_fields_by_hash(true);
+    by_hash.set_num_hash_threads(num_threads);
+    std::string report;
+    by_hash.ReportDifferencesToString(&report);
+    EXPECT_EQ(by_hash.Compare(msg1, msg2), expected_result);
+    EXPECT_EQ(report, expected);
+    by_hash.ReportDifferencesToString(nullptr);
+    EXPECT_EQ(by_hash.Compare(msg1, msg2), expected_result);
+    EXPECT_TRUE(by_hash.Compare(msg1, msg1));
+  }
+}
+
+TEST(MessageDifferencerTest, RepeatedFieldSetTest_MatchByHash) {
+  protobuf_unittest::TestDiffMessage msg1;
+  protobuf_unittest::TestDiffMessage msg2;
+  FillItemsForMatchingByHash(&msg1, &msg2);
+  const FieldDescriptor* item = GetFieldDescriptor(msg1, "item");
+
+  for (auto comparison : {util::MessageDifferencer::EQUAL,
+                          util::MessageDifferencer::EQUIVALENT}) {
+    SCOPED_TRACE(comparison);
+    ExpectSameReportWhenMatchingByHash(
+        msg1, msg2, [&](util::MessageDifferencer* differencer) {
+          differencer->set_message_field_comparison(comparison);
+          differencer->TreatAsSet(item);
+        });
+    ExpectSameReportWhenMatchingByHash(
+        msg1, msg2, [&](util::MessageDifferencer* differencer) {
+          differencer->set_message_field_comparison(comparison);
+          differencer->set_repeated_field_comparison(
+              util::MessageDifferencer::AS_SET);
+        });
+    ExpectSameReportWhenMatchingByHash(
+        msg1, msg2, [&](util::MessageDifferencer* differencer) {
+          differencer->set_message_field_comparison(comparison);
+          differencer->TreatAsSet(item);
+          differencer->IgnoreField(GetFieldDescriptor(msg1, "item.b"));
+        });
+  }
+}
+
+TEST(MessageDifferencerTest, RepeatedFieldMapTest_MatchByHash) {
+  protobuf_unittest::TestDiffMessage msg1;
+  protobuf_unittest::TestDiffMessage msg2;
+  FillItemsForMatchingByHash(&msg1, &msg2);
+  const FieldDescriptor* item = GetFieldDescriptor(msg1, "item");
+
+  ExpectSameReportWhenMatchingByHash(
+      msg1, msg2, [&](util::MessageDifferencer* differencer) {
+        differencer->TreatAsMapWithMultipleFieldsAsKey(
+            item, {GetFieldDescriptor(msg1, "item.a"),
+                   GetFieldDescriptor(msg1, "item.ra")});
+      });
+  ExpectSameReportWhenMatchingByHash(
+      msg1, msg2, [&](util::MessageDifferencer* differencer) {
+        differencer->TreatAsSet(GetFieldDescriptor(msg1, "item.ra"));
+        differencer->TreatAsMapWithMultipleFieldsAsKey(
+            item, {GetFieldDescriptor(msg1, "item.a"),
+                   GetFieldDescriptor(msg1, "item.ra")});
+      });
+  ExpectSameReportWhenMatchingByHash(
+      msg1, msg2, [&](util::MessageDifferencer* differencer) {
+        differencer->TreatAsMapWithMultipleFieldPathsAsKey(
+            item, {{GetFieldDescriptor(msg1, "item.m"),
+                    GetFieldDescriptor(msg1, "item.m.a")},
+                   {GetFieldDescriptor(msg1, "item.b")}});
+      });
+}
+
 TEST(MessageDifferencerTest, RepeatedFieldMapTest_Partial) {
   protobuf_unittest::TestDiffMessage msg1;
   // message msg1 {
@@ -0,0 +1,186 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/log/absl_check.h"
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+namespace {
+
+using internal::WireFormatLite;
+
+// Each worker thread processes several tasks so that uneven element sizes do
+// not leave threads idle at the end of the parse.
+constexpr int kTasksPerThread = 4;
+
+struct ScanResult {
+  // The encoded elements of the designated field, in input order.
+  std::vector<absl::string_view> elements;
+  // All other fields, concatenated in input order.
+  std::string rest;
+};
+
+// Splits the top-level fields of `data` into the elements of `field` and
+// everything else. Returns false if the input is malformed or `field` does not
+// only appear length-delimited, in which case the caller should fall back to
+// the sequential parser so that errors are reported the usual way.
+bool ScanElements(absl::string_view data, const FieldDescriptor* field,
+                  ScanResult* result) {
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  const uint32_t element_tag = WireFormatLite::MakeTag(
+      field->number(), WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+  size_t rest_begin = 0;
+  while (true) {
+    const size_t tag_begin = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0) {
+      // Either the end of the input or a zero or malformed tag.
+      if (tag_begin != data.size()) return false;
+      break;
+    }
+    if (tag == element_tag) {
+      uint32_t size;
+      if (!input.ReadVarint32(&size)) return false;
+      const size_t element_begin = input.CurrentPosition();
+      if (!input.Skip(static_cast<int>(size))) return false;
+      result->rest.append(data.data() + rest_begin, tag_begin - rest_begin);
+      result->elements.push_back(data.substr(element_begin, size));
+      rest_begin = input.CurrentPosition();
+    } else if (WireFormatLite::GetTagFieldNumber(tag) == field->number() ||
+               !WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+  }
+  result->rest.append(data.data() + rest_begin, data.size() - rest_begin);
+  return true;
+}
+
+bool ParseElement(absl::string_view data, Message* element) {
+  io::CodedInputStream input(reinterpret_cast<const uint8_t*>(data.data()),
+                             static_cast<int>(data.size()));
+  // The element is nested one level below the message being parsed.
+  input.SetRecursionLimit(io::CodedInputStream::GetDefaultRecursionLimit() -
+                          1);
+  return element->MergePartialFromCodedStream(&input) &&
+         input.ConsumedEntireMessage();
+}
+
+// Returns the element index each task starts at, splitting `elements` into at
+// most `num_tasks` runs of roughly equal byte size. The last entry is
+// `elements.size()`.
+std::vector<size_t> SplitIntoTasks(
+    const std::vector<absl::string_view>& elements, int num_tasks) {
+  size_t total_bytes = 0;
+  for (absl::string_view element : elements) total_bytes += element.size();
+
+  std::vector<size_t> bounds = {0};
+  size_t bytes = 0;
+  for (size_t i = 0; i < elements.size(); ++i) {
+    bytes += elements[i].size();
+    const size_t next_task = bounds.size();
+    if (bytes * num_tasks >= total_bytes * next_task &&
+        i + 1 < elements.size()) {
+      bounds.push_back(i + 1);
+    }
+  }
+  bounds.push_back(elements.size());
+  return bounds;
+}
+
+}  // namespace
+
+bool ParsePartialFromStringInParallel(absl::string_view data, Message* message,
+                                      const ParallelParseOptions& options) {
+  const FieldDescriptor* field = options.field;
+  if (field == nullptr || options.num_threads <= 1) {
+    return message->ParsePartialFromString(data);
+  }
+  ABSL_CHECK_EQ(field->containing_type(), message->GetDescriptor())
+      << field->full_name() << " is not a field of "
+      << message->GetDescriptor()->full_name();
+  ABSL_CHECK(field->is_repeated() &&
+             field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+             !field->is_map())
+      << field->full_name() << " is not a repeated message field";
+
+  ScanResult scan;
+  if (!ScanElements(data, field, &scan) ||
+      scan.elements.size() <
+          static_cast<size_t>(std::max(options.min_parallel_elements, 1))) {
+    return message->ParsePartialFromString(data);
+  }
+
+  // Parse everything but the elements, then allocate all the elements up front
+  // since the repeated field itself may not be mutated concurrently.
+  if (!message->ParsePartialFromString(scan.rest)) return false;
+  const Reflection* reflection = message->GetReflection();
+  std::vector<Message*> elements(scan.elements.size());
+  for (Message*& element : elements) {
+    element = reflection->AddMessage(message, field);
+  }
+
+  const std::vector<size_t> bounds =
+      SplitIntoTasks(scan.elements, options.num_threads * kTasksPerThread);
+  const size_t num_tasks = bounds.size() - 1;
+  std::atomic<size_t> next_task{0};
+  std::atomic<bool> ok{true};
+  auto worker = [&] {
+    size_t task;
+    while ((task = next_task.fetch_add(1, std::memory_order_relaxed)) <
+           num_tasks) {
+      for (size_t i = bounds[task]; i < bounds[task + 1]; ++i) {
+        if (!ok.load(std::memory_order_relaxed)) return;
+        if (!ParseElement(scan.elements[i], elements[i])) {
+          ok.store(false, std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  const size_t num_threads =
+      std::min(static_cast<size_t>(options.num_threads), num_tasks);
+  threads.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; ++i) threads.emplace_back(worker);
+  worker();
+  for (std::thread& thread : threads) thread.join();
+  return ok.load(std::memory_order_relaxed);
+}
+
+bool ParseFromStringInParallel(absl::string_view data, Message* message,
+                               const ParallelParseOptions& options) {
+  return ParsePartialFromStringInParallel(data, message, options) &&
+         message->IsInitialized();
+}
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
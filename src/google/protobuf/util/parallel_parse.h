@@ -0,0 +1,67 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Utilities for parsing messages with one very large repeated message field
+// (for example a batch envelope holding `repeated Record records = 1`) using
+// several threads.
+//
+// The input is first pre-scanned for the length-delimited boundaries of the
+// designated field's elements. Everything else is parsed sequentially, then
+// the elements are parsed concurrently into storage allocated up front. The
+// resulting message is identical to the one produced by the sequential parse.
+//
+// If the message lives on an Arena, the elements and everything they own are
+// allocated on that Arena from the worker threads, which Arena supports.
+
+#ifndef GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+#define GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
+
+#include "absl/strings/string_view.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+
+// Must be included last.
+#include "google/protobuf/port_def.inc"
+
+namespace google {
+namespace protobuf {
+namespace util {
+
+struct ParallelParseOptions {
+  // The repeated message field whose elements are parsed in parallel. It must
+  // be a field of the parsed message's type. If null, or if the input holds
+  // too few elements of it, the input is parsed sequentially.
+  const FieldDescriptor* field = nullptr;
+
+  // Maximum number of threads used, including the calling thread.
+  int num_threads = 1;
+
+  // Inputs with fewer elements of `field` than this are parsed sequentially,
+  // as thread start-up would dominate.
+  int min_parallel_elements = 256;
+};
+
+// Like Message::ParseFromString(), but parses the elements of
+// `options.field` using up to `options.num_threads` threads. Returns false if
+// the input is malformed or, for ParseFromStringInParallel(), if required
+// fields are missing.
+bool PROTOBUF_EXPORT ParseFromStringInParallel(
+    absl::string_view data, Message* message,
+    const ParallelParseOptions& options);
+
+// Like Message::ParsePartialFromString(); required fields are not checked.
+bool PROTOBUF_EXPORT ParsePartialFromStringInParallel(
+    absl::string_view data, Message* message,
+    const ParallelParseOptions& options);
+
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
+
+#include "google/protobuf/port_undef.inc"
+
+#endif  // GOOGLE_PROTOBUF_UTIL_PARALLEL_PARSE_H__
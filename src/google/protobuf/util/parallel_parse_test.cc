@@ -0,0 +1,148 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google Inc.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "google/protobuf/util/parallel_parse.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "google/protobuf/arena.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/test_util.h"
+#include "google/protobuf/unittest.pb.h"
+
+namespace google {
+namespace protobuf {
+namespace util {
+namespace {
+
+using ::protobuf_unittest::TestAllTypes;
+using ::protobuf_unittest::TestRequired;
+using ::protobuf_unittest::TestRequiredForeign;
+
+ParallelParseOptions Options(int num_threads) {
+  ParallelParseOptions options;
+  options.field =
+      TestAllTypes::descriptor()->FindFieldByName("repeated_nested_message");
+  options.num_threads = num_threads;
+  options.min_parallel_elements = 1;
+  return options;
+}
+
+// Returns the serialization of two messages back to back, so that the
+// elements of the repeated fields are interleaved with other fields.
+std::string MakeInput(int num_elements) {
+  std::string data;
+  for (int part = 0; part < 2; ++part) {
+    TestAllTypes message;
+    TestUtil::SetAllFields(&message);
+    for (int i = 0; i < num_elements; ++i) {
+      message.add_repeated_nested_message()->set_bb(part * num_elements + i);
+    }
+    data += message.SerializeAsString();
+  }
+  return data;
+}
+
+TEST(ParallelParseTest, MatchesSequentialParse) {
+  const std::string data = MakeInput(1000);
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  for (int num_threads : {1, 2, 3, 8}) {
+    TestAllTypes message;
+    ASSERT_TRUE(
+        ParseFromStringInParallel(data, &message, Options(num_threads)));
+    EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString())
+        << "num_threads=" << num_threads;
+    EXPECT_EQ(message.repeated_nested_message_size(), 2000);
+  }
+}
+
+TEST(ParallelParseTest, ParsesOnArena) {
+  const std::string data = MakeInput(500);
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  Arena arena;
+  auto* message = Arena::Create<TestAllTypes>(&arena);
+  ASSERT_TRUE(ParseFromStringInParallel(data, message, Options(4)));
+  EXPECT_EQ(message->SerializeAsString(), expected.SerializeAsString());
+  EXPECT_EQ(message->repeated_nested_message(0).GetArena(), &arena);
+}
+
+TEST(ParallelParseTest, ReplacesExistingContents) {
+  TestAllTypes message;
+  message.add_repeated_nested_message()->set_bb(-1);
+  message.set_optional_int32(-1);
+
+  const std::string data = MakeInput(10);
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+  ASSERT_TRUE(ParseFromStringInParallel(data, &message, Options(2)));
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+}
+
+TEST(ParallelParseTest, FewElementsParsedSequentially) {
+  ParallelParseOptions options = Options(4);
+  options.min_parallel_elements = 1000;
+  const std::string data = MakeInput(10);
+  TestAllTypes expected;
+  ASSERT_TRUE(expected.ParseFromString(data));
+
+  TestAllTypes message;
+  ASSERT_TRUE(ParseFromStringInParallel(data, &message, options));
+  EXPECT_EQ(message.SerializeAsString(), expected.SerializeAsString());
+}
+
+TEST(ParallelParseTest, MalformedElementFails) {
+  TestAllTypes message;
+  for (int i = 0; i < 100; ++i) message.add_repeated_nested_message();
+  std::string data = message.SerializeAsString();
+  // Append an element (field 48) whose `bb` varint is truncated.
+  data += std::string("\x82\x03\x02\x08\x80", 5);
+
+  TestAllTypes parsed;
+  EXPECT_FALSE(parsed.ParseFromString(data));
+  EXPECT_FALSE(ParseFromStringInParallel(data, &parsed, Options(4)));
+}
+
+TEST(ParallelParseTest, MalformedTopLevelFails) {
+  std::string data = MakeInput(10);
+  data.push_back('\x80');
+
+  TestAllTypes parsed;
+  EXPECT_FALSE(ParseFromStringInParallel(data, &parsed, Options(4)));
+}
+
+TEST(ParallelParseTest, ChecksRequiredFieldsOfElements) {
+  TestRequiredForeign message;
+  for (int i = 0; i < 10; ++i) {
+    TestRequired* required = message.add_repeated_message();
+    required->set_a(1);
+    required->set_b(2);
+    required->set_c(3);
+  }
+  message.mutable_repeated_message(5)->clear_b();
+  const std::string data = message.SerializePartialAsString();
+
+  ParallelParseOptions options;
+  options.field =
+      TestRequiredForeign::descriptor()->FindFieldByName("repeated_message");
+  options.num_threads = 2;
+  options.min_parallel_elements = 1;
+
+  TestRequiredForeign parsed;
+  EXPECT_FALSE(ParseFromStringInParallel(data, &parsed, options));
+  EXPECT_TRUE(ParsePartialFromStringInParallel(data, &parsed, options));
+  EXPECT_EQ(parsed.repeated_message_size(), 10);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace protobuf
+}  // namespace google
@@ -11,9 +11,19 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
+#include "absl/base/config.h"
+#include "absl/numeric/bits.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // Must be included last.
 #include "google/protobuf/port_def.inc"
 
@@ -154,6 +164,118 @@ limit0:
   return p;
 }
 
+// Bulk helpers for packed varint arrays.
+//
+// Packed varint fields are decoded in two passes: a block-wise scan that counts
+// terminating bytes (bytes without the continuation bit) so storage can be
+// reserved once, followed by a decode pass that converts whole 16-byte blocks
+// of single-byte varints at a time and only falls back to
+// `ShiftMixParseVarint` around multi-byte values.
+
+// Returns a mask with bit `i` set iff `p[i]` has its continuation bit set, for
+// the 8 bytes starting at `p`.
+inline PROTOBUF_ALWAYS_INLINE uint32_t VarintContinuationMask8(const char* p) {
+#ifdef ABSL_IS_LITTLE_ENDIAN
+  uint64_t word;
+  std::memcpy(&word, p, sizeof(word));
+  // Moves the top bit of byte `i` to bit `56 + i`; no partial products collide.
+  return static_cast<uint32_t>(
+      (((word & 0x8080808080808080) >> 7) * 0x0102040810204080) >> 56);
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < 8; ++i) {
+    mask |= static_cast<uint32_t>(static_cast<uint8_t>(p[i]) >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+// Returns a mask with bit `i` set iff `p[i]` has its continuation bit set, for
+// the 16 bytes starting at `p`.
+inline PROTOBUF_ALWAYS_INLINE uint32_t VarintContinuationMask16(const char* p) {
+#if defined(__SSE2__)
+  return static_cast<uint32_t>(_mm_movemask_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+#else
+  return VarintContinuationMask8(p) | (VarintContinuationMask8(p + 8) << 8);
+#endif
+}
+
+// Returns the number of varints terminating in [p, end), ie. the number of
+// bytes in the range without the continuation bit. For a well formed packed
+// array this is exactly the number of elements.
+inline int CountVarintTerminators(const char* p, const char* end) {
+  int count = 0;
+#if defined(__AVX2__)
+  for (; end - p >= 32; p += 32) {
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    count += 32 - absl::popcount(mask);
+  }
+#endif
+  for (; end - p >= 16; p += 16) {
+    count += 16 - absl::popcount(VarintContinuationMask16(p));
+  }
+  for (; p < end; ++p) {
+    count += static_cast<uint8_t>(*p) < 0x80;
+  }
+  return count;
+}
+
+// Converts a decoded varint to the repeated field element type `T`, applying
+// the zigzag transform if requested.
+template <typename T, bool zigzag>
+inline PROTOBUF_ALWAYS_INLINE T ConvertPackedVarint(uint64_t value) {
+  if (zigzag) {
+    if (sizeof(T) == 8) {
+      return static_cast<T>((value >> 1) ^ (~(value & 1) + 1));
+    }
+    uint32_t value32 = static_cast<uint32_t>(value);
+    return static_cast<T>((value32 >> 1) ^ (~(value32 & 1) + 1));
+  }
+  return static_cast<T>(value);
+}
+
+// Decodes every varint starting in [p, end) into `out`, which must have room
+// for `CountVarintTerminators(p, end) + 1` elements (the last varint may end
+// past `end`). Stores the number of decoded elements in `count` and returns a
+// pointer past the last decoded varint, or nullptr on a malformed varint.
+//
+// Reads full 16-byte blocks only when they lie entirely within [p, end); like
+// `ShiftMixParseVarint` it otherwise relies on 10 readable bytes past `p`.
+template <typename T, bool zigzag>
+inline const char* DecodePackedVarints(const char* p, const char* end, T* out,
+                                       int& count) {
+  T* const start = out;
+  while (p < end) {
+    if (end - p >= 16) {
+      uint32_t mask = VarintContinuationMask16(p);
+      if (mask == 0) {
+        // Sixteen single-byte varints, a loop the compiler vectorizes.
+        for (int i = 0; i < 16; ++i) {
+          out[i] = ConvertPackedVarint<T, zigzag>(static_cast<uint8_t>(p[i]));
+        }
+        p += 16;
+        out += 16;
+        continue;
+      }
+      // Convert the run of single-byte varints up to the first multi-byte one.
+      int run = absl::countr_zero(mask);
+      for (int i = 0; i < run; ++i) {
+        out[i] = ConvertPackedVarint<T, zigzag>(static_cast<uint8_t>(p[i]));
+      }
+      p += run;
+      out += run;
+    }
+    int64_t value;
+    p = ShiftMixParseVarint<int64_t>(p, value);
+    if (PROTOBUF_PREDICT_FALSE(p == nullptr)) break;
+    *out++ = ConvertPackedVarint<T, zigzag>(static_cast<uint64_t>(value));
+  }
+  count = static_cast<int>(out - start);
+  return p;
+}
+
 }  // namespace internal
 }  // namespace protobuf
 }  // namespace google
@@ -7,6 +7,9 @@
 
 #include "google/protobuf/varint_shuffle.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -302,6 +305,126 @@ TEST(ShiftMixParseVarint64Test, DroppingOverlongBits) {
 }
 
 
+// Serializes `values` as a packed array of varints, followed by enough zero
+// padding for the decoder to read past the end.
+std::vector<char> SerializePacked(const std::vector<uint64_t>& values) {
+  std::vector<char> bytes;
+  char buf[10];
+  for (uint64_t value : values) {
+    int n = NaiveSerialize(buf, value);
+    bytes.insert(bytes.end(), buf, buf + n);
+  }
+  return bytes;
+}
+
+// Returns values whose encodings are `len` bytes long, cycling through
+// `lengths`.
+std::vector<uint64_t> ValuesWithLengths(const std::vector<int>& lengths,
+                                        int count) {
+  std::vector<uint64_t> values;
+  for (int i = 0; i < count; ++i) {
+    int len = lengths[i % lengths.size()];
+    uint64_t value = len == 10 ? ~uint64_t{0} - i
+                               : (uint64_t{1} << (7 * len - 1)) + i % 61;
+    values.push_back(value);
+  }
+  return values;
+}
+
+template <typename T, bool zigzag>
+void TestDecodePacked(const std::vector<uint64_t>& values) {
+  std::vector<char> bytes = SerializePacked(values);
+  const size_t size = bytes.size();
+  bytes.resize(size + 16);
+  const char* begin = bytes.data();
+  const char* end = begin + size;
+
+  ASSERT_THAT(CountVarintTerminators(begin, end),
+              Eq(static_cast<int>(values.size())));
+
+  // Not std::vector<T> as that has no data() for bool.
+  std::unique_ptr<T[]> result(new T[values.size() + 1]);
+  int count = -1;
+  const char* p = DecodePackedVarints<T, zigzag>(begin, end, result.get(),
+                                                 count);
+  ASSERT_THAT(p, Eq(end));
+  ASSERT_THAT(count, Eq(static_cast<int>(values.size())));
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_THAT(result[i], Eq((ConvertPackedVarint<T, zigzag>(values[i]))))
+        << "at index " << i;
+  }
+}
+
+class DecodePackedVarintsTest : public TestWithParam<std::vector<int>> {
+ public:
+  std::vector<uint64_t> values(int count) const {
+    return ValuesWithLengths(GetParam(), count);
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(
+    Default, DecodePackedVarintsTest,
+    testing::Values(std::vector<int>{1}, std::vector<int>{2},
+                    std::vector<int>{5}, std::vector<int>{10},
+                    std::vector<int>{1, 1, 1, 1, 1, 1, 1, 3},
+                    std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10},
+                    std::vector<int>{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                     1, 1, 1, 1, 2}));
+
+TEST_P(DecodePackedVarintsTest, Unsigned) {
+  for (int count : {0, 1, 15, 16, 17, 100, 1000}) {
+    TestDecodePacked<uint32_t, false>(values(count));
+    TestDecodePacked<uint64_t, false>(values(count));
+  }
+}
+
+TEST_P(DecodePackedVarintsTest, ZigZag) {
+  for (int count : {0, 1, 15, 16, 17, 100, 1000}) {
+    TestDecodePacked<int32_t, true>(values(count));
+    TestDecodePacked<int64_t, true>(values(count));
+  }
+}
+
+TEST_P(DecodePackedVarintsTest, Bool) {
+  TestDecodePacked<bool, false>(values(100));
+}
+
+TEST(PackedVarintTest, LastVarintStraddlesEnd) {
+  std::vector<char> bytes = SerializePacked({1, 2, 3, 300});
+  bytes.resize(bytes.size() + 16);
+  // End the range in the middle of the final two-byte varint.
+  const char* end = bytes.data() + 4;
+  ASSERT_THAT(CountVarintTerminators(bytes.data(), end), Eq(3));
+
+  uint32_t result[4];
+  int count;
+  const char* p =
+      DecodePackedVarints<uint32_t, false>(bytes.data(), end, result, count);
+  ASSERT_THAT(p, Eq(end + 1));
+  ASSERT_THAT(count, Eq(4));
+  EXPECT_THAT(result[3], Eq(300));
+}
+
+TEST(PackedVarintTest, Malformed) {
+  std::vector<char> bytes(32, '\x01');
+  std::fill(bytes.begin() + 16, bytes.begin() + 27, '\xff');
+  uint64_t result[17];
+  int count;
+  const char* p = DecodePackedVarints<uint64_t, false>(
+      bytes.data(), bytes.data() + 20, result, count);
+  ASSERT_THAT(p, IsNull());
+  EXPECT_THAT(count, Eq(16));
+}
+
+TEST(PackedVarintTest, ContinuationMask) {
+  char data[16];
+  for (int bit = 0; bit < 16; ++bit) {
+    std::fill(data, data + 16, '\x7f');
+    data[bit] = '\x80';
+    EXPECT_THAT(VarintContinuationMask16(data), Eq(uint32_t{1} << bit));
+  }
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace protobuf
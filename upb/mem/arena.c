@@ -59,6 +59,15 @@ typedef struct upb_ArenaInternal {
   // Linked list of blocks to free/cleanup. Atomic only for the benefit of
   // upb_Arena_SpaceAllocated().
   UPB_ATOMIC(upb_MemBlock*) blocks;
+
+  // Blocks kept by upb_Arena_Reset(), in the order in which they were first
+  // allocated, to be used before allocating any new ones.  Atomic only for the
+  // benefit of upb_Arena_SpaceAllocated().
+  UPB_ATOMIC(upb_MemBlock*) spare_blocks;
+
+  // The start of the initial block, if there is one.  It ends where the arena
+  // itself begins.
+  char* initial_block;
 } upb_ArenaInternal;
 
 // All public + private state for an arena.
@@ -206,6 +215,11 @@ size_t upb_Arena_SpaceAllocated(upb_Arena* arena, size_t* fused_count) {
       memsize += sizeof(upb_MemBlock) + block->size;
       block = upb_Atomic_Load(&block->next, memory_order_relaxed);
     }
+    block = upb_Atomic_Load(&ai->spare_blocks, memory_order_relaxed);
+    while (block != NULL) {
+      memsize += sizeof(upb_MemBlock) + block->size;
+      block = upb_Atomic_Load(&block->next, memory_order_relaxed);
+    }
     ai = upb_Atomic_Load(&ai->next, memory_order_relaxed);
     local_fused_count++;
   }
@@ -260,6 +274,18 @@ static void _upb_Arena_AddBlock(upb_Arena* a, void* ptr, size_t size) {
 static bool _upb_Arena_AllocBlock(upb_Arena* a, size_t size) {
   upb_ArenaInternal* ai = upb_Arena_Internal(a);
   if (!ai->block_alloc) return false;
+
+  // Reuse the next block kept by upb_Arena_Reset(), if it is big enough.
+  upb_MemBlock* spare =
+      upb_Atomic_Load(&ai->spare_blocks, memory_order_relaxed);
+  if (spare != NULL && spare->size - kUpb_MemblockReserve >= size) {
+    upb_Atomic_Store(&ai->spare_blocks,
+                     upb_Atomic_Load(&spare->next, memory_order_relaxed),
+                     memory_order_relaxed);
+    _upb_Arena_AddBlock(a, spare, spare->size);
+    return true;
+  }
+
   upb_MemBlock* last_block = upb_Atomic_Load(&ai->blocks, memory_order_acquire);
   size_t last_size = last_block != NULL ? last_block->size : 128;
 
@@ -304,6 +330,8 @@ static upb_Arena* _upb_Arena_InitSlow(upb_alloc* alloc) {
   upb_Atomic_Init(&a->body.next, NULL);
   upb_Atomic_Init(&a->body.tail, &a->body);
   upb_Atomic_Init(&a->body.blocks, NULL);
+  upb_Atomic_Init(&a->body.spare_blocks, NULL);
+  a->body.initial_block = NULL;
 
   _upb_Arena_AddBlock(&a->head, mem, n);
 
@@ -342,6 +370,8 @@ upb_Arena* upb_Arena_Init(void* mem, size_t n, upb_alloc* alloc) {
   upb_Atomic_Init(&a->body.next, NULL);
   upb_Atomic_Init(&a->body.tail, &a->body);
   upb_Atomic_Init(&a->body.blocks, NULL);
+  upb_Atomic_Init(&a->body.spare_blocks, NULL);
+  a->body.initial_block = mem;
 
   a->body.block_alloc = _upb_Arena_MakeBlockAlloc(alloc, 1);
   a->head.UPB_PRIVATE(ptr) = mem;
@@ -359,7 +389,15 @@ static void _upb_Arena_DoFree(upb_ArenaInternal* ai) {
     upb_ArenaInternal* next_arena =
         (upb_ArenaInternal*)upb_Atomic_Load(&ai->next, memory_order_acquire);
     upb_alloc* block_alloc = _upb_ArenaInternal_BlockAlloc(ai);
-    upb_MemBlock* block = upb_Atomic_Load(&ai->blocks, memory_order_acquire);
+    upb_MemBlock* block =
+        upb_Atomic_Load(&ai->spare_blocks, memory_order_acquire);
+    while (block != NULL) {
+      upb_MemBlock* next_block =
+          upb_Atomic_Load(&block->next, memory_order_acquire);
+      upb_free(block_alloc, block);
+      block = next_block;
+    }
+    block = upb_Atomic_Load(&ai->blocks, memory_order_acquire);
     while (block != NULL) {
       // Load first since we are deleting block.
       upb_MemBlock* next_block =
@@ -404,6 +442,86 @@ retry:
   goto retry;
 }
 
+// Returns whether `block` fits in what is left of `*budget`, and if so takes it
+// out of the budget.
+static bool _upb_Arena_KeepBlock(upb_MemBlock* block, size_t* budget) {
+  if (block->size > *budget) return false;
+  *budget -= block->size;
+  UPB_POISON_MEMORY_REGION(UPB_PTR_AT(block, kUpb_MemblockReserve, char),
+                           block->size - kUpb_MemblockReserve);
+  return true;
+}
+
+bool upb_Arena_Reset(upb_Arena* a, size_t max_retained) {
+  upb_ArenaInternal* ai = upb_Arena_Internal(a);
+
+  // Only an arena that is not fused and has no other references owns all of
+  // its allocations.
+  if (upb_Atomic_Load(&ai->parent_or_count, memory_order_acquire) !=
+          _upb_Arena_TaggedFromRefcount(1) ||
+      upb_Atomic_Load(&ai->next, memory_order_acquire) != NULL) {
+    return false;
+  }
+
+  upb_alloc* block_alloc = _upb_ArenaInternal_BlockAlloc(ai);
+
+  // The blocks are listed newest first, which is also largest first for as
+  // long as they grow.  Keep as many as fit in the budget, listed in the order
+  // in which they were allocated, so that a similar run of allocations uses
+  // them in the same way again.
+  upb_MemBlock* kept = NULL;
+  upb_MemBlock* kept_last = NULL;
+  upb_MemBlock* first = NULL;
+  upb_MemBlock* block = upb_Atomic_Load(&ai->blocks, memory_order_relaxed);
+  while (block != NULL) {
+    upb_MemBlock* next = upb_Atomic_Load(&block->next, memory_order_relaxed);
+    if (next == NULL && !_upb_ArenaInternal_HasInitialBlock(ai)) {
+      // The oldest block holds the arena itself.
+      first = block;
+    } else if (_upb_Arena_KeepBlock(block, &max_retained)) {
+      upb_Atomic_Store(&block->next, kept, memory_order_relaxed);
+      if (kept == NULL) kept_last = block;
+      kept = block;
+    } else {
+      upb_free(block_alloc, block);
+    }
+    block = next;
+  }
+
+  // Blocks that were kept last time but not needed since go last.
+  block = upb_Atomic_Load(&ai->spare_blocks, memory_order_relaxed);
+  while (block != NULL) {
+    upb_MemBlock* next = upb_Atomic_Load(&block->next, memory_order_relaxed);
+    if (_upb_Arena_KeepBlock(block, &max_retained)) {
+      upb_Atomic_Store(&block->next, NULL, memory_order_relaxed);
+      if (kept_last != NULL) {
+        upb_Atomic_Store(&kept_last->next, block, memory_order_relaxed);
+      } else {
+        kept = block;
+      }
+      kept_last = block;
+    } else {
+      upb_free(block_alloc, block);
+    }
+    block = next;
+  }
+  upb_Atomic_Store(&ai->spare_blocks, kept, memory_order_relaxed);
+
+  // Start over in the initial block, or in the block holding the arena.
+  if (first != NULL) {
+    upb_Atomic_Store(&ai->blocks, first, memory_order_relaxed);
+    a->UPB_PRIVATE(ptr) = UPB_PTR_AT(first, kUpb_MemblockReserve, char);
+    a->UPB_PRIVATE(end) = UPB_PTR_AT(first, first->size, char);
+  } else {
+    upb_Atomic_Store(&ai->blocks, NULL, memory_order_relaxed);
+    a->UPB_PRIVATE(ptr) = ai->initial_block;
+    a->UPB_PRIVATE(end) = (char*)a;
+  }
+  UPB_POISON_MEMORY_REGION(a->UPB_PRIVATE(ptr),
+                           a->UPB_PRIVATE(end) - a->UPB_PRIVATE(ptr));
+  return true;
+}
+
 static void _upb_Arena_DoFuseArenaLists(upb_ArenaInternal* const parent,
                                         upb_ArenaInternal* child) {
   upb_ArenaInternal* parent_tail =
@@ -573,6 +691,9 @@ void UPB_PRIVATE(_upb_Arena_SwapIn)(upb_Arena* des, const upb_Arena* src) {
   desi->block_alloc = srci->block_alloc;
   upb_MemBlock* blocks = upb_Atomic_Load(&srci->blocks, memory_order_relaxed);
   upb_Atomic_Init(&desi->blocks, blocks);
+  upb_MemBlock* spare_blocks =
+      upb_Atomic_Load(&srci->spare_blocks, memory_order_relaxed);
+  upb_Atomic_Init(&desi->spare_blocks, spare_blocks);
 }
 
 void UPB_PRIVATE(_upb_Arena_SwapOut)(upb_Arena* des, const upb_Arena* src) {
@@ -582,4 +703,7 @@ void UPB_PRIVATE(_upb_Arena_SwapOut)(upb_Arena* des, const upb_Arena* src) {
   *des = *src;
   upb_MemBlock* blocks = upb_Atomic_Load(&srci->blocks, memory_order_relaxed);
   upb_Atomic_Store(&desi->blocks, blocks, memory_order_relaxed);
+  upb_MemBlock* spare_blocks =
+      upb_Atomic_Load(&srci->spare_blocks, memory_order_relaxed);
+  upb_Atomic_Store(&desi->spare_blocks, spare_blocks, memory_order_relaxed);
 }
@@ -41,6 +41,18 @@ extern "C" {
 UPB_API upb_Arena* upb_Arena_Init(void* mem, size_t n, upb_alloc* alloc);
 
 UPB_API void upb_Arena_Free(upb_Arena* a);
+
+// Frees everything allocated from the arena, so that it can be used again as
+// if it were new, for example for the next request of a server.  Up to
+// |max_retained| bytes of the blocks it allocated are kept and used again
+// before any new block is allocated, so an arena reused for similar work
+// stops allocating blocks at all.  The initial block, if any, is always
+// reused.  Other blocks are freed.
+//
+// Returns false, and does nothing, if the arena has been fused with another
+// arena or has references from upb_Arena_IncRefFor(), since those may still
+// use its memory.
+UPB_API bool upb_Arena_Reset(upb_Arena* a, size_t max_retained);
 UPB_API bool upb_Arena_Fuse(const upb_Arena* a, const upb_Arena* b);
 UPB_API bool upb_Arena_IsFused(const upb_Arena* a, const upb_Arena* b);
 
@@ -8,6 +8,8 @@
 #include "upb/mem/arena.h"
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <array>
 #include <memory>
@@ -208,6 +210,69 @@ TEST(ArenaTest, MaxBlockSize) {
   upb_Arena_Free(arena);
 }
 
+TEST(ArenaTest, ResetReusesBlocks) {
+  upb_Arena* arena = upb_Arena_New();
+  for (int i = 0; i < 100; ++i) {
+    upb_Arena_Malloc(arena, 1024);
+  }
+  size_t allocated = upb_Arena_SpaceAllocated(arena, nullptr);
+  for (int round = 0; round < 3; ++round) {
+    EXPECT_TRUE(upb_Arena_Reset(arena, SIZE_MAX));
+    for (int i = 0; i < 100; ++i) {
+      char* mem = static_cast<char*>(upb_Arena_Malloc(arena, 1024));
+      ASSERT_NE(mem, nullptr);
+      memset(mem, round, 1024);
+    }
+    // The same allocations fit in the retained blocks.
+    EXPECT_EQ(upb_Arena_SpaceAllocated(arena, nullptr), allocated);
+  }
+  upb_Arena_Free(arena);
+}
+
+TEST(ArenaTest, ResetRespectsBudget) {
+  upb_Arena* arena = upb_Arena_New();
+  for (int i = 0; i < 100; ++i) {
+    upb_Arena_Malloc(arena, 1024);
+  }
+  size_t allocated = upb_Arena_SpaceAllocated(arena, nullptr);
+  EXPECT_TRUE(upb_Arena_Reset(arena, 16 * 1024));
+  size_t retained = upb_Arena_SpaceAllocated(arena, nullptr);
+  EXPECT_LT(retained, allocated);
+  EXPECT_TRUE(upb_Arena_Reset(arena, 0));
+  EXPECT_LE(upb_Arena_SpaceAllocated(arena, nullptr), retained);
+  EXPECT_NE(upb_Arena_Malloc(arena, 1024), nullptr);
+  upb_Arena_Free(arena);
+}
+
+TEST(ArenaTest, ResetInitialBlock) {
+  char buf[1024];
+  upb_Arena* arena = upb_Arena_Init(buf, sizeof(buf), &upb_alloc_global);
+  void* first = upb_Arena_Malloc(arena, 16);
+  upb_Arena_Malloc(arena, 4096);
+  EXPECT_TRUE(upb_Arena_Reset(arena, 0));
+  EXPECT_EQ(upb_Arena_Malloc(arena, 16), first);
+  upb_Arena_Free(arena);
+}
+
+TEST(ArenaTest, ResetFailsWhenFused) {
+  upb_Arena* arena1 = upb_Arena_New();
+  upb_Arena* arena2 = upb_Arena_New();
+  EXPECT_TRUE(upb_Arena_Fuse(arena1, arena2));
+  EXPECT_FALSE(upb_Arena_Reset(arena1, SIZE_MAX));
+  EXPECT_FALSE(upb_Arena_Reset(arena2, SIZE_MAX));
+  upb_Arena_Free(arena1);
+  upb_Arena_Free(arena2);
+}
+
+TEST(ArenaTest, ResetFailsWithRef) {
+  upb_Arena* arena = upb_Arena_New();
+  upb_Arena_IncRefFor(arena, nullptr);
+  EXPECT_FALSE(upb_Arena_Reset(arena, SIZE_MAX));
+  upb_Arena_DecRefFor(arena, nullptr);
+  EXPECT_TRUE(upb_Arena_Reset(arena, SIZE_MAX));
+  upb_Arena_Free(arena);
+}
+
 #ifdef UPB_USE_C11_ATOMICS
 
 TEST(ArenaTest, FuzzFuseFreeRace) {
@@ -24,6 +24,9 @@
 #include "upb/message/tagged_ptr.h"
 #include "upb/mini_table/extension.h"
 #include "upb/mini_table/field.h"
+#include "upb/mini_table/internal/field.h"
+#include "upb/mini_table/internal/message.h"
+#include "upb/mini_table/internal/sub.h"
 #include "upb/mini_table/message.h"
 #include "upb/mini_table/sub.h"
 #include "upb/wire/decode.h"
@@ -226,6 +229,55 @@ upb_DecodeStatus upb_Map_PromoteMessages(upb_Map* map,
   return kUpb_DecodeStatus_Ok;
 }
 
+upb_MiniTable* upb_MiniTable_CopyWithLazyFields(
+    const upb_MiniTable* mini_table, const upb_MiniTableField* const* fields,
+    size_t count, upb_Arena* arena) {
+  size_t sub_count = 0;
+  for (int i = 0; i < upb_MiniTable_FieldCount(mini_table); i++) {
+    const upb_MiniTableField* f = upb_MiniTable_GetFieldByIndex(mini_table, i);
+    if (f->UPB_PRIVATE(submsg_index) != kUpb_NoSub &&
+        f->UPB_PRIVATE(submsg_index) >= sub_count) {
+      sub_count = f->UPB_PRIVATE(submsg_index) + 1;
+    }
+  }
+
+  // The struct is copied without its fasttable, which is disabled below, as
+  // the fasttable would parse the designated fields with their real types.
+  upb_MiniTable* copy = upb_Arena_Malloc(arena, sizeof(*copy));
+  upb_MiniTableSubInternal* subs =
+      upb_Arena_Malloc(arena, sub_count * sizeof(*subs));
+  // Like the MiniDescriptor decoder, each unlinked field gets its own pointer
+  // to the empty MiniTable, which upb_MiniTable_SetSubMessage() overwrites.
+  const upb_MiniTable** empty = upb_Arena_Malloc(arena, count * sizeof(*empty));
+  if (!copy || !subs || !empty) return NULL;
+  memcpy(copy, mini_table, sizeof(*copy));
+  memcpy(subs, mini_table->UPB_PRIVATE(subs), sub_count * sizeof(*subs));
+  for (size_t i = 0; i < count; i++) {
+    const upb_MiniTableField* f = fields[i];
+    UPB_ASSERT(upb_MiniTableField_Type(f) == kUpb_FieldType_Message);
+    UPB_ASSERT(!upb_MiniTableField_IsMap(f));
+    empty[i] = UPB_PRIVATE(_upb_MiniTable_Empty)();
+    subs[f->UPB_PRIVATE(submsg_index)].UPB_PRIVATE(submsg) = &empty[i];
+  }
+  copy->UPB_PRIVATE(subs) = subs;
+  copy->UPB_PRIVATE(table_mask) = (uint8_t)-1;
+  return copy;
+}
+
+upb_DecodeStatus upb_Message_GetOrPromoteMessage(
+    upb_Message* parent, const upb_MiniTable* mini_table,
+    const upb_MiniTableField* field, int decode_options, upb_Arena* arena,
+    upb_Message** sub) {
+  upb_TaggedMessagePtr tagged =
+      upb_Message_GetTaggedMessagePtr(parent, field, NULL);
+  if (!upb_TaggedMessagePtr_IsEmpty(tagged)) {
+    *sub = UPB_PRIVATE(_upb_TaggedMessagePtr_GetMessage)(tagged);
+    return kUpb_DecodeStatus_Ok;
+  }
+  return upb_Message_PromoteMessage(parent, mini_table, field, decode_options,
+                                    arena, sub);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // OLD promotion functions, will be removed!
 ////////////////////////////////////////////////////////////////////////////////
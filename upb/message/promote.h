@@ -116,6 +116,32 @@ upb_DecodeStatus upb_Map_PromoteMessages(upb_Map* map,
                                          const upb_MiniTable* mini_table,
                                          int decode_options, upb_Arena* arena);
 
+// Returns a copy of `mini_table` in which the sub-messages of the `count`
+// fields in `fields` are unlinked, for lazily decoding those fields.  Each
+// field must be a message field of `mini_table` that is not a group or a map.
+// The copy shares everything except its sub-message links with `mini_table`,
+// and is allocated on `arena`.  Returns NULL if allocation fails.
+//
+// Decoding with the copy and kUpb_DecodeOption_ExperimentalLazyUnlinked
+// stores the designated fields as "empty" messages holding their serialized
+// bytes, without parsing them.  The copy should only be used for decoding:
+// the resulting message should be accessed, encoded, and copied with
+// `mini_table`, which encodes the unparsed fields by writing their original
+// bytes and promotes them through upb_Message_GetOrPromoteMessage() and
+// upb_Array_PromoteMessages().
+upb_MiniTable* upb_MiniTable_CopyWithLazyFields(
+    const upb_MiniTable* mini_table, const upb_MiniTableField* const* fields,
+    size_t count, upb_Arena* arena);
+
+// Returns the value of the non-repeated message field `field` of `parent` in
+// `*sub`, or NULL if it is not set.  If the value is an "empty" message, it is
+// promoted first, as upb_Message_PromoteMessage() does; `field` must therefore
+// be linked in `mini_table`.
+upb_DecodeStatus upb_Message_GetOrPromoteMessage(
+    upb_Message* parent, const upb_MiniTable* mini_table,
+    const upb_MiniTableField* field, int decode_options, upb_Arena* arena,
+    upb_Message** sub);
+
 ////////////////////////////////////////////////////////////////////////////////
 // OLD promotion interfaces, will be removed!
 ////////////////////////////////////////////////////////////////////////////////
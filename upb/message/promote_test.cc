@@ -573,6 +573,85 @@ TEST(GeneratedCode, PromoteUnknownRepeatedMessage) {
             6);
 }
 
+TEST(GeneratedCode, LazyUnlinkedFields) {
+  upb::Arena arena;
+  upb_test_ModelWithSubMessages* input_msg =
+      upb_test_ModelWithSubMessages_new(arena.ptr());
+  upb_test_ModelWithSubMessages_set_id(input_msg, 11);
+  upb_test_ModelWithExtensions* sub_message =
+      upb_test_ModelWithSubMessages_mutable_optional_child(input_msg,
+                                                           arena.ptr());
+  upb_test_ModelWithExtensions_set_random_int32(sub_message, 12);
+  for (int i = 0; i < 2; i++) {
+    upb_test_ModelWithExtensions* item =
+        upb_test_ModelWithSubMessages_add_items(input_msg, arena.ptr());
+    upb_test_ModelWithExtensions_set_random_int32(item, 13 + i);
+  }
+  size_t serialized_size;
+  char* serialized = upb_test_ModelWithSubMessages_serialize(
+      input_msg, arena.ptr(), &serialized_size);
+
+  const upb_MiniTable* mini_table = &upb_0test__ModelWithSubMessages_msg_init;
+  const upb_MiniTableField* lazy_fields[] = {
+      upb_MiniTable_FindFieldByNumber(mini_table, 5),
+      upb_MiniTable_FindFieldByNumber(mini_table, 6),
+  };
+  const upb_MiniTable* lazy_table = upb_MiniTable_CopyWithLazyFields(
+      mini_table, lazy_fields, 2, arena.ptr());
+  ASSERT_NE(nullptr, lazy_table);
+
+  upb_Message* msg = upb_Message_New(mini_table, arena.ptr());
+  upb_DecodeStatus decode_status =
+      upb_Decode(serialized, serialized_size, msg, lazy_table, nullptr,
+                 kUpb_DecodeOption_ExperimentalLazyUnlinked, arena.ptr());
+  EXPECT_EQ(decode_status, kUpb_DecodeStatus_Ok);
+  EXPECT_EQ(upb_Message_GetInt32(
+                msg, upb_MiniTable_FindFieldByNumber(mini_table, 4), 0),
+            11);
+  EXPECT_TRUE(upb_TaggedMessagePtr_IsEmpty(
+      upb_Message_GetTaggedMessagePtr(msg, lazy_fields[0], nullptr)));
+
+  // The unparsed fields are written back as they were read.
+  CheckReserialize(msg, mini_table, arena.ptr(), serialized, serialized_size);
+
+  upb_Message* child;
+  EXPECT_EQ(kUpb_DecodeStatus_Ok,
+            upb_Message_GetOrPromoteMessage(msg, mini_table, lazy_fields[0], 0,
+                                            arena.ptr(), &child));
+  ASSERT_NE(nullptr, child);
+  EXPECT_EQ(upb_test_ModelWithExtensions_random_int32(
+                (upb_test_ModelWithExtensions*)child),
+            12);
+  // Once promoted, the field holds the promoted message.
+  upb_Message* again;
+  EXPECT_EQ(kUpb_DecodeStatus_Ok,
+            upb_Message_GetOrPromoteMessage(msg, mini_table, lazy_fields[0], 0,
+                                            arena.ptr(), &again));
+  EXPECT_EQ(child, again);
+
+  upb_Array* array = upb_Message_GetMutableArray(msg, lazy_fields[1]);
+  ASSERT_EQ(2, upb_Array_Size(array));
+  EXPECT_EQ(kUpb_DecodeStatus_Ok,
+            upb_Array_PromoteMessages(array,
+                                      &upb_0test__ModelWithExtensions_msg_init,
+                                      0, arena.ptr()));
+  EXPECT_EQ(upb_test_ModelWithExtensions_random_int32(
+                (upb_test_ModelWithExtensions*)upb_Array_Get(array, 1).msg_val),
+            14);
+  CheckReserialize(msg, mini_table, arena.ptr(), serialized, serialized_size);
+
+  // Errors in unparsed fields are only reported when promoting them.
+  const char malformed[] = {0x2a, 0x02, 0x22, 0x05};
+  msg = upb_Message_New(mini_table, arena.ptr());
+  decode_status =
+      upb_Decode(malformed, sizeof(malformed), msg, lazy_table, nullptr,
+                 kUpb_DecodeOption_ExperimentalLazyUnlinked, arena.ptr());
+  EXPECT_EQ(decode_status, kUpb_DecodeStatus_Ok);
+  EXPECT_EQ(kUpb_DecodeStatus_Malformed,
+            upb_Message_GetOrPromoteMessage(msg, mini_table, lazy_fields[0], 0,
+                                            arena.ptr(), &child));
+}
+
 TEST(GeneratedCode, PromoteUnknownToMap) {
   upb::Arena arena;
   upb_test_ModelWithMaps* input_msg = upb_test_ModelWithMaps_new(arena.ptr());
@@ -0,0 +1,307 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+// Tests of field kinds that the fasttable decoder parses without falling back
+// to the generic decoder.  The results must be the same either way, so these
+// tests pass without fasttable too, but they are meant to be run in a build
+// with --//upb:fasttable_enabled=true.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "upb/base/string_view.h"
+#include "upb/base/upcast.h"
+#include "upb/mem/arena.hpp"
+#include "upb/message/message.h"
+#include "upb/mini_table/extension_registry.h"
+#include "upb/mini_table/internal/message.h"
+#include "upb/mini_table/message.h"
+#include "upb/test/fasttable_test.upb.h"
+#include "upb/test/fasttable_test.upb_minitable.h"
+#include "upb/wire/internal/decode_fast.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+namespace {
+
+const upb_MiniTable* kTestMiniTable = &upb_0test__FastTableTest_msg_init;
+
+// Returns true if a field whose tag starts with `tag_byte` has a specialized
+// parser in the fast table.  Always true without fasttable.
+bool HasFastParser(uint8_t tag_byte) {
+#if UPB_FASTTABLE
+  const upb_MiniTable* mt = kTestMiniTable;
+  size_t slot = (tag_byte & 0xf8) >> 3;
+  if (mt->UPB_PRIVATE(table_mask) == (uint8_t)-1) return false;
+  if (slot > (size_t)(mt->UPB_PRIVATE(table_mask) >> 3)) return false;
+  return mt->UPB_PRIVATE(fasttable)[slot].field_parser !=
+         &_upb_FastDecoder_DecodeGeneric;
+#else
+  (void)tag_byte;
+  return true;
+#endif
+}
+
+upb_test_FastTableTest* Parse(const std::string& payload, upb_Arena* arena) {
+  upb_test_FastTableTest* msg =
+      upb_test_FastTableTest_parse(payload.data(), payload.size(), arena);
+  EXPECT_NE(msg, nullptr);
+  return msg;
+}
+
+std::string Serialize(const upb_test_FastTableTest* msg, upb_Arena* arena) {
+  size_t size;
+  char* buf = upb_test_FastTableTest_serialize(msg, arena, &size);
+  return std::string(buf, size);
+}
+
+std::string Unknown(const upb_test_FastTableTest* msg) {
+  size_t size;
+  const char* buf = upb_Message_GetUnknown(UPB_UPCAST(msg), &size);
+  return std::string(buf, size);
+}
+
+TEST(FastTableTest, ClosedEnumUnknownValue) {
+  ASSERT_TRUE(HasFastParser('\x08'));
+  upb::Arena arena;
+
+  // A known value followed by an unknown one keeps the known value.
+  upb_test_FastTableTest* msg =
+      Parse(std::string("\x08\x01\x08\x05"), arena.ptr());
+  EXPECT_TRUE(upb_test_FastTableTest_has_closed_enum(msg));
+  EXPECT_EQ(upb_test_FastTableTest_ONE,
+            upb_test_FastTableTest_closed_enum(msg));
+  EXPECT_EQ(std::string("\x08\x05"), Unknown(msg));
+
+  msg = Parse(std::string("\x08\x05"), arena.ptr());
+  EXPECT_FALSE(upb_test_FastTableTest_has_closed_enum(msg));
+  EXPECT_EQ(std::string("\x08\x05"), Unknown(msg));
+}
+
+TEST(FastTableTest, RepeatedClosedEnumUnknownValue) {
+  ASSERT_TRUE(HasFastParser('\x10'));
+  upb::Arena arena;
+
+  // The unknown value in the middle goes to the unknown fields, and parsing
+  // carries on with the next element.
+  upb_test_FastTableTest* msg =
+      Parse(std::string("\x10\x01\x10\x07\x10\x02"), arena.ptr());
+  size_t size;
+  const int32_t* values =
+      upb_test_FastTableTest_repeated_closed_enum(msg, &size);
+  ASSERT_EQ(2, size);
+  EXPECT_EQ(upb_test_FastTableTest_ONE, values[0]);
+  EXPECT_EQ(upb_test_FastTableTest_TWO, values[1]);
+  EXPECT_EQ(std::string("\x10\x07"), Unknown(msg));
+  EXPECT_EQ(std::string("\x10\x01\x10\x02\x10\x07"),
+            Serialize(msg, arena.ptr()));
+}
+
+TEST(FastTableTest, ThreeByteTags) {
+  for (uint8_t tag_byte : {0x80, 0x8a, 0x92, 0x9a, 0xa2}) {
+    ASSERT_TRUE(HasFastParser(tag_byte)) << static_cast<int>(tag_byte);
+  }
+  upb::Arena arena;
+
+  const char kPayload[] =
+      // high_repeated: [5, 6]
+      "\x80\x80\x01\x05\x80\x80\x01\x06"
+      // high_packed: [1, 2, 150]
+      "\x8a\x80\x01\x04\x01\x02\x96\x01"
+      // high_string: "abc"
+      "\x92\x80\x01\x03"
+      "abc"
+      // high_child: {high_string: ""}
+      "\x9a\x80\x01\x04\x92\x80\x01\x00"
+      // high_children: [{}, {high_repeated: [9]}]
+      "\xa2\x80\x01\x00\xa2\x80\x01\x04\x80\x80\x01\x09";
+  const std::string payload(kPayload, sizeof(kPayload) - 1);
+  upb_test_FastTableTest* msg = Parse(payload, arena.ptr());
+
+  size_t size;
+  const int32_t* repeated = upb_test_FastTableTest_high_repeated(msg, &size);
+  ASSERT_EQ(2, size);
+  EXPECT_EQ(5, repeated[0]);
+  EXPECT_EQ(6, repeated[1]);
+
+  const int32_t* packed = upb_test_FastTableTest_high_packed(msg, &size);
+  ASSERT_EQ(3, size);
+  EXPECT_EQ(1, packed[0]);
+  EXPECT_EQ(2, packed[1]);
+  EXPECT_EQ(150, packed[2]);
+
+  upb_StringView str = upb_test_FastTableTest_high_string(msg);
+  EXPECT_EQ("abc", std::string(str.data, str.size));
+
+  const upb_test_FastTableTest* child =
+      upb_test_FastTableTest_high_child(msg);
+  ASSERT_NE(nullptr, child);
+  EXPECT_TRUE(upb_test_FastTableTest_has_high_string(child));
+
+  const upb_test_FastTableTest* const* children =
+      upb_test_FastTableTest_high_children(msg, &size);
+  ASSERT_EQ(2, size);
+  repeated = upb_test_FastTableTest_high_repeated(children[1], &size);
+  ASSERT_EQ(1, size);
+  EXPECT_EQ(9, repeated[0]);
+
+  EXPECT_EQ("", Unknown(msg));
+  EXPECT_EQ(payload, Serialize(msg, arena.ptr()));
+}
+
+TEST(FastTableTest, OneofSwitchesSubMessage) {
+  ASSERT_TRUE(HasFastParser('\x1a'));
+  ASSERT_TRUE(HasFastParser('\x22'));
+  upb::Arena arena;
+
+  // sub_a {x: 1}, sub_b {y: 2}, sub_a {z: 3}: switching back to sub_a starts
+  // from an empty message instead of parsing into the sub_b message.
+  upb_test_FastTableTest* msg =
+      Parse(std::string("\x1a\x02\x08\x01"
+                        "\x22\x02\x08\x02"
+                        "\x1a\x02\x10\x03"),
+            arena.ptr());
+  ASSERT_EQ(upb_test_FastTableTest_sub_sub_a,
+            upb_test_FastTableTest_sub_case(msg));
+  const upb_test_FastTableTest_SubA* sub_a = upb_test_FastTableTest_sub_a(msg);
+  EXPECT_FALSE(upb_test_FastTableTest_SubA_has_x(sub_a));
+  EXPECT_EQ(3, upb_test_FastTableTest_SubA_z(sub_a));
+
+  // sub_a {x: 1}, sub_a {z: 3}, sub_b {y: 2}.
+  msg = Parse(std::string("\x1a\x02\x08\x01"
+                          "\x1a\x02\x10\x03"
+                          "\x22\x02\x08\x02"),
+              arena.ptr());
+  ASSERT_EQ(upb_test_FastTableTest_sub_sub_b,
+            upb_test_FastTableTest_sub_case(msg));
+  const upb_test_FastTableTest_SubB* sub_b = upb_test_FastTableTest_sub_b(msg);
+  EXPECT_EQ(2, upb_test_FastTableTest_SubB_y(sub_b));
+
+  // Repeating the same member merges into it.
+  msg = Parse(std::string("\x1a\x02\x08\x01"
+                          "\x1a\x02\x10\x03"),
+              arena.ptr());
+  ASSERT_EQ(upb_test_FastTableTest_sub_sub_a,
+            upb_test_FastTableTest_sub_case(msg));
+  sub_a = upb_test_FastTableTest_sub_a(msg);
+  EXPECT_EQ(1, upb_test_FastTableTest_SubA_x(sub_a));
+  EXPECT_EQ(3, upb_test_FastTableTest_SubA_z(sub_a));
+}
+
+TEST(FastTableTest, Maps) {
+  ASSERT_TRUE(HasFastParser('\x2a'));
+  ASSERT_TRUE(HasFastParser('\x32'));
+  upb::Arena arena;
+
+  const char kPayload[] =
+      // int_to_string: {1: "a"}, {2: "bc"}, {1: "z"}
+      "\x2a\x05\x08\x01\x12\x01"
+      "a"
+      "\x2a\x06\x08\x02\x12\x02"
+      "bc"
+      "\x2a\x05\x08\x01\x12\x01"
+      "z"
+      // string_to_sub: {"k": {x: 7}}, {"m": <no value>}
+      "\x32\x07\x0a\x01k\x12\x02\x08\x07"
+      "\x32\x03\x0a\x01m";
+  upb_test_FastTableTest* msg =
+      Parse(std::string(kPayload, sizeof(kPayload) - 1), arena.ptr());
+
+  // The later entry for a key replaces the earlier one.
+  ASSERT_EQ(2, upb_test_FastTableTest_int_to_string_size(msg));
+  upb_StringView str;
+  ASSERT_TRUE(upb_test_FastTableTest_int_to_string_get(msg, 1, &str));
+  EXPECT_EQ("z", std::string(str.data, str.size));
+  ASSERT_TRUE(upb_test_FastTableTest_int_to_string_get(msg, 2, &str));
+  EXPECT_EQ("bc", std::string(str.data, str.size));
+
+  // A missing message value is an empty message, not null.
+  ASSERT_EQ(2, upb_test_FastTableTest_string_to_sub_size(msg));
+  upb_test_FastTableTest_SubA* sub;
+  ASSERT_TRUE(upb_test_FastTableTest_string_to_sub_get(
+      msg, upb_StringView_FromString("k"), &sub));
+  EXPECT_EQ(7, upb_test_FastTableTest_SubA_x(sub));
+  ASSERT_TRUE(upb_test_FastTableTest_string_to_sub_get(
+      msg, upb_StringView_FromString("m"), &sub));
+  ASSERT_NE(nullptr, sub);
+  EXPECT_FALSE(upb_test_FastTableTest_SubA_has_x(sub));
+  EXPECT_EQ("", Unknown(msg));
+}
+
+TEST(FastTableTest, MapEntryUnknownField) {
+  upb::Arena arena;
+
+  // An entry with an unknown field is kept as an unknown field of the parent
+  // instead of being inserted.
+  const std::string entry("\x2a\x06\x08\x01\x18\x05\x12\x00", 8);
+  upb_test_FastTableTest* msg = Parse(entry, arena.ptr());
+  EXPECT_EQ(0, upb_test_FastTableTest_int_to_string_size(msg));
+  EXPECT_NE("", Unknown(msg));
+}
+
+TEST(FastTableTest, Extensions) {
+  // int32_ext shares its slot with high_children, the others have their own.
+  for (uint8_t tag_byte : {0xa8, 0xb5, 0xba}) {
+    ASSERT_TRUE(HasFastParser(tag_byte)) << static_cast<int>(tag_byte);
+  }
+  upb::Arena arena;
+  upb_ExtensionRegistry* extreg = upb_ExtensionRegistry_New(arena.ptr());
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(extreg, &upb_test_int32_ext_ext));
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(extreg, &upb_test_sint64_ext_ext));
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(extreg, &upb_test_fixed32_ext_ext));
+  ASSERT_TRUE(upb_ExtensionRegistry_Add(extreg, &upb_test_string_ext_ext));
+
+  const char kPayload[] =
+      // int32_ext: -1
+      "\xa0\x06\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01"
+      // sint64_ext: -3
+      "\xa8\x06\x05"
+      // fixed32_ext: 0x01020304
+      "\xb5\x06\x04\x03\x02\x01"
+      // string_ext: "hi"
+      "\xba\x06\x02"
+      "hi"
+      // closed_enum: ONE
+      "\x08\x01"
+      // Unregistered field 110: 7
+      "\xf0\x06\x07";
+  const std::string payload(kPayload, sizeof(kPayload) - 1);
+  upb_test_FastTableTest* msg = upb_test_FastTableTest_parse_ex(
+      payload.data(), payload.size(), extreg, 0, arena.ptr());
+  ASSERT_NE(nullptr, msg);
+
+  EXPECT_EQ(-1, upb_test_int32_ext(msg));
+  EXPECT_EQ(-3, upb_test_sint64_ext(msg));
+  EXPECT_EQ(0x01020304u, upb_test_fixed32_ext(msg));
+  upb_StringView str = upb_test_string_ext(msg);
+  EXPECT_EQ("hi", std::string(str.data, str.size));
+  EXPECT_EQ(upb_test_FastTableTest_ONE,
+            upb_test_FastTableTest_closed_enum(msg));
+  EXPECT_EQ(std::string("\xf0\x06\x07"), Unknown(msg));
+
+  // Without a registry they are all unknown fields.
+  msg = Parse(payload, arena.ptr());
+  EXPECT_FALSE(upb_test_has_sint64_ext(msg));
+  EXPECT_EQ(upb_test_FastTableTest_ONE,
+            upb_test_FastTableTest_closed_enum(msg));
+  EXPECT_EQ(payload.substr(0, payload.size() - 5) + "\xf0\x06\x07",
+            Unknown(msg));
+
+  // A value with the wrong wire type is an unknown field too.
+  msg = upb_test_FastTableTest_parse_ex("\xad\x06\x01\x02\x03\x04", 6,
+                                        extreg, 0, arena.ptr());
+  ASSERT_NE(nullptr, msg);
+  EXPECT_FALSE(upb_test_has_sint64_ext(msg));
+  EXPECT_EQ(std::string("\xad\x06\x01\x02\x03\x04", 6), Unknown(msg));
+}
+
+}  // namespace
+
+#include "upb/port/undef.inc"
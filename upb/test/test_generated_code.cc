@@ -12,16 +12,23 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "google/protobuf/test_messages_proto2.upb.h"
 #include "google/protobuf/test_messages_proto3.upb.h"
 #include "upb/base/status.h"
 #include "upb/base/string_view.h"
+#include "upb/io/chunked_input_stream.h"
+#include "upb/io/chunked_output_stream.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/io/zero_copy_output_stream.h"
 #include "upb/mem/arena.hpp"
 #include "upb/message/array.h"
 #include "upb/message/map.h"
 #include "upb/test/test.upb.h"
+#include "upb/wire/decode.h"
+#include "upb/wire/encode.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -925,6 +932,322 @@ TEST(GeneratedCode, Extensions) {
   ASSERT_EQ(0, memcmp(pb1, pb2, size1));
 }
 
+// Returns a message with sub-messages, packed and repeated fields and maps.
+static protobuf_test_messages_proto2_TestAllTypesProto2* NewNestedMessage(
+    upb_Arena* arena) {
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      protobuf_test_messages_proto2_TestAllTypesProto2_new(arena);
+  protobuf_test_messages_proto2_TestAllTypesProto2_set_optional_int32(msg, -1);
+  protobuf_test_messages_proto2_TestAllTypesProto2_set_optional_string(
+      msg, test_str_view);
+  protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage_set_a(
+      protobuf_test_messages_proto2_TestAllTypesProto2_mutable_optional_nested_message(
+          msg, arena),
+      test_int32);
+  protobuf_test_messages_proto2_TestAllTypesProto2* child =
+      protobuf_test_messages_proto2_TestAllTypesProto2_mutable_recursive_message(
+          msg, arena);
+  for (int32_t i = 0; i < 300; i += 7) {
+    protobuf_test_messages_proto2_TestAllTypesProto2_add_packed_int32(
+        child, i * i * i - 1000, arena);
+    protobuf_test_messages_proto2_TestAllTypesProto2_add_repeated_sint64(
+        child, -i, arena);
+    protobuf_test_messages_proto2_TestAllTypesProto2_map_int32_int32_set(
+        child, i, -i, arena);
+    protobuf_test_messages_proto2_TestAllTypesProto2_NestedMessage_set_a(
+        protobuf_test_messages_proto2_TestAllTypesProto2_add_repeated_nested_message(
+            msg, arena),
+        i);
+  }
+  protobuf_test_messages_proto2_TestAllTypesProto2_map_string_string_set(
+      child, test_str_view2, test_str_view3, arena);
+  protobuf_test_messages_proto2_TestAllTypesProto2_map_string_string_set(
+      child, test_str_view4, test_str_view, arena);
+  return msg;
+}
+
+// Expects the two-pass encoder to return the same status and output as the
+// one-pass encoder, both with and without a length prefix.
+static void ExpectPrecomputedSizesMatch(const upb_Message* msg,
+                                        const upb_MiniTable* mt, int opts,
+                                        upb_Arena* arena) {
+  for (auto encode : {upb_Encode, upb_EncodeLengthPrefixed}) {
+    SCOPED_TRACE(encode == upb_Encode ? "upb_Encode"
+                                      : "upb_EncodeLengthPrefixed");
+    char* pb1;
+    char* pb2;
+    size_t size1, size2;
+    upb_EncodeStatus status1 = encode(msg, mt, opts, arena, &pb1, &size1);
+    upb_EncodeStatus status2 = encode(
+        msg, mt, opts | kUpb_EncodeOption_PrecomputeSizes, arena, &pb2, &size2);
+    ASSERT_EQ(status1, status2);
+    if (status1 != kUpb_EncodeStatus_Ok) continue;
+    ASSERT_EQ(size1, size2);
+    EXPECT_EQ(0, memcmp(pb1, pb2, size1));
+  }
+}
+
+TEST(GeneratedCode, PrecomputeSizes) {
+  upb::Arena arena;
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      NewNestedMessage(arena.ptr());
+  const upb_MiniTable* mt =
+      &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init;
+
+  for (int opts : {0, static_cast<int>(kUpb_EncodeOption_Deterministic)}) {
+    SCOPED_TRACE(opts);
+    ExpectPrecomputedSizesMatch(UPB_UPCAST(msg), mt, opts, arena.ptr());
+  }
+
+  size_t size;
+  EXPECT_NE(nullptr,
+            protobuf_test_messages_proto2_TestAllTypesProto2_serialize_ex(
+                protobuf_test_messages_proto2_TestAllTypesProto2_new(
+                    arena.ptr()),
+                kUpb_EncodeOption_PrecomputeSizes, arena.ptr(), &size));
+  EXPECT_EQ(size, 0);
+}
+
+TEST(GeneratedCode, PrecomputeSizesExtensionsAndGroups) {
+  upb::Arena arena;
+  const int all_opts[] = {0, kUpb_EncodeOption_Deterministic};
+
+  // Extensions.
+  upb_test_ModelWithExtensions* msg =
+      upb_test_ModelWithExtensions_new(arena.ptr());
+  upb_test_ModelWithExtensions_set_random_int32(msg, 7);
+  upb_test_ModelExtension1* extension1 =
+      upb_test_ModelExtension1_new(arena.ptr());
+  upb_test_ModelExtension1_set_str(extension1,
+                                   upb_StringView_FromString("Hello"));
+  upb_test_ModelExtension1_set_model_ext(msg, extension1, arena.ptr());
+  upb_test_ModelExtension2* extension2 =
+      upb_test_ModelExtension2_new(arena.ptr());
+  upb_test_ModelExtension2_set_i(extension2, 5);
+  upb_test_ModelExtension2_set_model_ext(msg, extension2, arena.ptr());
+  for (int opts : all_opts) {
+    SCOPED_TRACE(opts);
+    ExpectPrecomputedSizesMatch(UPB_UPCAST(msg),
+                                &upb_0test__ModelWithExtensions_msg_init, opts,
+                                arena.ptr());
+  }
+
+  // MessageSet items.
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrect* msgset =
+      protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrect_new(
+          arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension1*
+      item1 =
+          protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension1_new(
+              arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension1_set_str(
+      item1, test_str_view);
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension1_set_message_set_extension(
+      msgset, item1, arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension2*
+      item2 =
+          protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension2_new(
+              arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension2_set_i(
+      item2, test_int32);
+  protobuf_test_messages_proto2_TestAllTypesProto2_MessageSetCorrectExtension2_set_message_set_extension(
+      msgset, item2, arena.ptr());
+  for (int opts : all_opts) {
+    SCOPED_TRACE(opts);
+    ExpectPrecomputedSizesMatch(
+        UPB_UPCAST(msgset),
+        &protobuf_0test_0messages__proto2__TestAllTypesProto2__MessageSetCorrect_msg_init,
+        opts, arena.ptr());
+  }
+
+  // Groups, including one in a sub-message.
+  protobuf_test_messages_proto2_TestAllTypesProto2* groups =
+      protobuf_test_messages_proto2_TestAllTypesProto2_new(arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2_Data_set_group_int32(
+      protobuf_test_messages_proto2_TestAllTypesProto2_mutable_data(
+          groups, arena.ptr()),
+      -1);
+  protobuf_test_messages_proto2_TestAllTypesProto2_MultiWordGroupField_set_group_uint32(
+      protobuf_test_messages_proto2_TestAllTypesProto2_mutable_multiwordgroupfield(
+          protobuf_test_messages_proto2_TestAllTypesProto2_mutable_recursive_message(
+              groups, arena.ptr()),
+          arena.ptr()),
+      1000);
+  for (int opts : all_opts) {
+    SCOPED_TRACE(opts);
+    ExpectPrecomputedSizesMatch(
+        UPB_UPCAST(groups),
+        &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init, opts,
+        arena.ptr());
+  }
+}
+
+TEST(GeneratedCode, PrecomputeSizesUnknownFields) {
+  upb::Arena arena;
+  protobuf_test_messages_proto2_UnknownToTestAllTypes* unknown =
+      protobuf_test_messages_proto2_UnknownToTestAllTypes_new(arena.ptr());
+  protobuf_test_messages_proto2_UnknownToTestAllTypes_set_optional_int32(
+      unknown, test_int32);
+  protobuf_test_messages_proto2_UnknownToTestAllTypes_set_optional_string(
+      unknown, test_str_view);
+  protobuf_test_messages_proto2_ForeignMessageProto2_set_c(
+      protobuf_test_messages_proto2_UnknownToTestAllTypes_mutable_nested_message(
+          unknown, arena.ptr()),
+      test_int32);
+  protobuf_test_messages_proto2_UnknownToTestAllTypes_OptionalGroup_set_a(
+      protobuf_test_messages_proto2_UnknownToTestAllTypes_mutable_optionalgroup(
+          unknown, arena.ptr()),
+      test_int32);
+  size_t size;
+  char* pb = protobuf_test_messages_proto2_UnknownToTestAllTypes_serialize(
+      unknown, arena.ptr(), &size);
+  ASSERT_NE(pb, nullptr);
+
+  // The unknown fields are both in the message and in a sub-message.
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      protobuf_test_messages_proto2_TestAllTypesProto2_parse(pb, size,
+                                                            arena.ptr());
+  ASSERT_NE(msg, nullptr);
+  protobuf_test_messages_proto2_TestAllTypesProto2* child =
+      protobuf_test_messages_proto2_TestAllTypesProto2_parse(pb, size,
+                                                            arena.ptr());
+  ASSERT_NE(child, nullptr);
+  protobuf_test_messages_proto2_TestAllTypesProto2_set_optional_int32(child,
+                                                                      -1);
+  protobuf_test_messages_proto2_TestAllTypesProto2_set_recursive_message(msg,
+                                                                         child);
+
+  for (int opts : {0, static_cast<int>(kUpb_EncodeOption_SkipUnknown),
+                   kUpb_EncodeOption_SkipUnknown |
+                       kUpb_EncodeOption_Deterministic}) {
+    SCOPED_TRACE(opts);
+    ExpectPrecomputedSizesMatch(
+        UPB_UPCAST(msg),
+        &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init, opts,
+        arena.ptr());
+  }
+}
+
+TEST(GeneratedCode, PrecomputeSizesCheckRequired) {
+  upb::Arena arena;
+  const upb_MiniTable* mt = &upb_0test__ModelWithRequired_msg_init;
+  upb_test_ModelWithRequired* msg = upb_test_ModelWithRequired_new(arena.ptr());
+  upb_test_ModelWithRequired_set_id(msg, 1);
+  upb_test_ModelWithRequired* child =
+      upb_test_ModelWithRequired_mutable_child(msg, arena.ptr());
+
+  // The sub-message is missing its required field.
+  char* pb;
+  size_t size;
+  EXPECT_EQ(upb_Encode(UPB_UPCAST(msg), mt,
+                       kUpb_EncodeOption_CheckRequired |
+                           kUpb_EncodeOption_PrecomputeSizes,
+                       arena.ptr(), &pb, &size),
+            kUpb_EncodeStatus_MissingRequired);
+  ExpectPrecomputedSizesMatch(UPB_UPCAST(msg), mt,
+                              kUpb_EncodeOption_CheckRequired, arena.ptr());
+
+  upb_test_ModelWithRequired_set_id(child, 2);
+  EXPECT_EQ(upb_Encode(UPB_UPCAST(msg), mt,
+                       kUpb_EncodeOption_CheckRequired |
+                           kUpb_EncodeOption_PrecomputeSizes,
+                       arena.ptr(), &pb, &size),
+            kUpb_EncodeStatus_Ok);
+  ExpectPrecomputedSizesMatch(UPB_UPCAST(msg), mt,
+                              kUpb_EncodeOption_CheckRequired, arena.ptr());
+}
+
+TEST(GeneratedCode, Streams) {
+  upb::Arena arena;
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg =
+      NewNestedMessage(arena.ptr());
+  const upb_MiniTable* mt =
+      &protobuf_0test_0messages__proto2__TestAllTypesProto2_msg_init;
+  const int opts = kUpb_EncodeOption_Deterministic;
+  size_t size;
+  char* pb = protobuf_test_messages_proto2_TestAllTypesProto2_serialize_ex(
+      msg, opts, arena.ptr(), &size);
+  ASSERT_NE(pb, nullptr);
+
+  std::vector<char> buf(size);
+  for (size_t limit : {size_t{1}, size_t{7}, size_t{64}, size}) {
+    SCOPED_TRACE(limit);
+    upb_ZeroCopyOutputStream* output =
+        upb_ChunkedOutputStream_New(buf.data(), size, limit, arena.ptr());
+    ASSERT_EQ(upb_EncodeToStream(UPB_UPCAST(msg), mt, opts, output),
+              kUpb_EncodeStatus_Ok);
+    EXPECT_EQ(upb_ZeroCopyOutputStream_ByteCount(output), size);
+    EXPECT_EQ(0, memcmp(buf.data(), pb, size));
+
+    upb_ZeroCopyInputStream* input =
+        upb_ChunkedInputStream_New(pb, size, limit, arena.ptr());
+    protobuf_test_messages_proto2_TestAllTypesProto2* msg2 =
+        protobuf_test_messages_proto2_TestAllTypesProto2_new(arena.ptr());
+    ASSERT_EQ(upb_DecodeFromStream(input, UPB_UPCAST(msg2), mt, nullptr, 0,
+                                   arena.ptr()),
+              kUpb_DecodeStatus_Ok);
+    size_t size2;
+    char* pb2 = protobuf_test_messages_proto2_TestAllTypesProto2_serialize_ex(
+        msg2, opts, arena.ptr(), &size2);
+    ASSERT_EQ(size, size2);
+    EXPECT_EQ(0, memcmp(pb, pb2, size));
+  }
+
+  // The encoding does not fit.
+  upb_ZeroCopyOutputStream* output =
+      upb_ChunkedOutputStream_New(buf.data(), size - 1, 64, arena.ptr());
+  EXPECT_EQ(upb_EncodeToStream(UPB_UPCAST(msg), mt, opts, output),
+            kUpb_EncodeStatus_StreamError);
+
+  // The input ends in the middle of a field.
+  upb_ZeroCopyInputStream* input =
+      upb_ChunkedInputStream_New(pb, size - 1, 64, arena.ptr());
+  protobuf_test_messages_proto2_TestAllTypesProto2* msg2 =
+      protobuf_test_messages_proto2_TestAllTypesProto2_new(arena.ptr());
+  EXPECT_EQ(upb_DecodeFromStream(input, UPB_UPCAST(msg2), mt, nullptr, 0,
+                                 arena.ptr()),
+            kUpb_DecodeStatus_Malformed);
+}
+
+TEST(GeneratedCode, StreamsCheckRequired) {
+  upb::Arena arena;
+  const upb_MiniTable* mt = &upb_0test__ModelWithRequired_msg_init;
+  upb_test_ModelWithRequired* msg = upb_test_ModelWithRequired_new(arena.ptr());
+  upb_test_ModelWithRequired* child =
+      upb_test_ModelWithRequired_mutable_child(msg, arena.ptr());
+  upb_test_ModelWithRequired* value =
+      upb_test_ModelWithRequired_new(arena.ptr());
+  upb_test_ModelWithRequired_map_im_set(msg, 1, value, arena.ptr());
+
+  auto decode = [&](const upb_test_ModelWithRequired* m) {
+    size_t size;
+    char* pb = upb_test_ModelWithRequired_serialize(m, arena.ptr(), &size);
+    EXPECT_NE(pb, nullptr);
+    // Small buffers put the top-level fields in separate runs.
+    upb_ZeroCopyInputStream* input =
+        upb_ChunkedInputStream_New(pb, size, 1, arena.ptr());
+    return upb_DecodeFromStream(
+        input, UPB_UPCAST(upb_test_ModelWithRequired_new(arena.ptr())), mt,
+        nullptr, kUpb_DecodeOption_CheckRequired, arena.ptr());
+  };
+
+  // The top-level message and its sub-messages are all missing `id`.
+  EXPECT_EQ(decode(msg), kUpb_DecodeStatus_MissingRequired);
+
+  // The top-level message is complete, but not its sub-messages.
+  upb_test_ModelWithRequired_set_id(msg, 1);
+  EXPECT_EQ(decode(msg), kUpb_DecodeStatus_MissingRequired);
+  upb_test_ModelWithRequired_set_id(child, 2);
+  EXPECT_EQ(decode(msg), kUpb_DecodeStatus_MissingRequired);
+
+  upb_test_ModelWithRequired_set_id(value, 3);
+  EXPECT_EQ(decode(msg), kUpb_DecodeStatus_Ok);
+
+  // A nested message is incomplete.
+  upb_test_ModelWithRequired_mutable_child(child, arena.ptr());
+  EXPECT_EQ(decode(msg), kUpb_DecodeStatus_MissingRequired);
+}
+
 TEST(GeneratedCode, Maps) {
   upb::Arena arena;
   upb_test_ModelWithMaps* msg = upb_test_ModelWithMaps_new(arena.ptr());
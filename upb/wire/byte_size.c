@@ -9,10 +9,10 @@
 
 #include <stddef.h>
 
-#include "upb/mem/arena.h"
 #include "upb/message/message.h"
 #include "upb/mini_table/message.h"
 #include "upb/wire/encode.h"
+#include "upb/wire/internal/encode.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -22,14 +22,8 @@ extern "C" {
 #endif
 
 size_t upb_ByteSize(const upb_Message* msg, const upb_MiniTable* mt) {
-  upb_Arena* arena = upb_Arena_New();
-  char* buf;
-  size_t res = 0;
-
-  upb_Encode(msg, mt, 0, arena, &buf, &res);
-
-  upb_Arena_Free(arena);
-  return res;
+  upb_EncodeStatus status;
+  return UPB_PRIVATE(_upb_Encode_Size)(msg, mt, 0, &status);
 }
 
 #ifdef __cplusplus
@@ -15,8 +15,11 @@
 
 #include "upb/base/descriptor_constants.h"
 #include "upb/base/internal/endian.h"
+#include "upb/base/status.h"
 #include "upb/base/string_view.h"
 #include "upb/hash/common.h"
+#include "upb/io/zero_copy_input_stream.h"
+#include "upb/mem/alloc.h"
 #include "upb/mem/arena.h"
 #include "upb/message/array.h"
 #include "upb/message/internal/accessors.h"
@@ -44,6 +47,7 @@
 #include "upb/wire/internal/constants.h"
 #include "upb/wire/internal/decoder.h"
 #include "upb/wire/reader.h"
+#include "upb/wire/types.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -322,15 +326,33 @@ const char* _upb_Decoder_RecurseSubMessage(upb_Decoder* d, const char* ptr,
   return ptr;
 }
 
+// Stores the `size` bytes of a sub-message as the unknown data of the "empty"
+// message `submsg` without parsing them, which is what parsing them with the
+// empty MiniTable would store too.
+UPB_NOINLINE
+static const char* _upb_Decoder_DecodeLazySubMessage(upb_Decoder* d,
+                                                     const char* ptr,
+                                                     upb_Message* submsg,
+                                                     int size) {
+  if (!UPB_PRIVATE(_upb_Message_AddUnknown)(submsg, ptr, size, &d->arena)) {
+    _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
+  }
+  return ptr + size;
+}
+
 UPB_FORCEINLINE
 const char* _upb_Decoder_DecodeSubMessage(upb_Decoder* d, const char* ptr,
                                           upb_Message* submsg,
                                           const upb_MiniTableSubInternal* subs,
                                           const upb_MiniTableField* field,
                                           int size) {
-  int saved_delta = upb_EpsCopyInputStream_PushLimit(&d->input, ptr, size);
   const upb_MiniTable* subl = _upb_MiniTableSubs_MessageByField(subs, field);
   UPB_ASSERT(subl);
+  if (UPB_UNLIKELY(d->options & kUpb_DecodeOption_ExperimentalLazyUnlinked) &&
+      UPB_PRIVATE(_upb_MiniTable_IsEmpty)(subl)) {
+    return _upb_Decoder_DecodeLazySubMessage(d, ptr, submsg, size);
+  }
+  int saved_delta = upb_EpsCopyInputStream_PushLimit(&d->input, ptr, size);
   ptr = _upb_Decoder_RecurseSubMessage(d, ptr, submsg, subl, DECODE_NOGROUP);
   upb_EpsCopyInputStream_PopLimit(&d->input, ptr, saved_delta);
   return ptr;
@@ -590,8 +612,7 @@ static const char* _upb_Decoder_DecodeToArray(
   }
 }
 
-static upb_Map* _upb_Decoder_CreateMap(upb_Decoder* d,
-                                       const upb_MiniTable* entry) {
+upb_Map* _upb_Decoder_CreateMap(upb_Decoder* d, const upb_MiniTable* entry) {
   // Maps descriptor type -> upb map size
   static const uint8_t kSizeInMap[] = {
       [0] = -1,  // invalid descriptor type
@@ -626,28 +647,9 @@ static upb_Map* _upb_Decoder_CreateMap(upb_Decoder* d,
   return ret;
 }
 
-static const char* _upb_Decoder_DecodeToMap(
-    upb_Decoder* d, const char* ptr, upb_Message* msg,
-    const upb_MiniTableSubInternal* subs, const upb_MiniTableField* field,
-    wireval* val) {
-  upb_Map** map_p = UPB_PTR_AT(msg, field->UPB_PRIVATE(offset), upb_Map*);
-  upb_Map* map = *map_p;
-  upb_MapEntry ent;
-  UPB_ASSERT(upb_MiniTableField_Type(field) == kUpb_FieldType_Message);
-  const upb_MiniTable* entry = _upb_MiniTableSubs_MessageByField(subs, field);
-
-  UPB_ASSERT(entry);
-  UPB_ASSERT(entry->UPB_PRIVATE(field_count) == 2);
-  UPB_ASSERT(upb_MiniTableField_IsScalar(&entry->UPB_PRIVATE(fields)[0]));
-  UPB_ASSERT(upb_MiniTableField_IsScalar(&entry->UPB_PRIVATE(fields)[1]));
-
-  if (!map) {
-    map = _upb_Decoder_CreateMap(d, entry);
-    *map_p = map;
-  }
-
-  // Parse map entry.
-  memset(&ent, 0, sizeof(ent));
+void _upb_Decoder_InitMapEntry(upb_Decoder* d, const upb_MiniTable* entry,
+                               upb_MapEntry* ent) {
+  memset(ent, 0, sizeof(*ent));
 
   if (entry->UPB_PRIVATE(fields)[1].UPB_PRIVATE(descriptortype) ==
           kUpb_FieldType_Message ||
@@ -657,21 +659,22 @@ static const char* _upb_Decoder_DecodeToMap(
     upb_TaggedMessagePtr msg;
     _upb_Decoder_NewSubMessage(d, entry->UPB_PRIVATE(subs),
                                &entry->UPB_PRIVATE(fields)[1], &msg);
-    ent.v.val = upb_value_uintptr(msg);
+    ent->v.val = upb_value_uintptr(msg);
   }
+}
 
-  ptr = _upb_Decoder_DecodeSubMessage(d, ptr, &ent.message, subs, field,
-                                      val->size);
+void _upb_Decoder_InsertMapEntry(upb_Decoder* d, upb_Message* msg,
+                                 upb_Map* map, const upb_MiniTable* entry,
+                                 uint32_t field_number, upb_MapEntry* ent) {
   // check if ent had any unknown fields
   size_t size;
-  upb_Message_GetUnknown(&ent.message, &size);
+  upb_Message_GetUnknown(&ent->message, &size);
   if (size != 0) {
     char* buf;
     size_t size;
-    uint32_t tag =
-        ((uint32_t)field->UPB_PRIVATE(number) << 3) | kUpb_WireType_Delimited;
+    uint32_t tag = (field_number << 3) | kUpb_WireType_Delimited;
     upb_EncodeStatus status =
-        upb_Encode(&ent.message, entry, 0, &d->arena, &buf, &size);
+        upb_Encode(&ent->message, entry, 0, &d->arena, &buf, &size);
     if (status != kUpb_EncodeStatus_Ok) {
       _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
     }
@@ -680,11 +683,39 @@ static const char* _upb_Decoder_DecodeToMap(
       _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
     }
   } else {
-    if (_upb_Map_Insert(map, &ent.k, map->key_size, &ent.v, map->val_size,
+    if (_upb_Map_Insert(map, &ent->k, map->key_size, &ent->v, map->val_size,
                         &d->arena) == kUpb_MapInsertStatus_OutOfMemory) {
       _upb_Decoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
     }
   }
+}
+
+static const char* _upb_Decoder_DecodeToMap(
+    upb_Decoder* d, const char* ptr, upb_Message* msg,
+    const upb_MiniTableSubInternal* subs, const upb_MiniTableField* field,
+    wireval* val) {
+  upb_Map** map_p = UPB_PTR_AT(msg, field->UPB_PRIVATE(offset), upb_Map*);
+  upb_Map* map = *map_p;
+  upb_MapEntry ent;
+  UPB_ASSERT(upb_MiniTableField_Type(field) == kUpb_FieldType_Message);
+  const upb_MiniTable* entry = _upb_MiniTableSubs_MessageByField(subs, field);
+
+  UPB_ASSERT(entry);
+  UPB_ASSERT(entry->UPB_PRIVATE(field_count) == 2);
+  UPB_ASSERT(upb_MiniTableField_IsScalar(&entry->UPB_PRIVATE(fields)[0]));
+  UPB_ASSERT(upb_MiniTableField_IsScalar(&entry->UPB_PRIVATE(fields)[1]));
+
+  if (!map) {
+    map = _upb_Decoder_CreateMap(d, entry);
+    *map_p = map;
+  }
+
+  // Parse map entry.
+  _upb_Decoder_InitMapEntry(d, entry, &ent);
+  ptr = _upb_Decoder_DecodeSubMessage(d, ptr, &ent.message, subs, field,
+                                      val->size);
+  _upb_Decoder_InsertMapEntry(d, msg, map, entry, field->UPB_PRIVATE(number),
+                              &ent);
   return ptr;
 }
 
@@ -1337,7 +1368,7 @@ const char* _upb_FastDecoder_DecodeGeneric(struct upb_Decoder* d,
                                            intptr_t table, uint64_t hasbits,
                                            uint64_t data) {
   (void)data;
-  *(uint32_t*)msg |= hasbits;
+  ((uint32_t*)msg)[2] |= hasbits;  // Sync hasbits.
   return _upb_Decoder_DecodeMessage(d, ptr, msg, decode_totablep(table));
 }
 
@@ -1391,6 +1422,9 @@ upb_DecodeStatus upb_Decode(const char* buf, size_t size, upb_Message* msg,
   decoder.unknown = NULL;
   decoder.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
   decoder.end_group = DECODE_NOGROUP;
+  if (options & kUpb_DecodeOption_ExperimentalLazyUnlinked) {
+    options |= kUpb_DecodeOption_ExperimentalAllowUnlinked;
+  }
   decoder.options = (uint16_t)options;
   decoder.missing_required = false;
   decoder.status = kUpb_DecodeStatus_Ok;
@@ -1440,6 +1474,317 @@ upb_DecodeStatus upb_DecodeLengthPrefixed(const char* buf, size_t size,
   return upb_Decode(buf, msg_len, msg, mt, extreg, options, arena);
 }
 
+// upb_DecodeFromStream() cuts the input into runs of whole top-level fields,
+// which it finds by scanning their tags and lengths.
+
+typedef enum {
+  kUpb_ScanField_Complete,
+  kUpb_ScanField_Incomplete,
+  kUpb_ScanField_Malformed,
+} upb_ScanField;
+
+static upb_ScanField _upb_Decoder_ScanVarint(const char** ptr, const char* end,
+                                             uint64_t* val) {
+  uint64_t ret = 0;
+  for (int i = 0; i < 10; i++) {
+    if (*ptr == end) return kUpb_ScanField_Incomplete;
+    uint64_t byte = (uint8_t)*(*ptr)++;
+    ret |= (byte & 0x7f) << (i * 7);
+    if ((byte & 0x80) == 0) {
+      *val = ret;
+      return kUpb_ScanField_Complete;
+    }
+  }
+  return kUpb_ScanField_Malformed;
+}
+
+// Finds the size of the field which starts at `start`.  If the field does not
+// end before `end`, returns kUpb_ScanField_Incomplete and sets *size to the
+// size of the field if that is already known, or to zero otherwise.  An end
+// group tag is a field of its own, whose number is returned in *end_group.
+static upb_ScanField _upb_Decoder_ScanField(const char* start,
+                                            const char* end, int depth,
+                                            size_t* size,
+                                            uint32_t* end_group) {
+  const char* ptr = start;
+  uint64_t tag;
+  uint64_t val;
+  *size = 0;
+  *end_group = 0;
+  upb_ScanField ret = _upb_Decoder_ScanVarint(&ptr, end, &tag);
+  if (ret != kUpb_ScanField_Complete) return ret;
+  uint32_t field_number = tag >> 3;
+  if (tag > UINT32_MAX || field_number == 0) return kUpb_ScanField_Malformed;
+  switch (tag & 7) {
+    case kUpb_WireType_Varint:
+      ret = _upb_Decoder_ScanVarint(&ptr, end, &val);
+      if (ret != kUpb_ScanField_Complete) return ret;
+      val = 0;
+      break;
+    case kUpb_WireType_64Bit:
+      val = 8;
+      break;
+    case kUpb_WireType_32Bit:
+      val = 4;
+      break;
+    case kUpb_WireType_Delimited:
+      ret = _upb_Decoder_ScanVarint(&ptr, end, &val);
+      if (ret != kUpb_ScanField_Complete) return ret;
+      if (val > INT32_MAX) return kUpb_ScanField_Malformed;
+      break;
+    case kUpb_WireType_StartGroup:
+      if (--depth == 0) return kUpb_ScanField_Malformed;
+      while (true) {
+        size_t field_size;
+        uint32_t group_end;
+        ret = _upb_Decoder_ScanField(ptr, end, depth, &field_size, &group_end);
+        if (ret != kUpb_ScanField_Complete) return ret;
+        ptr += field_size;
+        if (group_end == field_number) break;
+        if (group_end) return kUpb_ScanField_Malformed;
+      }
+      val = 0;
+      break;
+    case kUpb_WireType_EndGroup:
+      *end_group = field_number;
+      val = 0;
+      break;
+    default:
+      return kUpb_ScanField_Malformed;
+  }
+  *size = (ptr - start) + val;
+  return (size_t)(end - ptr) < val ? kUpb_ScanField_Incomplete
+                                   : kUpb_ScanField_Complete;
+}
+
+typedef struct {
+  upb_Message* msg;
+  const upb_MiniTable* mt;
+  const upb_ExtensionRegistry* extreg;
+  int options;
+  int depth;
+  upb_Arena* arena;
+
+  // The start of a top-level field that is split across buffers.
+  char* pending;
+  size_t pending_size, pending_cap;
+} upb_StreamDecoder;
+
+static upb_DecodeStatus _upb_StreamDecoder_Decode(upb_StreamDecoder* d,
+                                                  const char* buf,
+                                                  size_t size) {
+  return upb_Decode(buf, size, d->msg, d->mt, d->extreg, d->options, d->arena);
+}
+
+static bool _upb_StreamDecoder_AddPending(upb_StreamDecoder* d,
+                                          const char* data, size_t size) {
+  if (d->pending_cap - d->pending_size < size) {
+    size_t new_cap = UPB_MAX(d->pending_cap * 2, d->pending_size + size);
+    char* pending = upb_grealloc(d->pending, d->pending_cap, new_cap);
+    if (!pending) return false;
+    d->pending = pending;
+    d->pending_cap = new_cap;
+  }
+  memcpy(d->pending + d->pending_size, data, size);
+  d->pending_size += size;
+  return true;
+}
+
+// Decodes the buffer [ptr, end) after the bytes that are pending from earlier
+// buffers.
+static upb_DecodeStatus _upb_StreamDecoder_DecodeBuffer(upb_StreamDecoder* d,
+                                                        const char* ptr,
+                                                        const char* end) {
+  upb_ScanField scan;
+  size_t field_size;
+  uint32_t end_group;
+
+  // Complete the field that the previous buffers ended in the middle of,
+  // copying no more of this buffer than it needs if its size is known.
+  while (d->pending_size) {
+    scan = _upb_Decoder_ScanField(d->pending, d->pending + d->pending_size,
+                                  d->depth, &field_size, &end_group);
+    if (scan == kUpb_ScanField_Malformed || end_group) {
+      return kUpb_DecodeStatus_Malformed;
+    }
+    if (scan == kUpb_ScanField_Complete) {
+      // Any bytes copied past the end of the field came from this buffer.
+      ptr -= d->pending_size - field_size;
+      d->pending_size = 0;
+      upb_DecodeStatus status =
+          _upb_StreamDecoder_Decode(d, d->pending, field_size);
+      if (status != kUpb_DecodeStatus_Ok) return status;
+      break;
+    }
+    if (ptr == end) return kUpb_DecodeStatus_Ok;
+    size_t want = field_size ? field_size - d->pending_size
+                             : UPB_MAX(d->pending_size, 64);
+    size_t n = UPB_MIN(want, (size_t)(end - ptr));
+    if (!_upb_StreamDecoder_AddPending(d, ptr, n)) {
+      return kUpb_DecodeStatus_OutOfMemory;
+    }
+    ptr += n;
+  }
+
+  // Decode the whole fields of this buffer straight from it.
+  const char* start = ptr;
+  while (ptr < end) {
+    scan = _upb_Decoder_ScanField(ptr, end, d->depth, &field_size, &end_group);
+    if (scan == kUpb_ScanField_Malformed || end_group) {
+      return kUpb_DecodeStatus_Malformed;
+    }
+    if (scan == kUpb_ScanField_Incomplete) break;
+    ptr += field_size;
+  }
+  if (ptr != start) {
+    upb_DecodeStatus status = _upb_StreamDecoder_Decode(d, start, ptr - start);
+    if (status != kUpb_DecodeStatus_Ok) return status;
+  }
+
+  if (ptr != end && !_upb_StreamDecoder_AddPending(d, ptr, end - ptr)) {
+    return kUpb_DecodeStatus_OutOfMemory;
+  }
+  return kUpb_DecodeStatus_Ok;
+}
+
+// Returns whether `msg` and all of its sub-messages have their required
+// fields.  Sub-messages that were not parsed, because their field is unlinked,
+// cannot be checked and are skipped.
+static bool _upb_StreamDecoder_IsInitialized(const upb_Message* msg,
+                                             const upb_MiniTable* m);
+
+static bool _upb_StreamDecoder_IsTaggedInitialized(upb_TaggedMessagePtr tagged,
+                                                   const upb_MiniTable* m) {
+  if (!m || upb_TaggedMessagePtr_IsEmpty(tagged)) return true;
+  return _upb_StreamDecoder_IsInitialized(
+      UPB_PRIVATE(_upb_TaggedMessagePtr_GetMessage)(tagged), m);
+}
+
+static bool _upb_StreamDecoder_IsArrayInitialized(const upb_Array* arr,
+                                                  const upb_MiniTable* m) {
+  if (!arr) return true;
+  const upb_TaggedMessagePtr* ptr = upb_Array_DataPtr(arr);
+  const upb_TaggedMessagePtr* end = ptr + upb_Array_Size(arr);
+  for (; ptr != end; ptr++) {
+    if (!_upb_StreamDecoder_IsTaggedInitialized(*ptr, m)) return false;
+  }
+  return true;
+}
+
+static bool _upb_StreamDecoder_IsMapInitialized(const upb_Map* map,
+                                                const upb_MiniTable* entry) {
+  const upb_MiniTableField* val_field = upb_MiniTable_MapValue(entry);
+  if (!map || upb_MiniTableField_CType(val_field) != kUpb_CType_Message) {
+    return true;
+  }
+  const upb_MiniTable* val_m =
+      upb_MiniTable_GetSubMessageTable(entry, val_field);
+  upb_MessageValue key, val;
+  size_t iter = kUpb_Map_Begin;
+  while (upb_Map_Next(map, &key, &val, &iter)) {
+    if (!_upb_StreamDecoder_IsTaggedInitialized(val.tagged_msg_val, val_m)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool _upb_StreamDecoder_IsInitialized(const upb_Message* msg,
+                                             const upb_MiniTable* m) {
+  if (m->UPB_PRIVATE(required_count) &&
+      !UPB_PRIVATE(_upb_Message_IsInitializedShallow)(msg, m)) {
+    return false;
+  }
+
+  for (int i = 0; i < upb_MiniTable_FieldCount(m); i++) {
+    const upb_MiniTableField* f = upb_MiniTable_GetFieldByIndex(m, i);
+    if (upb_MiniTableField_CType(f) != kUpb_CType_Message) continue;
+    const void* mem = UPB_PRIVATE(_upb_Message_DataPtr)(msg, f);
+    bool ok;
+    if (upb_MiniTableField_IsMap(f)) {
+      ok = _upb_StreamDecoder_IsMapInitialized(
+          *(const upb_Map* const*)mem, upb_MiniTable_MapEntrySubMessage(m, f));
+    } else if (upb_MiniTableField_IsArray(f)) {
+      ok = _upb_StreamDecoder_IsArrayInitialized(
+          *(const upb_Array* const*)mem,
+          upb_MiniTable_GetSubMessageTable(m, f));
+    } else {
+      ok = !upb_Message_HasBaseField(msg, f) ||
+           _upb_StreamDecoder_IsTaggedInitialized(
+               *(const upb_TaggedMessagePtr*)mem,
+               upb_MiniTable_GetSubMessageTable(m, f));
+    }
+    if (!ok) return false;
+  }
+
+  if (m->UPB_PRIVATE(ext) != kUpb_ExtMode_NonExtendable) {
+    size_t count;
+    const upb_Extension* ext = UPB_PRIVATE(_upb_Message_Getexts)(msg, &count);
+    const upb_Extension* end = ext + count;
+    for (; ext != end; ext++) {
+      const upb_MiniTableField* f = &ext->ext->UPB_PRIVATE(field);
+      if (upb_MiniTableField_CType(f) != kUpb_CType_Message) continue;
+      const upb_MiniTable* ext_m =
+          upb_MiniTableExtension_GetSubMessage(ext->ext);
+      bool ok = upb_MiniTableField_IsArray(f)
+                    ? _upb_StreamDecoder_IsArrayInitialized(
+                          ext->data.array_val, ext_m)
+                    : _upb_StreamDecoder_IsInitialized(ext->data.msg_val,
+                                                       ext_m);
+      if (!ok) return false;
+    }
+  }
+  return true;
+}
+
+upb_DecodeStatus upb_DecodeFromStream(upb_ZeroCopyInputStream* input,
+                                      upb_Message* msg, const upb_MiniTable* mt,
+                                      const upb_ExtensionRegistry* extreg,
+                                      int options, upb_Arena* arena) {
+  upb_StreamDecoder d;
+  unsigned depth = (unsigned)options >> 16;
+
+  d.msg = msg;
+  d.mt = mt;
+  d.extreg = extreg;
+  // The stream may reuse its buffers, so strings cannot alias them.  Each
+  // run of fields is decoded without the others, so a run cannot tell whether
+  // the message is missing a required field that a later run sets; required
+  // fields are checked once the whole message has been decoded instead.
+  d.options = options & ~(kUpb_DecodeOption_AliasString |
+                          kUpb_DecodeOption_CheckRequired);
+  d.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
+  d.arena = arena;
+  d.pending = NULL;
+  d.pending_size = 0;
+  d.pending_cap = 0;
+
+  upb_DecodeStatus ret = kUpb_DecodeStatus_Ok;
+  upb_Status status;
+  upb_Status_Clear(&status);
+  const char* buf;
+  size_t size;
+  while ((buf = upb_ZeroCopyInputStream_Next(input, &size, &status))) {
+    ret = _upb_StreamDecoder_DecodeBuffer(&d, buf, buf + size);
+    if (ret != kUpb_DecodeStatus_Ok) break;
+  }
+
+  if (ret == kUpb_DecodeStatus_Ok) {
+    if (!upb_Status_IsOk(&status)) {
+      ret = kUpb_DecodeStatus_StreamError;
+    } else if (d.pending_size) {
+      // The input ended in the middle of a field.
+      ret = kUpb_DecodeStatus_Malformed;
+    } else if ((options & kUpb_DecodeOption_CheckRequired) &&
+               !_upb_StreamDecoder_IsInitialized(msg, mt)) {
+      ret = kUpb_DecodeStatus_MissingRequired;
+    }
+  }
+
+  if (d.pending) upb_gfree(d.pending);
+  return ret;
+}
+
 const char* upb_DecodeStatus_String(upb_DecodeStatus status) {
   switch (status) {
     case kUpb_DecodeStatus_Ok:
@@ -1456,6 +1801,8 @@ const char* upb_DecodeStatus_String(upb_DecodeStatus status) {
       return "Missing required field";
     case kUpb_DecodeStatus_UnlinkedSubMessage:
       return "Unlinked sub-message field was present";
+    case kUpb_DecodeStatus_StreamError:
+      return "Input stream failed";
     default:
       return "Unknown decode status";
   }
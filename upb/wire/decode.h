@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "upb/io/zero_copy_input_stream.h"
 #include "upb/mem/arena.h"
 #include "upb/message/message.h"
 #include "upb/mini_table/extension_registry.h"
@@ -93,6 +94,21 @@ enum {
    * as non-UTF-8 proto3 string fields.
    */
   kUpb_DecodeOption_AlwaysValidateUtf8 = 8,
+
+  /* EXPERIMENTAL:
+   *
+   * If set, unlinked sub-message fields (see above) are not parsed at all:
+   * their serialized bytes are stored as-is in the "empty" message, to be
+   * parsed if and when the message is promoted.  This makes decoding and
+   * re-encoding messages whose sub-messages are mostly passed through much
+   * cheaper, but errors in those sub-messages are only detected on promotion.
+   * Groups are always parsed.  Implies
+   * kUpb_DecodeOption_ExperimentalAllowUnlinked.
+   *
+   * upb_MiniTable_CopyWithLazyFields() in message/promote.h creates a
+   * MiniTable that decodes chosen fields of a linked MiniTable this way.
+   */
+  kUpb_DecodeOption_ExperimentalLazyUnlinked = 16,
 };
 
 UPB_INLINE uint32_t upb_DecodeOptions_MaxDepth(uint16_t depth) {
@@ -127,6 +143,9 @@ typedef enum {
   // kUpb_DecodeOptions_ExperimentalAllowUnlinked was not specified in the list
   // of options.
   kUpb_DecodeStatus_UnlinkedSubMessage = 6,
+
+  // The input stream of upb_DecodeFromStream() failed.
+  kUpb_DecodeStatus_StreamError = 7,
 } upb_DecodeStatus;
 // LINT.ThenChange(//depot/google3/third_party/protobuf/rust/upb.rs:decode_status)
 
@@ -143,6 +162,20 @@ UPB_API upb_DecodeStatus upb_DecodeLengthPrefixed(
     const upb_MiniTable* mt, const upb_ExtensionRegistry* extreg, int options,
     upb_Arena* arena);
 
+// Same as upb_Decode but reads `input` up to its end, decoding whole
+// top-level fields straight from the stream's buffers as they arrive.  Only a
+// top-level field which is split across buffers is copied, so the input is
+// never held in memory all at once, and a large message made of many fields,
+// like a long repeated field, needs no more memory than its largest field.
+//
+// kUpb_DecodeOption_AliasString is ignored, because the stream may reuse its
+// buffers.  With kUpb_DecodeOption_CheckRequired, the required fields of the
+// message and of all of its sub-messages are checked once the whole message
+// has been decoded.
+UPB_API upb_DecodeStatus upb_DecodeFromStream(
+    upb_ZeroCopyInputStream* input, upb_Message* msg, const upb_MiniTable* mt,
+    const upb_ExtensionRegistry* extreg, int options, upb_Arena* arena);
+
 // Utility function for wrapper languages to get an error string from a
 // upb_DecodeStatus.
 UPB_API const char* upb_DecodeStatus_String(upb_DecodeStatus status);
@@ -5,7 +5,9 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
-// We encode backwards, to avoid pre-computing lengths (one-pass encode).
+// We encode backwards, to avoid pre-computing lengths (one-pass encode),
+// unless kUpb_EncodeOption_PrecomputeSizes or upb_EncodeToStream() asks for a
+// two-pass encode that pre-computes them and writes forwards.
 
 #include "upb/wire/encode.h"
 
@@ -19,6 +21,8 @@
 #include "upb/base/string_view.h"
 #include "upb/hash/common.h"
 #include "upb/hash/str_table.h"
+#include "upb/io/zero_copy_output_stream.h"
+#include "upb/mem/alloc.h"
 #include "upb/mem/arena.h"
 #include "upb/message/array.h"
 #include "upb/message/internal/accessors.h"
@@ -38,6 +42,7 @@
 #include "upb/mini_table/internal/sub.h"
 #include "upb/mini_table/message.h"
 #include "upb/wire/internal/constants.h"
+#include "upb/wire/internal/encode.h"
 #include "upb/wire/types.h"
 
 // Must be last.
@@ -79,6 +84,15 @@ typedef struct {
   int options;
   int depth;
   _upb_mapsorter sorter;
+
+  // Only used by the two-pass encoder: the lengths computed by the first pass,
+  // in the order in which the second pass needs them.
+  size_t* sizes;
+  size_t size_count, size_cap;
+  size_t next_size;
+
+  // If set, the two-pass encoder writes into the buffers of this stream.
+  upb_ZeroCopyOutputStream* output;
 } upb_encstate;
 
 static size_t upb_roundup_pow2(size_t bytes) {
@@ -413,6 +427,7 @@ static void encode_array(upb_encstate* e, const upb_Message* msg,
     }
   }
 #undef VARINT_CASE
+#undef TAG
 
   if (packed) {
     encode_varint(e, e->limit - e->ptr - pre_len);
@@ -612,6 +627,785 @@ static void encode_message(upb_encstate* e, const upb_Message* msg,
   *size = (e->limit - e->ptr) - pre_len;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Two-pass encoder, for kUpb_EncodeOption_PrecomputeSizes.
+//
+// The first pass computes the length of every length-delimited value that
+// holds encoded fields (sub-messages, map entries and packed arrays) and
+// records the lengths in the order in which the second pass reaches those
+// values.  The second pass then writes the message forwards into a single
+// buffer of exactly the right size.  Both passes visit the fields in the
+// order in which the one-pass encoder writes them, so the output is the same.
+////////////////////////////////////////////////////////////////////////////////
+
+UPB_FORCEINLINE
+size_t encode_varintsize(uint64_t val) {
+#ifdef __GNUC__
+  // One byte for every 7 significant bits: (bits * 9 + 64) / 64 rounds
+  // bits / 7 up without dividing.
+  return ((63 - __builtin_clzll(val | 1)) * 9 + 73) / 64;
+#else
+  size_t size = 1;
+  while (val >= 0x80) {
+    val >>= 7;
+    size++;
+  }
+  return size;
+#endif
+}
+
+// The size of a tag does not depend on its wire type.
+static size_t encode_tagsize(uint32_t field_number) {
+  return encode_varintsize(field_number << 3);
+}
+
+// Iterates over the entries of a map backwards, in the order the one-pass
+// encoder writes them.
+typedef struct {
+  const upb_Map* map;
+  _upb_sortedmap sorted;
+  size_t pos;
+} encode_mapiter;
+
+static void encode_mapiter_begin(upb_encstate* e, const upb_Map* map,
+                                 const upb_MiniTable* layout,
+                                 encode_mapiter* it) {
+  it->map = map;
+  if (e->options & kUpb_EncodeOption_Deterministic) {
+    if (!_upb_mapsorter_pushmap(
+            &e->sorter,
+            layout->UPB_PRIVATE(fields)[0].UPB_PRIVATE(descriptortype), map,
+            &it->sorted)) {
+      encode_err(e, kUpb_EncodeStatus_OutOfMemory);
+    }
+    it->pos = it->sorted.end;
+  } else {
+    it->pos = upb_table_size(&map->table.t);
+  }
+}
+
+static bool encode_mapiter_next(upb_encstate* e, encode_mapiter* it,
+                                upb_MapEntry* ent) {
+  const upb_tabent* tabent;
+  if (e->options & kUpb_EncodeOption_Deterministic) {
+    if (it->pos == (size_t)it->sorted.start) return false;
+    tabent = (const upb_tabent*)e->sorter.entries[--it->pos];
+  } else {
+    do {
+      if (it->pos == 0) return false;
+      tabent = &it->map->table.t.entries[--it->pos];
+    } while (upb_tabent_isempty(tabent));
+  }
+  _upb_map_fromkey(upb_tabstrview(tabent->key), &ent->k, it->map->key_size);
+  upb_value val = {tabent->val.val};
+  _upb_map_fromvalue(val, &ent->v, it->map->val_size);
+  return true;
+}
+
+static void encode_mapiter_end(upb_encstate* e, encode_mapiter* it) {
+  if (e->options & kUpb_EncodeOption_Deterministic) {
+    _upb_mapsorter_popmap(&e->sorter, &it->sorted);
+  }
+}
+
+// Iterates over the extensions of a message backwards, in the order the
+// one-pass encoder writes them.
+typedef struct {
+  const upb_Extension* exts;
+  _upb_sortedmap sorted;
+  size_t pos;
+  bool is_sorted;
+} encode_extiter;
+
+static void encode_extiter_begin(upb_encstate* e, const upb_Message* msg,
+                                 encode_extiter* it) {
+  size_t count;
+  it->exts = UPB_PRIVATE(_upb_Message_Getexts)(msg, &count);
+  it->pos = count;
+  it->is_sorted = count && (e->options & kUpb_EncodeOption_Deterministic);
+  if (it->is_sorted &&
+      !_upb_mapsorter_pushexts(&e->sorter, it->exts, count, &it->sorted)) {
+    encode_err(e, kUpb_EncodeStatus_OutOfMemory);
+  }
+}
+
+static const upb_Extension* encode_extiter_next(upb_encstate* e,
+                                                encode_extiter* it) {
+  if (it->pos == 0) return NULL;
+  it->pos--;
+  if (it->is_sorted) return e->sorter.entries[it->sorted.start + it->pos];
+  return &it->exts[it->pos];
+}
+
+static void encode_extiter_end(upb_encstate* e, encode_extiter* it) {
+  if (it->is_sorted) _upb_mapsorter_popmap(&e->sorter, &it->sorted);
+}
+
+// The sub-table of an extension field, as encode_ext() builds it.
+static upb_MiniTableSubInternal encode_extsub(const upb_Extension* ext) {
+  upb_MiniTableSubInternal sub;
+  if (upb_MiniTableField_IsSubMessage(&ext->ext->UPB_PRIVATE(field))) {
+    sub.UPB_PRIVATE(submsg) = &ext->ext->UPB_PRIVATE(sub).UPB_PRIVATE(submsg);
+  } else {
+    sub.UPB_PRIVATE(subenum) = ext->ext->UPB_PRIVATE(sub).UPB_PRIVATE(subenum);
+  }
+  return sub;
+}
+
+static const upb_MiniTable* encode_taggedtable(upb_TaggedMessagePtr tagged,
+                                               const upb_MiniTable* m) {
+  return upb_TaggedMessagePtr_IsEmpty(tagged)
+             ? UPB_PRIVATE(_upb_MiniTable_Empty)()
+             : m;
+}
+
+// First pass: sizes.
+
+// Reserves the next entry of the size table, to be set by the caller once it
+// knows the size.
+static size_t sizepass_reserve(upb_encstate* e) {
+  if (e->size_count == e->size_cap) {
+    size_t new_cap = e->size_cap ? e->size_cap * 2 : 64;
+    size_t* sizes = upb_grealloc(e->sizes, e->size_cap * sizeof(*sizes),
+                                 new_cap * sizeof(*sizes));
+    if (!sizes) encode_err(e, kUpb_EncodeStatus_OutOfMemory);
+    e->sizes = sizes;
+    e->size_cap = new_cap;
+  }
+  return e->size_count++;
+}
+
+// Records `size` for the second pass, and returns the size of the value
+// including its length prefix.
+static size_t sizepass_delimited(upb_encstate* e, size_t slot, size_t size) {
+  e->sizes[slot] = size;
+  return encode_varintsize(size) + size;
+}
+
+static size_t sizepass_message(upb_encstate* e, const upb_Message* msg,
+                               const upb_MiniTable* m);
+
+static size_t sizepass_submessage(upb_encstate* e,
+                                  upb_TaggedMessagePtr tagged,
+                                  const upb_MiniTable* m) {
+  size_t slot = sizepass_reserve(e);
+  size_t size = sizepass_message(
+      e, UPB_PRIVATE(_upb_TaggedMessagePtr_GetMessage)(tagged),
+      encode_taggedtable(tagged, m));
+  return sizepass_delimited(e, slot, size);
+}
+
+static size_t sizepass_group(upb_encstate* e, upb_TaggedMessagePtr tagged,
+                             const upb_MiniTable* m) {
+  return sizepass_message(
+      e, UPB_PRIVATE(_upb_TaggedMessagePtr_GetMessage)(tagged),
+      encode_taggedtable(tagged, m));
+}
+
+static size_t sizepass_scalar(upb_encstate* e, const void* field_mem,
+                              const upb_MiniTableSubInternal* subs,
+                              const upb_MiniTableField* f) {
+  size_t tag_size = encode_tagsize(upb_MiniTableField_Number(f));
+  switch (f->UPB_PRIVATE(descriptortype)) {
+    case kUpb_FieldType_Double:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_Fixed64:
+      return tag_size + 8;
+    case kUpb_FieldType_Float:
+    case kUpb_FieldType_Fixed32:
+    case kUpb_FieldType_SFixed32:
+      return tag_size + 4;
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_UInt64:
+      return tag_size + encode_varintsize(*(uint64_t*)field_mem);
+    case kUpb_FieldType_UInt32:
+      return tag_size + encode_varintsize(*(uint32_t*)field_mem);
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_Enum:
+      return tag_size + encode_varintsize((int64_t) * (int32_t*)field_mem);
+    case kUpb_FieldType_Bool:
+      return tag_size + 1;
+    case kUpb_FieldType_SInt32:
+      return tag_size + encode_varintsize(encode_zz32(*(int32_t*)field_mem));
+    case kUpb_FieldType_SInt64:
+      return tag_size + encode_varintsize(encode_zz64(*(int64_t*)field_mem));
+    case kUpb_FieldType_String:
+    case kUpb_FieldType_Bytes: {
+      size_t size = ((upb_StringView*)field_mem)->size;
+      return tag_size + encode_varintsize(size) + size;
+    }
+    case kUpb_FieldType_Group:
+    case kUpb_FieldType_Message: {
+      upb_TaggedMessagePtr submsg = *(upb_TaggedMessagePtr*)field_mem;
+      const upb_MiniTable* subm = _upb_Encoder_GetSubMiniTable(subs, f);
+      if (submsg == 0) return 0;
+      if (--e->depth == 0) encode_err(e, kUpb_EncodeStatus_MaxDepthExceeded);
+      size_t size =
+          f->UPB_PRIVATE(descriptortype) == kUpb_FieldType_Group
+              ? 2 * tag_size + sizepass_group(e, submsg, subm)
+              : tag_size + sizepass_submessage(e, submsg, subm);
+      e->depth++;
+      return size;
+    }
+    default:
+      UPB_UNREACHABLE();
+  }
+}
+
+static size_t sizepass_array(upb_encstate* e, const upb_Message* msg,
+                             const upb_MiniTableSubInternal* subs,
+                             const upb_MiniTableField* f) {
+  const upb_Array* arr = *UPB_PTR_AT(msg, f->UPB_PRIVATE(offset), upb_Array*);
+  if (arr == NULL || upb_Array_Size(arr) == 0) return 0;
+
+  const bool packed = upb_MiniTableField_IsPacked(f);
+  const size_t count = upb_Array_Size(arr);
+  const size_t tag_size = encode_tagsize(upb_MiniTableField_Number(f));
+  size_t size = 0;
+
+#define VARINT_CASE(ctype, encode)                       \
+  {                                                      \
+    const ctype* ptr = upb_Array_DataPtr(arr);           \
+    const ctype* end = ptr + count;                      \
+    for (; ptr != end; ptr++) {                          \
+      size += encode_varintsize(encode);                 \
+    }                                                    \
+  }                                                      \
+  break;
+
+  switch (f->UPB_PRIVATE(descriptortype)) {
+    case kUpb_FieldType_Double:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_Fixed64:
+      size = count * 8;
+      break;
+    case kUpb_FieldType_Float:
+    case kUpb_FieldType_Fixed32:
+    case kUpb_FieldType_SFixed32:
+      size = count * 4;
+      break;
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_UInt64:
+      VARINT_CASE(uint64_t, *ptr);
+    case kUpb_FieldType_UInt32:
+      VARINT_CASE(uint32_t, *ptr);
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_Enum:
+      VARINT_CASE(int32_t, (int64_t)*ptr);
+    case kUpb_FieldType_Bool:
+      size = count;
+      break;
+    case kUpb_FieldType_SInt32:
+      VARINT_CASE(int32_t, encode_zz32(*ptr));
+    case kUpb_FieldType_SInt64:
+      VARINT_CASE(int64_t, encode_zz64(*ptr));
+    case kUpb_FieldType_String:
+    case kUpb_FieldType_Bytes: {
+      const upb_StringView* ptr = upb_Array_DataPtr(arr);
+      const upb_StringView* end = ptr + count;
+      for (; ptr != end; ptr++) {
+        size += tag_size + encode_varintsize(ptr->size) + ptr->size;
+      }
+      return size;
+    }
+    case kUpb_FieldType_Group:
+    case kUpb_FieldType_Message: {
+      const upb_TaggedMessagePtr* ptr = upb_Array_DataPtr(arr);
+      const upb_TaggedMessagePtr* end = ptr + count;
+      const upb_MiniTable* subm = _upb_Encoder_GetSubMiniTable(subs, f);
+      const bool is_group =
+          f->UPB_PRIVATE(descriptortype) == kUpb_FieldType_Group;
+      if (--e->depth == 0) encode_err(e, kUpb_EncodeStatus_MaxDepthExceeded);
+      for (; ptr != end; ptr++) {
+        size += is_group ? 2 * tag_size + sizepass_group(e, *ptr, subm)
+                         : tag_size + sizepass_submessage(e, *ptr, subm);
+      }
+      e->depth++;
+      return size;
+    }
+  }
+#undef VARINT_CASE
+
+  if (packed) {
+    return tag_size + sizepass_delimited(e, sizepass_reserve(e), size);
+  }
+  return count * tag_size + size;
+}
+
+static size_t sizepass_map(upb_encstate* e, const upb_Message* msg,
+                           const upb_MiniTableSubInternal* subs,
+                           const upb_MiniTableField* f) {
+  const upb_Map* map = *UPB_PTR_AT(msg, f->UPB_PRIVATE(offset), const upb_Map*);
+  const upb_MiniTable* layout = _upb_Encoder_GetSubMiniTable(subs, f);
+  UPB_ASSERT(upb_MiniTable_FieldCount(layout) == 2);
+  if (!map || !upb_Map_Size(map)) return 0;
+
+  const upb_MiniTableField* key_field = upb_MiniTable_MapKey(layout);
+  const upb_MiniTableField* val_field = upb_MiniTable_MapValue(layout);
+  const size_t tag_size = encode_tagsize(upb_MiniTableField_Number(f));
+  size_t size = 0;
+  encode_mapiter it;
+  upb_MapEntry ent;
+  encode_mapiter_begin(e, map, layout, &it);
+  while (encode_mapiter_next(e, &it, &ent)) {
+    size_t slot = sizepass_reserve(e);
+    size_t entry_size =
+        sizepass_scalar(e, &ent.k, layout->UPB_PRIVATE(subs), key_field) +
+        sizepass_scalar(e, &ent.v, layout->UPB_PRIVATE(subs), val_field);
+    size += tag_size + sizepass_delimited(e, slot, entry_size);
+  }
+  encode_mapiter_end(e, &it);
+  return size;
+}
+
+static size_t sizepass_field(upb_encstate* e, const upb_Message* msg,
+                             const upb_MiniTableSubInternal* subs,
+                             const upb_MiniTableField* field) {
+  switch (UPB_PRIVATE(_upb_MiniTableField_Mode)(field)) {
+    case kUpb_FieldMode_Array:
+      return sizepass_array(e, msg, subs, field);
+    case kUpb_FieldMode_Map:
+      return sizepass_map(e, msg, subs, field);
+    case kUpb_FieldMode_Scalar:
+      return sizepass_scalar(
+          e, UPB_PTR_AT(msg, field->UPB_PRIVATE(offset), void), subs, field);
+    default:
+      UPB_UNREACHABLE();
+  }
+}
+
+static size_t sizepass_ext(upb_encstate* e, const upb_Extension* ext,
+                           bool is_message_set) {
+  if (UPB_UNLIKELY(is_message_set)) {
+    size_t slot = sizepass_reserve(e);
+    size_t size = sizepass_message(
+        e, ext->data.msg_val, upb_MiniTableExtension_GetSubMessage(ext->ext));
+    return 2 * encode_tagsize(kUpb_MsgSet_Item) +
+           encode_tagsize(kUpb_MsgSet_TypeId) +
+           encode_varintsize(upb_MiniTableExtension_Number(ext->ext)) +
+           encode_tagsize(kUpb_MsgSet_Message) +
+           sizepass_delimited(e, slot, size);
+  }
+  upb_MiniTableSubInternal sub = encode_extsub(ext);
+  return sizepass_field(e, (upb_Message*)&ext->data, &sub,
+                        &ext->ext->UPB_PRIVATE(field));
+}
+
+static size_t sizepass_message(upb_encstate* e, const upb_Message* msg,
+                               const upb_MiniTable* m) {
+  size_t size = 0;
+
+  if (e->options & kUpb_EncodeOption_CheckRequired) {
+    if (m->UPB_PRIVATE(required_count)) {
+      if (!UPB_PRIVATE(_upb_Message_IsInitializedShallow)(msg, m)) {
+        encode_err(e, kUpb_EncodeStatus_MissingRequired);
+      }
+    }
+  }
+
+  const upb_MiniTableField* f = &m->UPB_PRIVATE(fields)[0];
+  const upb_MiniTableField* end = f + m->UPB_PRIVATE(field_count);
+  for (; f != end; f++) {
+    if (encode_shouldencode(e, msg, f)) {
+      size += sizepass_field(e, msg, m->UPB_PRIVATE(subs), f);
+    }
+  }
+
+  if (m->UPB_PRIVATE(ext) != kUpb_ExtMode_NonExtendable) {
+    encode_extiter it;
+    const upb_Extension* ext;
+    encode_extiter_begin(e, msg, &it);
+    while ((ext = encode_extiter_next(e, &it))) {
+      size += sizepass_ext(e, ext,
+                           m->UPB_PRIVATE(ext) == kUpb_ExtMode_IsMessageSet);
+    }
+    encode_extiter_end(e, &it);
+  }
+
+  if ((e->options & kUpb_EncodeOption_SkipUnknown) == 0) {
+    size_t unknown_size;
+    upb_Message_GetUnknown(msg, &unknown_size);
+    size += unknown_size;
+  }
+
+  return size;
+}
+
+// Second pass: writes forwards, either into a buffer of the size computed by
+// the first pass, or into the buffers of an output stream, which it asks for
+// whenever the current one is full.
+
+static size_t writepass_nextsize(upb_encstate* e) {
+  UPB_ASSERT(e->next_size < e->size_count);
+  return e->sizes[e->next_size++];
+}
+
+UPB_NOINLINE
+static void writepass_nextbuffer(upb_encstate* e) {
+  size_t count;
+  upb_Status status;
+  upb_Status_Clear(&status);
+  char* buf = upb_ZeroCopyOutputStream_Next(e->output, &count, &status);
+  if (!buf) {
+    // There is no buffer to back up into.
+    e->buf = NULL;
+    encode_err(e, kUpb_EncodeStatus_StreamError);
+  }
+  e->buf = e->ptr = buf;
+  e->limit = buf + count;
+}
+
+UPB_NOINLINE
+static void writepass_bytes_slow(upb_encstate* e, const char* data,
+                                 size_t len) {
+  // A buffer sized by the first pass never runs out of space.
+  UPB_ASSERT(e->output);
+  while (true) {
+    size_t n = UPB_MIN(len, (size_t)(e->limit - e->ptr));
+    if (n) {
+      memcpy(e->ptr, data, n);
+      e->ptr += n;
+      data += n;
+      len -= n;
+    }
+    if (len == 0) return;
+    writepass_nextbuffer(e);
+  }
+}
+
+UPB_FORCEINLINE
+void writepass_bytes(upb_encstate* e, const void* data, size_t len) {
+  if (len == 0) return; /* memcpy() with zero size is UB */
+  if (UPB_UNLIKELY((size_t)(e->limit - e->ptr) < len)) {
+    writepass_bytes_slow(e, data, len);
+    return;
+  }
+  memcpy(e->ptr, data, len);
+  e->ptr += len;
+}
+
+UPB_FORCEINLINE
+void writepass_varint(upb_encstate* e, uint64_t val) {
+  if (UPB_UNLIKELY(e->limit - e->ptr < UPB_PB_VARINT_MAX_LEN)) {
+    char buf[UPB_PB_VARINT_MAX_LEN];
+    writepass_bytes(e, buf, encode_varint64(val, buf));
+  } else if (val < 128) {
+    *e->ptr++ = val;
+  } else {
+    e->ptr += encode_varint64(val, e->ptr);
+  }
+}
+
+static void writepass_fixed64(upb_encstate* e, uint64_t val) {
+  val = upb_BigEndian64(val);
+  writepass_bytes(e, &val, sizeof(uint64_t));
+}
+
+static void writepass_fixed32(upb_encstate* e, uint32_t val) {
+  val = upb_BigEndian32(val);
+  writepass_bytes(e, &val, sizeof(uint32_t));
+}
+
+static void writepass_double(upb_encstate* e, double d) {
+  uint64_t u64;
+  memcpy(&u64, &d, sizeof(uint64_t));
+  writepass_fixed64(e, u64);
+}
+
+static void writepass_float(upb_encstate* e, float d) {
+  uint32_t u32;
+  memcpy(&u32, &d, sizeof(uint32_t));
+  writepass_fixed32(e, u32);
+}
+
+static void writepass_tag(upb_encstate* e, uint32_t field_number,
+                          uint8_t wire_type) {
+  writepass_varint(e, (field_number << 3) | wire_type);
+}
+
+static void writepass_message(upb_encstate* e, const upb_Message* msg,
+                              const upb_MiniTable* m);
+
+static void writepass_tagged(upb_encstate* e, upb_TaggedMessagePtr tagged,
+                             const upb_MiniTable* m) {
+  writepass_message(e, UPB_PRIVATE(_upb_TaggedMessagePtr_GetMessage)(tagged),
+                    encode_taggedtable(tagged, m));
+}
+
+static void writepass_scalar(upb_encstate* e, const void* _field_mem,
+                             const upb_MiniTableSubInternal* subs,
+                             const upb_MiniTableField* f) {
+  const char* field_mem = _field_mem;
+  const uint32_t number = upb_MiniTableField_Number(f);
+
+#define CASE(ctype, type, wtype, encodeval) \
+  {                                         \
+    ctype val = *(ctype*)field_mem;         \
+    writepass_tag(e, number, wtype);        \
+    writepass_##type(e, encodeval);         \
+    break;                                  \
+  }
+
+  switch (f->UPB_PRIVATE(descriptortype)) {
+    case kUpb_FieldType_Double:
+      CASE(double, double, kUpb_WireType_64Bit, val);
+    case kUpb_FieldType_Float:
+      CASE(float, float, kUpb_WireType_32Bit, val);
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_UInt64:
+      CASE(uint64_t, varint, kUpb_WireType_Varint, val);
+    case kUpb_FieldType_UInt32:
+      CASE(uint32_t, varint, kUpb_WireType_Varint, val);
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_Enum:
+      CASE(int32_t, varint, kUpb_WireType_Varint, (int64_t)val);
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_Fixed64:
+      CASE(uint64_t, fixed64, kUpb_WireType_64Bit, val);
+    case kUpb_FieldType_Fixed32:
+    case kUpb_FieldType_SFixed32:
+      CASE(uint32_t, fixed32, kUpb_WireType_32Bit, val);
+    case kUpb_FieldType_Bool:
+      CASE(bool, varint, kUpb_WireType_Varint, val);
+    case kUpb_FieldType_SInt32:
+      CASE(int32_t, varint, kUpb_WireType_Varint, encode_zz32(val));
+    case kUpb_FieldType_SInt64:
+      CASE(int64_t, varint, kUpb_WireType_Varint, encode_zz64(val));
+    case kUpb_FieldType_String:
+    case kUpb_FieldType_Bytes: {
+      upb_StringView view = *(upb_StringView*)field_mem;
+      writepass_tag(e, number, kUpb_WireType_Delimited);
+      writepass_varint(e, view.size);
+      writepass_bytes(e, view.data, view.size);
+      break;
+    }
+    case kUpb_FieldType_Group: {
+      upb_TaggedMessagePtr submsg = *(upb_TaggedMessagePtr*)field_mem;
+      if (submsg == 0) return;
+      writepass_tag(e, number, kUpb_WireType_StartGroup);
+      writepass_tagged(e, submsg, _upb_Encoder_GetSubMiniTable(subs, f));
+      writepass_tag(e, number, kUpb_WireType_EndGroup);
+      break;
+    }
+    case kUpb_FieldType_Message: {
+      upb_TaggedMessagePtr submsg = *(upb_TaggedMessagePtr*)field_mem;
+      if (submsg == 0) return;
+      writepass_tag(e, number, kUpb_WireType_Delimited);
+      writepass_varint(e, writepass_nextsize(e));
+      writepass_tagged(e, submsg, _upb_Encoder_GetSubMiniTable(subs, f));
+      break;
+    }
+    default:
+      UPB_UNREACHABLE();
+  }
+#undef CASE
+}
+
+static void writepass_fixedarray(upb_encstate* e, const upb_Array* arr,
+                                 size_t elem_size, uint32_t tag) {
+  size_t bytes = upb_Array_Size(arr) * elem_size;
+  const char* ptr = upb_Array_DataPtr(arr);
+  const char* end = ptr + bytes;
+
+  if (tag || !upb_IsLittleEndian()) {
+    for (; ptr != end; ptr += elem_size) {
+      if (tag) writepass_varint(e, tag);
+      if (elem_size == 4) {
+        uint32_t val;
+        memcpy(&val, ptr, sizeof(val));
+        writepass_fixed32(e, val);
+      } else {
+        UPB_ASSERT(elem_size == 8);
+        uint64_t val;
+        memcpy(&val, ptr, sizeof(val));
+        writepass_fixed64(e, val);
+      }
+    }
+  } else {
+    writepass_bytes(e, ptr, bytes);
+  }
+}
+
+static void writepass_array(upb_encstate* e, const upb_Message* msg,
+                            const upb_MiniTableSubInternal* subs,
+                            const upb_MiniTableField* f) {
+  const upb_Array* arr = *UPB_PTR_AT(msg, f->UPB_PRIVATE(offset), upb_Array*);
+  if (arr == NULL || upb_Array_Size(arr) == 0) return;
+
+  const bool packed = upb_MiniTableField_IsPacked(f);
+  const uint32_t number = upb_MiniTableField_Number(f);
+  const size_t count = upb_Array_Size(arr);
+  if (packed) {
+    writepass_tag(e, number, kUpb_WireType_Delimited);
+    writepass_varint(e, writepass_nextsize(e));
+  }
+
+#define VARINT_CASE(ctype, encode)                                 \
+  {                                                                \
+    const ctype* ptr = upb_Array_DataPtr(arr);                     \
+    const ctype* end = ptr + count;                                \
+    uint32_t tag = packed ? 0 : (number << 3) | kUpb_WireType_Varint; \
+    for (; ptr != end; ptr++) {                                    \
+      if (tag) writepass_varint(e, tag);                           \
+      writepass_varint(e, encode);                                 \
+    }                                                              \
+  }                                                                \
+  return;
+
+#define TAG(wire_type) (packed ? 0 : (number << 3 | wire_type))
+
+  switch (f->UPB_PRIVATE(descriptortype)) {
+    case kUpb_FieldType_Double:
+      writepass_fixedarray(e, arr, sizeof(double), TAG(kUpb_WireType_64Bit));
+      return;
+    case kUpb_FieldType_Float:
+      writepass_fixedarray(e, arr, sizeof(float), TAG(kUpb_WireType_32Bit));
+      return;
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_Fixed64:
+      writepass_fixedarray(e, arr, sizeof(uint64_t), TAG(kUpb_WireType_64Bit));
+      return;
+    case kUpb_FieldType_Fixed32:
+    case kUpb_FieldType_SFixed32:
+      writepass_fixedarray(e, arr, sizeof(uint32_t), TAG(kUpb_WireType_32Bit));
+      return;
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_UInt64:
+      VARINT_CASE(uint64_t, *ptr);
+    case kUpb_FieldType_UInt32:
+      VARINT_CASE(uint32_t, *ptr);
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_Enum:
+      VARINT_CASE(int32_t, (int64_t)*ptr);
+    case kUpb_FieldType_Bool:
+      VARINT_CASE(bool, *ptr);
+    case kUpb_FieldType_SInt32:
+      VARINT_CASE(int32_t, encode_zz32(*ptr));
+    case kUpb_FieldType_SInt64:
+      VARINT_CASE(int64_t, encode_zz64(*ptr));
+    case kUpb_FieldType_String:
+    case kUpb_FieldType_Bytes: {
+      const upb_StringView* ptr = upb_Array_DataPtr(arr);
+      const upb_StringView* end = ptr + count;
+      for (; ptr != end; ptr++) {
+        writepass_tag(e, number, kUpb_WireType_Delimited);
+        writepass_varint(e, ptr->size);
+        writepass_bytes(e, ptr->data, ptr->size);
+      }
+      return;
+    }
+    case kUpb_FieldType_Group: {
+      const upb_TaggedMessagePtr* ptr = upb_Array_DataPtr(arr);
+      const upb_TaggedMessagePtr* end = ptr + count;
+      const upb_MiniTable* subm = _upb_Encoder_GetSubMiniTable(subs, f);
+      for (; ptr != end; ptr++) {
+        writepass_tag(e, number, kUpb_WireType_StartGroup);
+        writepass_tagged(e, *ptr, subm);
+        writepass_tag(e, number, kUpb_WireType_EndGroup);
+      }
+      return;
+    }
+    case kUpb_FieldType_Message: {
+      const upb_TaggedMessagePtr* ptr = upb_Array_DataPtr(arr);
+      const upb_TaggedMessagePtr* end = ptr + count;
+      const upb_MiniTable* subm = _upb_Encoder_GetSubMiniTable(subs, f);
+      for (; ptr != end; ptr++) {
+        writepass_tag(e, number, kUpb_WireType_Delimited);
+        writepass_varint(e, writepass_nextsize(e));
+        writepass_tagged(e, *ptr, subm);
+      }
+      return;
+    }
+  }
+#undef VARINT_CASE
+#undef TAG
+}
+
+static void writepass_map(upb_encstate* e, const upb_Message* msg,
+                          const upb_MiniTableSubInternal* subs,
+                          const upb_MiniTableField* f) {
+  const upb_Map* map = *UPB_PTR_AT(msg, f->UPB_PRIVATE(offset), const upb_Map*);
+  const upb_MiniTable* layout = _upb_Encoder_GetSubMiniTable(subs, f);
+  if (!map || !upb_Map_Size(map)) return;
+
+  const upb_MiniTableField* key_field = upb_MiniTable_MapKey(layout);
+  const upb_MiniTableField* val_field = upb_MiniTable_MapValue(layout);
+  encode_mapiter it;
+  upb_MapEntry ent;
+  encode_mapiter_begin(e, map, layout, &it);
+  while (encode_mapiter_next(e, &it, &ent)) {
+    writepass_tag(e, upb_MiniTableField_Number(f), kUpb_WireType_Delimited);
+    writepass_varint(e, writepass_nextsize(e));
+    writepass_scalar(e, &ent.k, layout->UPB_PRIVATE(subs), key_field);
+    writepass_scalar(e, &ent.v, layout->UPB_PRIVATE(subs), val_field);
+  }
+  encode_mapiter_end(e, &it);
+}
+
+static void writepass_field(upb_encstate* e, const upb_Message* msg,
+                            const upb_MiniTableSubInternal* subs,
+                            const upb_MiniTableField* field) {
+  switch (UPB_PRIVATE(_upb_MiniTableField_Mode)(field)) {
+    case kUpb_FieldMode_Array:
+      writepass_array(e, msg, subs, field);
+      break;
+    case kUpb_FieldMode_Map:
+      writepass_map(e, msg, subs, field);
+      break;
+    case kUpb_FieldMode_Scalar:
+      writepass_scalar(e, UPB_PTR_AT(msg, field->UPB_PRIVATE(offset), void),
+                       subs, field);
+      break;
+    default:
+      UPB_UNREACHABLE();
+  }
+}
+
+static void writepass_ext(upb_encstate* e, const upb_Extension* ext,
+                          bool is_message_set) {
+  if (UPB_UNLIKELY(is_message_set)) {
+    writepass_tag(e, kUpb_MsgSet_Item, kUpb_WireType_StartGroup);
+    writepass_tag(e, kUpb_MsgSet_TypeId, kUpb_WireType_Varint);
+    writepass_varint(e, upb_MiniTableExtension_Number(ext->ext));
+    writepass_tag(e, kUpb_MsgSet_Message, kUpb_WireType_Delimited);
+    writepass_varint(e, writepass_nextsize(e));
+    writepass_message(e, ext->data.msg_val,
+                      upb_MiniTableExtension_GetSubMessage(ext->ext));
+    writepass_tag(e, kUpb_MsgSet_Item, kUpb_WireType_EndGroup);
+  } else {
+    upb_MiniTableSubInternal sub = encode_extsub(ext);
+    writepass_field(e, (upb_Message*)&ext->data, &sub,
+                    &ext->ext->UPB_PRIVATE(field));
+  }
+}
+
+static void writepass_message(upb_encstate* e, const upb_Message* msg,
+                              const upb_MiniTable* m) {
+  const upb_MiniTableField* f = &m->UPB_PRIVATE(fields)[0];
+  const upb_MiniTableField* end = f + m->UPB_PRIVATE(field_count);
+  for (; f != end; f++) {
+    if (encode_shouldencode(e, msg, f)) {
+      writepass_field(e, msg, m->UPB_PRIVATE(subs), f);
+    }
+  }
+
+  if (m->UPB_PRIVATE(ext) != kUpb_ExtMode_NonExtendable) {
+    encode_extiter it;
+    const upb_Extension* ext;
+    encode_extiter_begin(e, msg, &it);
+    while ((ext = encode_extiter_next(e, &it))) {
+      writepass_ext(e, ext, m->UPB_PRIVATE(ext) == kUpb_ExtMode_IsMessageSet);
+    }
+    encode_extiter_end(e, &it);
+  }
+
+  if ((e->options & kUpb_EncodeOption_SkipUnknown) == 0) {
+    size_t unknown_size;
+    const char* unknown = upb_Message_GetUnknown(msg, &unknown_size);
+    if (unknown) writepass_bytes(e, unknown, unknown_size);
+  }
+}
+
 static upb_EncodeStatus upb_Encoder_Encode(upb_encstate* const encoder,
                                            const upb_Message* const msg,
                                            const upb_MiniTable* const l,
@@ -623,9 +1417,27 @@ static upb_EncodeStatus upb_Encoder_Encode(upb_encstate* const encoder,
   // NULL on error and we still set it to non-NULL on a successful empty result.
   if (UPB_SETJMP(encoder->err) == 0) {
     size_t encoded_msg_size;
-    encode_message(encoder, msg, l, &encoded_msg_size);
-    if (prepend_len) {
-      encode_varint(encoder, encoded_msg_size);
+    if (encoder->options & kUpb_EncodeOption_PrecomputeSizes) {
+      encoded_msg_size = sizepass_message(encoder, msg, l);
+      size_t total = encoded_msg_size;
+      if (prepend_len) total += encode_varintsize(encoded_msg_size);
+      encoder->buf = total ? upb_Arena_Malloc(encoder->arena, total) : NULL;
+      if (total && !encoder->buf) {
+        encode_err(encoder, kUpb_EncodeStatus_OutOfMemory);
+      }
+      encoder->ptr = encoder->buf;
+      encoder->limit = encoder->buf + total;
+      if (prepend_len) writepass_varint(encoder, encoded_msg_size);
+      writepass_message(encoder, msg, l);
+      UPB_ASSERT(encoder->ptr == encoder->limit);
+      UPB_ASSERT(encoder->next_size == encoder->size_count);
+      // Point at the start of the output, as the one-pass encoder does.
+      encoder->ptr = encoder->buf;
+    } else {
+      encode_message(encoder, msg, l, &encoded_msg_size);
+      if (prepend_len) {
+        encode_varint(encoder, encoded_msg_size);
+      }
     }
     *size = encoder->limit - encoder->ptr;
     if (*size == 0) {
@@ -642,6 +1454,7 @@ static upb_EncodeStatus upb_Encoder_Encode(upb_encstate* const encoder,
   }
 
   _upb_mapsorter_destroy(&encoder->sorter);
+  if (encoder->sizes) upb_gfree(encoder->sizes);
   return encoder->status;
 }
 
@@ -660,6 +1473,11 @@ static upb_EncodeStatus _upb_Encode(const upb_Message* msg,
   e.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
   e.options = options;
   _upb_mapsorter_init(&e.sorter);
+  e.sizes = NULL;
+  e.size_count = 0;
+  e.size_cap = 0;
+  e.next_size = 0;
+  e.output = NULL;
 
   return upb_Encoder_Encode(&e, msg, l, buf, size, prepend_len);
 }
@@ -670,6 +1488,62 @@ upb_EncodeStatus upb_Encode(const upb_Message* msg, const upb_MiniTable* l,
   return _upb_Encode(msg, l, options, arena, buf, size, false);
 }
 
+size_t UPB_PRIVATE(_upb_Encode_Size)(const upb_Message* msg,
+                                     const upb_MiniTable* l, int options,
+                                     upb_EncodeStatus* status) {
+  upb_encstate e;
+  unsigned depth = (unsigned)options >> 16;
+
+  e.status = kUpb_EncodeStatus_Ok;
+  e.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
+  e.options = options;
+  _upb_mapsorter_init(&e.sorter);
+  e.sizes = NULL;
+  e.size_count = 0;
+  e.size_cap = 0;
+  e.output = NULL;
+
+  size_t size = UPB_SETJMP(e.err) == 0 ? sizepass_message(&e, msg, l) : 0;
+
+  _upb_mapsorter_destroy(&e.sorter);
+  if (e.sizes) upb_gfree(e.sizes);
+  *status = e.status;
+  return size;
+}
+
+upb_EncodeStatus upb_EncodeToStream(const upb_Message* msg,
+                                    const upb_MiniTable* l, int options,
+                                    upb_ZeroCopyOutputStream* output) {
+  upb_encstate e;
+  unsigned depth = (unsigned)options >> 16;
+
+  e.status = kUpb_EncodeStatus_Ok;
+  e.arena = NULL;
+  e.buf = NULL;
+  e.limit = NULL;
+  e.ptr = NULL;
+  e.depth = depth ? depth : kUpb_WireFormat_DefaultDepthLimit;
+  e.options = options | kUpb_EncodeOption_PrecomputeSizes;
+  _upb_mapsorter_init(&e.sorter);
+  e.sizes = NULL;
+  e.size_count = 0;
+  e.size_cap = 0;
+  e.next_size = 0;
+  e.output = output;
+
+  if (UPB_SETJMP(e.err) == 0) {
+    sizepass_message(&e, msg, l);
+    writepass_message(&e, msg, l);
+    UPB_ASSERT(e.next_size == e.size_count);
+  }
+
+  // Hand back the unused end of the last buffer, which also flushes it.
+  if (e.buf) upb_ZeroCopyOutputStream_BackUp(output, e.limit - e.ptr);
+  _upb_mapsorter_destroy(&e.sorter);
+  if (e.sizes) upb_gfree(e.sizes);
+  return e.status;
+}
+
 upb_EncodeStatus upb_EncodeLengthPrefixed(const upb_Message* msg,
                                           const upb_MiniTable* l, int options,
                                           upb_Arena* arena, char** buf,
@@ -687,6 +1561,8 @@ const char* upb_EncodeStatus_String(upb_EncodeStatus status) {
       return "Max depth exceeded";
     case kUpb_EncodeStatus_OutOfMemory:
       return "Arena alloc failed";
+    case kUpb_EncodeStatus_StreamError:
+      return "Output stream failed";
     default:
       return "Unknown encode status";
   }
@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "upb/io/zero_copy_output_stream.h"
 #include "upb/mem/arena.h"
 #include "upb/message/message.h"
 #include "upb/mini_table/message.h"
@@ -38,6 +39,21 @@ enum {
 
   // When set, the encode will fail if any required fields are missing.
   kUpb_EncodeOption_CheckRequired = 4,
+
+  /* EXPERIMENTAL:
+   *
+   * If set, the message is encoded in two passes: the first computes the size
+   * of every sub-message, and the second writes the message forwards into a
+   * single buffer of exactly the right size.  This avoids growing the output
+   * buffer, which copies the data written so far and leaves the smaller
+   * buffers behind in the arena, at the cost of visiting the message twice.
+   * It pays off for large messages, especially with a fresh arena.  The
+   * output is the same as without this option.
+   *
+   * The sizes are kept in a side table that is malloc()ed and free()d during
+   * the encode.
+   */
+  kUpb_EncodeOption_PrecomputeSizes = 8,
 };
 
 // LINT.IfChange
@@ -48,6 +64,9 @@ typedef enum {
 
   // kUpb_EncodeOption_CheckRequired failed but the parse otherwise succeeded.
   kUpb_EncodeStatus_MissingRequired = 3,
+
+  // The output stream of upb_EncodeToStream() failed to provide a buffer.
+  kUpb_EncodeStatus_StreamError = 4,
 } upb_EncodeStatus;
 // LINT.ThenChange(//depot/google3/third_party/protobuf/rust/upb.rs:encode_status)
 
@@ -75,6 +94,19 @@ UPB_API upb_EncodeStatus upb_EncodeLengthPrefixed(const upb_Message* msg,
                                                   const upb_MiniTable* l,
                                                   int options, upb_Arena* arena,
                                                   char** buf, size_t* size);
+// Encodes the message into the buffers of `output`, asking it for a new one
+// whenever the last one is full, so that the encoding never needs to be held
+// in memory all at once.  The output is the same as that of upb_Encode().
+//
+// This is always a two-pass encode (kUpb_EncodeOption_PrecomputeSizes), which
+// checks the whole message before writing anything: on any error other than
+// kUpb_EncodeStatus_StreamError, nothing is written to the stream.  If the
+// stream fails, it holds a prefix of the encoding.
+UPB_API upb_EncodeStatus upb_EncodeToStream(const upb_Message* msg,
+                                            const upb_MiniTable* l,
+                                            int options,
+                                            upb_ZeroCopyOutputStream* output);
+
 // Utility function for wrapper languages to get an error string from a
 // upb_EncodeStatus.
 UPB_API const char* upb_EncodeStatus_String(upb_EncodeStatus status);
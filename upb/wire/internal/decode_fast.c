@@ -17,10 +17,20 @@
 
 #include "upb/wire/internal/decode_fast.h"
 
+#include "upb/base/descriptor_constants.h"
 #include "upb/message/array.h"
 #include "upb/message/internal/array.h"
+#include "upb/message/internal/extension.h"
+#include "upb/message/internal/map_entry.h"
+#include "upb/message/map.h"
+#include "upb/mini_table/enum.h"
+#include "upb/mini_table/extension.h"
+#include "upb/mini_table/extension_registry.h"
+#include "upb/mini_table/field.h"
+#include "upb/mini_table/internal/message.h"
 #include "upb/mini_table/sub.h"
 #include "upb/wire/internal/decoder.h"
+#include "upb/wire/types.h"
 
 // Must be last.
 #include "upb/port/def.inc"
@@ -79,12 +89,17 @@ const char* fastdecode_dispatch(UPB_PARSE_PARAMS) {
   UPB_MUSTTAIL return _upb_FastDecoder_TagDispatch(UPB_PARSE_ARGS);
 }
 
+// For three-byte tags, `data` holds the first two bytes of the expected tag in
+// its low bits (where dispatch XORs them with the actual tag), and the third
+// byte in bits 32-39, which are otherwise only used by oneofs.
 UPB_FORCEINLINE
-bool fastdecode_checktag(uint16_t data, int tagbytes) {
+bool fastdecode_checktag(uint64_t data, const char* ptr, int tagbytes) {
   if (tagbytes == 1) {
     return (data & 0xff) == 0;
+  } else if (tagbytes == 2) {
+    return (uint16_t)data == 0;
   } else {
-    return data == 0;
+    return (uint16_t)data == 0 && (uint8_t)ptr[2] == (uint8_t)(data >> 32);
   }
 }
 
@@ -181,11 +196,15 @@ void* fastdecode_resizearr(upb_Decoder* d, void* dst, fastdecode_arr* farr,
 }
 
 UPB_FORCEINLINE
-bool fastdecode_tagmatch(uint32_t tag, uint64_t data, int tagbytes) {
+bool fastdecode_tagmatch(uint32_t tag, uint64_t data, const char* ptr,
+                         int tagbytes) {
   if (tagbytes == 1) {
     return (uint8_t)tag == (uint8_t)data;
-  } else {
+  } else if (tagbytes == 2) {
     return (uint16_t)tag == (uint16_t)data;
+  } else {
+    return (uint16_t)tag == (uint16_t)data &&
+           (uint8_t)ptr[2] == (uint8_t)(data >> 32);
   }
 }
 
@@ -206,7 +225,7 @@ fastdecode_nextret fastdecode_nextrepeated(upb_Decoder* d, void* dst,
 
   if (UPB_LIKELY(!_upb_Decoder_IsDone(d, ptr))) {
     ret.tag = _upb_FastDecoder_LoadTag(*ptr);
-    if (fastdecode_tagmatch(ret.tag, data, tagbytes)) {
+    if (fastdecode_tagmatch(ret.tag, data, *ptr, tagbytes)) {
       ret.next = FD_NEXT_SAMEFIELD;
     } else {
       fastdecode_commitarr(dst, farr, valbytes);
@@ -261,7 +280,8 @@ void* fastdecode_getfield(upb_Decoder* d, const char* ptr, upb_Message* msg,
       }
       begin = upb_Array_MutableDataPtr(farr->arr);
       farr->end = begin + (farr->arr->UPB_PRIVATE(capacity) * valbytes);
-      *data = _upb_FastDecoder_LoadTag(ptr);
+      // Keep the third byte of three-byte tags for fastdecode_tagmatch().
+      *data = _upb_FastDecoder_LoadTag(ptr) | (*data & (0xffull << 32));
       return begin + (farr->arr->UPB_PRIVATE(size) * valbytes);
     }
     default:
@@ -270,17 +290,17 @@ void* fastdecode_getfield(upb_Decoder* d, const char* ptr, upb_Message* msg,
 }
 
 UPB_FORCEINLINE
-bool fastdecode_flippacked(uint64_t* data, int tagbytes) {
+bool fastdecode_flippacked(uint64_t* data, const char* ptr, int tagbytes) {
   *data ^= (0x2 ^ 0x0);  // Patch data to match packed wiretype.
-  return fastdecode_checktag(*data, tagbytes);
+  return fastdecode_checktag(*data, ptr, tagbytes);
 }
 
-#define FASTDECODE_CHECKPACKED(tagbytes, card, func)                \
-  if (UPB_UNLIKELY(!fastdecode_checktag(data, tagbytes))) {         \
-    if (card == CARD_r && fastdecode_flippacked(&data, tagbytes)) { \
-      UPB_MUSTTAIL return func(UPB_PARSE_ARGS);                     \
-    }                                                               \
-    RETURN_GENERIC("packed check tag mismatch\n");                  \
+#define FASTDECODE_CHECKPACKED(tagbytes, card, func)                     \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, ptr, tagbytes))) {         \
+    if (card == CARD_r && fastdecode_flippacked(&data, ptr, tagbytes)) { \
+      UPB_MUSTTAIL return func(UPB_PARSE_ARGS);                          \
+    }                                                                    \
+    RETURN_GENERIC("packed check tag mismatch\n");                       \
   }
 
 /* varint fields **************************************************************/
@@ -433,7 +453,8 @@ const char* fastdecode_topackedvarint(upb_EpsCopyInputStream* e,
 #define v_ZZ false
 
 /* Generate all combinations:
- * {s,o,r,p} x {b1,v4,z4,v8,z8} x {1bt,2bt} */
+ * {s,o,r,p} x {b1,v4,z4,v8,z8} x {1bt,2bt}
+ * {s,r,p} x {b1,v4,z4,v8,z8} x {3bt} */
 
 #define F(card, type, valbytes, tagbytes)                                      \
   UPB_NOINLINE                                                                 \
@@ -459,6 +480,9 @@ TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
 TAGBYTES(p)
+TYPES(s, 3)
+TYPES(r, 3)
+TYPES(p, 3)
 
 #undef z_ZZ
 #undef b_ZZ
@@ -473,6 +497,102 @@ TAGBYTES(p)
 #undef FASTDECODE_PACKEDVARINT
 #undef FASTDECODE_VARINT
 
+/* closed enum fields *********************************************************/
+
+UPB_FORCEINLINE
+const upb_MiniTableEnum* fastdecode_enumtable(intptr_t table, uint64_t data) {
+  const upb_MiniTable* tablep = decode_totablep(table);
+  uint32_t sub_idx = (data >> 16) & 0xff;
+  return tablep->UPB_PRIVATE(subs)[sub_idx].UPB_PRIVATE(subenum);
+}
+
+// Values that a closed enum does not declare must be stored as unknown fields,
+// which the generic parser takes care of.  So each value is decoded and checked
+// before anything is stored, while `ptr` still points at its tag.  Packed
+// closed enums are left to the generic parser entirely.
+#define FASTDECODE_ENUM(d, ptr, msg, table, hasbits, data, tagbytes, card)     \
+  uint64_t val;                                                                \
+  const char* next;                                                            \
+  void* dst;                                                                   \
+  fastdecode_arr farr;                                                         \
+  const upb_MiniTableEnum* e;                                                  \
+                                                                               \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, ptr, tagbytes))) {               \
+    RETURN_GENERIC("enum field tag mismatch\n");                               \
+  }                                                                            \
+                                                                               \
+  e = fastdecode_enumtable(table, data);                                       \
+  next = fastdecode_varint64(ptr + tagbytes, &val);                            \
+  if (next == NULL) _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed); \
+  if (UPB_UNLIKELY(!upb_MiniTableEnum_CheckValue(e, (uint32_t)val))) {         \
+    RETURN_GENERIC("unknown enum value\n");                                    \
+  }                                                                            \
+                                                                               \
+  dst = fastdecode_getfield(d, ptr, msg, &data, &hasbits, &farr, 4, card);     \
+  if (card == CARD_r) {                                                        \
+    if (UPB_UNLIKELY(!dst)) {                                                  \
+      RETURN_GENERIC("need array resize\n");                                   \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  again:                                                                       \
+  if (card == CARD_r) {                                                        \
+    dst = fastdecode_resizearr(d, dst, &farr, 4);                              \
+  }                                                                            \
+                                                                               \
+  ptr = next;                                                                  \
+  memcpy(dst, &val, 4);                                                        \
+                                                                               \
+  if (card == CARD_r) {                                                        \
+    fastdecode_nextret ret =                                                   \
+        fastdecode_nextrepeated(d, dst, &ptr, &farr, data, tagbytes, 4);       \
+    switch (ret.next) {                                                        \
+      case FD_NEXT_SAMEFIELD:                                                  \
+        next = fastdecode_varint64(ptr + tagbytes, &val);                      \
+        if (next == NULL) {                                                    \
+          _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);           \
+        }                                                                      \
+        if (UPB_UNLIKELY(!upb_MiniTableEnum_CheckValue(e, (uint32_t)val))) {   \
+          fastdecode_commitarr(ret.dst, &farr, 4);                             \
+          RETURN_GENERIC("unknown enum value\n");                              \
+        }                                                                      \
+        dst = ret.dst;                                                         \
+        goto again;                                                            \
+      case FD_NEXT_OTHERFIELD:                                                 \
+        data = ret.tag;                                                        \
+        UPB_MUSTTAIL return _upb_FastDecoder_TagDispatch(UPB_PARSE_ARGS);      \
+      case FD_NEXT_ATLIMIT:                                                    \
+        return ptr;                                                            \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  UPB_MUSTTAIL return fastdecode_dispatch(UPB_PARSE_ARGS);
+
+/* Generate all combinations:
+ * {s,o,r} x {e4} x {1bt,2bt}
+ * {s,r} x {e4} x {3bt} */
+
+#define F(card, tagbytes)                                        \
+  UPB_NOINLINE                                                   \
+  const char* upb_p##card##e4_##tagbytes##bt(UPB_PARSE_PARAMS) { \
+    FASTDECODE_ENUM(d, ptr, msg, table, hasbits, data, tagbytes, \
+                    CARD_##card);                                \
+  }
+
+#define TAGBYTES(card) \
+  F(card, 1)           \
+  F(card, 2)
+
+TAGBYTES(s)
+TAGBYTES(o)
+TAGBYTES(r)
+F(s, 3)
+F(r, 3)
+
+#undef F
+#undef TAGBYTES
+#undef FASTDECODE_ENUM
+
 /* fixed fields ***************************************************************/
 
 #define FASTDECODE_UNPACKEDFIXED(d, ptr, msg, table, hasbits, data, tagbytes, \
@@ -566,7 +686,8 @@ TAGBYTES(p)
   }
 
 /* Generate all combinations:
- * {s,o,r,p} x {f4,f8} x {1bt,2bt} */
+ * {s,o,r,p} x {f4,f8} x {1bt,2bt}
+ * {s,r,p} x {f4,f8} x {3bt} */
 
 #define F(card, valbytes, tagbytes)                                         \
   UPB_NOINLINE                                                              \
@@ -588,6 +709,9 @@ TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
 TAGBYTES(p)
+TYPES(s, 3)
+TYPES(r, 3)
+TYPES(p, 3)
 
 #undef F
 #undef TYPES
@@ -679,7 +803,7 @@ void fastdecode_docopy(upb_Decoder* d, const char* ptr, uint32_t size, int copy,
   char* buf;                                                                   \
                                                                                \
   UPB_ASSERT(!upb_EpsCopyInputStream_AliasingAvailable(&d->input, ptr, 0));    \
-  UPB_ASSERT(fastdecode_checktag(data, tagbytes));                             \
+  UPB_ASSERT(fastdecode_checktag(data, ptr, tagbytes));                        \
                                                                                \
   dst = fastdecode_getfield(d, ptr, msg, &data, &hasbits, &farr,               \
                             sizeof(upb_StringView), card);                     \
@@ -762,7 +886,7 @@ void fastdecode_docopy(upb_Decoder* d, const char* ptr, uint32_t size, int copy,
   fastdecode_arr farr;                                                        \
   int64_t size;                                                               \
                                                                               \
-  if (UPB_UNLIKELY(!fastdecode_checktag(data, tagbytes))) {                   \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, ptr, tagbytes))) {              \
     RETURN_GENERIC("string field tag mismatch\n");                            \
   }                                                                           \
                                                                               \
@@ -826,7 +950,8 @@ void fastdecode_docopy(upb_Decoder* d, const char* ptr, uint32_t size, int copy,
   UPB_MUSTTAIL return fastdecode_dispatch(UPB_PARSE_ARGS);
 
 /* Generate all combinations:
- * {p,c} x {s,o,r} x {s, b} x {1bt,2bt} */
+ * {p,c} x {s,o,r} x {s, b} x {1bt,2bt}
+ * {p,c} x {s,r} x {s, b} x {3bt} */
 
 #define s_VALIDATE true
 #define b_VALIDATE false
@@ -854,6 +979,8 @@ void fastdecode_docopy(upb_Decoder* d, const char* ptr, uint32_t size, int copy,
 TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
+UTF8(s, 3)
+UTF8(r, 3)
 
 #undef s_VALIDATE
 #undef b_VALIDATE
@@ -903,7 +1030,7 @@ const char* fastdecode_tosubmsg(upb_EpsCopyInputStream* e, const char* ptr,
 #define FASTDECODE_SUBMSG(d, ptr, msg, table, hasbits, data, tagbytes,    \
                           msg_ceil_bytes, card)                           \
                                                                           \
-  if (UPB_UNLIKELY(!fastdecode_checktag(data, tagbytes))) {               \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, ptr, tagbytes))) {          \
     RETURN_GENERIC("submessage field tag mismatch\n");                    \
   }                                                                       \
                                                                           \
@@ -914,8 +1041,8 @@ const char* fastdecode_tosubmsg(upb_EpsCopyInputStream* e, const char* ptr,
   upb_Message** dst;                                                      \
   uint32_t submsg_idx = (data >> 16) & 0xff;                              \
   const upb_MiniTable* tablep = decode_totablep(table);                   \
-  const upb_MiniTable* subtablep = upb_MiniTableSub_Message(              \
-      *UPB_PRIVATE(_upb_MiniTable_GetSubByIndex)(tablep, submsg_idx));    \
+  const upb_MiniTable* subtablep =                                        \
+      UPB_PRIVATE(_upb_MiniTable_GetSubTableByIndex)(tablep, submsg_idx); \
   fastdecode_submsgdata submsg = {decode_totable(subtablep)};             \
   fastdecode_arr farr;                                                    \
                                                                           \
@@ -924,6 +1051,14 @@ const char* fastdecode_tosubmsg(upb_EpsCopyInputStream* e, const char* ptr,
     RETURN_GENERIC("submessage doesn't have fast tables.");               \
   }                                                                       \
                                                                           \
+  if (card == CARD_o) {                                                   \
+    uint16_t case_ofs = data >> 32;                                       \
+    if (*UPB_PTR_AT(msg, case_ofs, uint32_t) != (uint8_t)(data >> 24)) {  \
+      /* The field holds another member of the oneof, if anything. */     \
+      *(upb_Message**)fastdecode_fieldmem(msg, data) = NULL;              \
+    }                                                                     \
+  }                                                                       \
+                                                                          \
   dst = fastdecode_getfield(d, ptr, msg, &data, &hasbits, &farr,          \
                             sizeof(upb_Message*), card);                  \
                                                                           \
@@ -991,10 +1126,177 @@ const char* fastdecode_tosubmsg(upb_EpsCopyInputStream* e, const char* ptr,
 TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
+SIZES(s, 3)
+SIZES(r, 3)
 
 #undef TAGBYTES
 #undef SIZES
 #undef F
 #undef FASTDECODE_SUBMSG
 
+/* map fields *****************************************************************/
+
+// Returns the field number of the expected tag, which starts at `ptr`.
+UPB_FORCEINLINE
+uint32_t fastdecode_fieldnumber(const char* ptr, int tagbytes) {
+  uint32_t tag = (uint8_t)ptr[0] & 0x7f;
+  if (tagbytes > 1) tag |= (uint32_t)((uint8_t)ptr[1] & 0x7f) << 7;
+  if (tagbytes > 2) tag |= (uint32_t)(uint8_t)ptr[2] << 14;
+  return tag >> 3;
+}
+
+// Each entry is parsed into a upb_MapEntry on the stack through the entry's
+// own fast table, as _upb_Decoder_DecodeToMap() does, and then inserted into
+// the map.  Consecutive entries of the same map are parsed in a loop.
+#define FASTDECODE_MAPENTRY(d, ptr, msg, table, hasbits, data, tagbytes)    \
+                                                                            \
+  if (UPB_UNLIKELY(!fastdecode_checktag(data, ptr, tagbytes))) {            \
+    RETURN_GENERIC("map field tag mismatch\n");                             \
+  }                                                                         \
+                                                                            \
+  if (--d->depth == 0) {                                                    \
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_MaxDepthExceeded);       \
+  }                                                                         \
+                                                                            \
+  uint32_t entry_idx = (data >> 16) & 0xff;                                 \
+  const upb_MiniTable* tablep = decode_totablep(table);                     \
+  const upb_MiniTable* entryp =                                             \
+      UPB_PRIVATE(_upb_MiniTable_GetSubTableByIndex)(tablep, entry_idx);    \
+                                                                            \
+  if (entryp->UPB_PRIVATE(table_mask) == (uint8_t)-1) {                     \
+    d->depth++;                                                             \
+    RETURN_GENERIC("map entry doesn't have fast tables.");                  \
+  }                                                                         \
+                                                                            \
+  UPB_ASSERT(!upb_Message_IsFrozen(msg));                                   \
+  upb_Map** map_p = fastdecode_fieldmem(msg, data);                         \
+  upb_Map* map = *map_p;                                                    \
+  if (UPB_UNLIKELY(!map)) {                                                 \
+    *map_p = map = _upb_Decoder_CreateMap(d, entryp);                       \
+  }                                                                         \
+                                                                            \
+  uint32_t field_number = fastdecode_fieldnumber(ptr, tagbytes);            \
+  /* Keep the third byte of three-byte tags for fastdecode_tagmatch(). */   \
+  data = _upb_FastDecoder_LoadTag(ptr) | (data & (0xffull << 32));          \
+                                                                            \
+  again:;                                                                   \
+  upb_MapEntry ent;                                                         \
+  _upb_Decoder_InitMapEntry(d, entryp, &ent);                               \
+  fastdecode_submsgdata submsg = {decode_totable(entryp), &ent.message};    \
+                                                                            \
+  ptr += tagbytes;                                                          \
+  ptr = fastdecode_delimited(d, ptr, fastdecode_tosubmsg, &submsg);         \
+                                                                            \
+  if (UPB_UNLIKELY(ptr == NULL || d->end_group != DECODE_NOGROUP)) {        \
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);              \
+  }                                                                         \
+                                                                            \
+  _upb_Decoder_InsertMapEntry(d, msg, map, entryp, field_number, &ent);     \
+                                                                            \
+  if (UPB_LIKELY(!_upb_Decoder_IsDone(d, &ptr)) &&                          \
+      fastdecode_tagmatch(_upb_FastDecoder_LoadTag(ptr), data, ptr,         \
+                          tagbytes)) {                                      \
+    goto again;                                                             \
+  }                                                                         \
+                                                                            \
+  d->depth++;                                                               \
+  UPB_MUSTTAIL return fastdecode_dispatch(UPB_PARSE_ARGS);
+
+#define F(tagbytes)                                                 \
+  const char* upb_pmm_##tagbytes##bt(UPB_PARSE_PARAMS) {            \
+    FASTDECODE_MAPENTRY(d, ptr, msg, table, hasbits, data, tagbytes); \
+  }
+
+F(1)
+F(2)
+F(3)
+
+#undef F
+#undef FASTDECODE_MAPENTRY
+
+/* extensions *****************************************************************/
+
+const char* _upb_FastDecoder_DecodeExtension(UPB_PARSE_PARAMS) {
+  // These slots have no expected tag, so `data` is just the tag as read.
+  uint32_t tag = (uint8_t)data;
+  int tagbytes = 1;
+  if (tag & 0x80) {
+    uint32_t byte = (uint8_t)(data >> 8);
+    // Three-byte tags do not fit in the table's extension slots.
+    if (byte & 0x80) RETURN_GENERIC("extension tag too long\n");
+    tag = (tag & 0x7f) | (byte << 7);
+    tagbytes = 2;
+  }
+
+  if (!d->extreg) RETURN_GENERIC("no extension registry\n");
+  const upb_MiniTableExtension* ext = upb_ExtensionRegistry_Lookup(
+      d->extreg, decode_totablep(table), tag >> 3);
+  if (!ext) RETURN_GENERIC("unknown field\n");
+
+  const upb_MiniTableField* f = &ext->UPB_PRIVATE(field);
+  if (!upb_MiniTableField_IsScalar(f)) RETURN_GENERIC("repeated extension\n");
+
+  int wire_type;
+  int valbytes;
+  bool zigzag = false;
+  switch (f->UPB_PRIVATE(descriptortype)) {
+    case kUpb_FieldType_Bool:
+      wire_type = kUpb_WireType_Varint;
+      valbytes = 1;
+      break;
+    case kUpb_FieldType_SInt32:
+      zigzag = true;
+      /* fallthrough */
+    case kUpb_FieldType_Int32:
+    case kUpb_FieldType_UInt32:
+      wire_type = kUpb_WireType_Varint;
+      valbytes = 4;
+      break;
+    case kUpb_FieldType_SInt64:
+      zigzag = true;
+      /* fallthrough */
+    case kUpb_FieldType_Int64:
+    case kUpb_FieldType_UInt64:
+      wire_type = kUpb_WireType_Varint;
+      valbytes = 8;
+      break;
+    case kUpb_FieldType_Fixed32:
+    case kUpb_FieldType_SFixed32:
+    case kUpb_FieldType_Float:
+      wire_type = kUpb_WireType_32Bit;
+      valbytes = 4;
+      break;
+    case kUpb_FieldType_Fixed64:
+    case kUpb_FieldType_SFixed64:
+    case kUpb_FieldType_Double:
+      wire_type = kUpb_WireType_64Bit;
+      valbytes = 8;
+      break;
+    default:
+      // Closed enums, strings and sub-messages.
+      RETURN_GENERIC("extension type not handled\n");
+  }
+  if ((int)(tag & 7) != wire_type) RETURN_GENERIC("extension wire type\n");
+
+  upb_Extension* ext_val =
+      UPB_PRIVATE(_upb_Message_GetOrCreateExtension)(msg, ext, &d->arena);
+  if (UPB_UNLIKELY(!ext_val)) {
+    _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_OutOfMemory);
+  }
+
+  ptr += tagbytes;
+  if (wire_type == kUpb_WireType_Varint) {
+    uint64_t val;
+    ptr = fastdecode_varint64(ptr, &val);
+    if (ptr == NULL) _upb_FastDecoder_ErrorJmp(d, kUpb_DecodeStatus_Malformed);
+    val = fastdecode_munge(val, valbytes, zigzag);
+    memcpy(&ext_val->data, &val, valbytes);
+  } else {
+    memcpy(&ext_val->data, ptr, valbytes);
+    ptr += valbytes;
+  }
+
+  UPB_MUSTTAIL return fastdecode_dispatch(UPB_PARSE_ARGS);
+}
+
 #endif /* UPB_FASTTABLE */
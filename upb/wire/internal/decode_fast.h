@@ -22,6 +22,8 @@
 //   - 'o' for oneof
 //   - 'r' for non-packed repeated
 //   - 'p' for packed repeated
+//   - 'm' for map, whose type is always 'm' (the map entry) and whose
+//     function names have no size ceiling, as entries are parsed on the stack
 //
 // In position 3 (type):
 //   - 'b1' for bool
@@ -31,13 +33,15 @@
 //   - 'z8' for zig-zag-encoded 8-byte varint
 //   - 'f4' for 4-byte fixed
 //   - 'f8' for 8-byte fixed
+//   - 'e4' for closed enum (4-byte varint, checked against the enum)
 //   - 'm' for sub-message
 //   - 's' for string (validate UTF-8)
 //   - 'b' for bytes
 //
 // In position 4 (tag length):
 //   - '1' for one-byte tags (field numbers 1-15)
-//   - '2' for two-byte tags (field numbers 16-2048)
+//   - '2' for two-byte tags (field numbers 16-2047)
+//   - '3' for three-byte tags (field numbers 2048-262143), except for oneofs
 
 #ifndef UPB_WIRE_INTERNAL_DECODE_FAST_H_
 #define UPB_WIRE_INTERNAL_DECODE_FAST_H_
@@ -60,6 +64,15 @@ const char* _upb_FastDecoder_DecodeGeneric(struct upb_Decoder* d,
                                            intptr_t table, uint64_t hasbits,
                                            uint64_t data);
 
+// Fills the otherwise unused slots of extendable messages that extension
+// tags map to.  Looks the extension up in the decoder's registry and parses
+// singular numeric extensions directly, falling back to the generic parser
+// for anything else.
+const char* _upb_FastDecoder_DecodeExtension(struct upb_Decoder* d,
+                                             const char* ptr, upb_Message* msg,
+                                             intptr_t table, uint64_t hasbits,
+                                             uint64_t data);
+
 #define UPB_PARSE_PARAMS                                                    \
   struct upb_Decoder *d, const char *ptr, upb_Message *msg, intptr_t table, \
       uint64_t hasbits, uint64_t data
@@ -86,11 +99,32 @@ TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
 TAGBYTES(p)
+TYPES(s, 3)
+TYPES(r, 3)
+TYPES(p, 3)
 
 #undef F
 #undef TYPES
 #undef TAGBYTES
 
+/* closed enum fields *********************************************************/
+
+#define F(card, tagbytes) \
+  const char* upb_p##card##e4_##tagbytes##bt(UPB_PARSE_PARAMS);
+
+#define TAGBYTES(card) \
+  F(card, 1)           \
+  F(card, 2)
+
+TAGBYTES(s)
+TAGBYTES(o)
+TAGBYTES(r)
+F(s, 3)
+F(r, 3)
+
+#undef F
+#undef TAGBYTES
+
 /* string fields **************************************************************/
 
 #define F(card, tagbytes, type)                                     \
@@ -108,6 +142,8 @@ TAGBYTES(p)
 TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
+UTF8(s, 3)
+UTF8(r, 3)
 
 #undef F
 #undef UTF8
@@ -132,11 +168,23 @@ TAGBYTES(r)
 TAGBYTES(s)
 TAGBYTES(o)
 TAGBYTES(r)
+SIZES(s, 3)
+SIZES(r, 3)
 
 #undef F
 #undef SIZES
 #undef TAGBYTES
 
+/* map fields *****************************************************************/
+
+#define F(tagbytes) const char* upb_pmm_##tagbytes##bt(UPB_PARSE_PARAMS);
+
+F(1)
+F(2)
+F(3)
+
+#undef F
+
 #undef UPB_PARSE_PARAMS
 
 #ifdef __cplusplus
@@ -14,7 +14,10 @@
 #define UPB_WIRE_INTERNAL_DECODER_H_
 
 #include "upb/mem/internal/arena.h"
+#include "upb/message/internal/map_entry.h"
 #include "upb/message/internal/message.h"
+#include "upb/message/map.h"
+#include "upb/mini_table/message.h"
 #include "upb/wire/decode.h"
 #include "upb/wire/eps_copy_input_stream.h"
 #include "utf8_range.h"
@@ -66,6 +69,19 @@ const char* _upb_Decoder_CheckRequired(upb_Decoder* d, const char* ptr,
                                        const upb_Message* msg,
                                        const upb_MiniTable* m);
 
+// Map fields: decode.c and the fast decoder both parse each entry into a
+// stack upb_MapEntry that is set up by _upb_Decoder_InitMapEntry() and then
+// handed to _upb_Decoder_InsertMapEntry(), which adds it to `map` or, if the
+// entry had unknown fields, re-encodes it into the unknown fields of `msg`.
+upb_Map* _upb_Decoder_CreateMap(upb_Decoder* d, const upb_MiniTable* entry);
+
+void _upb_Decoder_InitMapEntry(upb_Decoder* d, const upb_MiniTable* entry,
+                               upb_MapEntry* ent);
+
+void _upb_Decoder_InsertMapEntry(upb_Decoder* d, upb_Message* msg,
+                                 upb_Map* map, const upb_MiniTable* entry,
+                                 uint32_t field_number, upb_MapEntry* ent);
+
 /* x86-64 pointers always have the high 16 bits matching. So we can shift
  * left 8 and right 8 without loss of information. */
 UPB_INLINE intptr_t decode_totable(const upb_MiniTable* tablep) {
@@ -0,0 +1,37 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2024 Google LLC.  All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef UPB_WIRE_INTERNAL_ENCODE_H_
+#define UPB_WIRE_INTERNAL_ENCODE_H_
+
+#include <stddef.h>
+
+#include "upb/message/message.h"
+#include "upb/mini_table/message.h"
+#include "upb/wire/encode.h"
+
+// Must be last.
+#include "upb/port/def.inc"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the size of `msg` encoded with `options`, which is computed without
+// encoding it, like the first pass of kUpb_EncodeOption_PrecomputeSizes does.
+// Returns 0 and sets `*status` on error.
+size_t UPB_PRIVATE(_upb_Encode_Size)(const upb_Message* msg,
+                                     const upb_MiniTable* l, int options,
+                                     upb_EncodeStatus* status);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#include "upb/port/undef.inc"
+
+#endif /* UPB_WIRE_INTERNAL_ENCODE_H_ */
@@ -20,6 +20,8 @@
 #include "upb/mini_table/field.h"
 #include "upb/mini_table/message.h"
 #include "upb/reflection/def.hpp"
+#include "upb/reflection/extension_range.h"
+#include "upb/reflection/message_def.h"
 #include "upb/wire/types.h"
 #include "upb_generator/file_layout.h"
 
@@ -110,8 +112,8 @@ uint64_t GetEncodedTag(upb::FieldDefPtr field) {
 
 int GetTableSlot(upb::FieldDefPtr field) {
   uint64_t tag = GetEncodedTag(field);
-  if (tag > 0x7fff) {
-    // Tag must fit within a two-byte varint.
+  if (tag > 0x7fffff) {
+    // Tag must fit within a three-byte varint.
     return -1;
   }
   return (tag & 0xf8) >> 3;
@@ -130,8 +132,11 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
       break;
     case kUpb_FieldType_Enum:
       if (upb_MiniTableField_IsClosedEnum(mt_f)) {
-        // We don't have the means to test proto2 enum fields for valid values.
-        return false;
+        // Unknown values of packed closed enums have to be moved to the
+        // unknown fields one by one, which only the generic parser does.
+        if (upb_MiniTableField_IsPacked(mt_f)) return false;
+        type = "e4";
+        break;
       }
       [[fallthrough]];
     case kUpb_FieldType_Int32:
@@ -176,10 +181,11 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
   } else if (upb_MiniTableField_IsScalar(mt_f)) {
     cardinality = upb_MiniTableField_IsInOneof(mt_f) ? "o" : "s";
   } else {
-    return false;  // Not supported yet (ever?).
+    cardinality = "m";
   }
 
   uint64_t expected_tag = GetEncodedTag(field);
+  int tag_bytes = expected_tag > 0xffff ? 3 : expected_tag > 0xff ? 2 : 1;
 
   // Data is:
   //
@@ -189,9 +195,13 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
   // |--------|--------|--------|--------|--------|--------|--------|--------|
   //
   // - |presence| is either hasbit index or field number for oneofs.
+  // - |submsg| is the index of the sub-message or closed enum table.
+  // - For three-byte tags, the third byte of the tag takes the place of the
+  //   case offset.  Oneof fields never have three-byte tags, as their field
+  //   number must fit in |presence|.
 
-  uint64_t data =
-      static_cast<uint64_t>(mt_f->UPB_PRIVATE(offset)) << 48 | expected_tag;
+  uint64_t data = static_cast<uint64_t>(mt_f->UPB_PRIVATE(offset)) << 48 |
+                  (expected_tag & 0xffff) | (expected_tag >> 16) << 32;
 
   if (field.IsSequence()) {
     // No hasbit/oneof-related fields.
@@ -204,17 +214,24 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
   } else {
     uint64_t hasbit_index = 63;  // No hasbit (set a high, unused bit).
     if (mt_f->presence) {
-      hasbit_index = mt_f->presence;
-      if (hasbit_index > 31) return false;
+      // The fast decoder accumulates the 32 hasbits that follow the upb_Message
+      // header, which start at hasbit 64, see fastdecode_dispatch().
+      if (mt_f->presence < 64 || mt_f->presence > 95) return false;
+      hasbit_index = mt_f->presence - 64;
     }
     data |= hasbit_index << 24;
   }
 
-  if (field.ctype() == kUpb_CType_Message) {
+  if (field.ctype() == kUpb_CType_Message || type == "e4") {
     uint64_t idx = mt_f->UPB_PRIVATE(submsg_index);
     if (idx > 255) return false;
     data |= idx << 16;
+  }
 
+  if (cardinality == "m") {
+    // Map entries are parsed on the stack, so there is no size ceiling.
+    ent.first = absl::Substitute("upb_pmm_$0bt", tag_bytes);
+  } else if (field.ctype() == kUpb_CType_Message) {
     std::string size_ceil = "max";
     size_t size = SIZE_MAX;
     if (field.message_type().file() == field.file()) {
@@ -233,16 +250,36 @@ bool TryFillTableEntry(const DefPoolPair& pools, upb::FieldDefPtr field,
       }
     }
     ent.first = absl::Substitute("upb_p$0$1_$2bt_max$3b", cardinality, type,
-                                 expected_tag > 0xff ? "2" : "1", size_ceil);
+                                 tag_bytes, size_ceil);
 
   } else {
-    ent.first = absl::Substitute("upb_p$0$1_$2bt", cardinality, type,
-                                 expected_tag > 0xff ? "2" : "1");
+    ent.first =
+        absl::Substitute("upb_p$0$1_$2bt", cardinality, type, tag_bytes);
   }
   ent.second = data;
   return true;
 }
 
+// Returns the table slots that tags of the message's extension ranges map to.
+// Three-byte tags are left to the generic parser.
+std::vector<int> ExtensionSlots(upb::MessageDefPtr message) {
+  std::vector<bool> used(32);
+  for (int i = 0; i < message.extension_range_count(); i++) {
+    const upb_ExtensionRange* r =
+        upb_MessageDef_ExtensionRange(message.ptr(), i);
+    int32_t end = std::min<int32_t>(upb_ExtensionRange_End(r), 2048);
+    for (int32_t number = upb_ExtensionRange_Start(r); number < end;
+         number++) {
+      used[number < 16 ? number : 16 + (number & 15)] = true;
+    }
+  }
+  std::vector<int> slots;
+  for (int slot = 0; slot < 32; slot++) {
+    if (used[slot]) slots.push_back(slot);
+  }
+  return slots;
+}
+
 }  // namespace
 
 std::vector<TableEntry> FastDecodeTable(upb::MessageDefPtr message,
@@ -270,6 +307,22 @@ std::vector<TableEntry> FastDecodeTable(upb::MessageDefPtr message,
     }
     table[slot] = ent;
   }
+
+  // Extensions are only known at runtime, so the slots their tags map to get a
+  // parser that looks them up in the decoder's extension registry.
+  // MessageSet items are groups and are left to the generic parser.
+  if (message.extension_range_count() > 0 &&
+      !UPB_DESC(MessageOptions_message_set_wire_format)(message.options())) {
+    for (int slot : ExtensionSlots(message)) {
+      while ((size_t)slot >= table.size()) {
+        size_t size = std::max(static_cast<size_t>(1), table.size() * 2);
+        table.resize(size, TableEntry{"_upb_FastDecoder_DecodeGeneric", 0});
+      }
+      if (table[slot].first == "_upb_FastDecoder_DecodeGeneric") {
+        table[slot] = TableEntry{"_upb_FastDecoder_DecodeExtension", 0};
+      }
+    }
+  }
   return table;
 }
 